@@ -26,8 +26,8 @@ static const KnownConstant KNOWN_CONSTANTS[] = {
     {"silver", 2.4142135623730950488}
 };
 
-static bool parse_values_csv(const Config *config, RunSummary *summary);
-static bool parse_events_csv(RunSummary *summary);
+static bool parse_values_csv(const Config *config, RunAnalyzer *analyzer);
+static bool parse_events_csv(RunAnalyzer *analyzer);
 
 void run_summary_init(RunSummary *summary) {
     rational_init(summary->final_ratio);
@@ -91,13 +91,14 @@ void run_summary_copy(RunSummary *dest, const RunSummary *src) {
 }
 
 bool analyze_latest_run(const Config *config, RunSummary *summary) {
-    if (!parse_values_csv(config, summary)) {
-        return false;
-    }
-    if (!parse_events_csv(summary)) {
-        return false;
+    RunAnalyzer analyzer;
+    run_analyzer_init(&analyzer, summary);
+    bool ok = parse_values_csv(config, &analyzer) && parse_events_csv(&analyzer);
+    if (ok) {
+        run_analyzer_finish(&analyzer);
     }
-    return true;
+    run_analyzer_clear(&analyzer);
+    return ok;
 }
 
 bool simulate_and_analyze(const Config *config, RunSummary *summary) {
@@ -105,6 +106,22 @@ bool simulate_and_analyze(const Config *config, RunSummary *summary) {
     return analyze_latest_run(config, summary);
 }
 
+bool simulate_and_analyze_batched(const Config *config, const char *events_path,
+                                  const char *values_path, RunSummary *summary,
+                                  BatchOutput *batch) {
+    RunAnalyzer analyzer;
+    run_analyzer_init(&analyzer, summary);
+    SimulateFiles files = {events_path, values_path, NULL, batch};
+    bool ok = simulate_resumable(config, &files, run_analyzer_observer, &analyzer, NULL, false) ==
+              SIMULATE_COMPLETED;
+    // simulate_resumable() reports its own failures.
+    if (ok) {
+        run_analyzer_finish(&analyzer);
+    }
+    run_analyzer_clear(&analyzer);
+    return ok;
+}
+
 const char *analysis_psi_type_label(const Config *config) {
     return config->triple_psi_mode ? "3-way" : "2-way";
 }
@@ -182,198 +199,197 @@ static void determine_pattern(RunSummary *summary, bool ratio_defined, bool dive
     }
 }
 
-static bool parse_values_csv(const Config *config, RunSummary *summary) {
-    (void)config;
-    FILE *file = fopen("values.csv", "r");
-    if (!file) {
-        return false;
-    }
-
-    char line[4096];
-    if (!fgets(line, sizeof(line), file)) {
-        fclose(file);
-        return false;
-    }
-
-    mpq_t upsilon;
-    mpq_t beta;
-    mpq_t ratio;
-    rational_init(upsilon);
-    rational_init(beta);
-    rational_init(ratio);
-
-    mpz_t abs_num;
-    mpz_t abs_den;
-    mpz_t max_mag_num;
-    mpz_t max_mag_den;
-    mpz_init(abs_num);
-    mpz_init(abs_den);
-    mpz_init(max_mag_num);
-    mpz_init(max_mag_den);
-    mpz_set_ui(max_mag_num, 0UL);
-    mpz_set_ui(max_mag_den, 0UL);
-
-    size_t stack_sum = 0U;
-    double ratio_mean = 0.0;
-    double ratio_m2 = 0.0;
-    size_t ratio_count = 0U;
-    double ratio_min = 0.0;
-    double ratio_max = 0.0;
-    double previous_ratio = 0.0;
-    bool have_previous_ratio = false;
-    double max_delta = 0.0;
-    size_t sign_changes = 0U;
-
-    double best_delta = INFINITY;
-    size_t best_constant_index = SIZE_MAX;
+void run_analyzer_init(RunAnalyzer *analyzer, RunSummary *summary) {
+    analyzer->summary = summary;
+    rational_init(analyzer->upsilon);
+    rational_init(analyzer->beta);
+    rational_init(analyzer->ratio);
+    mpz_init(analyzer->abs_value);
+    mpz_init_set_ui(analyzer->max_mag_num, 0UL);
+    mpz_init_set_ui(analyzer->max_mag_den, 0UL);
+    analyzer->stack_sum = 0U;
+    analyzer->ratio_mean = 0.0;
+    analyzer->ratio_m2 = 0.0;
+    analyzer->ratio_count = 0U;
+    analyzer->ratio_min = 0.0;
+    analyzer->ratio_max = 0.0;
+    analyzer->previous_ratio = 0.0;
+    analyzer->have_previous_ratio = false;
+    analyzer->max_delta = 0.0;
+    analyzer->sign_changes = 0U;
+    analyzer->best_delta = INFINITY;
+    analyzer->best_constant_index = SIZE_MAX;
+    analyzer->last_psi_index = 0U;
+    analyzer->have_last_psi = false;
+    analyzer->spacing_mean = 0.0;
+    analyzer->spacing_m2 = 0.0;
+    analyzer->spacing_count = 0U;
 
     summary->ratio_defined = false;
     summary->total_samples = 0U;
     summary->total_ticks = 0U;
+    summary->psi_events = 0U;
+    summary->rho_events = 0U;
+    summary->mu_zero_events = 0U;
+}
 
-    while (fgets(line, sizeof(line), file)) {
-        char *saveptr = NULL;
-        char *token = strtok_r(line, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        size_t tick = (size_t)strtoull(token, NULL, 10);
-        summary->total_ticks = tick;
+void run_analyzer_clear(RunAnalyzer *analyzer) {
+    rational_clear(analyzer->upsilon);
+    rational_clear(analyzer->beta);
+    rational_clear(analyzer->ratio);
+    mpz_clear(analyzer->abs_value);
+    mpz_clear(analyzer->max_mag_num);
+    mpz_clear(analyzer->max_mag_den);
+}
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        int microtick = atoi(token);
-        (void)microtick;
+static void track_magnitude(RunAnalyzer *analyzer, mpz_srcptr value, mpz_ptr maximum) {
+    mpz_abs(analyzer->abs_value, value);
+    if (mpz_cmp(analyzer->abs_value, maximum) > 0) {
+        mpz_set(maximum, analyzer->abs_value);
+    }
+}
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        mpz_set_str(mpq_numref(upsilon), token, 10);
+void run_analyzer_add_values(RunAnalyzer *analyzer, size_t tick, mpz_srcptr upsilon_num,
+                             mpz_srcptr upsilon_den, mpz_srcptr beta_num, mpz_srcptr beta_den,
+                             size_t stack_size) {
+    RunSummary *summary = analyzer->summary;
+    summary->total_ticks = tick;
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        mpz_set_str(mpq_denref(upsilon), token, 10);
+    // Copied as written; values.csv holds the same, uncanonicalised, pairs.
+    mpz_set(mpq_numref(analyzer->upsilon), upsilon_num);
+    mpz_set(mpq_denref(analyzer->upsilon), upsilon_den);
+    mpz_set(mpq_numref(analyzer->beta), beta_num);
+    mpz_set(mpq_denref(analyzer->beta), beta_den);
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        mpz_set_str(mpq_numref(beta), token, 10);
+    if (stack_size >= ARRAY_COUNT(summary->stack_histogram)) {
+        stack_size = ARRAY_COUNT(summary->stack_histogram) - 1U;
+    }
+    summary->stack_histogram[stack_size] += 1U;
+    analyzer->stack_sum += stack_size;
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
-            continue;
-        }
-        mpz_set_str(mpq_denref(beta), token, 10);
+    summary->total_samples += 1U;
 
-        unsigned long stack_size = 0UL;
-        for (int field_index = 6; field_index <= 22; ++field_index) {
-            token = strtok_r(NULL, ",", &saveptr);
-            if (!token) {
-                break;
-            }
-            if (field_index == 22) {
-                stack_size = strtoul(token, NULL, 10);
-            }
-        }
+    track_magnitude(analyzer, upsilon_num, analyzer->max_mag_num);
+    track_magnitude(analyzer, upsilon_den, analyzer->max_mag_den);
+    track_magnitude(analyzer, beta_num, analyzer->max_mag_num);
+    track_magnitude(analyzer, beta_den, analyzer->max_mag_den);
 
-        if (stack_size >= ARRAY_COUNT(summary->stack_histogram)) {
-            stack_size = ARRAY_COUNT(summary->stack_histogram) - 1U;
+    if (rational_is_zero(analyzer->beta)) {
+        return;
+    }
+    rational_div(analyzer->ratio, analyzer->upsilon, analyzer->beta);
+    summary->ratio_defined = true;
+    summary->final_ratio_snapshot = mpq_get_d(analyzer->ratio);
+    rational_set(summary->final_ratio, analyzer->ratio);
+
+    ++analyzer->ratio_count;
+    double snapshot = summary->final_ratio_snapshot;
+    if (analyzer->ratio_count == 1U) {
+        analyzer->ratio_min = snapshot;
+        analyzer->ratio_max = snapshot;
+    } else {
+        if (snapshot < analyzer->ratio_min) {
+            analyzer->ratio_min = snapshot;
+        }
+        if (snapshot > analyzer->ratio_max) {
+            analyzer->ratio_max = snapshot;
         }
-        summary->stack_histogram[stack_size] += 1U;
-        stack_sum += stack_size;
+    }
 
-        summary->total_samples += 1U;
+    double delta = snapshot - analyzer->ratio_mean;
+    analyzer->ratio_mean += delta / (double)analyzer->ratio_count;
+    double delta2 = snapshot - analyzer->ratio_mean;
+    analyzer->ratio_m2 += delta * delta2;
 
-        mpz_abs(abs_num, mpq_numref(upsilon));
-        if (mpz_cmp(abs_num, max_mag_num) > 0) {
-            mpz_set(max_mag_num, abs_num);
+    if (analyzer->have_previous_ratio) {
+        double diff = fabs(snapshot - analyzer->previous_ratio);
+        if (diff > analyzer->max_delta) {
+            analyzer->max_delta = diff;
         }
-
-        mpz_abs(abs_den, mpq_denref(upsilon));
-        if (mpz_cmp(abs_den, max_mag_den) > 0) {
-            mpz_set(max_mag_den, abs_den);
+        if ((snapshot > 0.0 && analyzer->previous_ratio < 0.0) ||
+            (snapshot < 0.0 && analyzer->previous_ratio > 0.0)) {
+            ++analyzer->sign_changes;
         }
+    }
+    analyzer->previous_ratio = snapshot;
+    analyzer->have_previous_ratio = true;
 
-        mpz_abs(abs_num, mpq_numref(beta));
-        if (mpz_cmp(abs_num, max_mag_num) > 0) {
-            mpz_set(max_mag_num, abs_num);
+    for (size_t i = 0; i < ARRAY_COUNT(KNOWN_CONSTANTS); ++i) {
+        double constant_delta = fabs(snapshot - KNOWN_CONSTANTS[i].value);
+        if (constant_delta < analyzer->best_delta) {
+            analyzer->best_delta = constant_delta;
+            analyzer->best_constant_index = i;
         }
-
-        mpz_abs(abs_den, mpq_denref(beta));
-        if (mpz_cmp(abs_den, max_mag_den) > 0) {
-            mpz_set(max_mag_den, abs_den);
+        if (constant_delta < 1e-5 && summary->convergence_tick == 0U) {
+            summary->convergence_tick = tick;
         }
+    }
+}
 
-        if (!rational_is_zero(beta)) {
-            rational_div(ratio, upsilon, beta);
-            summary->ratio_defined = true;
-            summary->final_ratio_snapshot = mpq_get_d(ratio);
-            rational_set(summary->final_ratio, ratio);
-            gmp_snprintf(summary->final_ratio_str, sizeof(summary->final_ratio_str), "%Zd/%Zd",
-                         mpq_numref(ratio), mpq_denref(ratio));
-
-            ++ratio_count;
-            double snapshot = summary->final_ratio_snapshot;
-            if (ratio_count == 1U) {
-                ratio_min = snapshot;
-                ratio_max = snapshot;
-            } else {
-                if (snapshot < ratio_min) {
-                    ratio_min = snapshot;
-                }
-                if (snapshot > ratio_max) {
-                    ratio_max = snapshot;
-                }
-            }
-
-            double delta = snapshot - ratio_mean;
-            ratio_mean += delta / (double)ratio_count;
-            double delta2 = snapshot - ratio_mean;
-            ratio_m2 += delta * delta2;
-
-            if (have_previous_ratio) {
-                double diff = fabs(snapshot - previous_ratio);
-                if (diff > max_delta) {
-                    max_delta = diff;
-                }
-                if ((snapshot > 0.0 && previous_ratio < 0.0) ||
-                    (snapshot < 0.0 && previous_ratio > 0.0)) {
-                    ++sign_changes;
-                }
-            }
-            previous_ratio = snapshot;
-            have_previous_ratio = true;
-
-            for (size_t i = 0; i < ARRAY_COUNT(KNOWN_CONSTANTS); ++i) {
-                double constant_delta = fabs(snapshot - KNOWN_CONSTANTS[i].value);
-                if (constant_delta < best_delta) {
-                    best_delta = constant_delta;
-                    best_constant_index = i;
-                }
-                if (constant_delta < 1e-5 && summary->convergence_tick == 0U) {
-                    summary->convergence_tick = tick;
-                }
-            }
+void run_analyzer_add_events(RunAnalyzer *analyzer, size_t tick, int microtick, bool rho_event,
+                             bool psi_fired, bool mu_zero) {
+    RunSummary *summary = analyzer->summary;
+    if (rho_event) {
+        ++summary->rho_events;
+    }
+    if (psi_fired) {
+        ++summary->psi_events;
+        size_t current_index = (tick - 1U) * 11U + (size_t)microtick;
+        if (analyzer->have_last_psi) {
+            double spacing = (double)(current_index - analyzer->last_psi_index);
+            ++analyzer->spacing_count;
+            double delta = spacing - analyzer->spacing_mean;
+            analyzer->spacing_mean += delta / (double)analyzer->spacing_count;
+            double delta2 = spacing - analyzer->spacing_mean;
+            analyzer->spacing_m2 += delta * delta2;
         }
+        analyzer->last_psi_index = current_index;
+        analyzer->have_last_psi = true;
+    }
+    if (mu_zero) {
+        ++summary->mu_zero_events;
     }
+}
 
-    fclose(file);
+void run_analyzer_add_row(RunAnalyzer *analyzer, const TraceRow *row) {
+    run_analyzer_add_values(analyzer, row->tick, row->components[0], row->components[1],
+                            row->components[2], row->components[3], row->koppa_stack_size);
+    run_analyzer_add_events(analyzer, row->tick, row->microtick,
+                            (row->flags & TRACE_FLAG_RHO_EVENT) != 0U,
+                            (row->flags & TRACE_FLAG_PSI_FIRED) != 0U,
+                            (row->flags & TRACE_FLAG_MU_ZERO) != 0U);
+}
+
+void run_analyzer_observer(void *user_data, size_t tick, int microtick, char phase,
+                           const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
+                           bool forced_emission) {
+    (void)phase;
+    (void)forced_emission;
+    RunAnalyzer *analyzer = (RunAnalyzer *)user_data;
+    run_analyzer_add_values(analyzer, tick, mpq_numref(state->upsilon),
+                            mpq_denref(state->upsilon), mpq_numref(state->beta),
+                            mpq_denref(state->beta), state->koppa_stack_size);
+    run_analyzer_add_events(analyzer, tick, microtick, rho_event, psi_fired, mu_zero);
+}
+
+void run_analyzer_finish(RunAnalyzer *analyzer) {
+    RunSummary *summary = analyzer->summary;
 
-    summary->ratio_mean = ratio_mean;
-    if (ratio_count > 1U) {
-        summary->ratio_variance = ratio_m2 / (double)(ratio_count - 1U);
+    // Only the last ratio is kept, so render it to decimal once.
+    if (summary->ratio_defined) {
+        gmp_snprintf(summary->final_ratio_str, sizeof(summary->final_ratio_str), "%Zd/%Zd",
+                     mpq_numref(summary->final_ratio), mpq_denref(summary->final_ratio));
+    }
+
+    summary->ratio_mean = analyzer->ratio_mean;
+    if (analyzer->ratio_count > 1U) {
+        summary->ratio_variance = analyzer->ratio_m2 / (double)(analyzer->ratio_count - 1U);
         summary->ratio_stddev = sqrt(summary->ratio_variance);
     } else {
         summary->ratio_variance = 0.0;
         summary->ratio_stddev = 0.0;
     }
-    summary->ratio_range = ratio_max - ratio_min;
+    summary->ratio_range = analyzer->ratio_max - analyzer->ratio_min;
 
     bool ratio_defined = summary->ratio_defined;
 
@@ -382,63 +398,71 @@ static bool parse_values_csv(const Config *config, RunSummary *summary) {
 
     bool divergent = ratio_defined &&
                      (summary->ratio_range > 1.0e6 ||
-                      mpz_cmp(max_mag_num, divergence_threshold) > 0 ||
-                      mpz_cmp(max_mag_den, divergence_threshold) > 0);
+                      mpz_cmp(analyzer->max_mag_num, divergence_threshold) > 0 ||
+                      mpz_cmp(analyzer->max_mag_den, divergence_threshold) > 0);
 
-    bool fixed_point = ratio_defined && summary->ratio_range < 1.0e-9 && max_delta < 1.0e-12;
+    bool fixed_point = ratio_defined && summary->ratio_range < 1.0e-9 &&
+                       analyzer->max_delta < 1.0e-12;
     bool oscillating = ratio_defined && !divergent && !fixed_point &&
-                       summary->ratio_range < 100.0 && sign_changes > ratio_count / 3U;
+                       summary->ratio_range < 100.0 &&
+                       analyzer->sign_changes > analyzer->ratio_count / 3U;
 
-    if (best_constant_index != SIZE_MAX) {
-        strncpy(summary->closest_constant, KNOWN_CONSTANTS[best_constant_index].name,
+    if (analyzer->best_constant_index != SIZE_MAX) {
+        strncpy(summary->closest_constant, KNOWN_CONSTANTS[analyzer->best_constant_index].name,
                 sizeof(summary->closest_constant));
         summary->closest_constant[sizeof(summary->closest_constant) - 1] = '\0';
-        summary->closest_delta = best_delta;
+        summary->closest_delta = analyzer->best_delta;
     } else {
         strncpy(summary->closest_constant, "None", sizeof(summary->closest_constant));
         summary->closest_constant[sizeof(summary->closest_constant) - 1] = '\0';
         summary->closest_delta = INFINITY;
     }
 
-    update_stack_summary(summary, stack_sum);
-    determine_pattern(summary, ratio_defined, divergent, fixed_point, oscillating, best_constant_index,
-                      best_delta);
-
+    update_stack_summary(summary, analyzer->stack_sum);
+    determine_pattern(summary, ratio_defined, divergent, fixed_point, oscillating,
+                      analyzer->best_constant_index, analyzer->best_delta);
     mpz_clear(divergence_threshold);
-    mpz_clear(abs_num);
-    mpz_clear(abs_den);
-    mpz_clear(max_mag_num);
-    mpz_clear(max_mag_den);
-    rational_clear(upsilon);
-    rational_clear(beta);
-    rational_clear(ratio);
 
-    return true;
+    if (analyzer->spacing_count > 1U) {
+        summary->psi_spacing_mean = analyzer->spacing_mean;
+        summary->psi_spacing_stddev =
+            sqrt(analyzer->spacing_m2 / (double)(analyzer->spacing_count - 1U));
+    } else {
+        summary->psi_spacing_mean = analyzer->spacing_count == 1U ? analyzer->spacing_mean : 0.0;
+        summary->psi_spacing_stddev = 0.0;
+    }
 }
 
-static bool parse_events_csv(RunSummary *summary) {
-    FILE *file = fopen("events.csv", "r");
+static bool parse_values_csv(const Config *config, RunAnalyzer *analyzer) {
+    (void)config;
+    FILE *file = fopen("values.csv", "r");
     if (!file) {
         return false;
     }
 
-    char line[1024];
-    if (!fgets(line, sizeof(line), file)) {
+    // Rows grow with the magnitude of the state, so no fixed buffer fits.
+    char *line = NULL;
+    size_t line_capacity = 0U;
+    if (getline(&line, &line_capacity, file) < 0) {
+        free(line);
+        fclose(file);
+        return false;
+    }
+    int radix = simulate_values_radix_from_line(line);
+    if (radix == 0) {
+        radix = 10;
+    } else if (getline(&line, &line_capacity, file) < 0) {
+        free(line);
         fclose(file);
         return false;
     }
 
-    size_t psi_event_count = 0U;
-    size_t rho_event_count = 0U;
-    size_t mu_zero_count = 0U;
-
-    size_t last_psi_index = 0U;
-    bool have_last_psi = false;
-    double spacing_mean = 0.0;
-    double spacing_m2 = 0.0;
-    size_t spacing_count = 0U;
+    mpz_t fields[4];
+    for (size_t i = 0; i < ARRAY_COUNT(fields); ++i) {
+        mpz_init(fields[i]);
+    }
 
-    while (fgets(line, sizeof(line), file)) {
+    while (getline(&line, &line_capacity, file) >= 0) {
         char *saveptr = NULL;
         char *token = strtok_r(line, ",", &saveptr);
         if (!token) {
@@ -450,66 +474,89 @@ static bool parse_events_csv(RunSummary *summary) {
         if (!token) {
             continue;
         }
-        int microtick = atoi(token);
 
-        token = strtok_r(NULL, ",", &saveptr);
-        if (!token) {
+        // upsilon and beta, each as numerator, denominator.
+        size_t parsed = 0U;
+        for (; parsed < ARRAY_COUNT(fields); ++parsed) {
+            token = strtok_r(NULL, ",", &saveptr);
+            if (!token) {
+                break;
+            }
+            mpz_set_str(fields[parsed], token, radix);
+        }
+        if (parsed < ARRAY_COUNT(fields)) {
             continue;
         }
-        (void)token;
 
-        token = strtok_r(NULL, ",", &saveptr);
+        unsigned long stack_size = 0UL;
+        for (int field_index = 6; field_index <= 22; ++field_index) {
+            token = strtok_r(NULL, ",", &saveptr);
+            if (!token) {
+                break;
+            }
+            if (field_index == 22) {
+                stack_size = strtoul(token, NULL, 10);
+            }
+        }
+
+        run_analyzer_add_values(analyzer, tick, fields[0], fields[1], fields[2], fields[3],
+                                (size_t)stack_size);
+    }
+
+    free(line);
+    fclose(file);
+    for (size_t i = 0; i < ARRAY_COUNT(fields); ++i) {
+        mpz_clear(fields[i]);
+    }
+    return true;
+}
+
+static bool parse_events_csv(RunAnalyzer *analyzer) {
+    FILE *file = fopen("events.csv", "r");
+    if (!file) {
+        return false;
+    }
+
+    char line[1024];
+    if (!fgets(line, sizeof(line), file)) {
+        fclose(file);
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        char *saveptr = NULL;
+        char *token = strtok_r(line, ",", &saveptr);
         if (!token) {
             continue;
         }
-        int rho_event = atoi(token);
-        if (rho_event != 0) {
-            ++rho_event_count;
-        }
+        size_t tick = (size_t)strtoull(token, NULL, 10);
 
         token = strtok_r(NULL, ",", &saveptr);
         if (!token) {
             continue;
         }
-        int psi_event = atoi(token);
-        if (psi_event != 0) {
-            ++psi_event_count;
-            size_t current_index = (tick - 1U) * 11U + (size_t)microtick;
-            if (have_last_psi) {
-                double spacing = (double)(current_index - last_psi_index);
-                ++spacing_count;
-                double delta = spacing - spacing_mean;
-                spacing_mean += delta / (double)spacing_count;
-                double delta2 = spacing - spacing_mean;
-                spacing_m2 += delta * delta2;
-            }
-            last_psi_index = current_index;
-            have_last_psi = true;
-        }
+        int microtick = atoi(token);
 
+        // phase
         token = strtok_r(NULL, ",", &saveptr);
         if (!token) {
             continue;
         }
-        int mu_zero = atoi(token);
-        if (mu_zero != 0) {
-            ++mu_zero_count;
+
+        int flags[3];
+        size_t parsed = 0U;
+        for (; parsed < ARRAY_COUNT(flags); ++parsed) {
+            token = strtok_r(NULL, ",", &saveptr);
+            if (!token) {
+                break;
+            }
+            flags[parsed] = atoi(token);
         }
+        // A short row still counts the flags it has, as before.
+        run_analyzer_add_events(analyzer, tick, microtick, parsed > 0U && flags[0] != 0,
+                                parsed > 1U && flags[1] != 0, parsed > 2U && flags[2] != 0);
     }
 
     fclose(file);
-
-    summary->psi_events = psi_event_count;
-    summary->rho_events = rho_event_count;
-    summary->mu_zero_events = mu_zero_count;
-
-    if (spacing_count > 1U) {
-        summary->psi_spacing_mean = spacing_mean;
-        summary->psi_spacing_stddev = sqrt(spacing_m2 / (double)(spacing_count - 1U));
-    } else {
-        summary->psi_spacing_mean = spacing_count == 1U ? spacing_mean : 0.0;
-        summary->psi_spacing_stddev = 0.0;
-    }
-
     return true;
 }
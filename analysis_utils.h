@@ -5,7 +5,10 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "batch_output.h"
 #include "config.h"
+#include "state.h"
+#include "trace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -41,8 +44,62 @@ void run_summary_init(RunSummary *summary);
 void run_summary_clear(RunSummary *summary);
 void run_summary_copy(RunSummary *dest, const RunSummary *src);
 
+// Incremental analysis: feed every microtick of a run in order, then call
+// run_analyzer_finish().  The summary is the same as analyze_latest_run()
+// computes from the run's CSVs, without rendering or parsing any text.
+typedef struct {
+    RunSummary *summary;
+    mpq_t upsilon;
+    mpq_t beta;
+    mpq_t ratio;
+    mpz_t abs_value;
+    mpz_t max_mag_num;
+    mpz_t max_mag_den;
+    size_t stack_sum;
+    double ratio_mean;
+    double ratio_m2;
+    size_t ratio_count;
+    double ratio_min;
+    double ratio_max;
+    double previous_ratio;
+    bool have_previous_ratio;
+    double max_delta;
+    size_t sign_changes;
+    double best_delta;
+    size_t best_constant_index;
+    size_t last_psi_index;
+    bool have_last_psi;
+    double spacing_mean;
+    double spacing_m2;
+    size_t spacing_count;
+} RunAnalyzer;
+
+// Results accumulate into summary, which must stay valid until finish.
+void run_analyzer_init(RunAnalyzer *analyzer, RunSummary *summary);
+void run_analyzer_clear(RunAnalyzer *analyzer);
+// The values.csv part of a row: upsilon, beta and the koppa stack size.
+void run_analyzer_add_values(RunAnalyzer *analyzer, size_t tick, mpz_srcptr upsilon_num,
+                             mpz_srcptr upsilon_den, mpz_srcptr beta_num, mpz_srcptr beta_den,
+                             size_t stack_size);
+// The events.csv part of a row.
+void run_analyzer_add_events(RunAnalyzer *analyzer, size_t tick, int microtick, bool rho_event,
+                             bool psi_fired, bool mu_zero);
+void run_analyzer_add_row(RunAnalyzer *analyzer, const TraceRow *row);
+// SimulateObserver (see simulate.h) feeding the RunAnalyzer in user_data.
+void run_analyzer_observer(void *user_data, size_t tick, int microtick, char phase,
+                           const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
+                           bool forced_emission);
+void run_analyzer_finish(RunAnalyzer *analyzer);
+
 bool analyze_latest_run(const Config *config, RunSummary *summary);
 bool simulate_and_analyze(const Config *config, RunSummary *summary);
+// As simulate_and_analyze(), writing the CSVs to events_path and values_path
+// (either may be NULL) through batch when it is set.  Every microtick is
+// analysed as it is produced, so the files are never read back and the batch
+// is not drained; batched files are complete once the caller drains it.
+bool simulate_and_analyze_batched(const Config *config, const char *events_path,
+                                  const char *values_path, RunSummary *summary,
+                                  BatchOutput *batch);
 
 const char *analysis_psi_type_label(const Config *config);
 bool analysis_constant_value(const char *name, double *value);
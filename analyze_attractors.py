@@ -51,7 +51,21 @@ EventRecord = namedtuple(
 )
 
 
-def _fraction_from_row(row, num_key, den_key, default):
+RADIX_MARKER = "#radix="
+
+
+def _read_radix_marker(handle):
+    """Consume a leading ``#radix=N`` line and return N (10 when absent)."""
+
+    position = handle.tell()
+    line = handle.readline()
+    if line.startswith(RADIX_MARKER):
+        return int(line[len(RADIX_MARKER):])
+    handle.seek(position)
+    return 10
+
+
+def _fraction_from_row(row, num_key, den_key, default, radix=10):
     """Read a fraction from CSV row, tolerating missing data."""
 
     num = row.get(num_key)
@@ -59,8 +73,8 @@ def _fraction_from_row(row, num_key, den_key, default):
     try:
         if num is None or den is None:
             raise ValueError
-        num_val = int(num)
-        den_val = int(den)
+        num_val = int(num, radix)
+        den_val = int(den, radix)
         if den_val == 0:
             return default
         return Fraction(num_val, den_val)
@@ -116,16 +130,17 @@ def load_values(path):
 
     records = []
     with open(path, "r", encoding="utf-8") as handle:
+        radix = _read_radix_marker(handle)
         reader = csv.DictReader(handle)
         for row in reader:
             tick = int(row["tick"])
             mt = int(row["mt"])
 
-            upsilon = _fraction_from_row(row, "upsilon_num", "upsilon_den", Fraction(0, 1))
-            beta = _fraction_from_row(row, "beta_num", "beta_den", Fraction(1, 1))
-            koppa = _fraction_from_row(row, "koppa_num", "koppa_den", Fraction(0, 1))
-            memory = _fraction_from_row(row, "memory_num", "memory_den", Fraction(0, 1))
-            phi = _fraction_from_row(row, "phi_num", "phi_den", Fraction(0, 1))
+            upsilon = _fraction_from_row(row, "upsilon_num", "upsilon_den", Fraction(0, 1), radix)
+            beta = _fraction_from_row(row, "beta_num", "beta_den", Fraction(1, 1), radix)
+            koppa = _fraction_from_row(row, "koppa_num", "koppa_den", Fraction(0, 1), radix)
+            memory = _fraction_from_row(row, "memory_num", "memory_den", Fraction(0, 1), radix)
+            phi = _fraction_from_row(row, "phi_num", "phi_den", Fraction(0, 1), radix)
 
             ratio = float(upsilon) / float(beta) if beta != 0 else math.inf
             composite_index = tick + (mt / 100.0)
@@ -0,0 +1,710 @@
+/*
+ * batch_output.c
+ *
+ * Each stream owns at most one pooled buffer at a time.  When it fills, or
+ * when the stream is closed, the buffer is queued as a single positioned
+ * write.  With io_uring the first write of a file is linked behind its
+ * openat, and the last one ahead of its close, so a short file costs one
+ * three-entry chain and no system call of its own: the ring is only entered
+ * when it is full, when a buffer or descriptor slot has to be recycled, or
+ * when the caller drains.  Writes carry explicit offsets, so only the
+ * open-before-write and write-before-close orders need enforcing.
+ */
+
+#define _GNU_SOURCE
+
+#include "batch_output.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef TRTS_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#define BATCH_DEFAULT_BUFFER_SIZE (256U * 1024U)
+#define BATCH_DEFAULT_BUFFER_COUNT 64U
+#define BATCH_DEFAULT_MAX_FILES 64U
+#define BATCH_NO_BUFFER ((size_t)-1)
+
+struct BatchOutputFile {
+    BatchOutput *output;
+    size_t slot;
+    int fd;
+    bool open_queued;
+    bool open_done;
+    bool awaiting_sync;
+    size_t writes_in_flight;
+    uint64_t offset;
+    size_t buffer;
+    size_t fill;
+    char path[];
+};
+
+static void record_error(BatchOutput *output, int error) {
+    if (output->error == 0) {
+        output->error = error;
+    }
+}
+
+static unsigned char *buffer_data(const BatchOutput *output, size_t buffer) {
+    return output->buffer_memory + buffer * output->options.buffer_size;
+}
+
+static void release_buffer(BatchOutput *output, size_t buffer) {
+    output->free_buffers[output->free_buffer_count++] = buffer;
+}
+
+static void release_slot(BatchOutput *output, BatchOutputFile *file) {
+    output->files[file->slot] = NULL;
+    free(file);
+}
+
+/* ===========================================================
+   IO_URING BACKEND
+   =========================================================== */
+
+#ifdef TRTS_HAVE_IO_URING
+
+#define BATCH_RING_ENTRIES 256U
+
+enum { OP_OPEN = 1, OP_WRITE, OP_FSYNC, OP_CLOSE };
+
+struct BatchOutputRing {
+    int fd;
+    void *sq_map;
+    size_t sq_map_size;
+    void *cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned queued;
+    size_t *write_lengths;
+};
+
+static uint64_t op_data(unsigned kind, size_t slot, size_t buffer) {
+    return ((uint64_t)kind << 56) | ((uint64_t)slot << 28) | (uint64_t)(buffer & 0x0FFFFFFFU);
+}
+
+static void ring_destroy(BatchOutputRing *ring) {
+    if (ring->sqes && ring->sqes != MAP_FAILED) {
+        munmap(ring->sqes, ring->sqes_size);
+    }
+    if (ring->cq_map && ring->cq_map != MAP_FAILED && ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    if (ring->sq_map && ring->sq_map != MAP_FAILED) {
+        munmap(ring->sq_map, ring->sq_map_size);
+    }
+    if (ring->fd >= 0) {
+        close(ring->fd);
+    }
+    free(ring->write_lengths);
+    free(ring);
+}
+
+// Set up the ring and register the buffer pool and an empty table of
+// direct descriptors.  Any failure (old kernel, seccomp, locked memory
+// limits) leaves the caller on the plain backend.
+static BatchOutputRing *ring_create(BatchOutput *output) {
+    BatchOutputRing *ring = (BatchOutputRing *)calloc(1, sizeof(BatchOutputRing));
+    if (!ring) {
+        return NULL;
+    }
+    ring->fd = -1;
+    ring->write_lengths = (size_t *)calloc(output->options.buffer_count, sizeof(size_t));
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = BATCH_RING_ENTRIES * 4U;
+    ring->fd = (int)syscall(__NR_io_uring_setup, BATCH_RING_ENTRIES, &params);
+    if (ring->fd < 0 || !ring->write_lengths) {
+        ring_destroy(ring);
+        return NULL;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_map_size > ring->sq_map_size) {
+            ring->sq_map_size = ring->cq_map_size;
+        }
+    }
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        ring_destroy(ring);
+        return NULL;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_map = ring->sq_map;
+    } else {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            ring_destroy(ring);
+            return NULL;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = (struct io_uring_sqe *)mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                             MAP_SHARED | MAP_POPULATE, ring->fd,
+                                             IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        ring_destroy(ring);
+        return NULL;
+    }
+
+    unsigned char *sq = (unsigned char *)ring->sq_map;
+    unsigned char *cq = (unsigned char *)ring->cq_map;
+    ring->sq_head = (unsigned *)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+    struct iovec *iovecs = (struct iovec *)calloc(output->options.buffer_count,
+                                                  sizeof(struct iovec));
+    int *descriptors = (int *)malloc(output->options.max_files * sizeof(int));
+    bool registered = iovecs && descriptors;
+    if (registered) {
+        for (size_t i = 0; i < output->options.buffer_count; ++i) {
+            iovecs[i].iov_base = buffer_data(output, i);
+            iovecs[i].iov_len = output->options.buffer_size;
+        }
+        for (size_t i = 0; i < output->options.max_files; ++i) {
+            descriptors[i] = -1;
+        }
+        registered =
+            syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, iovecs,
+                    (unsigned)output->options.buffer_count) == 0 &&
+            syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, descriptors,
+                    (unsigned)output->options.max_files) == 0;
+    }
+    free(iovecs);
+    free(descriptors);
+    if (!registered) {
+        ring_destroy(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+static void handle_completion(BatchOutput *output, uint64_t user_data, int result) {
+    const unsigned kind = (unsigned)(user_data >> 56);
+    const size_t slot = (size_t)((user_data >> 28) & 0x0FFFFFFFU);
+    const size_t buffer = (size_t)(user_data & 0x0FFFFFFFU);
+    BatchOutputFile *file = output->files[slot];
+    output->pending_ops -= 1U;
+
+    if (result < 0) {
+        record_error(output, -result);
+    }
+    switch (kind) {
+    case OP_OPEN:
+        if (file) {
+            file->open_done = true;
+        }
+        break;
+    case OP_WRITE:
+        if (result >= 0) {
+            output->bytes_written += (uint64_t)result;
+            if ((size_t)result != output->ring->write_lengths[buffer]) {
+                record_error(output, EIO);
+            }
+        }
+        release_buffer(output, buffer);
+        if (file) {
+            file->writes_in_flight -= 1U;
+        }
+        break;
+    case OP_FSYNC:
+        break;
+    case OP_CLOSE:
+        if (file) {
+            output->files_written += 1U;
+            release_slot(output, file);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void ring_reap(BatchOutput *output) {
+    BatchOutputRing *ring = output->ring;
+    unsigned head = *ring->cq_head;
+    const unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        const struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        handle_completion(output, cqe->user_data, cqe->res);
+        ++head;
+    }
+    __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+// Submit everything queued and wait for at least wait_count completions.
+static void ring_enter(BatchOutput *output, unsigned wait_count) {
+    BatchOutputRing *ring = output->ring;
+    if (wait_count > output->pending_ops) {
+        wait_count = (unsigned)output->pending_ops;
+    }
+    if (ring->queued > 0U || wait_count > 0U) {
+        int submitted;
+        do {
+            submitted = (int)syscall(__NR_io_uring_enter, ring->fd, ring->queued, wait_count,
+                                     wait_count > 0U ? IORING_ENTER_GETEVENTS : 0U, NULL, 0);
+        } while (submitted < 0 && errno == EINTR);
+        output->system_calls += 1U;
+        if (submitted < 0) {
+            record_error(output, errno);
+        } else {
+            ring->queued -= (unsigned)submitted;
+        }
+    }
+    ring_reap(output);
+}
+
+// Make room for a chain of count entries; chains never straddle a submit.
+static void ring_reserve(BatchOutput *output, unsigned count) {
+    BatchOutputRing *ring = output->ring;
+    const unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_entries - (*ring->sq_tail - head) < count) {
+        ring_enter(output, 0U);
+    }
+}
+
+static struct io_uring_sqe *ring_next(BatchOutput *output, uint8_t opcode, uint64_t user_data,
+                                      bool linked) {
+    BatchOutputRing *ring = output->ring;
+    const unsigned tail = *ring->sq_tail;
+    const unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->user_data = user_data;
+    sqe->flags = linked ? IOSQE_IO_LINK : 0;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1U, __ATOMIC_RELEASE);
+    ring->queued += 1U;
+    output->pending_ops += 1U;
+    output->operations += 1U;
+    return sqe;
+}
+
+static void queue_open(BatchOutput *output, BatchOutputFile *file, bool linked) {
+    struct io_uring_sqe *sqe =
+        ring_next(output, IORING_OP_OPENAT, op_data(OP_OPEN, file->slot, 0U), linked);
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)file->path;
+    sqe->len = 0666;
+    // Direct descriptors never reach the file table, so O_CLOEXEC is
+    // meaningless here and the kernel rejects it.
+    sqe->open_flags = O_WRONLY | O_CREAT | O_TRUNC;
+    sqe->file_index = (uint32_t)file->slot + 1U;
+    file->open_queued = true;
+}
+
+static void queue_write(BatchOutput *output, BatchOutputFile *file, bool linked) {
+    struct io_uring_sqe *sqe =
+        ring_next(output, IORING_OP_WRITE_FIXED, op_data(OP_WRITE, file->slot, file->buffer),
+                  linked);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    sqe->fd = (int)file->slot;
+    sqe->addr = (uint64_t)(uintptr_t)buffer_data(output, file->buffer);
+    sqe->len = (uint32_t)file->fill;
+    sqe->off = file->offset;
+    sqe->buf_index = (uint16_t)file->buffer;
+    output->ring->write_lengths[file->buffer] = file->fill;
+    file->offset += file->fill;
+    file->writes_in_flight += 1U;
+    file->buffer = BATCH_NO_BUFFER;
+    file->fill = 0U;
+}
+
+static void queue_fsync(BatchOutput *output, BatchOutputFile *file, bool linked) {
+    struct io_uring_sqe *sqe =
+        ring_next(output, IORING_OP_FSYNC, op_data(OP_FSYNC, file->slot, 0U), linked);
+    sqe->flags |= IOSQE_FIXED_FILE;
+    sqe->fd = (int)file->slot;
+}
+
+static void queue_close(BatchOutput *output, BatchOutputFile *file) {
+    struct io_uring_sqe *sqe =
+        ring_next(output, IORING_OP_CLOSE, op_data(OP_CLOSE, file->slot, 0U), false);
+    sqe->file_index = (uint32_t)file->slot + 1U;
+}
+
+// Writes may only be queued unlinked once the file is known to be open, and
+// a close only once no earlier write of the file is still in flight.
+static void ring_wait_for_file(BatchOutput *output, BatchOutputFile *file, bool for_close) {
+    while (output->pending_ops > 0U &&
+           ((file->open_queued && !file->open_done) ||
+            (for_close && file->writes_in_flight > 0U))) {
+        ring_enter(output, 1U);
+    }
+}
+
+static void ring_flush(BatchOutput *output, BatchOutputFile *file, bool closing) {
+    if (file->buffer != BATCH_NO_BUFFER && file->fill == 0U) {
+        release_buffer(output, file->buffer);
+        file->buffer = BATCH_NO_BUFFER;
+    }
+    const bool has_data = file->buffer != BATCH_NO_BUFFER;
+    const bool close_now = closing && !output->options.sync_shards;
+    if (!has_data && !close_now && file->open_queued) {
+        return;
+    }
+    ring_wait_for_file(output, file, close_now);
+    ring_reserve(output, 3U);
+    if (!file->open_queued) {
+        queue_open(output, file, has_data || close_now);
+    }
+    if (has_data) {
+        queue_write(output, file, close_now);
+    }
+    if (close_now) {
+        queue_close(output, file);
+    }
+}
+
+static void ring_sync_and_close(BatchOutput *output, BatchOutputFile *file) {
+    ring_wait_for_file(output, file, true);
+    ring_reserve(output, 2U);
+    queue_fsync(output, file, true);
+    queue_close(output, file);
+}
+
+#endif // TRTS_HAVE_IO_URING
+
+/* ===========================================================
+   PLAIN BACKEND
+   =========================================================== */
+
+static void plain_flush(BatchOutput *output, BatchOutputFile *file) {
+    if (file->buffer == BATCH_NO_BUFFER) {
+        return;
+    }
+    const unsigned char *data = buffer_data(output, file->buffer);
+    size_t written = 0U;
+    while (written < file->fill) {
+        ssize_t result = pwrite(file->fd, data + written, file->fill - written,
+                                (off_t)(file->offset + written));
+        output->system_calls += 1U;
+        output->operations += 1U;
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            record_error(output, errno);
+            break;
+        }
+        written += (size_t)result;
+    }
+    output->bytes_written += written;
+    file->offset += file->fill;
+    file->fill = 0U;
+    release_buffer(output, file->buffer);
+    file->buffer = BATCH_NO_BUFFER;
+}
+
+static void plain_close(BatchOutput *output, BatchOutputFile *file, bool sync) {
+    if (sync && fsync(file->fd) != 0) {
+        record_error(output, errno);
+    }
+    if (close(file->fd) != 0) {
+        record_error(output, errno);
+    }
+    output->system_calls += sync ? 2U : 1U;
+    output->operations += sync ? 2U : 1U;
+    output->files_written += 1U;
+    release_slot(output, file);
+}
+
+/* ===========================================================
+   SHARED
+   =========================================================== */
+
+static void flush_file(BatchOutput *output, BatchOutputFile *file, bool closing) {
+#ifdef TRTS_HAVE_IO_URING
+    if (output->backend == BATCH_OUTPUT_IO_URING) {
+        ring_flush(output, file, closing);
+        return;
+    }
+#endif
+    plain_flush(output, file);
+    if (closing && !output->options.sync_shards) {
+        plain_close(output, file, false);
+    }
+}
+
+// Free a pooled buffer: wait for an in-flight write to complete, or hand
+// another stream's partly filled buffer to the kernel early.
+static bool acquire_buffer(BatchOutput *output, BatchOutputFile *file) {
+    while (output->free_buffer_count == 0U) {
+#ifdef TRTS_HAVE_IO_URING
+        if (output->backend == BATCH_OUTPUT_IO_URING && output->pending_ops > 0U) {
+            ring_enter(output, 1U);
+            continue;
+        }
+#endif
+        BatchOutputFile *victim = NULL;
+        for (size_t i = 0; i < output->options.max_files && !victim; ++i) {
+            BatchOutputFile *candidate = output->files[i];
+            if (candidate && candidate != file && candidate->buffer != BATCH_NO_BUFFER) {
+                victim = candidate;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        flush_file(output, victim, false);
+    }
+    file->buffer = output->free_buffers[--output->free_buffer_count];
+    file->fill = 0U;
+    return true;
+}
+
+static ssize_t cookie_write(void *cookie, const char *data, size_t size) {
+    BatchOutputFile *file = (BatchOutputFile *)cookie;
+    BatchOutput *output = file->output;
+    size_t consumed = 0U;
+    while (consumed < size) {
+        if (file->buffer == BATCH_NO_BUFFER && !acquire_buffer(output, file)) {
+            errno = ENOBUFS;
+            return consumed > 0U ? (ssize_t)consumed : -1;
+        }
+        size_t room = output->options.buffer_size - file->fill;
+        size_t chunk = size - consumed < room ? size - consumed : room;
+        memcpy(buffer_data(output, file->buffer) + file->fill, data + consumed, chunk);
+        file->fill += chunk;
+        consumed += chunk;
+        if (file->fill == output->options.buffer_size) {
+            flush_file(output, file, false);
+        }
+    }
+    return (ssize_t)size;
+}
+
+// Always succeeds: the close is only queued, and an error recorded earlier
+// may belong to any file of the batch.  Failures are reported by the next
+// drain instead (see batch_output.h).
+static int cookie_close(void *cookie) {
+    BatchOutputFile *file = (BatchOutputFile *)cookie;
+    BatchOutput *output = file->output;
+    file->awaiting_sync = output->options.sync_shards;
+    flush_file(output, file, true);
+    return 0;
+}
+
+void batch_output_options_init(BatchOutputOptions *options) {
+    options->buffer_size = BATCH_DEFAULT_BUFFER_SIZE;
+    options->buffer_count = BATCH_DEFAULT_BUFFER_COUNT;
+    options->max_files = BATCH_DEFAULT_MAX_FILES;
+    options->sync_shards = false;
+    options->force_plain = false;
+}
+
+bool batch_output_init(BatchOutput *output, const BatchOutputOptions *options) {
+    memset(output, 0, sizeof(*output));
+    if (options) {
+        output->options = *options;
+    } else {
+        batch_output_options_init(&output->options);
+    }
+    if (output->options.buffer_size == 0U) {
+        output->options.buffer_size = BATCH_DEFAULT_BUFFER_SIZE;
+    }
+    if (output->options.buffer_count == 0U) {
+        output->options.buffer_count = BATCH_DEFAULT_BUFFER_COUNT;
+    }
+    if (output->options.max_files == 0U) {
+        output->options.max_files = BATCH_DEFAULT_MAX_FILES;
+    }
+    // The kernel registers at most UIO_MAXIOV buffers.
+    if (output->options.buffer_count > 1024U) {
+        output->options.buffer_count = 1024U;
+    }
+
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    if (posix_memalign((void **)&output->buffer_memory, page,
+                       output->options.buffer_size * output->options.buffer_count) != 0) {
+        output->buffer_memory = NULL;
+        return false;
+    }
+    output->free_buffers = (size_t *)malloc(output->options.buffer_count * sizeof(size_t));
+    output->files = (BatchOutputFile **)calloc(output->options.max_files,
+                                               sizeof(BatchOutputFile *));
+    if (!output->free_buffers || !output->files) {
+        batch_output_clear(output);
+        return false;
+    }
+    for (size_t i = 0; i < output->options.buffer_count; ++i) {
+        output->free_buffers[i] = output->options.buffer_count - 1U - i;
+    }
+    output->free_buffer_count = output->options.buffer_count;
+
+    output->backend = BATCH_OUTPUT_PLAIN;
+#ifdef TRTS_HAVE_IO_URING
+    if (!output->options.force_plain) {
+        output->ring = ring_create(output);
+        if (output->ring) {
+            output->backend = BATCH_OUTPUT_IO_URING;
+        }
+    }
+#endif
+    return true;
+}
+
+void batch_output_clear(BatchOutput *output) {
+    if (output->files) {
+        batch_output_shard_boundary(output);
+    }
+#ifdef TRTS_HAVE_IO_URING
+    if (output->ring) {
+        ring_destroy(output->ring);
+    }
+#endif
+    if (output->files) {
+        for (size_t i = 0; i < output->options.max_files; ++i) {
+            free(output->files[i]);
+        }
+    }
+    free(output->files);
+    free(output->free_buffers);
+    free(output->buffer_memory);
+    memset(output, 0, sizeof(*output));
+}
+
+const char *batch_output_backend_name(const BatchOutput *output) {
+    return output->backend == BATCH_OUTPUT_IO_URING ? "io_uring" : "plain";
+}
+
+// fsync and close every file closed since the last boundary.  Failures are
+// recorded for the next drain.
+static void close_awaiting_sync(BatchOutput *output) {
+    for (size_t i = 0; i < output->options.max_files; ++i) {
+        BatchOutputFile *file = output->files[i];
+        if (!file || !file->awaiting_sync) {
+            continue;
+        }
+        file->awaiting_sync = false;
+#ifdef TRTS_HAVE_IO_URING
+        if (output->backend == BATCH_OUTPUT_IO_URING) {
+            ring_sync_and_close(output, file);
+            continue;
+        }
+#endif
+        plain_close(output, file, true);
+    }
+}
+
+static bool claim_slot(BatchOutput *output, size_t *slot) {
+    for (;;) {
+        bool awaiting_sync = false;
+        for (size_t i = 0; i < output->options.max_files; ++i) {
+            if (!output->files[i]) {
+                *slot = i;
+                return true;
+            }
+            awaiting_sync = awaiting_sync || output->files[i]->awaiting_sync;
+        }
+        // Every slot is taken: retire finished files, which for sync_shards
+        // means syncing them early.  Errors stay recorded for the caller's
+        // next drain.
+        if (awaiting_sync) {
+            close_awaiting_sync(output);
+        } else if (output->pending_ops > 0U) {
+#ifdef TRTS_HAVE_IO_URING
+            ring_enter(output, 1U);
+#endif
+        } else {
+            return false;
+        }
+    }
+}
+
+FILE *batch_output_open(BatchOutput *output, const char *path) {
+    size_t slot = 0U;
+    if (!claim_slot(output, &slot)) {
+        errno = EMFILE;
+        return NULL;
+    }
+    const size_t path_length = strlen(path);
+    BatchOutputFile *file = (BatchOutputFile *)calloc(1, sizeof(BatchOutputFile) + path_length + 1U);
+    if (!file) {
+        return NULL;
+    }
+    file->output = output;
+    file->slot = slot;
+    file->fd = -1;
+    file->buffer = BATCH_NO_BUFFER;
+    memcpy(file->path, path, path_length + 1U);
+
+    if (output->backend == BATCH_OUTPUT_PLAIN) {
+        file->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        output->system_calls += 1U;
+        output->operations += 1U;
+        if (file->fd < 0) {
+            // Reported now and again by the next drain, as a queued open
+            // failing on the ring would be.
+            record_error(output, errno);
+            free(file);
+            return NULL;
+        }
+    }
+
+    cookie_io_functions_t functions = {NULL, cookie_write, NULL, cookie_close};
+    FILE *stream = fopencookie(file, "w", functions);
+    if (!stream) {
+        if (file->fd >= 0) {
+            close(file->fd);
+        }
+        free(file);
+        return NULL;
+    }
+    output->files[slot] = file;
+    return stream;
+}
+
+bool batch_output_drain(BatchOutput *output) {
+#ifdef TRTS_HAVE_IO_URING
+    if (output->backend == BATCH_OUTPUT_IO_URING) {
+        while (output->pending_ops > 0U) {
+            ring_enter(output, (unsigned)output->pending_ops);
+        }
+    }
+#endif
+    if (output->error != 0) {
+        errno = output->error;
+        output->error = 0;
+        return false;
+    }
+    return true;
+}
+
+bool batch_output_shard_boundary(BatchOutput *output) {
+    close_awaiting_sync(output);
+    return batch_output_drain(output);
+}
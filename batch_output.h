@@ -0,0 +1,88 @@
+// batch_output.h
+// Batched file output for sweeps that write many short files.  Files are
+// opened as ordinary FILE streams, so existing fprintf/gmp_fprintf writers
+// work unchanged, but their bytes are collected in a fixed pool of large
+// buffers and the open, write and close calls are queued instead of issued
+// one by one.  On Linux the queue is an io_uring with the buffer pool
+// registered for fixed writes and files opened into direct descriptor
+// slots; elsewhere, or when the ring cannot be created, the same interface
+// falls back to plain open/write/close.  Optionally closes are deferred to
+// shard boundaries, where each file gets an fsync linked ahead of its close.
+
+#ifndef BATCH_OUTPUT_H
+#define BATCH_OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BATCH_OUTPUT_PLAIN = 0,
+    BATCH_OUTPUT_IO_URING
+} BatchOutputBackend;
+
+typedef struct {
+    // Size and number of pooled write buffers; 0 selects the defaults
+    // (256 KiB x 64).
+    size_t buffer_size;
+    size_t buffer_count;
+    // Files that may be open or awaiting their shard fsync at once.
+    size_t max_files;
+    // Defer closes to batch_output_shard_boundary() and fsync first.
+    bool sync_shards;
+    // Skip io_uring even when it is available.
+    bool force_plain;
+} BatchOutputOptions;
+
+typedef struct BatchOutputFile BatchOutputFile;
+typedef struct BatchOutputRing BatchOutputRing;
+
+typedef struct {
+    BatchOutputBackend backend;
+    BatchOutputOptions options;
+    BatchOutputRing *ring;
+    unsigned char *buffer_memory;
+    size_t *free_buffers;
+    size_t free_buffer_count;
+    BatchOutputFile **files;
+    size_t pending_ops;
+    int error;
+    uint64_t system_calls;
+    uint64_t operations;
+    uint64_t bytes_written;
+    uint64_t files_written;
+} BatchOutput;
+
+void batch_output_options_init(BatchOutputOptions *options);
+bool batch_output_init(BatchOutput *output, const BatchOutputOptions *options);
+// Drains outstanding work and closes every file still waiting for a shard
+// boundary.  Every stream must have been fclose()d first.
+void batch_output_clear(BatchOutput *output);
+const char *batch_output_backend_name(const BatchOutput *output);
+
+// Create or truncate path and return a write-only stream feeding the batch.
+// fclose() queues the close; the file is complete once the batch drains.
+// Writes and closes complete asynchronously, so fclose() on these streams
+// always succeeds: a failed open, write, fsync or close of any file is only
+// reported by the next batch_output_drain() or batch_output_shard_boundary().
+// The stream cannot seek or report its position.
+FILE *batch_output_open(BatchOutput *output, const char *path);
+
+// Wait until every queued write and close has finished.  Returns false and
+// sets errno if any operation failed since the previous drain.
+bool batch_output_drain(BatchOutput *output);
+
+// With sync_shards, fsync and close every file closed since the last
+// boundary, then drain.  Otherwise equivalent to batch_output_drain().
+bool batch_output_shard_boundary(BatchOutput *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BATCH_OUTPUT_H
@@ -0,0 +1,198 @@
+/*
+ * checkpoint.c
+ *
+ * Checkpoint files use fixed-width little-endian integers and GMP's raw
+ * mpz format (which is itself byte-order independent), so a run can be
+ * preempted on one host and resumed on another.  Numerators and
+ * denominators are stored separately and restored verbatim; nothing is
+ * canonicalised on either side.
+ */
+
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sweep_merge.h"
+
+static const unsigned char CHECKPOINT_MAGIC[8] = {'T', 'R', 'T', 'S', 'C', 'K', 'P', '\0'};
+
+static bool write_u64(FILE *file, uint64_t value) {
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; ++i) {
+        bytes[i] = (unsigned char)(value >> (8U * i));
+    }
+    return fwrite(bytes, 1, sizeof(bytes), file) == sizeof(bytes);
+}
+
+static bool read_u64(FILE *file, uint64_t *value) {
+    unsigned char bytes[8];
+    if (fread(bytes, 1, sizeof(bytes), file) != sizeof(bytes)) {
+        return false;
+    }
+    *value = 0U;
+    for (size_t i = 0; i < 8; ++i) {
+        *value |= (uint64_t)bytes[i] << (8U * i);
+    }
+    return true;
+}
+
+static bool write_rational(FILE *file, mpq_srcptr value) {
+    return mpz_out_raw(file, mpq_numref(value)) != 0 && mpz_out_raw(file, mpq_denref(value)) != 0;
+}
+
+static bool read_rational(FILE *file, mpq_ptr value) {
+    return mpz_inp_raw(mpq_numref(value), file) != 0 && mpz_inp_raw(mpq_denref(value), file) != 0;
+}
+
+static bool write_config_fingerprint(FILE *file, const Config *config) {
+    TraceBuffer fingerprint;
+    trace_buffer_init(&fingerprint);
+    bool ok = sweep_merge_config_fingerprint(config, &fingerprint) &&
+              write_u64(file, (uint64_t)fingerprint.size) &&
+              fwrite(fingerprint.data, 1, fingerprint.size, file) == fingerprint.size &&
+              write_u64(file, (uint64_t)config->values_radix);
+    trace_buffer_clear(&fingerprint);
+    return ok;
+}
+
+static bool config_fingerprint_matches(FILE *file, const Config *config) {
+    TraceBuffer expected;
+    TraceBuffer stored;
+    trace_buffer_init(&expected);
+    trace_buffer_init(&stored);
+    uint64_t size = 0U;
+    uint64_t radix = 0U;
+    bool ok = sweep_merge_config_fingerprint(config, &expected) && read_u64(file, &size) &&
+              size == (uint64_t)expected.size;
+    for (uint64_t i = 0; ok && i < size; ++i) {
+        int byte = getc(file);
+        unsigned char value = (unsigned char)byte;
+        ok = byte != EOF && trace_buffer_append(&stored, &value, 1U);
+    }
+    ok = ok && memcmp(stored.data, expected.data, expected.size) == 0 &&
+         read_u64(file, &radix) && radix == (uint64_t)config->values_radix;
+    trace_buffer_clear(&expected);
+    trace_buffer_clear(&stored);
+    return ok;
+}
+
+bool checkpoint_write(const char *path, const Config *config,
+                      const CheckpointPosition *position, const TRTS_State *state) {
+    char temp_path[1024];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE *file = fopen(temp_path, "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool ok = fwrite(CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC), file) ==
+                  sizeof(CHECKPOINT_MAGIC) &&
+              write_u64(file, CHECKPOINT_FORMAT_VERSION) &&
+              write_u64(file, (uint64_t)position->ticks_total) &&
+              write_rational(file, config->initial_upsilon) &&
+              write_rational(file, config->initial_beta) &&
+              write_rational(file, config->initial_koppa) &&
+              write_config_fingerprint(file, config) &&
+              write_u64(file, (uint64_t)position->tick) &&
+              write_u64(file, (uint64_t)position->microtick) &&
+              write_u64(file, (uint64_t)position->events_offset) &&
+              write_u64(file, (uint64_t)position->values_offset) &&
+              write_u64(file, (uint64_t)position->trace_offset) &&
+              write_u64(file, position->trace_rows);
+
+    mpq_ptr rationals[STATE_RATIONAL_COUNT];
+    state_rationals((TRTS_State *)state, rationals);
+    for (size_t i = 0; ok && i < STATE_RATIONAL_COUNT; ++i) {
+        ok = write_rational(file, rationals[i]);
+    }
+    ok = ok && write_u64(file, (uint64_t)state->koppa_stack_size) &&
+         write_u64(file, (uint64_t)(int64_t)state->koppa_sample_index) &&
+         write_u64(file, (uint64_t)state_flag_bits(state)) &&
+         write_u64(file, (uint64_t)state->tick);
+
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (!ok || rename(temp_path, path) != 0) {
+        remove(temp_path);
+        return false;
+    }
+    return true;
+}
+
+static bool seed_matches(FILE *file, mpq_srcptr seed, mpq_ptr scratch) {
+    return read_rational(file, scratch) &&
+           mpz_cmp(mpq_numref(scratch), mpq_numref(seed)) == 0 &&
+           mpz_cmp(mpq_denref(scratch), mpq_denref(seed)) == 0;
+}
+
+static bool fail(char *error, size_t error_capacity, const char *message) {
+    if (error && error_capacity > 0) {
+        snprintf(error, error_capacity, "%s", message);
+    }
+    return false;
+}
+
+bool checkpoint_read(const char *path, const Config *config, CheckpointPosition *position,
+                     TRTS_State *state, char *error, size_t error_capacity) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return fail(error, error_capacity, "unable to open checkpoint");
+    }
+
+    unsigned char magic[sizeof(CHECKPOINT_MAGIC)];
+    uint64_t version = 0U;
+    uint64_t ticks_total = 0U;
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+        memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0 || !read_u64(file, &version) ||
+        version != CHECKPOINT_FORMAT_VERSION || !read_u64(file, &ticks_total)) {
+        fclose(file);
+        return fail(error, error_capacity, "not a checkpoint of this format version");
+    }
+
+    mpq_t scratch;
+    mpq_init(scratch);
+    bool seeds_ok = seed_matches(file, config->initial_upsilon, scratch) &&
+                    seed_matches(file, config->initial_beta, scratch) &&
+                    seed_matches(file, config->initial_koppa, scratch) &&
+                    config_fingerprint_matches(file, config);
+    mpq_clear(scratch);
+    if (!seeds_ok || ticks_total != (uint64_t)config->ticks) {
+        fclose(file);
+        return fail(error, error_capacity, "checkpoint was written for a different configuration");
+    }
+
+    uint64_t tick = 0U, microtick = 0U, events_offset = 0U, values_offset = 0U,
+             trace_offset = 0U, trace_rows = 0U;
+    bool ok = read_u64(file, &tick) && read_u64(file, &microtick) &&
+              read_u64(file, &events_offset) && read_u64(file, &values_offset) &&
+              read_u64(file, &trace_offset) && read_u64(file, &trace_rows);
+
+    mpq_ptr rationals[STATE_RATIONAL_COUNT];
+    state_rationals(state, rationals);
+    for (size_t i = 0; ok && i < STATE_RATIONAL_COUNT; ++i) {
+        ok = read_rational(file, rationals[i]);
+    }
+    uint64_t stack_size = 0U, sample_index = 0U, flag_bits = 0U, state_tick = 0U;
+    ok = ok && read_u64(file, &stack_size) && read_u64(file, &sample_index) &&
+         read_u64(file, &flag_bits) && read_u64(file, &state_tick);
+    fclose(file);
+
+    if (!ok || stack_size > 4U || microtick < 1U || microtick > 11U) {
+        return fail(error, error_capacity, "truncated or corrupt checkpoint");
+    }
+
+    position->tick = (size_t)tick;
+    position->microtick = (int)microtick;
+    position->ticks_total = (size_t)ticks_total;
+    position->events_offset = (int64_t)events_offset;
+    position->values_offset = (int64_t)values_offset;
+    position->trace_offset = (int64_t)trace_offset;
+    position->trace_rows = trace_rows;
+    state->koppa_stack_size = (size_t)stack_size;
+    state->koppa_sample_index = (int)(int64_t)sample_index;
+    state_apply_flag_bits(state, (unsigned int)flag_bits);
+    state->tick = (size_t)state_tick;
+    return true;
+}
@@ -0,0 +1,51 @@
+// checkpoint.h
+// Exact, host-independent snapshots of a running simulation.  A checkpoint
+// is taken at a microtick boundary, directly after that microtick's outputs
+// were emitted, and records the full TRTS_State (raw numerators and
+// denominators, never canonicalised), the position in the run and the byte
+// offsets reached in each output file.  Resuming truncates the outputs back
+// to those offsets and continues with the next microtick, so a preempted and
+// resumed run produces the same bytes as an uninterrupted one.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CHECKPOINT_FORMAT_VERSION 2
+
+typedef struct {
+    size_t tick;       // last completed tick
+    int microtick;     // last completed microtick within that tick
+    size_t ticks_total;
+    int64_t events_offset; // -1 when the output is not in use
+    int64_t values_offset;
+    int64_t trace_offset;
+    uint64_t trace_rows;
+} CheckpointPosition;
+
+// Writes to "<path>.tmp" and renames it over path, so a crash while
+// checkpointing never leaves a truncated checkpoint behind.
+bool checkpoint_write(const char *path, const Config *config,
+                      const CheckpointPosition *position, const TRTS_State *state);
+
+// state must have been initialised with state_init().  Fails when the file
+// is malformed or was written for a different configuration: tick count,
+// seeds, values radix or anything in sweep_merge_config_fingerprint().
+bool checkpoint_read(const char *path, const Config *config, CheckpointPosition *position,
+                     TRTS_State *state, char *error, size_t error_capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHECKPOINT_H
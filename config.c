@@ -47,6 +47,12 @@ void config_init(Config *config) {
     config->enable_fibonacci_gate = false;
     config->sign_flip_mode = SIGN_FLIP_NONE;
     config->koppa_wrap_threshold = 1000UL;
+    config->koppa_gate_slide_below = 10UL;
+    config->koppa_gate_multi_below = 100UL;
+    config->values_radix = 10;
+    config->compaction_interval = 64U;
+    config->threshold_tracker = NULL;
+    config->prime_batch = NULL;
 
     /* Initialise custom ratio window.  Disabled by default. */
     config->enable_ratio_custom_range = false;
@@ -77,3 +83,7 @@ void config_clear(Config *config) {
     /* Clear modulus bound big integer */
     mpz_clear(config->modulus_bound);
 }
+
+bool config_values_radix_supported(int radix) {
+    return radix == 10 || (radix >= 2 && radix <= 32 && (radix & (radix - 1)) == 0);
+}
@@ -87,6 +87,8 @@ typedef enum {
     SIGN_FLIP_ALTERNATE
 } SignFlipMode;
 
+struct ThresholdTracker;
+
 /*
  * Primary configuration structure controlling engine behaviour.  The
  * boolean flags enable optional features.  Newly added fields below
@@ -131,6 +133,15 @@ typedef struct {
     SignFlipMode sign_flip_mode;
     unsigned long koppa_wrap_threshold;
 
+    /*
+     * Koppa-gated engine bands: with enable_koppa_gated_engine set, the
+     * engine slides while |num(κ)| < koppa_gate_slide_below, multiplies
+     * while it is below koppa_gate_multi_below and adds otherwise.  JSON
+     * keys of the same name; 10 and 100 by default.
+     */
+    unsigned long koppa_gate_slide_below;
+    unsigned long koppa_gate_multi_below;
+
     /*
      * Custom ratio window: when ratio_trigger_mode is RATIO_TRIGGER_CUSTOM,
      * the lower and upper bounds of the window are taken from these
@@ -158,9 +169,41 @@ typedef struct {
      * and either the numerator or denominator of a rational exceeds
      * this modulus, the value is reduced modulo this bound.  This
      * value is an arbitrary precision integer and must be initialised
-     * and cleared via config_init()/config_clear().
+     * and cleared via config_init()/config_clear().  JSON key
+     * "modulus_bound": a decimal string or "2^N"; 0 disables it.
      */
     mpz_t modulus_bound;
+
+    /*
+     * Radix of the rational components written to values.csv.  10 is
+     * plain decimal; a power of two up to 32 trades readability for
+     * linear-time conversion of very large numerators and is announced
+     * by a "#radix=N" line ahead of the header.  Output only: it has no
+     * effect on the simulation.
+     */
+    int values_radix;
+
+    /*
+     * Ticks between limb-capacity compaction passes over the state (see
+     * state_compact() in state.h); 0 disables compaction.  Only the memory
+     * held by the run changes, never its values or outputs.
+     */
+    size_t compaction_interval;
+
+    /*
+     * Parametric runs only (see threshold.h): receives every comparison
+     * against a threshold parameter.  NULL for ordinary runs; never read
+     * from or written to configuration files.
+     */
+    struct ThresholdTracker *threshold_tracker;
+
+    /*
+     * Runs simulated side by side only (see prime_batch.h): E-phase prime
+     * checks are classified together with the other participants' before
+     * any probable-prime test.  NULL for ordinary runs; never read from or
+     * written to configuration files.
+     */
+    struct PrimeBatch *prime_batch;
 } Config;
 
 /* Initialise a Config with sane defaults.  Allocates internal GMP
@@ -174,6 +217,9 @@ void config_init(Config *config);
 
 void config_clear(Config *config);
 
+/* True for the radices values.csv can be written in: 10, 2, 4, 8, 16, 32. */
+bool config_values_radix_supported(int radix);
+
 #ifdef __cplusplus
 }
 #endif
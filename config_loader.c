@@ -161,6 +161,26 @@ static bool parse_rational_string(const char *text, mpq_t value) {
     return true;
 }
 
+// "2^N" or a decimal integer; 0 disables the bound.
+static bool parse_modulus_bound(const char *text, mpz_t value) {
+    if (text[0] == '2' && text[1] == '^') {
+        char *end_ptr = NULL;
+        unsigned long exponent = strtoul(text + 2, &end_ptr, 10);
+        if (!isdigit((unsigned char)text[2]) || *end_ptr != '\0' || exponent > (1UL << 24)) {
+            return false;
+        }
+        mpz_set_ui(value, 0UL);
+        mpz_setbit(value, exponent);
+        return true;
+    }
+    for (const char *p = text; *p; ++p) {
+        if (!isdigit((unsigned char)*p)) {
+            return false;
+        }
+    }
+    return text[0] != '\0' && mpz_set_str(value, text, 10) == 0;
+}
+
 static void apply_optional_bool(const char *json, const char *key, bool *target) {
     bool value = false;
     if (json_extract_bool(json, key, &value)) {
@@ -266,6 +286,7 @@ bool config_load_from_file(Config *config, const char *path, char *error_buffer,
     apply_optional_bool(json, "psi_strength_parameter", &config->enable_psi_strength_parameter);
     apply_optional_bool(json, "ratio_snapshot_logging", &config->enable_ratio_snapshot_logging);
     apply_optional_bool(json, "feedback_oscillator", &config->enable_feedback_oscillator);
+    apply_optional_bool(json, "ratio_custom_range", &config->enable_ratio_custom_range);
 
     enum_value = (int)config->koppa_trigger;
     apply_optional_enum(json, "koppa_trigger", KOPPA_ON_PSI, KOPPA_ON_ALL_MU, &enum_value);
@@ -277,7 +298,7 @@ bool config_load_from_file(Config *config, const char *path, char *error_buffer,
     config->mt10_behavior = (Mt10Behavior)enum_value;
 
     enum_value = (int)config->ratio_trigger_mode;
-    apply_optional_enum(json, "ratio_trigger_mode", RATIO_TRIGGER_NONE, RATIO_TRIGGER_PLASTIC,
+    apply_optional_enum(json, "ratio_trigger_mode", RATIO_TRIGGER_NONE, RATIO_TRIGGER_CUSTOM,
                         &enum_value);
     config->ratio_trigger_mode = (RatioTriggerMode)enum_value;
 
@@ -300,6 +321,30 @@ bool config_load_from_file(Config *config, const char *path, char *error_buffer,
         config->koppa_wrap_threshold = wrap_value;
     }
 
+    unsigned long gate_value = 0UL;
+    if (json_extract_unsigned(json, "koppa_gate_slide_below", &gate_value)) {
+        config->koppa_gate_slide_below = gate_value;
+    }
+    if (json_extract_unsigned(json, "koppa_gate_multi_below", &gate_value)) {
+        config->koppa_gate_multi_below = gate_value;
+    }
+
+    unsigned long compaction_value = 0UL;
+    if (json_extract_unsigned(json, "compaction_interval", &compaction_value)) {
+        config->compaction_interval = (size_t)compaction_value;
+    }
+
+    int radix_value = 0;
+    if (json_extract_int(json, "values_radix", &radix_value)) {
+        if (!config_values_radix_supported(radix_value)) {
+            write_error(error_buffer, error_capacity,
+                        "values_radix must be 10 or a power of two up to 32");
+            free(buffer);
+            return false;
+        }
+        config->values_radix = radix_value;
+    }
+
     char rational_buffer[128];
     if (json_extract_string(json, "upsilon_seed", rational_buffer, sizeof(rational_buffer))) {
         if (!parse_rational_string(rational_buffer, config->initial_upsilon)) {
@@ -309,6 +354,24 @@ bool config_load_from_file(Config *config, const char *path, char *error_buffer,
         }
     }
 
+    if (json_extract_string(json, "ratio_custom_lower", rational_buffer,
+                            sizeof(rational_buffer))) {
+        if (!parse_rational_string(rational_buffer, config->ratio_custom_lower)) {
+            write_error(error_buffer, error_capacity, "Invalid ratio_custom_lower");
+            free(buffer);
+            return false;
+        }
+    }
+
+    if (json_extract_string(json, "ratio_custom_upper", rational_buffer,
+                            sizeof(rational_buffer))) {
+        if (!parse_rational_string(rational_buffer, config->ratio_custom_upper)) {
+            write_error(error_buffer, error_capacity, "Invalid ratio_custom_upper");
+            free(buffer);
+            return false;
+        }
+    }
+
     if (json_extract_string(json, "beta_seed", rational_buffer, sizeof(rational_buffer))) {
         if (!parse_rational_string(rational_buffer, config->initial_beta)) {
             write_error(error_buffer, error_capacity, "Invalid beta seed");
@@ -325,6 +388,16 @@ bool config_load_from_file(Config *config, const char *path, char *error_buffer,
         }
     }
 
+    char modulus_buffer[2048];
+    if (json_extract_string(json, "modulus_bound", modulus_buffer, sizeof(modulus_buffer))) {
+        if (!parse_modulus_bound(modulus_buffer, config->modulus_bound)) {
+            write_error(error_buffer, error_capacity,
+                        "modulus_bound must be a non-negative decimal integer or 2^N");
+            free(buffer);
+            return false;
+        }
+    }
+
     free(buffer);
     return true;
 }
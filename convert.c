@@ -0,0 +1,1055 @@
+// convert.c
+// trts_convert: one-off conversion of archived events.csv / values.csv pairs
+// into binary traces, so later analyses read raw limbs instead of parsing
+// decimal.  Both CSVs are mapped, split at row boundaries and converted in
+// parallel chunks; each chunk is encoded against the last row of the chunk
+// before it, so the output is byte-identical to a trace written in one pass.
+// Columns are matched by header name, which covers the older, narrower
+// layouts still in the archive.  Every converted row (or every Nth with
+// --verify-every) is decoded again and re-rendered in the source layout, and
+// must match the original line byte for byte.  values.csv files that start
+// with a "#radix=N" line are parsed and re-rendered in that radix.  A
+// provenance record is written next to each trace.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <gmp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "simulate.h"
+#include "trace.h"
+
+#define CONVERT_MAX_COLUMNS 64
+#define CONVERT_CHUNK_ROWS 4096U
+#define CONVERT_CHUNK_BYTES (8U * 1024U * 1024U)
+#define CONVERT_DEFAULT_VERIFY_EVERY 64U
+
+typedef enum {
+    COLUMN_TICK,
+    COLUMN_MICROTICK,
+    COLUMN_PHASE,
+    COLUMN_FLAG,
+    COLUMN_KOPPA_SAMPLE_INDEX,
+    COLUMN_KOPPA_STACK_SIZE,
+    COLUMN_COMPONENT
+} ColumnKind;
+
+typedef struct {
+    const char *name;
+    ColumnKind kind;
+    unsigned int value; // flag bit or component index
+} ColumnSpec;
+
+// Every column either CSV has ever carried.  event_type is the old name of
+// the phase column.
+static const ColumnSpec EVENT_COLUMNS[] = {
+    {"tick", COLUMN_TICK, 0U},
+    {"mt", COLUMN_MICROTICK, 0U},
+    {"phase", COLUMN_PHASE, 0U},
+    {"event_type", COLUMN_PHASE, 0U},
+    {"rho_event", COLUMN_FLAG, TRACE_FLAG_RHO_EVENT},
+    {"psi_fired", COLUMN_FLAG, TRACE_FLAG_PSI_FIRED},
+    {"mu_zero", COLUMN_FLAG, TRACE_FLAG_MU_ZERO},
+    {"forced_emission", COLUMN_FLAG, TRACE_FLAG_FORCED_EMISSION},
+    {"ratio_triggered", COLUMN_FLAG, TRACE_FLAG_RATIO_TRIGGERED},
+    {"triple_psi", COLUMN_FLAG, TRACE_FLAG_TRIPLE_PSI},
+    {"dual_engine", COLUMN_FLAG, TRACE_FLAG_DUAL_ENGINE},
+    {"koppa_sample_index", COLUMN_KOPPA_SAMPLE_INDEX, 0U},
+    {"ratio_threshold", COLUMN_FLAG, TRACE_FLAG_RATIO_THRESHOLD},
+    {"psi_strength", COLUMN_FLAG, TRACE_FLAG_PSI_STRENGTH},
+    {"sign_flip", COLUMN_FLAG, TRACE_FLAG_SIGN_FLIP},
+};
+
+static const ColumnSpec VALUE_COLUMNS[] = {
+    {"tick", COLUMN_TICK, 0U},
+    {"mt", COLUMN_MICROTICK, 0U},
+    {"upsilon_num", COLUMN_COMPONENT, 0U},
+    {"upsilon_den", COLUMN_COMPONENT, 1U},
+    {"beta_num", COLUMN_COMPONENT, 2U},
+    {"beta_den", COLUMN_COMPONENT, 3U},
+    {"koppa_num", COLUMN_COMPONENT, 4U},
+    {"koppa_den", COLUMN_COMPONENT, 5U},
+    {"koppa_sample_num", COLUMN_COMPONENT, 6U},
+    {"koppa_sample_den", COLUMN_COMPONENT, 7U},
+    {"prev_upsilon_num", COLUMN_COMPONENT, 8U},
+    {"prev_upsilon_den", COLUMN_COMPONENT, 9U},
+    {"prev_beta_num", COLUMN_COMPONENT, 10U},
+    {"prev_beta_den", COLUMN_COMPONENT, 11U},
+    {"koppa_stack0_num", COLUMN_COMPONENT, 12U},
+    {"koppa_stack0_den", COLUMN_COMPONENT, 13U},
+    {"koppa_stack1_num", COLUMN_COMPONENT, 14U},
+    {"koppa_stack1_den", COLUMN_COMPONENT, 15U},
+    {"koppa_stack2_num", COLUMN_COMPONENT, 16U},
+    {"koppa_stack2_den", COLUMN_COMPONENT, 17U},
+    {"koppa_stack3_num", COLUMN_COMPONENT, 18U},
+    {"koppa_stack3_den", COLUMN_COMPONENT, 19U},
+    {"koppa_stack_size", COLUMN_KOPPA_STACK_SIZE, 0U},
+    {"delta_upsilon_num", COLUMN_COMPONENT, 20U},
+    {"delta_upsilon_den", COLUMN_COMPONENT, 21U},
+    {"delta_beta_num", COLUMN_COMPONENT, 22U},
+    {"delta_beta_den", COLUMN_COMPONENT, 23U},
+    {"triangle_phi_over_epsilon_num", COLUMN_COMPONENT, 24U},
+    {"triangle_phi_over_epsilon_den", COLUMN_COMPONENT, 25U},
+    {"triangle_prev_over_phi_num", COLUMN_COMPONENT, 26U},
+    {"triangle_prev_over_phi_den", COLUMN_COMPONENT, 27U},
+    {"triangle_epsilon_over_prev_num", COLUMN_COMPONENT, 28U},
+    {"triangle_epsilon_over_prev_den", COLUMN_COMPONENT, 29U},
+};
+
+#define ARRAY_COUNT(arr) (sizeof(arr) / sizeof((arr)[0]))
+
+typedef struct {
+    const char *path;
+    int fd;
+    const char *data;
+    size_t size;
+    struct stat info;
+    // Header layout, resolved against one of the tables above.
+    const ColumnSpec *columns[CONVERT_MAX_COLUMNS];
+    size_t column_count;
+    char header[4096];
+    // Radix of the component columns, from an optional "#radix=N" line.
+    int radix;
+    // Start offset of every data row.
+    size_t *rows;
+    size_t row_count;
+} CsvFile;
+
+typedef struct {
+    const CsvFile *events;
+    const CsvFile *values;
+    size_t verify_every;
+    // Trace components that no column provides, filled with the value a
+    // fresh mpq_t has (numerators 0, denominators 1).
+    bool component_present[TRACE_COMPONENT_COUNT];
+} ConvertJob;
+
+typedef struct {
+    const ConvertJob *job;
+    size_t first_row;
+    size_t end_row;
+    char *output;
+    size_t output_size;
+    size_t rows_verified;
+    bool ok;
+    char error[256];
+} ConvertChunk;
+
+typedef struct {
+    ConvertChunk *chunks;
+    size_t chunk_count;
+    size_t next;
+} ChunkQueue;
+
+typedef struct {
+    const char *data;
+    size_t begin;
+    size_t end;
+    size_t *rows;
+    size_t row_count;
+    size_t row_capacity;
+} RowScan;
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--jobs <n>] [--verify-every <n>] [--force] <run-dir>...\n"
+            "       %s [options] --events <path> --values <path> --output <trace>\n"
+            "Converts events.csv / values.csv pairs into binary traces.  For each\n"
+            "run directory, <run-dir>/run.trace is written together with\n"
+            "<run-dir>/run.trace.provenance.json; existing traces are kept unless\n"
+            "--force is given.  Every Nth row (default %u, 1 = all, 0 = none) is\n"
+            "re-rendered from the trace and compared with the source line.\n",
+            program, program, CONVERT_DEFAULT_VERIFY_EVERY);
+}
+
+/* ===========================================================
+   CSV MAPPING AND ROW INDEX
+   =========================================================== */
+
+static void csv_file_close(CsvFile *file) {
+    if (file->data && file->size > 0U) {
+        munmap((void *)file->data, file->size);
+    }
+    if (file->fd >= 0) {
+        close(file->fd);
+    }
+    free(file->rows);
+    file->data = NULL;
+    file->fd = -1;
+    file->rows = NULL;
+}
+
+static size_t line_end(const char *data, size_t size, size_t start) {
+    const char *newline = (const char *)memchr(data + start, '\n', size - start);
+    return newline ? (size_t)(newline - data) : size;
+}
+
+static bool parse_header(CsvFile *file, const ColumnSpec *table, size_t table_count,
+                         size_t header_start, size_t header_end) {
+    size_t length = header_end - header_start;
+    if (length >= sizeof(file->header)) {
+        fprintf(stderr, "%s: header line is too long\n", file->path);
+        return false;
+    }
+    memcpy(file->header, file->data + header_start, length);
+    file->header[length] = '\0';
+
+    file->column_count = 0U;
+    char *cursor = file->header;
+    for (;;) {
+        char *comma = strchr(cursor, ',');
+        size_t name_length = comma ? (size_t)(comma - cursor) : strlen(cursor);
+        const ColumnSpec *spec = NULL;
+        for (size_t i = 0; i < table_count && !spec; ++i) {
+            if (strlen(table[i].name) == name_length &&
+                strncmp(table[i].name, cursor, name_length) == 0) {
+                spec = &table[i];
+            }
+        }
+        if (!spec) {
+            fprintf(stderr, "%s: unknown column '%.*s'\n", file->path, (int)name_length, cursor);
+            return false;
+        }
+        for (size_t i = 0; i < file->column_count; ++i) {
+            if (file->columns[i]->kind == spec->kind && file->columns[i]->value == spec->value) {
+                fprintf(stderr, "%s: duplicate column '%s'\n", file->path, spec->name);
+                return false;
+            }
+        }
+        if (file->column_count == CONVERT_MAX_COLUMNS) {
+            fprintf(stderr, "%s: too many columns\n", file->path);
+            return false;
+        }
+        file->columns[file->column_count++] = spec;
+        if (!comma) {
+            break;
+        }
+        cursor = comma + 1;
+    }
+    return true;
+}
+
+static void *scan_rows(void *argument) {
+    RowScan *scan = (RowScan *)argument;
+    size_t position = scan->begin;
+    // A row starts wherever the previous byte is a newline.
+    if (position > 0U && scan->data[position - 1U] != '\n') {
+        const char *newline =
+            (const char *)memchr(scan->data + position, '\n', scan->end - position);
+        position = newline ? (size_t)(newline - scan->data) + 1U : scan->end;
+    }
+    while (position < scan->end) {
+        if (scan->row_count == scan->row_capacity) {
+            size_t capacity = scan->row_capacity ? scan->row_capacity * 2U : 4096U;
+            size_t *rows = (size_t *)realloc(scan->rows, capacity * sizeof(size_t));
+            if (!rows) {
+                scan->row_count = SIZE_MAX;
+                return NULL;
+            }
+            scan->rows = rows;
+            scan->row_capacity = capacity;
+        }
+        scan->rows[scan->row_count++] = position;
+        const char *newline =
+            (const char *)memchr(scan->data + position, '\n', scan->end - position);
+        if (!newline) {
+            break;
+        }
+        position = (size_t)(newline - scan->data) + 1U;
+    }
+    return NULL;
+}
+
+// Split the body into one byte range per job and collect row starts in
+// parallel; the ranges are concatenated in order afterwards.
+static bool index_rows(CsvFile *file, size_t body_start, size_t jobs) {
+    if (jobs == 0U) {
+        jobs = 1U;
+    }
+    size_t body = file->size - body_start;
+    if (body < jobs * 65536U) {
+        jobs = 1U;
+    }
+    RowScan *scans = (RowScan *)calloc(jobs, sizeof(RowScan));
+    pthread_t *threads = (pthread_t *)calloc(jobs, sizeof(pthread_t));
+    bool ok = scans && threads;
+    size_t started = 0U;
+    for (size_t i = 0; ok && i < jobs; ++i) {
+        scans[i].data = file->data;
+        scans[i].begin = body_start + body / jobs * i;
+        scans[i].end = (i + 1U == jobs) ? file->size : body_start + body / jobs * (i + 1U);
+        if (i == 0U) {
+            scan_rows(&scans[i]);
+        } else if (pthread_create(&threads[i], NULL, scan_rows, &scans[i]) == 0) {
+            started = i;
+        } else {
+            ok = false;
+        }
+    }
+    for (size_t i = 1; i <= started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    size_t total = 0U;
+    for (size_t i = 0; ok && i < jobs; ++i) {
+        if (scans[i].row_count == SIZE_MAX) {
+            ok = false;
+        } else {
+            total += scans[i].row_count;
+        }
+    }
+    if (ok) {
+        file->rows = (size_t *)malloc((total ? total : 1U) * sizeof(size_t));
+        ok = file->rows != NULL;
+    }
+    if (ok) {
+        file->row_count = 0U;
+        for (size_t i = 0; i < jobs; ++i) {
+            memcpy(file->rows + file->row_count, scans[i].rows,
+                   scans[i].row_count * sizeof(size_t));
+            file->row_count += scans[i].row_count;
+        }
+    }
+    for (size_t i = 0; scans && i < jobs; ++i) {
+        free(scans[i].rows);
+    }
+    free(scans);
+    free(threads);
+    if (!ok) {
+        fprintf(stderr, "%s: out of memory while indexing rows\n", file->path);
+    }
+    return ok;
+}
+
+static bool csv_file_open(CsvFile *file, const char *path, const ColumnSpec *table,
+                          size_t table_count, size_t jobs) {
+    memset(file, 0, sizeof(*file));
+    file->path = path;
+    file->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (file->fd < 0 || fstat(file->fd, &file->info) != 0) {
+        perror(path);
+        csv_file_close(file);
+        return false;
+    }
+    file->size = (size_t)file->info.st_size;
+    if (file->size == 0U) {
+        fprintf(stderr, "%s: empty file\n", path);
+        csv_file_close(file);
+        return false;
+    }
+    void *data = mmap(NULL, file->size, PROT_READ, MAP_PRIVATE, file->fd, 0);
+    if (data == MAP_FAILED) {
+        perror(path);
+        file->size = 0U;
+        csv_file_close(file);
+        return false;
+    }
+    file->data = (const char *)data;
+    madvise(data, file->size, MADV_SEQUENTIAL);
+
+    size_t header_start = 0U;
+    size_t header_end = line_end(file->data, file->size, 0U);
+    file->radix = 10;
+    size_t marker_length = strlen(SIMULATE_RADIX_MARKER);
+    if (header_end >= marker_length &&
+        memcmp(file->data, SIMULATE_RADIX_MARKER, marker_length) == 0) {
+        char marker[32];
+        size_t length = header_end < sizeof(marker) ? header_end : sizeof(marker) - 1U;
+        memcpy(marker, file->data, length);
+        marker[length] = '\0';
+        file->radix = simulate_values_radix_from_line(marker);
+        if (file->radix == 0 || header_end >= file->size) {
+            fprintf(stderr, "%s: invalid radix line\n", path);
+            csv_file_close(file);
+            return false;
+        }
+        header_start = header_end + 1U;
+        header_end = line_end(file->data, file->size, header_start);
+    }
+    size_t body_start = header_end < file->size ? header_end + 1U : file->size;
+    if (!parse_header(file, table, table_count, header_start, header_end) ||
+        !index_rows(file, body_start, jobs)) {
+        csv_file_close(file);
+        return false;
+    }
+    return true;
+}
+
+static bool has_column(const CsvFile *file, ColumnKind kind) {
+    for (size_t i = 0; i < file->column_count; ++i) {
+        if (file->columns[i]->kind == kind) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ===========================================================
+   ROW PARSING AND RENDERING
+   =========================================================== */
+
+// Copy a field out of the mapping so it is NUL-terminated.
+static const char *field_text(TraceBuffer *scratch, const char *field, size_t length) {
+    trace_buffer_reset(scratch);
+    if (!trace_buffer_append(scratch, field, length) || !trace_buffer_append(scratch, "", 1U)) {
+        return NULL;
+    }
+    return (const char *)scratch->data;
+}
+
+static bool parse_long(const char *text, long min_value, long max_value, long *value) {
+    if (*text == '\0') {
+        return false;
+    }
+    char *end = NULL;
+    errno = 0;
+    long parsed = strtol(text, &end, 10);
+    if (errno != 0 || *end != '\0' || parsed < min_value || parsed > max_value) {
+        return false;
+    }
+    *value = parsed;
+    return true;
+}
+
+// Integers exactly as mpz_get_str() writes them: an optional '-', then
+// lowercase digits of radix with no leading zeros, and no "-0".  mpz_set_str()
+// also accepts whitespace, uppercase and leading zeros, none of which would
+// survive the round trip.
+static bool canonical_integer(const char *text, int radix) {
+    if (*text == '-') {
+        ++text;
+        if (text[0] == '0') {
+            return false;
+        }
+    }
+    if (text[0] == '\0' || (text[0] == '0' && text[1] != '\0')) {
+        return false;
+    }
+    for (; *text != '\0'; ++text) {
+        int digit;
+        if (*text >= '0' && *text <= '9') {
+            digit = *text - '0';
+        } else if (*text >= 'a' && *text <= 'z') {
+            digit = *text - 'a' + 10;
+        } else {
+            return false;
+        }
+        if (digit >= radix) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Apply one field.  tick and microtick appear in both files and must agree;
+// seen_position tracks whether the row already fixed them.
+static bool parse_field(const ColumnSpec *spec, int radix, const char *text, TraceRow *row,
+                        bool *seen_position) {
+    long value = 0;
+    switch (spec->kind) {
+    case COLUMN_TICK: {
+        char *end = NULL;
+        errno = 0;
+        unsigned long long tick = strtoull(text, &end, 10);
+        if (*text == '\0' || *text == '-' || errno != 0 || *end != '\0') {
+            return false;
+        }
+        if (seen_position[0] && row->tick != (size_t)tick) {
+            return false;
+        }
+        row->tick = (size_t)tick;
+        seen_position[0] = true;
+        return true;
+    }
+    case COLUMN_MICROTICK:
+        // Stored as one byte in the trace.
+        if (!parse_long(text, 0L, 255L, &value) ||
+            (seen_position[1] && row->microtick != (int)value)) {
+            return false;
+        }
+        row->microtick = (int)value;
+        seen_position[1] = true;
+        return true;
+    case COLUMN_PHASE:
+        if (text[0] == '\0' || text[1] != '\0') {
+            return false;
+        }
+        row->phase = text[0];
+        return true;
+    case COLUMN_FLAG:
+        if ((text[0] != '0' && text[0] != '1') || text[1] != '\0') {
+            return false;
+        }
+        if (text[0] == '1') {
+            row->flags |= spec->value;
+        }
+        return true;
+    case COLUMN_KOPPA_SAMPLE_INDEX:
+        if (!parse_long(text, -1L, 254L, &value)) {
+            return false;
+        }
+        row->koppa_sample_index = (int)value;
+        return true;
+    case COLUMN_KOPPA_STACK_SIZE:
+        if (!parse_long(text, 0L, 4L, &value)) {
+            return false;
+        }
+        row->koppa_stack_size = (size_t)value;
+        return true;
+    case COLUMN_COMPONENT:
+        // GMP switches to divide-and-conquer conversion for long inputs, so
+        // giant integers are not parsed in quadratic time.
+        return canonical_integer(text, radix) &&
+               mpz_set_str(row->components[spec->value], text, radix) == 0;
+    }
+    return false;
+}
+
+static bool parse_line(const CsvFile *file, size_t row_index, TraceRow *row,
+                       bool *seen_position, TraceBuffer *scratch, char *error,
+                       size_t error_size) {
+    size_t start = file->rows[row_index];
+    size_t end = line_end(file->data, file->size, start);
+    size_t column = 0U;
+    size_t position = start;
+    for (;;) {
+        const char *comma =
+            (const char *)memchr(file->data + position, ',', end - position);
+        size_t field_end = comma ? (size_t)(comma - file->data) : end;
+        if (column == file->column_count) {
+            snprintf(error, error_size, "%s row %zu: more than %zu fields", file->path,
+                     row_index + 1U, file->column_count);
+            return false;
+        }
+        const ColumnSpec *spec = file->columns[column];
+        const char *text = field_text(scratch, file->data + position, field_end - position);
+        if (!text || !parse_field(spec, file->radix, text, row, seen_position)) {
+            snprintf(error, error_size, "%s row %zu: cannot convert %s '%.40s'", file->path,
+                     row_index + 1U, spec->name, text ? text : "");
+            return false;
+        }
+        ++column;
+        if (!comma) {
+            break;
+        }
+        position = field_end + 1U;
+    }
+    if (column != file->column_count) {
+        snprintf(error, error_size, "%s row %zu: %zu of %zu fields", file->path, row_index + 1U,
+                 column, file->column_count);
+        return false;
+    }
+    return true;
+}
+
+static void reset_row(const ConvertJob *job, TraceRow *row) {
+    row->tick = 0U;
+    row->microtick = 0;
+    row->phase = 'E';
+    row->flags = 0U;
+    row->koppa_sample_index = -1;
+    row->koppa_stack_size = 0U;
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        if (!job->component_present[i]) {
+            mpz_set_ui(row->components[i], (i % 2U == 1U) ? 1UL : 0UL);
+        }
+    }
+}
+
+static bool parse_row(const ConvertJob *job, size_t row_index, TraceRow *row,
+                      TraceBuffer *scratch, char *error, size_t error_size) {
+    bool seen_position[2] = {false, false};
+    reset_row(job, row);
+    return parse_line(job->events, row_index, row, seen_position, scratch, error, error_size) &&
+           parse_line(job->values, row_index, row, seen_position, scratch, error, error_size);
+}
+
+static bool render_text(TraceBuffer *out, const char *text) {
+    return trace_buffer_append(out, text, strlen(text));
+}
+
+static bool render_field(TraceBuffer *out, const ColumnSpec *spec, int radix,
+                         const TraceRow *row) {
+    char number[32];
+    switch (spec->kind) {
+    case COLUMN_TICK:
+        snprintf(number, sizeof(number), "%zu", row->tick);
+        return render_text(out, number);
+    case COLUMN_MICROTICK:
+        snprintf(number, sizeof(number), "%d", row->microtick);
+        return render_text(out, number);
+    case COLUMN_PHASE:
+        return trace_buffer_append(out, &row->phase, 1U);
+    case COLUMN_FLAG:
+        return render_text(out, (row->flags & spec->value) ? "1" : "0");
+    case COLUMN_KOPPA_SAMPLE_INDEX:
+        snprintf(number, sizeof(number), "%d", row->koppa_sample_index);
+        return render_text(out, number);
+    case COLUMN_KOPPA_STACK_SIZE:
+        snprintf(number, sizeof(number), "%zu", row->koppa_stack_size);
+        return render_text(out, number);
+    case COLUMN_COMPONENT: {
+        mpz_srcptr value = row->components[spec->value];
+        // Room for the digits, a sign and the terminator.
+        size_t length = mpz_sizeinbase(value, radix) + 2U;
+        if (out->capacity - out->size < length) {
+            size_t capacity = out->capacity * 2U + length;
+            unsigned char *data = (unsigned char *)realloc(out->data, capacity);
+            if (!data) {
+                return false;
+            }
+            out->data = data;
+            out->capacity = capacity;
+        }
+        size_t offset = out->size;
+        mpz_get_str((char *)out->data + offset, radix, value);
+        out->size = offset + strlen((const char *)out->data + offset);
+        return true;
+    }
+    }
+    return false;
+}
+
+// Re-render a decoded row in the file's own column layout and compare it
+// with the source line.
+static bool line_matches(const CsvFile *file, size_t row_index, const TraceRow *row,
+                         TraceBuffer *rendered) {
+    trace_buffer_reset(rendered);
+    for (size_t i = 0; i < file->column_count; ++i) {
+        if ((i > 0U && !trace_buffer_append(rendered, ",", 1U)) ||
+            !render_field(rendered, file->columns[i], file->radix, row)) {
+            return false;
+        }
+    }
+    size_t start = file->rows[row_index];
+    size_t end = line_end(file->data, file->size, start);
+    return rendered->size == end - start &&
+           memcmp(rendered->data, file->data + start, rendered->size) == 0;
+}
+
+/* ===========================================================
+   PARALLEL CONVERSION
+   =========================================================== */
+
+static bool encode_row(TraceEncoder *encoder, TraceBuffer *payload, const TraceRow *row) {
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        components[i] = row->components[i];
+    }
+    trace_buffer_reset(payload);
+    return trace_encode_row(encoder, payload, row->tick, row->microtick, row->phase, row->flags,
+                            row->koppa_sample_index, row->koppa_stack_size, components);
+}
+
+static void convert_chunk(ConvertChunk *chunk) {
+    const ConvertJob *job = chunk->job;
+    TraceRow rows[2];
+    TraceRow decoded;
+    trace_row_init(&rows[0]);
+    trace_row_init(&rows[1]);
+    trace_row_init(&decoded);
+    TraceEncoder encoder;
+    trace_encoder_init(&encoder, true);
+    TraceBuffer scratch;
+    TraceBuffer payload;
+    TraceBuffer rendered;
+    trace_buffer_init(&scratch);
+    trace_buffer_init(&payload);
+    trace_buffer_init(&rendered);
+    FILE *output = open_memstream(&chunk->output, &chunk->output_size);
+
+    chunk->ok = output != NULL;
+    int current = 0;
+    // Prime the encoder with the row before the chunk so cross-row
+    // references come out exactly as in a sequential pass.
+    if (chunk->ok && chunk->first_row > 0U) {
+        chunk->ok = parse_row(job, chunk->first_row - 1U, &rows[1], &scratch, chunk->error,
+                              sizeof(chunk->error)) &&
+                    encode_row(&encoder, &payload, &rows[1]);
+    }
+    for (size_t row_index = chunk->first_row; chunk->ok && row_index < chunk->end_row;
+         ++row_index) {
+        TraceRow *row = &rows[current];
+        const TraceRow *previous = (row_index > 0U) ? &rows[current ^ 1] : NULL;
+        if (!parse_row(job, row_index, row, &scratch, chunk->error, sizeof(chunk->error))) {
+            chunk->ok = false;
+            break;
+        }
+        if (!encode_row(&encoder, &payload, row) ||
+            !trace_write_record(output, payload.data, payload.size)) {
+            snprintf(chunk->error, sizeof(chunk->error), "row %zu: encoding failed",
+                     row_index + 1U);
+            chunk->ok = false;
+            break;
+        }
+        if (job->verify_every > 0U && row_index % job->verify_every == 0U) {
+            if (!trace_decode_row(payload.data, payload.size, previous, &decoded) ||
+                !line_matches(job->events, row_index, &decoded, &rendered) ||
+                !line_matches(job->values, row_index, &decoded, &rendered)) {
+                snprintf(chunk->error, sizeof(chunk->error),
+                         "row %zu does not round-trip exactly", row_index + 1U);
+                chunk->ok = false;
+                break;
+            }
+            chunk->rows_verified += 1U;
+        }
+        current ^= 1;
+    }
+    if (output && fclose(output) != 0) {
+        chunk->ok = false;
+    }
+
+    trace_buffer_clear(&rendered);
+    trace_buffer_clear(&payload);
+    trace_buffer_clear(&scratch);
+    trace_encoder_clear(&encoder);
+    trace_row_clear(&decoded);
+    trace_row_clear(&rows[1]);
+    trace_row_clear(&rows[0]);
+}
+
+static void *chunk_worker(void *argument) {
+    ChunkQueue *queue = (ChunkQueue *)argument;
+    for (;;) {
+        size_t index = __atomic_fetch_add(&queue->next, 1U, __ATOMIC_RELAXED);
+        if (index >= queue->chunk_count) {
+            return NULL;
+        }
+        convert_chunk(&queue->chunks[index]);
+    }
+}
+
+// Chunks end at row boundaries, after CONVERT_CHUNK_ROWS rows or once the
+// source lines reach CONVERT_CHUNK_BYTES, whichever comes first.
+static size_t chunk_end(const ConvertJob *job, size_t first_row) {
+    const CsvFile *events = job->events;
+    const CsvFile *values = job->values;
+    size_t row_count = events->row_count;
+    size_t end = first_row;
+    size_t bytes = 0U;
+    while (end < row_count && end - first_row < CONVERT_CHUNK_ROWS &&
+           bytes < CONVERT_CHUNK_BYTES) {
+        size_t next_events = end + 1U < row_count ? events->rows[end + 1U] : events->size;
+        size_t next_values = end + 1U < row_count ? values->rows[end + 1U] : values->size;
+        bytes += (next_events - events->rows[end]) + (next_values - values->rows[end]);
+        ++end;
+    }
+    return end;
+}
+
+typedef struct {
+    size_t rows;
+    size_t rows_verified;
+    uint64_t trace_bytes;
+} ConvertResult;
+
+// Convert in waves of a few chunks per job so memory stays bounded; each
+// wave is written out in row order before the next one starts.
+static bool convert_rows(const ConvertJob *job, FILE *trace, size_t jobs,
+                         ConvertResult *result) {
+    const size_t wave_size = jobs * 4U;
+    ConvertChunk *chunks = (ConvertChunk *)calloc(wave_size, sizeof(ConvertChunk));
+    pthread_t *threads = (pthread_t *)calloc(jobs, sizeof(pthread_t));
+    bool ok = chunks && threads;
+    size_t next_row = 0U;
+    while (ok && next_row < job->events->row_count) {
+        ChunkQueue queue = {chunks, 0U, 0U};
+        while (queue.chunk_count < wave_size && next_row < job->events->row_count) {
+            ConvertChunk *chunk = &chunks[queue.chunk_count++];
+            memset(chunk, 0, sizeof(*chunk));
+            chunk->job = job;
+            chunk->first_row = next_row;
+            chunk->end_row = chunk_end(job, next_row);
+            next_row = chunk->end_row;
+        }
+        size_t started = 0U;
+        for (size_t i = 1; i < jobs && i < queue.chunk_count; ++i) {
+            if (pthread_create(&threads[i], NULL, chunk_worker, &queue) != 0) {
+                break;
+            }
+            started = i;
+        }
+        chunk_worker(&queue);
+        for (size_t i = 1; i <= started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+
+        for (size_t i = 0; i < queue.chunk_count; ++i) {
+            ConvertChunk *chunk = &chunks[i];
+            if (ok && !chunk->ok) {
+                fprintf(stderr, "%s\n", chunk->error[0] ? chunk->error : "conversion failed");
+                ok = false;
+            }
+            if (ok && fwrite(chunk->output, 1, chunk->output_size, trace) != chunk->output_size) {
+                perror("trace");
+                ok = false;
+            }
+            if (ok) {
+                result->rows += chunk->end_row - chunk->first_row;
+                result->rows_verified += chunk->rows_verified;
+                result->trace_bytes += chunk->output_size;
+            }
+            free(chunk->output);
+            chunk->output = NULL;
+        }
+    }
+    free(threads);
+    free(chunks);
+    return ok;
+}
+
+/* ===========================================================
+   PROVENANCE
+   =========================================================== */
+
+static void write_json_string(FILE *file, const char *text) {
+    fputc('"', file);
+    for (const unsigned char *cursor = (const unsigned char *)text; *cursor; ++cursor) {
+        if (*cursor == '"' || *cursor == '\\') {
+            fprintf(file, "\\%c", *cursor);
+        } else if (*cursor < 0x20U) {
+            fprintf(file, "\\u%04x", *cursor);
+        } else {
+            fputc(*cursor, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static void write_source_json(FILE *file, const char *label, const CsvFile *source) {
+    fprintf(file, "  \"%s\": {\n    \"path\": ", label);
+    write_json_string(file, source->path);
+    fprintf(file,
+            ",\n    \"bytes\": %llu,\n    \"mtime_ns\": %lld,\n    \"rows\": %zu,\n"
+            "    \"columns\": ",
+            (unsigned long long)source->size,
+            (long long)source->info.st_mtim.tv_sec * 1000000000LL +
+                (long long)source->info.st_mtim.tv_nsec,
+            source->row_count);
+    write_json_string(file, source->header);
+    fprintf(file, "\n  },\n");
+}
+
+static bool write_provenance(const char *path, const char *trace_path, const ConvertJob *job,
+                             const ConvertResult *result, size_t jobs, double seconds) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+
+    fprintf(file, "{\n  \"tool\": \"trts_convert\",\n  \"trace_format_version\": %d,\n",
+            TRACE_FORMAT_VERSION);
+    fprintf(file, "  \"converted_at\": \"%s\",\n  \"trace\": ", stamp);
+    write_json_string(file, trace_path);
+    fprintf(file, ",\n  \"trace_bytes\": %llu,\n  \"rows\": %zu,\n",
+            (unsigned long long)result->trace_bytes, result->rows);
+    write_source_json(file, "events", job->events);
+    write_source_json(file, "values", job->values);
+
+    fprintf(file, "  \"defaulted_columns\": [");
+    bool first = true;
+    const CsvFile *sources[2] = {job->events, job->values};
+    const ColumnSpec *tables[2] = {EVENT_COLUMNS, VALUE_COLUMNS};
+    const size_t table_counts[2] = {ARRAY_COUNT(EVENT_COLUMNS), ARRAY_COUNT(VALUE_COLUMNS)};
+    for (size_t s = 0; s < 2U; ++s) {
+        for (size_t i = 0; i < table_counts[s]; ++i) {
+            const ColumnSpec *spec = &tables[s][i];
+            bool present = false;
+            for (size_t c = 0; c < sources[s]->column_count && !present; ++c) {
+                present = sources[s]->columns[c]->kind == spec->kind &&
+                          sources[s]->columns[c]->value == spec->value;
+            }
+            // tick/mt come from either file, event_type is an alias.
+            if (present || spec->kind == COLUMN_TICK || spec->kind == COLUMN_MICROTICK ||
+                strcmp(spec->name, "event_type") == 0) {
+                continue;
+            }
+            fprintf(file, "%s\"%s\"", first ? "" : ", ", spec->name);
+            first = false;
+        }
+    }
+    fprintf(file, "],\n");
+    fprintf(file,
+            "  \"verification\": {\"every\": %zu, \"rows_verified\": %zu, \"mismatches\": 0},\n",
+            job->verify_every, result->rows_verified);
+    fprintf(file, "  \"jobs\": %zu,\n  \"seconds\": %.3f\n}\n", jobs, seconds);
+    return fclose(file) == 0;
+}
+
+/* ===========================================================
+   DRIVER
+   =========================================================== */
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+static bool convert_pair(const char *events_path, const char *values_path,
+                         const char *trace_path, size_t jobs, size_t verify_every, bool force) {
+    char provenance_path[1024];
+    snprintf(provenance_path, sizeof(provenance_path), "%s.provenance.json", trace_path);
+    if (!force && access(trace_path, F_OK) == 0 && access(provenance_path, F_OK) == 0) {
+        printf("%s: already converted\n", trace_path);
+        return true;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CsvFile events;
+    CsvFile values;
+    if (!csv_file_open(&events, events_path, EVENT_COLUMNS, ARRAY_COUNT(EVENT_COLUMNS), jobs)) {
+        return false;
+    }
+    if (!csv_file_open(&values, values_path, VALUE_COLUMNS, ARRAY_COUNT(VALUE_COLUMNS), jobs)) {
+        csv_file_close(&events);
+        return false;
+    }
+
+    bool ok = true;
+    if (events.row_count != values.row_count) {
+        fprintf(stderr, "%s has %zu rows but %s has %zu\n", events_path, events.row_count,
+                values_path, values.row_count);
+        ok = false;
+    } else if (!has_column(&events, COLUMN_TICK) || !has_column(&events, COLUMN_MICROTICK) ||
+               !has_column(&values, COLUMN_TICK) || !has_column(&values, COLUMN_MICROTICK) ||
+               !has_column(&events, COLUMN_PHASE)) {
+        fprintf(stderr, "%s / %s: tick, mt and phase columns are required\n", events_path,
+                values_path);
+        ok = false;
+    }
+
+    ConvertJob job;
+    memset(&job, 0, sizeof(job));
+    job.events = &events;
+    job.values = &values;
+    job.verify_every = verify_every;
+    for (size_t i = 0; i < values.column_count; ++i) {
+        if (values.columns[i]->kind == COLUMN_COMPONENT) {
+            job.component_present[values.columns[i]->value] = true;
+        }
+    }
+
+    ConvertResult result = {0U, 0U, 0U};
+    FILE *trace = NULL;
+    if (ok) {
+        trace = fopen(trace_path, "wb");
+        if (!trace) {
+            perror(trace_path);
+            ok = false;
+        }
+    }
+    if (ok) {
+        long header_size = 0;
+        ok = trace_write_header(trace, true) && (header_size = ftell(trace)) > 0 &&
+             convert_rows(&job, trace, jobs, &result);
+        result.trace_bytes += (uint64_t)header_size;
+    }
+    if (trace && fclose(trace) != 0) {
+        perror(trace_path);
+        ok = false;
+    }
+    if (ok) {
+        ok = write_provenance(provenance_path, trace_path, &job, &result, jobs,
+                              elapsed_seconds(&start));
+    }
+    if (ok) {
+        printf("%s: %zu rows, %zu verified, %llu -> %llu bytes in %.2fs\n", trace_path,
+               result.rows, result.rows_verified,
+               (unsigned long long)(events.size + values.size),
+               (unsigned long long)result.trace_bytes, elapsed_seconds(&start));
+    } else if (trace) {
+        unlink(trace_path);
+        unlink(provenance_path);
+    }
+    csv_file_close(&values);
+    csv_file_close(&events);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *events_path = NULL;
+    const char *values_path = NULL;
+    const char *output_path = NULL;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t jobs = processors > 0 ? (size_t)processors : 1U;
+    size_t verify_every = CONVERT_DEFAULT_VERIFY_EVERY;
+    bool force = false;
+    int first_directory = argc;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (strcmp(argv[i], "--values") == 0 && i + 1 < argc) {
+            values_path = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            jobs = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--verify-every") == 0 && i + 1 < argc) {
+            verify_every = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (argv[i][0] == '-') {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            first_directory = i;
+            break;
+        }
+    }
+    if (jobs == 0U) {
+        jobs = 1U;
+    }
+
+    bool explicit_pair = events_path || values_path || output_path;
+    if (explicit_pair ? (!events_path || !values_path || !output_path || first_directory < argc)
+                      : first_directory >= argc) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (explicit_pair) {
+        return convert_pair(events_path, values_path, output_path, jobs, verify_every, force)
+                   ? EXIT_SUCCESS
+                   : EXIT_FAILURE;
+    }
+
+    size_t failures = 0U;
+    for (int i = first_directory; i < argc; ++i) {
+        char events[1024];
+        char values[1024];
+        char trace[1024];
+        snprintf(events, sizeof(events), "%s/events.csv", argv[i]);
+        snprintf(values, sizeof(values), "%s/values.csv", argv[i]);
+        snprintf(trace, sizeof(trace), "%s/run.trace", argv[i]);
+        if (!convert_pair(events, values, trace, jobs, verify_every, force)) {
+            fprintf(stderr, "%s: conversion failed\n", argv[i]);
+            ++failures;
+        }
+    }
+    if (failures > 0U) {
+        fprintf(stderr, "%zu of %d run directories failed\n", failures, argc - first_directory);
+    }
+    return failures == 0U ? EXIT_SUCCESS : EXIT_FAILURE;
+}
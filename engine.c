@@ -17,6 +17,7 @@
 #include <stdbool.h>
 
 #include "rational.h"
+#include "threshold.h"
 
 // Forward declarations of helpers
 static EngineTrackMode convert_engine_mode(EngineMode mode);
@@ -37,8 +38,8 @@ static void apply_sign_flip(const Config *config, TRTS_State *state,
 static void update_triangle(const Config *config, TRTS_State *state);
 static void apply_delta_cross(const Config *config, TRTS_State *state,
                                mpq_t new_upsilon, mpq_t new_beta);
-static void apply_modular_wrap(const Config *config, TRTS_State *state);
-static void rational_mod_bound(mpq_t value, const mpz_t bound);
+static void apply_modular_wrap(const Config *config, TRTS_State *state,
+                               EngineReducer *reducer);
 
 /* ===========================================================
    Helper functions
@@ -115,12 +116,20 @@ static EngineTrackMode apply_koppa_gate(const Config *config,
     mpz_init(magnitude);
     rational_abs_num(magnitude, state->koppa);
     EngineTrackMode result = base_mode;
-    if (mpz_cmp_ui(magnitude, 10UL) < 0) {
+    bool slide = mpz_cmp_ui(magnitude, config->koppa_gate_slide_below) < 0;
+    if (config->threshold_tracker) {
+        threshold_record_z(config->threshold_tracker, THRESHOLD_KOPPA_GATE_SLIDE,
+                           THRESHOLD_ABOVE, magnitude, slide);
+    }
+    if (slide) {
         result = ENGINE_TRACK_SLIDE;
-    } else if (mpz_cmp_ui(magnitude, 100UL) < 0) {
-        result = ENGINE_TRACK_MULTI;
     } else {
-        result = ENGINE_TRACK_ADD;
+        bool multi = mpz_cmp_ui(magnitude, config->koppa_gate_multi_below) < 0;
+        if (config->threshold_tracker) {
+            threshold_record_z(config->threshold_tracker, THRESHOLD_KOPPA_GATE_MULTI,
+                               THRESHOLD_ABOVE, magnitude, multi);
+        }
+        result = multi ? ENGINE_TRACK_MULTI : ENGINE_TRACK_ADD;
     }
     mpz_clear(magnitude);
     return result;
@@ -217,54 +226,82 @@ static void apply_delta_cross(const Config *config, TRTS_State *state,
     }
 }
 
-// Reduce a rational's numerator and denominator modulo bound.  If bound is
-// zero this function does nothing.  This helper maintains the sign of the
-// numerator and denominator separately and never canonicalises the result.
-static void rational_mod_bound(mpq_t value, const mpz_t bound) {
-    if (mpz_cmp_ui(bound, 0UL) == 0) {
-        return;
+void engine_reducer_init(EngineReducer *reducer, const Config *config) {
+    mpz_init(reducer->bound);
+    mpz_init(reducer->remainder);
+    mpq_init(reducer->quotient);
+    reducer->enabled = mpz_sgn(config->modulus_bound) > 0;
+    reducer->power_of_two = false;
+    reducer->bound_bits = 0;
+    if (reducer->enabled) {
+        mpz_set(reducer->bound, config->modulus_bound);
+        reducer->bound_bits = mpz_sizeinbase(reducer->bound, 2) - 1U;
+        reducer->power_of_two = mpz_scan1(reducer->bound, 0) == reducer->bound_bits;
     }
-    mpz_ptr num = mpq_numref(value);
-    mpz_ptr den = mpq_denref(value);
-    // Reduce numerator modulo bound while preserving sign
-    mpz_t rem;
-    mpz_init(rem);
-    mpz_mod(rem, num, bound);
-    // Ensure remainder has same sign as original numerator
-    if (mpz_sgn(num) < 0 && mpz_cmp_ui(rem, 0UL) != 0) {
-        mpz_sub(rem, rem, bound);
+}
+
+void engine_reducer_clear(EngineReducer *reducer) {
+    mpz_clear(reducer->bound);
+    mpz_clear(reducer->remainder);
+    mpq_clear(reducer->quotient);
+}
+
+// value mod bound with the sign of value (mpz_mod followed by subtracting
+// the bound from a non-zero remainder of a negative value), i.e. the
+// truncated remainder.  When keep_on_zero is set a zero remainder leaves
+// value unchanged.
+static void reduce_signed(EngineReducer *reducer, mpz_ptr value, bool keep_on_zero) {
+    if (mpz_cmpabs(value, reducer->bound) < 0) {
+        return;
     }
-    mpz_set(num, rem);
-    // Reduce denominator modulo bound while preserving sign
-    mpz_mod(rem, den, bound);
-    if (mpz_sgn(den) < 0 && mpz_cmp_ui(rem, 0UL) != 0) {
-        mpz_sub(rem, rem, bound);
+    if (reducer->power_of_two) {
+        mpz_tdiv_r_2exp(reducer->remainder, value, reducer->bound_bits);
+    } else {
+        mpz_tdiv_r(reducer->remainder, value, reducer->bound);
     }
-    if (mpz_cmp_ui(rem, 0UL) != 0) {
-        mpz_set(den, rem);
+    if (!keep_on_zero || mpz_sgn(reducer->remainder) != 0) {
+        mpz_swap(value, reducer->remainder);
     }
-    mpz_clear(rem);
 }
 
-static void apply_modular_wrap(const Config *config, TRTS_State *state) {
+// Reduce a rational's numerator and denominator modulo the reducer's bound.
+// The sign of the numerator and denominator is kept separately and the
+// result is never canonicalised; a denominator that is a multiple of the
+// bound is left as it is.
+static void rational_mod_bound(EngineReducer *reducer, mpq_t value) {
+    reduce_signed(reducer, mpq_numref(value), false);
+    reduce_signed(reducer, mpq_denref(value), true);
+}
+
+// κ ← κ mod β exactly as rational_mod() computes it: the canonical quotient
+// n/d minus its floor, which is (n fdiv_r d)/d in the same canonical form.
+static void koppa_wrap(EngineReducer *reducer, TRTS_State *state) {
+    mpq_div(reducer->quotient, state->koppa, state->beta);
+    mpz_fdiv_r(mpq_numref(state->koppa), mpq_numref(reducer->quotient),
+               mpq_denref(reducer->quotient));
+    mpz_swap(mpq_denref(state->koppa), mpq_denref(reducer->quotient));
+}
+
+static void apply_modular_wrap(const Config *config, TRTS_State *state,
+                               EngineReducer *reducer) {
     if (!config->enable_modular_wrap) {
         return;
     }
     // Original behaviour: wrap κ modulo β when |κ| > koppa_wrap_threshold
-    mpz_t magnitude;
-    mpz_init(magnitude);
-    rational_abs_num(magnitude, state->koppa);
-    if (mpz_cmp_ui(magnitude, config->koppa_wrap_threshold) > 0) {
-        // Wrap κ by β; use rational_mod() from rational.c
-        rational_mod(state->koppa, state->koppa, state->beta);
+    bool wrap = mpz_cmpabs_ui(mpq_numref(state->koppa), config->koppa_wrap_threshold) > 0;
+    if (config->threshold_tracker) {
+        threshold_record_z(config->threshold_tracker, THRESHOLD_KOPPA_WRAP, THRESHOLD_BELOW,
+                           mpq_numref(state->koppa), wrap);
+    }
+    if (wrap) {
+        koppa_wrap(reducer, state);
     }
-    mpz_clear(magnitude);
     // New behaviour: reduce upsilon, beta and koppa by modulus_bound if set
     // This does not interfere with the above wrap.
-    if (mpz_cmp_ui(config->modulus_bound, 0UL) > 0) {
-        rational_mod_bound(state->upsilon, config->modulus_bound);
-        rational_mod_bound(state->beta, config->modulus_bound);
-        rational_mod_bound(state->koppa, config->modulus_bound);
+    if (reducer->enabled) {
+        rational_mod_bound(reducer, state->upsilon);
+        rational_mod_bound(reducer, state->beta);
+        rational_mod_bound(reducer, state->koppa);
     }
 }
 
@@ -273,6 +310,15 @@ static void apply_modular_wrap(const Config *config, TRTS_State *state) {
    =========================================================== */
 
 bool engine_step(const Config *config, TRTS_State *state, int microtick) {
+    EngineReducer reducer;
+    engine_reducer_init(&reducer, config);
+    bool success = engine_step_reduced(config, state, microtick, &reducer);
+    engine_reducer_clear(&reducer);
+    return success;
+}
+
+bool engine_step_reduced(const Config *config, TRTS_State *state, int microtick,
+                         EngineReducer *reducer) {
     mpq_t ups_before;
     mpq_t beta_before;
     rational_init(ups_before);
@@ -310,7 +356,7 @@ bool engine_step(const Config *config, TRTS_State *state, int microtick) {
     apply_delta_cross(config, state, new_upsilon, new_beta);
     apply_sign_flip(config, state, new_upsilon, new_beta);
     update_triangle(config, state);
-    apply_modular_wrap(config, state);
+    apply_modular_wrap(config, state, reducer);
     if (success) {
         rational_set(state->upsilon, new_upsilon);
         rational_set(state->beta, new_beta);
@@ -20,11 +20,32 @@ Violation of these principles invalidates all results. There are no exceptions.
 #ifndef ENGINE_H
 #define ENGINE_H
 
+#include <gmp.h>
 #include <stdbool.h>
 
 #include "config.h"
 #include "state.h"
 
+// Reduction context for the modular wrap, built once per run from
+// config->modulus_bound so the E phase neither re-examines the bound nor
+// allocates temporaries on every step.  A power-of-two bound reduces by
+// masking; values already inside the bound are left untouched.
+typedef struct {
+    bool enabled;
+    bool power_of_two;
+    mp_bitcnt_t bound_bits;
+    mpz_t bound;
+    mpz_t remainder;
+    mpq_t quotient;      // scratch for the koppa-by-beta wrap
+} EngineReducer;
+
+void engine_reducer_init(EngineReducer *reducer, const Config *config);
+void engine_reducer_clear(EngineReducer *reducer);
+
 bool engine_step(const Config *config, TRTS_State *state, int microtick);
 
+// engine_step() with a reducer prepared by engine_reducer_init() for config.
+bool engine_step_reduced(const Config *config, TRTS_State *state, int microtick,
+                         EngineReducer *reducer);
+
 #endif // ENGINE_H
@@ -70,14 +70,19 @@ def parse_arguments(argv: Sequence[str]) -> argparse.Namespace:
     return parser.parse_args(argv)
 
 
-def _safe_fraction(numerator: Optional[str], denominator: Optional[str]) -> Optional[Fraction]:
+RADIX_MARKER = "#radix="
+
+
+def _safe_fraction(
+    numerator: Optional[str], denominator: Optional[str], radix: int = 10
+) -> Optional[Fraction]:
     """Create a :class:`Fraction` from CSV columns, tolerating bad data."""
 
     if numerator is None or denominator is None:
         return None
     try:
-        num = int(numerator)
-        den = int(denominator)
+        num = int(numerator, radix)
+        den = int(denominator, radix)
         if den == 0:
             return None
     except (TypeError, ValueError):
@@ -94,12 +99,20 @@ def _parse_bool(value: Optional[str]) -> bool:
     return value in {"1", "true", "yes", "y", "on"}
 
 
-def _read_csv_rows(path: str) -> Tuple[List[str], List[Dict[str, str]]]:
+def _read_csv_rows(path: str) -> Tuple[List[str], List[Dict[str, str]], int]:
+    """Return headers, rows and the radix announced by a ``#radix=N`` line."""
+
+    radix = 10
     with open(path, "r", encoding="utf-8") as handle:
+        first = handle.readline()
+        if first.startswith(RADIX_MARKER):
+            radix = int(first[len(RADIX_MARKER):])
+        else:
+            handle.seek(0)
         reader = csv.DictReader(handle)
         rows = list(reader)
         headers = reader.fieldnames or []
-    return headers, rows
+    return headers, rows, radix
 
 
 def _is_value_table(headers: Sequence[str]) -> bool:
@@ -166,12 +179,12 @@ def load_snapshots(paths: Sequence[str]) -> Dict[Tuple[int, int], MicrotickSnaps
 
         extension = os.path.splitext(path)[1].lower()
         if extension == ".csv":
-            headers, rows = _read_csv_rows(path)
+            headers, rows, radix = _read_csv_rows(path)
             if not headers:
                 continue
             header_lower = [h.lower() for h in headers]
             if _is_value_table(header_lower):
-                _load_value_rows(rows, snapshots)
+                _load_value_rows(rows, snapshots, radix)
             elif _is_event_table(header_lower):
                 _load_event_rows(rows, snapshots)
             else:
@@ -189,7 +202,9 @@ def _snapshot_for(snapshots: Dict[Tuple[int, int], MicrotickSnapshot], tick: int
     return snapshots[key]
 
 
-def _load_value_rows(rows: Iterable[Dict[str, str]], snapshots: Dict[Tuple[int, int], MicrotickSnapshot]) -> None:
+def _load_value_rows(
+    rows: Iterable[Dict[str, str]], snapshots: Dict[Tuple[int, int], MicrotickSnapshot], radix: int = 10
+) -> None:
     for row in rows:
         tick = _extract_int(row, "tick")
         mt = _extract_int(row, "mt")
@@ -197,11 +212,11 @@ def _load_value_rows(rows: Iterable[Dict[str, str]], snapshots: Dict[Tuple[int,
             continue
 
         snapshot = _snapshot_for(snapshots, tick, mt)
-        snapshot.upsilon = _safe_fraction(row.get("upsilon_num"), row.get("upsilon_den"))
-        snapshot.beta = _safe_fraction(row.get("beta_num"), row.get("beta_den"))
-        snapshot.koppa = _safe_fraction(row.get("koppa_num"), row.get("koppa_den"))
-        snapshot.memory = _safe_fraction(row.get("memory_num"), row.get("memory_den"))
-        snapshot.phi = _safe_fraction(row.get("phi_num"), row.get("phi_den"))
+        snapshot.upsilon = _safe_fraction(row.get("upsilon_num"), row.get("upsilon_den"), radix)
+        snapshot.beta = _safe_fraction(row.get("beta_num"), row.get("beta_den"), radix)
+        snapshot.koppa = _safe_fraction(row.get("koppa_num"), row.get("koppa_den"), radix)
+        snapshot.memory = _safe_fraction(row.get("memory_num"), row.get("memory_den"), radix)
+        snapshot.phi = _safe_fraction(row.get("phi_num"), row.get("phi_den"), radix)
 
         if snapshot.upsilon is not None and snapshot.beta not in (None, Fraction(0, 1)):
             snapshot.ratio_snapshot = float(snapshot.upsilon) / float(snapshot.beta)
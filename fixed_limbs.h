@@ -0,0 +1,396 @@
+// fixed_limbs.h
+// Fixed-capacity integers for the mid-size regime.  Between single-word
+// values and truly big ones, most runs spend long stretches with components
+// of two to eight limbs, where mpz call overhead, size normalisation and
+// allocation checks cost as much as the arithmetic itself.  FixedInt keeps
+// its limbs inline, in mpz's signed-size layout, with room for the product
+// of two FIXED_LIMBS-limb values; the kernels are unrolled for every operand
+// length up to FIXED_LIMBS and fall back to plain loops beyond it.
+//
+// The kernels never canonicalise anything: they compute exactly the
+// integers mpz_add, mpz_sub, mpz_mul and mpz_cmp would, so a caller can take
+// the fixed path or the mpz path and get bit-identical results.  Every
+// operation that could produce more than FIXED_CAPACITY limbs returns false
+// instead, leaving the caller to promote to GMP; so does fixed_set_mpz on a
+// wider operand, and on platforms without 64-bit limbs and a 128-bit
+// product everything does, so the tier simply switches itself off there.
+
+#ifndef FIXED_LIMBS_H
+#define FIXED_LIMBS_H
+
+#include <gmp.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FIXED_LIMBS 8
+#define FIXED_CAPACITY (2 * FIXED_LIMBS)
+
+#if GMP_NUMB_BITS == 64 && GMP_NAIL_BITS == 0 && defined(__SIZEOF_INT128__)
+#define FIXED_LIMBS_AVAILABLE 1
+#else
+#define FIXED_LIMBS_AVAILABLE 0
+#endif
+
+typedef struct {
+    mp_limb_t limbs[FIXED_CAPACITY];
+    int size;       // limb count, negated for negative values; 0 is zero
+} FixedInt;
+
+static inline int fixed_abs_size(int size) {
+    return size < 0 ? -size : size;
+}
+
+static inline int fixed_sgn(const FixedInt *value) {
+    return value->size > 0 ? 1 : (value->size < 0 ? -1 : 0);
+}
+
+static inline void fixed_neg(FixedInt *value) {
+    value->size = -value->size;
+}
+
+static inline void fixed_set_limb(FixedInt *dest, mp_limb_t value) {
+    dest->limbs[0] = value;
+    dest->size = value != 0 ? 1 : 0;
+}
+
+// False (dest untouched) when src does not fit.
+static inline bool fixed_set_mpz(FixedInt *dest, mpz_srcptr src) {
+#if FIXED_LIMBS_AVAILABLE
+    int size = (int)mpz_size(src);
+    if (size > FIXED_CAPACITY) {
+        return false;
+    }
+    const mp_limb_t *limbs = mpz_limbs_read(src);
+    for (int i = 0; i < size; ++i) {
+        dest->limbs[i] = limbs[i];
+    }
+    dest->size = mpz_sgn(src) < 0 ? -size : size;
+    return true;
+#else
+    (void)dest;
+    (void)src;
+    return false;
+#endif
+}
+
+static inline void fixed_get_mpz(mpz_ptr dest, const FixedInt *src) {
+    int size = fixed_abs_size(src->size);
+    mp_limb_t *limbs = mpz_limbs_write(dest, size > 0 ? size : 1);
+    for (int i = 0; i < size; ++i) {
+        limbs[i] = src->limbs[i];
+    }
+    mpz_limbs_finish(dest, src->size);
+}
+
+#if FIXED_LIMBS_AVAILABLE
+
+// ---------------------------------------------------------------------------
+// Magnitude kernels.  Each FIXED_*_KERNEL(name, n) expands to a routine over
+// n limbs: with a constant n the loops unroll completely, and the _any
+// variants take n at run time for the lengths past FIXED_LIMBS.
+
+typedef unsigned __int128 fixed_dlimb_t;
+
+// r = a + b over n limbs; returns the carry out.
+#define FIXED_ADD_KERNEL(name, n)                                                    \
+    static inline mp_limb_t name(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, \
+                                 int count) {                                         \
+        (void)count;                                                                  \
+        mp_limb_t carry = 0;                                                          \
+        _Pragma("GCC unroll 8") for (int i = 0; i < (n); ++i) {                       \
+            fixed_dlimb_t sum = (fixed_dlimb_t)a[i] + b[i] + carry;                   \
+            r[i] = (mp_limb_t)sum;                                                    \
+            carry = (mp_limb_t)(sum >> 64);                                           \
+        }                                                                             \
+        return carry;                                                                 \
+    }
+
+// r = a - b over n limbs; returns the borrow out.
+#define FIXED_SUB_KERNEL(name, n)                                                    \
+    static inline mp_limb_t name(mp_limb_t *r, const mp_limb_t *a, const mp_limb_t *b, \
+                                 int count) {                                         \
+        (void)count;                                                                  \
+        mp_limb_t borrow = 0;                                                         \
+        _Pragma("GCC unroll 8") for (int i = 0; i < (n); ++i) {                       \
+            mp_limb_t x = a[i];                                                       \
+            mp_limb_t y = b[i];                                                       \
+            r[i] = x - y - borrow;                                                    \
+            borrow = (mp_limb_t)((x < y) | ((x == y) & borrow));                      \
+        }                                                                             \
+        return borrow;                                                                \
+    }
+
+// Compare a and b over n limbs, most significant first.
+#define FIXED_CMP_KERNEL(name, n)                                                    \
+    static inline int name(const mp_limb_t *a, const mp_limb_t *b, int count) {      \
+        (void)count;                                                                  \
+        _Pragma("GCC unroll 8") for (int i = (n) - 1; i >= 0; --i) {                  \
+            if (a[i] != b[i]) {                                                       \
+                return a[i] > b[i] ? 1 : -1;                                          \
+            }                                                                         \
+        }                                                                             \
+        return 0;                                                                     \
+    }
+
+// Schoolbook product of an-limb a and n-limb b into an + n limbs of r: one
+// multiply-accumulate row over b per limb of a.
+#define FIXED_MUL_KERNEL(name, n)                                                    \
+    static inline void name(mp_limb_t *r, const mp_limb_t *a, int an, const mp_limb_t *b, \
+                            int count) {                                              \
+        (void)count;                                                                  \
+        mp_limb_t carry = 0;                                                          \
+        _Pragma("GCC unroll 8") for (int j = 0; j < (n); ++j) {                       \
+            fixed_dlimb_t product = (fixed_dlimb_t)a[0] * b[j] + carry;               \
+            r[j] = (mp_limb_t)product;                                                \
+            carry = (mp_limb_t)(product >> 64);                                       \
+        }                                                                             \
+        r[(n)] = carry;                                                               \
+        for (int i = 1; i < an; ++i) {                                                \
+            mp_limb_t ai = a[i];                                                      \
+            carry = 0;                                                                \
+            _Pragma("GCC unroll 8") for (int j = 0; j < (n); ++j) {                   \
+                fixed_dlimb_t product = (fixed_dlimb_t)ai * b[j] + r[i + j] + carry;  \
+                r[i + j] = (mp_limb_t)product;                                        \
+                carry = (mp_limb_t)(product >> 64);                                   \
+            }                                                                         \
+            r[i + (n)] = carry;                                                       \
+        }                                                                             \
+    }
+
+#define FIXED_KERNELS(suffix, n)                                                     \
+    FIXED_ADD_KERNEL(fixed_add_##suffix, n)                                           \
+    FIXED_SUB_KERNEL(fixed_sub_##suffix, n)                                           \
+    FIXED_CMP_KERNEL(fixed_cmp_##suffix, n)                                           \
+    FIXED_MUL_KERNEL(fixed_mul_##suffix, n)
+
+FIXED_KERNELS(1, 1)
+FIXED_KERNELS(2, 2)
+FIXED_KERNELS(3, 3)
+FIXED_KERNELS(4, 4)
+FIXED_KERNELS(5, 5)
+FIXED_KERNELS(6, 6)
+FIXED_KERNELS(7, 7)
+FIXED_KERNELS(8, 8)
+FIXED_KERNELS(any, count)
+
+#undef FIXED_KERNELS
+#undef FIXED_MUL_KERNEL
+#undef FIXED_CMP_KERNEL
+#undef FIXED_SUB_KERNEL
+#undef FIXED_ADD_KERNEL
+
+#define FIXED_DISPATCH(n, call)                                                      \
+    switch (n) {                                                                      \
+    case 1: call(1); break;                                                           \
+    case 2: call(2); break;                                                           \
+    case 3: call(3); break;                                                           \
+    case 4: call(4); break;                                                           \
+    case 5: call(5); break;                                                           \
+    case 6: call(6); break;                                                           \
+    case 7: call(7); break;                                                           \
+    case 8: call(8); break;                                                           \
+    default: call(any); break;                                                        \
+    }
+
+// Compare |a| with |b| for sizes an, bn > 0.
+static inline int fixed_cmpabs_n(const mp_limb_t *a, int an, const mp_limb_t *b, int bn) {
+    if (an != bn) {
+        return an > bn ? 1 : -1;
+    }
+    int result = 0;
+#define FIXED_CALL(k) result = fixed_cmp_##k(a, b, an)
+    FIXED_DISPATCH(an, FIXED_CALL)
+#undef FIXED_CALL
+    return result;
+}
+
+// r = |a| + |b| with an >= bn > 0.  False when the sum needs more than
+// FIXED_CAPACITY limbs; otherwise *rn is the size of r.
+static inline bool fixed_add_abs(mp_limb_t *r, int *rn, const mp_limb_t *a, int an,
+                                 const mp_limb_t *b, int bn) {
+    mp_limb_t carry = 0;
+#define FIXED_CALL(k) carry = fixed_add_##k(r, a, b, bn)
+    FIXED_DISPATCH(bn, FIXED_CALL)
+#undef FIXED_CALL
+    for (int i = bn; i < an; ++i) {
+        mp_limb_t sum = a[i] + carry;
+        carry = (mp_limb_t)(sum < carry);
+        r[i] = sum;
+    }
+    if (carry) {
+        if (an == FIXED_CAPACITY) {
+            return false;
+        }
+        r[an++] = carry;
+    }
+    *rn = an;
+    return true;
+}
+
+// r = |a| - |b| with |a| > |b| > 0; returns the normalised size of r.
+static inline int fixed_sub_abs(mp_limb_t *r, const mp_limb_t *a, int an, const mp_limb_t *b,
+                                int bn) {
+    mp_limb_t borrow = 0;
+#define FIXED_CALL(k) borrow = fixed_sub_##k(r, a, b, bn)
+    FIXED_DISPATCH(bn, FIXED_CALL)
+#undef FIXED_CALL
+    for (int i = bn; i < an; ++i) {
+        mp_limb_t x = a[i];
+        r[i] = x - borrow;
+        borrow = (mp_limb_t)(x < borrow);
+    }
+    while (an > 0 && r[an - 1] == 0) {
+        --an;
+    }
+    return an;
+}
+
+#endif // FIXED_LIMBS_AVAILABLE
+
+// ---------------------------------------------------------------------------
+// Signed operations.  r may alias an operand.
+
+static inline int fixed_cmpabs(const FixedInt *a, const FixedInt *b) {
+#if FIXED_LIMBS_AVAILABLE
+    int an = fixed_abs_size(a->size);
+    int bn = fixed_abs_size(b->size);
+    if (an == 0 || bn == 0) {
+        return an == bn ? 0 : (an > 0 ? 1 : -1);
+    }
+    return fixed_cmpabs_n(a->limbs, an, b->limbs, bn);
+#else
+    (void)a;
+    (void)b;
+    return 0;
+#endif
+}
+
+static inline int fixed_cmp(const FixedInt *a, const FixedInt *b) {
+    if (a->size != b->size) {
+        return a->size > b->size ? 1 : -1;
+    }
+    int magnitude = fixed_cmpabs(a, b);
+    return a->size < 0 ? -magnitude : magnitude;
+}
+
+// r = a + b, or a - b when subtract is set.
+static inline bool fixed_add_signed(FixedInt *r, const FixedInt *a, const FixedInt *b,
+                                    bool subtract) {
+#if FIXED_LIMBS_AVAILABLE
+    int bsize = subtract ? -b->size : b->size;
+    if (bsize == 0) {
+        *r = *a;
+        return true;
+    }
+    if (a->size == 0) {
+        *r = *b;
+        r->size = bsize;
+        return true;
+    }
+    int an = fixed_abs_size(a->size);
+    int bn = fixed_abs_size(bsize);
+    mp_limb_t limbs[FIXED_CAPACITY];
+    int size = 0;
+    if ((a->size < 0) == (bsize < 0)) {
+        bool ok = an >= bn ? fixed_add_abs(limbs, &size, a->limbs, an, b->limbs, bn)
+                           : fixed_add_abs(limbs, &size, b->limbs, bn, a->limbs, an);
+        if (!ok) {
+            return false;
+        }
+        size = a->size < 0 ? -size : size;
+    } else {
+        int order = fixed_cmpabs_n(a->limbs, an, b->limbs, bn);
+        if (order == 0) {
+            r->size = 0;
+            return true;
+        }
+        if (order > 0) {
+            size = fixed_sub_abs(limbs, a->limbs, an, b->limbs, bn);
+            size = a->size < 0 ? -size : size;
+        } else {
+            size = fixed_sub_abs(limbs, b->limbs, bn, a->limbs, an);
+            size = bsize < 0 ? -size : size;
+        }
+    }
+    int count = fixed_abs_size(size);
+    for (int i = 0; i < count; ++i) {
+        r->limbs[i] = limbs[i];
+    }
+    r->size = size;
+    return true;
+#else
+    (void)r;
+    (void)a;
+    (void)b;
+    (void)subtract;
+    return false;
+#endif
+}
+
+static inline bool fixed_add(FixedInt *r, const FixedInt *a, const FixedInt *b) {
+    return fixed_add_signed(r, a, b, false);
+}
+
+static inline bool fixed_sub(FixedInt *r, const FixedInt *a, const FixedInt *b) {
+    return fixed_add_signed(r, a, b, true);
+}
+
+// r = a * b; false when the operands' limbs add up to more than
+// FIXED_CAPACITY (as in mpz, the product may then still fit in one less).
+static inline bool fixed_mul(FixedInt *r, const FixedInt *a, const FixedInt *b) {
+#if FIXED_LIMBS_AVAILABLE
+    int an = fixed_abs_size(a->size);
+    int bn = fixed_abs_size(b->size);
+    if (an == 0 || bn == 0) {
+        r->size = 0;
+        return true;
+    }
+    if (an + bn > FIXED_CAPACITY) {
+        return false;
+    }
+    // The rows run over b, so let b be the longer operand: while it has at
+    // most FIXED_LIMBS limbs every row is an unrolled kernel.
+    const FixedInt *rows = a;
+    const FixedInt *columns = b;
+    if (an > bn) {
+        rows = b;
+        columns = a;
+        int swap = an;
+        an = bn;
+        bn = swap;
+    }
+    // Room for any kernel's rows, even for sizes the check above rules out.
+    mp_limb_t limbs[2 * FIXED_CAPACITY];
+#define FIXED_CALL(k) fixed_mul_##k(limbs, rows->limbs, an, columns->limbs, bn)
+    FIXED_DISPATCH(bn, FIXED_CALL)
+#undef FIXED_CALL
+    int size = an + bn;
+    if (limbs[size - 1] == 0) {
+        --size;
+    }
+    bool negative = (a->size < 0) != (b->size < 0);
+    for (int i = 0; i < size; ++i) {
+        r->limbs[i] = limbs[i];
+    }
+    r->size = negative ? -size : size;
+    return true;
+#else
+    (void)r;
+    (void)a;
+    (void)b;
+    return false;
+#endif
+}
+
+#if FIXED_LIMBS_AVAILABLE
+#undef FIXED_DISPATCH
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FIXED_LIMBS_H
@@ -0,0 +1,302 @@
+/*
+ * flight_recorder.c
+ *
+ * Ring of self-contained trace rows.  Each row is encoded without
+ * cross-row references so that the oldest row can be evicted at any time
+ * and every dump is a valid trace on its own.  The encoded bytes following
+ * the tick also serve as an exact fingerprint of the logged state, which is
+ * how recurrences inside the window are detected: a hash index finds the
+ * candidate slot and a byte comparison confirms it.
+ */
+
+#include "flight_recorder.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static volatile sig_atomic_t flight_dump_requested = 0;
+
+static void flight_signal_handler(int signal_number) {
+    (void)signal_number;
+    flight_dump_requested = 1;
+}
+
+void flight_recorder_install_signal_handler(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = flight_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR1, &action, NULL);
+}
+
+// FNV-1a over the state portion of an encoded row.
+static uint64_t hash_bytes(const unsigned char *data, size_t size) {
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+bool flight_recorder_init(FlightRecorder *recorder, size_t depth, size_t byte_budget,
+                          unsigned int triggers, const char *prefix) {
+    if (depth == 0U) {
+        return false;
+    }
+    // At most half full, so probe sequences stay short.
+    size_t buckets = 2U;
+    while (buckets < depth * 2U) {
+        buckets *= 2U;
+    }
+    recorder->slots = (FlightSlot *)calloc(depth, sizeof(FlightSlot));
+    recorder->state_index = (size_t *)malloc(buckets * sizeof(size_t));
+    if (!recorder->slots || !recorder->state_index) {
+        free(recorder->slots);
+        free(recorder->state_index);
+        recorder->slots = NULL;
+        recorder->state_index = NULL;
+        return false;
+    }
+    for (size_t i = 0; i < buckets; ++i) {
+        recorder->state_index[i] = SIZE_MAX;
+    }
+    recorder->state_index_mask = buckets - 1U;
+    for (size_t i = 0; i < depth; ++i) {
+        trace_buffer_init(&recorder->slots[i].record);
+    }
+    recorder->depth = depth;
+    recorder->count = 0U;
+    recorder->next = 0U;
+    recorder->byte_budget = byte_budget;
+    recorder->bytes_in_use = 0U;
+    trace_encoder_init(&recorder->encoder, false);
+    recorder->triggers = triggers;
+    recorder->fired = 0U;
+    recorder->post_trigger_rows = 0U;
+    recorder->pending_count = 0U;
+    snprintf(recorder->prefix, sizeof(recorder->prefix), "%s", prefix ? prefix : "flight");
+    recorder->dump_count = 0U;
+    recorder->last_tick = 0U;
+    recorder->last_microtick = 0;
+    return true;
+}
+
+void flight_recorder_clear(FlightRecorder *recorder) {
+    if (!recorder->slots) {
+        return;
+    }
+    for (size_t i = 0; i < recorder->depth; ++i) {
+        trace_buffer_clear(&recorder->slots[i].record);
+    }
+    free(recorder->slots);
+    free(recorder->state_index);
+    recorder->slots = NULL;
+    recorder->state_index = NULL;
+    trace_encoder_clear(&recorder->encoder);
+}
+
+bool flight_recorder_parse_triggers(const char *text, unsigned int *triggers) {
+    unsigned int mask = 0U;
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%s", text ? text : "");
+    char *saveptr = NULL;
+    for (char *token = strtok_r(buffer, ",", &saveptr); token;
+         token = strtok_r(NULL, ",", &saveptr)) {
+        if (strcmp(token, "triple_psi") == 0) {
+            mask |= FLIGHT_TRIGGER_TRIPLE_PSI;
+        } else if (strcmp(token, "mu_zero") == 0) {
+            mask |= FLIGHT_TRIGGER_MU_ZERO;
+        } else if (strcmp(token, "recurrence") == 0) {
+            mask |= FLIGHT_TRIGGER_RECURRENCE;
+        } else if (strcmp(token, "none") != 0) {
+            return false;
+        }
+    }
+    *triggers = mask;
+    return true;
+}
+
+void flight_recorder_set_post_trigger(FlightRecorder *recorder, size_t rows) {
+    recorder->post_trigger_rows = rows < recorder->depth ? rows : recorder->depth - 1U;
+}
+
+static size_t oldest_index(const FlightRecorder *recorder) {
+    return (recorder->next + recorder->depth - recorder->count) % recorder->depth;
+}
+
+static bool same_state(const FlightSlot *a, const FlightSlot *b) {
+    size_t size = a->record.size - a->state_offset;
+    return a->state_hash == b->state_hash && b->record.size - b->state_offset == size &&
+           memcmp(a->record.data + a->state_offset, b->record.data + b->state_offset, size) == 0;
+}
+
+// Bucket holding the slot with the same state as slot, or the empty bucket
+// where it would go.
+static size_t index_find(const FlightRecorder *recorder, const FlightSlot *slot) {
+    size_t bucket = (size_t)slot->state_hash & recorder->state_index_mask;
+    while (recorder->state_index[bucket] != SIZE_MAX &&
+           !same_state(&recorder->slots[recorder->state_index[bucket]], slot)) {
+        bucket = (bucket + 1U) & recorder->state_index_mask;
+    }
+    return bucket;
+}
+
+// Linear-probing deletion: shift later members of the cluster back so no
+// lookup stops early at the hole.
+static void index_remove(FlightRecorder *recorder, size_t bucket) {
+    size_t mask = recorder->state_index_mask;
+    size_t hole = bucket;
+    size_t probe = bucket;
+    recorder->state_index[hole] = SIZE_MAX;
+    for (;;) {
+        probe = (probe + 1U) & mask;
+        size_t slot_index = recorder->state_index[probe];
+        if (slot_index == SIZE_MAX) {
+            return;
+        }
+        size_t home = (size_t)recorder->slots[slot_index].state_hash & mask;
+        if (((probe - home) & mask) >= ((probe - hole) & mask)) {
+            recorder->state_index[hole] = slot_index;
+            recorder->state_index[probe] = SIZE_MAX;
+            hole = probe;
+        }
+    }
+}
+
+// The buffer is kept for the next row written to the slot.
+static void evict_oldest(FlightRecorder *recorder) {
+    size_t oldest = oldest_index(recorder);
+    FlightSlot *slot = &recorder->slots[oldest];
+    size_t bucket = index_find(recorder, slot);
+    // A newer slot with the same state owns the entry; leave it alone.
+    if (recorder->state_index[bucket] == oldest) {
+        index_remove(recorder, bucket);
+    }
+    recorder->bytes_in_use -= slot->record.size;
+    trace_buffer_reset(&slot->record);
+    recorder->count -= 1U;
+}
+
+// Record the newest slot in the index.  Returns true when it repeats the
+// state of an older retained slot.
+static bool index_newest(FlightRecorder *recorder, size_t newest) {
+    size_t bucket = index_find(recorder, &recorder->slots[newest]);
+    bool recurrence = recorder->state_index[bucket] != SIZE_MAX;
+    recorder->state_index[bucket] = newest;
+    return recurrence;
+}
+
+static void arm_trigger(FlightRecorder *recorder, unsigned int trigger, const char *reason) {
+    if (!(recorder->triggers & trigger) || (recorder->fired & trigger) ||
+        recorder->pending_count == FLIGHT_PENDING_MAX) {
+        return;
+    }
+    recorder->fired |= trigger;
+    FlightPending *pending = &recorder->pending[recorder->pending_count++];
+    snprintf(pending->reason, sizeof(pending->reason), "%s", reason);
+    pending->rows = recorder->post_trigger_rows;
+}
+
+void flight_recorder_record(FlightRecorder *recorder, size_t tick, int microtick, char phase,
+                            const TRTS_State *state, bool rho_event, bool psi_fired,
+                            bool mu_zero, bool forced_emission) {
+    if (recorder->count == recorder->depth) {
+        evict_oldest(recorder);
+    }
+    size_t slot_index = recorder->next;
+    FlightSlot *slot = &recorder->slots[slot_index];
+
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    trace_state_components(state, components);
+    unsigned int flags = trace_flags_from_state(state, rho_event, psi_fired, mu_zero,
+                                                forced_emission);
+
+    trace_buffer_reset(&slot->record);
+    trace_encode_row(&recorder->encoder, &slot->record, tick, microtick, phase, flags,
+                     state->koppa_sample_index, state->koppa_stack_size, components);
+
+    // The row starts with the tick varint; everything after it describes the
+    // state and is what recurrence detection compares.
+    size_t offset = 0U;
+    while (slot->record.data[offset++] & 0x80u) {
+    }
+    slot->state_offset = offset;
+    slot->state_hash = hash_bytes(slot->record.data + offset, slot->record.size - offset);
+
+    recorder->bytes_in_use += slot->record.size;
+    recorder->next = (recorder->next + 1U) % recorder->depth;
+    recorder->count += 1U;
+    recorder->last_tick = tick;
+    recorder->last_microtick = microtick;
+
+    while (recorder->byte_budget > 0U && recorder->bytes_in_use > recorder->byte_budget &&
+           recorder->count > 1U) {
+        evict_oldest(recorder);
+    }
+    bool recurrence = index_newest(recorder, slot_index);
+
+    if ((flags & TRACE_FLAG_TRIPLE_PSI) && (flags & TRACE_FLAG_PSI_FIRED)) {
+        arm_trigger(recorder, FLIGHT_TRIGGER_TRIPLE_PSI, "triple_psi");
+    }
+    if (flags & TRACE_FLAG_MU_ZERO) {
+        arm_trigger(recorder, FLIGHT_TRIGGER_MU_ZERO, "mu_zero");
+    }
+    if (recurrence) {
+        arm_trigger(recorder, FLIGHT_TRIGGER_RECURRENCE, "recurrence");
+    }
+
+    if (flight_dump_requested) {
+        flight_dump_requested = 0;
+        flight_recorder_dump(recorder, "signal");
+    }
+    size_t kept = 0U;
+    for (size_t i = 0; i < recorder->pending_count; ++i) {
+        FlightPending *pending = &recorder->pending[i];
+        if (pending->rows == 0U) {
+            flight_recorder_dump(recorder, pending->reason);
+        } else {
+            pending->rows -= 1U;
+            recorder->pending[kept++] = *pending;
+        }
+    }
+    recorder->pending_count = kept;
+}
+
+bool flight_recorder_dump(FlightRecorder *recorder, const char *reason) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s_%s_%zu_%d.trace", recorder->prefix, reason,
+             recorder->last_tick, recorder->last_microtick);
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    bool ok = trace_write_header(file, false);
+    size_t index = oldest_index(recorder);
+    for (size_t i = 0; ok && i < recorder->count; ++i) {
+        const FlightSlot *slot = &recorder->slots[index];
+        ok = trace_write_record(file, slot->record.data, slot->record.size);
+        index = (index + 1U) % recorder->depth;
+    }
+    if (fclose(file) != 0) {
+        ok = false;
+    }
+    if (ok) {
+        recorder->dump_count += 1U;
+    }
+    return ok;
+}
+
+void flight_recorder_finish(FlightRecorder *recorder) {
+    for (size_t i = 0; i < recorder->pending_count; ++i) {
+        flight_recorder_dump(recorder, recorder->pending[i].reason);
+    }
+    recorder->pending_count = 0U;
+    if (recorder->count > 0U) {
+        flight_recorder_dump(recorder, "end");
+    }
+}
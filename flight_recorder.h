@@ -0,0 +1,97 @@
+// flight_recorder.h
+// In-memory ring sink that keeps the most recent microticks in the binary
+// trace row encoding (see trace.h) and writes them out as a standalone trace
+// on request: on SIGUSR1, on the first occurrence of configured events and
+// at the end of a run.  Memory use is bounded by a row count and an optional
+// byte budget instead of growing with the run.
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "state.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    FLIGHT_TRIGGER_TRIPLE_PSI = 1u << 0,
+    FLIGHT_TRIGGER_MU_ZERO = 1u << 1,
+    FLIGHT_TRIGGER_RECURRENCE = 1u << 2
+} FlightTrigger;
+
+typedef struct {
+    TraceBuffer record;
+    size_t state_offset;
+    uint64_t state_hash;
+} FlightSlot;
+
+// An event dump waiting for its post-trigger rows.  Every trigger fires at
+// most once per run, so one entry per trigger kind is enough.
+typedef struct {
+    char reason[32];
+    size_t rows;
+} FlightPending;
+
+#define FLIGHT_PENDING_MAX 3
+
+typedef struct {
+    FlightSlot *slots;
+    size_t depth;
+    size_t count;
+    size_t next;
+    size_t byte_budget;
+    size_t bytes_in_use;
+    // Open-addressing index from state fingerprint to the newest retained
+    // slot holding that state; SIZE_MAX marks an empty bucket.
+    size_t *state_index;
+    size_t state_index_mask;
+    TraceEncoder encoder;
+    unsigned int triggers;
+    unsigned int fired;
+    size_t post_trigger_rows;
+    FlightPending pending[FLIGHT_PENDING_MAX];
+    size_t pending_count;
+    char prefix[256];
+    size_t dump_count;
+    size_t last_tick;
+    int last_microtick;
+} FlightRecorder;
+
+// depth is the number of microticks retained; byte_budget (0 = unlimited)
+// additionally caps the encoded bytes of the retained rows.  Dumps are written
+// to "<prefix>_<reason>_<tick>_<mt>.trace".
+bool flight_recorder_init(FlightRecorder *recorder, size_t depth, size_t byte_budget,
+                          unsigned int triggers, const char *prefix);
+void flight_recorder_clear(FlightRecorder *recorder);
+
+// Parse a comma separated trigger list ("triple_psi,mu_zero,recurrence").
+bool flight_recorder_parse_triggers(const char *text, unsigned int *triggers);
+
+// Number of further microticks to record after an event trigger before the
+// dump is written, so the dump holds context on both sides of the event.
+// Triggers that fire while another dump is pending get their own dump.
+void flight_recorder_set_post_trigger(FlightRecorder *recorder, size_t rows);
+
+// Route SIGUSR1 to a dump request that is honoured at the next microtick.
+void flight_recorder_install_signal_handler(void);
+
+void flight_recorder_record(FlightRecorder *recorder, size_t tick, int microtick, char phase,
+                            const TRTS_State *state, bool rho_event, bool psi_fired,
+                            bool mu_zero, bool forced_emission);
+
+bool flight_recorder_dump(FlightRecorder *recorder, const char *reason);
+
+// Flush any pending event dump and write the end-of-run dump.
+void flight_recorder_finish(FlightRecorder *recorder);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FLIGHT_RECORDER_H
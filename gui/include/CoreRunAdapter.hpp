@@ -0,0 +1,118 @@
+// gui/include/CoreRunAdapter.hpp
+// Runs simulations in-process through trts_core.  The GUI no longer carries
+// its own copy of the simulation loop, so interactive runs execute exactly
+// the code path used by trts_engine and the batch tools.  Runs started with
+// start() execute on a worker thread; each microtick is kept in the binary
+// trace row encoding and only rendered to text when a view asks for it.
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <vector>
+
+#include "TRTSConfig.hpp"
+#include "../../simulate.h"   // simulate_resumable, Config, TRTS_State
+#include "../../trace.h"      // TraceEncoder, TraceRow
+
+class QThread;
+
+// Append-only log of one run's microticks as self-contained trace rows (see
+// trace.h).  The run thread appends; any thread may decode.  Memory grows
+// with the encoded size of the run, not with its rendered text.
+class MicrotickStore {
+public:
+    MicrotickStore();
+    ~MicrotickStore();
+    MicrotickStore(const MicrotickStore &) = delete;
+    MicrotickStore &operator=(const MicrotickStore &) = delete;
+
+    void clear();
+    int size() const;
+    // Bytes held by the encoded rows.
+    size_t byteSize() const;
+
+    void append(size_t tick, int microtick, char phase, const TRTS_State *state,
+                bool rho, bool psi, bool mu_zero, bool forced);
+
+    // Decode row index into an initialised TraceRow.
+    bool decode(int index, TraceRow *row) const;
+
+private:
+    mutable QMutex      m_mutex;
+    TraceEncoder        m_encoder;   // run thread only
+    TraceBuffer         m_scratch;   // run thread only
+    TraceBuffer         m_data;
+    std::vector<size_t> m_offsets;   // start of each row in m_data
+};
+
+class CoreRunAdapter : public QObject {
+    Q_OBJECT
+public:
+    // Columns in OutputTableWidget order: tick, mt, υ, β, κ, ψ, ρ, μ, events.
+    enum Column {
+        TickColumn, MicrotickColumn, UpsilonColumn, BetaColumn, KoppaColumn,
+        PsiColumn, RhoColumn, MuColumn, EventsColumn, ColumnCount
+    };
+
+    explicit CoreRunAdapter(QObject *parent = nullptr);
+    ~CoreRunAdapter() override;
+
+    // Fill an initialised Config from the GUI configuration.  Seeds that do
+    // not parse are reported through errors and left at 0/1.
+    static void toCoreConfig(const TRTSConfig &cfg, Config *out, QStringList *errors);
+
+    // Start a run on a worker thread.  Returns false while a run is still
+    // in progress.  finished() is emitted when the run ends.
+    bool start(const TRTSConfig &cfg, const QString &tracePath = QString());
+    bool isRunning() const;
+    void wait();
+
+    // Run to completion on the calling thread.  When tracePath is not empty
+    // the core's binary trace writer records the run, producing the same
+    // bytes as `trts_engine --trace` for the same configuration.
+    bool run(const TRTSConfig &cfg, const QString &tracePath = QString());
+
+    const MicrotickStore &store() const { return m_store; }
+    // values_radix of the run held in store().
+    int radix() const { return m_radix; }
+
+    // Render one column of a decoded row.  Rationals are written as raw
+    // "numerator/denominator" exactly as the core holds them, in radix.
+    static QString columnText(const TraceRow &row, int column, int radix);
+
+signals:
+    // The store was emptied for a new run.
+    void rowsReset();
+    // Rows [first, first + count) are in the store.  Emitted in batches so
+    // the GUI thread sees a few signals per second, not one per microtick.
+    void rowsAppended(int first, int count);
+    void finished(bool ok);
+    void statusMessage(const QString &message);
+
+private:
+    static void observer(void *userData,
+                         size_t tick,
+                         int microtick,
+                         char phase,
+                         const TRTS_State *state,
+                         bool rho,
+                         bool psi,
+                         bool mu_zero,
+                         bool forced);
+    // GUI thread: build the core Config and empty the store for a new run.
+    void prepare(const TRTSConfig &cfg, Config *c);
+    // Any thread: run c to completion, appending to the store.
+    bool execute(const Config *c, const QByteArray &tracePath);
+    void publishRows();
+
+    MicrotickStore m_store;
+    QThread       *m_thread = nullptr;
+    QElapsedTimer  m_publishTimer;
+    int            m_published = 0;
+    int            m_radix = 10;
+};
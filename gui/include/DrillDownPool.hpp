@@ -0,0 +1,78 @@
+// gui/include/DrillDownPool.hpp
+// Background runs behind PhaseMapExplorer.  Each phase-map cell is run
+// through trts_core on a QThreadPool into its own MicrotickStore, so the
+// result stays in the compact binary trace encoding; finished stores are
+// kept in an LRU bounded by their encoded size.  A requested cell runs ahead
+// of prefetched ones, and every run can be cancelled at its next tick.
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QString>
+#include <QThreadPool>
+#include <QVector>
+
+#include <memory>
+
+#include "CoreRunAdapter.hpp"
+#include "TRTSConfig.hpp"
+
+class DrillDownPool : public QObject {
+    Q_OBJECT
+public:
+    explicit DrillDownPool(QObject *parent = nullptr);
+    // Cancels every run and waits for the workers.
+    ~DrillDownPool() override;
+
+    // Encoded bytes of finished runs kept for revisits.
+    void setCacheBudget(size_t bytes);
+
+    // Run cell key, ahead of any prefetch, unless it is cached or already
+    // running.  The previous request is cancelled if it has not finished.
+    // Rows stream through cellRowsAppended(); a cached cell reports all of
+    // its rows at once.
+    void request(const QString &key, const TRTSConfig &cfg);
+    // Queue cells at low priority.  Prefetches of cells not listed are
+    // cancelled, so hovering across the map keeps only the latest
+    // neighbourhood in flight.
+    void prefetch(const QVector<QPair<QString, TRTSConfig>> &cells);
+    void cancelAll();
+
+    // Rows of a cached or running cell, or null.  The store stays valid for
+    // as long as the caller holds it, even after eviction.
+    std::shared_ptr<const MicrotickStore> store(const QString &key) const;
+    int radix(const QString &key) const;
+    bool isCached(const QString &key) const;
+
+signals:
+    void cellRowsAppended(const QString &key, int first, int count);
+    void cellFinished(const QString &key, bool ok);
+
+private:
+    struct Job;
+    class Task;
+
+    void startJob(const QString &key, const TRTSConfig &cfg, bool foreground);
+    void cancelJob(const std::shared_ptr<Job> &job);
+    // GUI thread: publish rows of a running job / file it in the cache.
+    void publish(const std::shared_ptr<Job> &job);
+    void finishJob(const std::shared_ptr<Job> &job, bool ok);
+    void touch(const QString &key);
+    void evict();
+
+    struct CacheEntry {
+        std::shared_ptr<const MicrotickStore> store;
+        int radix = 10;
+        size_t bytes = 0;
+    };
+
+    QThreadPool                         m_pool;
+    QHash<QString, std::shared_ptr<Job>> m_jobs;       // queued or running
+    QHash<QString, CacheEntry>           m_cache;
+    QList<QString>                       m_recent;     // cache keys, most recent first
+    size_t                               m_cacheBytes = 0;
+    size_t                               m_cacheBudget = 256U * 1024U * 1024U;
+    QString                              m_foreground;
+};
@@ -52,6 +52,7 @@ private:
     QSpinBox *m_tickCount;
     QSpinBox *m_microTickMs;
     QSpinBox *m_koppaWrap;
+    QComboBox *m_valuesRadix;
 
     QCheckBox *m_dualTrackSymmetry;
     QCheckBox *m_triplePsi;
@@ -7,10 +7,8 @@
 #include <QTabWidget>
 #include <QProcess>
 #include "RhythmVisualizerWidget.hpp"   // <— now included before member use
-// Core engine headers
-#include "../../state.h"      // TRTS_State
-#include "../../simulate.h"   // simulate_stream, Config
-#include "../../config.h"
+// Core engine access
+#include "CoreRunAdapter.hpp"
 // GUI panels and widgets:
 
 #include "TRTSConfig.hpp"
@@ -35,6 +33,9 @@ public:
     QSize minimumSizeHint() const override;
     QSize sizeHint() const override;
 
+    // Owner of the in-process run and its microtick store.
+    const CoreRunAdapter *coreRunAdapter() const { return m_adapter; }
+
 private slots:
     void handleStartRun();
     void handleStopRun();
@@ -47,6 +48,7 @@ private slots:
     void appendLogEntry(const QStringList &columns);
     void logStatus(const QString &message);
     void handlePause();
+    void handleRowsAppended(int first, int count);
 
 private:
     void buildUi();
@@ -80,23 +82,16 @@ private:
     // Optional external-process fallback
     TRTSCoreProcess       *m_process{};
 
+    // In-process trts_core runs
+    CoreRunAdapter        *m_adapter{};
+
     // Engine configuration
     TRTSConfig             config;
 
-    // ─────────────────────────────────────────────────────────────────────────
-    // Observer prototype for streaming updates
-    static void guiObserver(void *userData,
-                            size_t tick,
-                            int microtick,
-                            char phase,
-                            const TRTS_State *state,
-                            bool rho,
-                            bool psi,
-                            bool mu_zero,
-                            bool forced);
-
 signals:
-    // Emitted once per microtick by guiObserver
+    // Emitted for the newest microtick of every batch of rows published by
+    // CoreRunAdapter, so status panels follow the run without a signal per
+    // microtick.
     void engineUpdate(size_t tick,
                       int microtick,
                       char phase,
@@ -104,5 +99,8 @@ signals:
                       bool psi,
                       bool mu_zero,
                       bool forced);
+    // Forwarded from CoreRunAdapter; the rows live in its MicrotickStore.
+    void rowsReset();
+    void rowsAppended(int first, int count);
 };
 
@@ -2,10 +2,15 @@
 #pragma once
 
 #include <QWidget>
-#include <QStandardItemModel>
 #include <QTableView>
 #include <QPushButton>
-#include <QStringList>
+#include <QCheckBox>
+
+#include <memory>
+
+#include "CoreRunAdapter.hpp"
+
+class MicrotickTableModel;
 
 class OutputTableWidget : public QWidget {
     Q_OBJECT
@@ -14,25 +19,28 @@ public:
     explicit OutputTableWidget(QWidget *parent = nullptr);
     ~OutputTableWidget() override = default;
 
-    void appendRow(const QStringList &row);
+    // Returns to the live run.
     void clear();
 
 signals:
     void exportCsvRequested();
 
+public slots:
+    // Show a phase-map drill-down (PhaseMapExplorer::drillDownSelected) in
+    // place of the live run until clear(); its rows follow through
+    // onDrillDownRowsAppended().
+    void showDrillDown(std::shared_ptr<const MicrotickStore> store, int radix);
+    void onDrillDownRowsAppended(int first, int count);
+
 private slots:
-    // Receives live updates from MainWindow::engineUpdate
-    void onEngineUpdate(size_t tick,
-                        int microtick,
-                        char phase,
-                        bool rho,
-                        bool psi,
-                        bool mu_zero,
-                        bool forced);
+    // Receives batched updates from MainWindow::rowsAppended
+    void onRowsAppended(int first, int count);
 
 private:
-    QTableView        *m_table{};
-    QStandardItemModel*m_model{};
-    QPushButton       *m_exportButton{};
+    QTableView          *m_table{};
+    MicrotickTableModel *m_model{};
+    QPushButton         *m_exportButton{};
+    // Renders υ, β and κ written in another radix as decimal.  Cells are
+    // rendered when painted, so only visible rows are converted.
+    QCheckBox           *m_decimalToggle{};
 };
-
@@ -4,27 +4,63 @@
 #include <QVector>
 #include <QStringList>
 
+#include <memory>
+
+#include "TRTSConfig.hpp"
+
+class DrillDownPool;
+class MicrotickStore;
 class QTableWidget;
 class QLabel;
 class QPushButton;
+class QSpinBox;
 
 class PhaseMapExplorer : public QWidget {
     Q_OBJECT
 public:
     explicit PhaseMapExplorer(QWidget *parent = nullptr);
 
+    // Configuration of each map row, in row order, for drill-down runs.
+    // Rows without one cannot be drilled into.
+    void setCellConfigurations(const QVector<TRTSConfig> &configs);
+    DrillDownPool *drillDownPool() const { return m_drillDown; }
+
 signals:
     void loadPhaseMapRequested();
     void rerunRequested(const QString &configurationHash);
+    // A clicked cell's run, from the drill-down cache or still in progress.
+    // Its rows so far are in store; later ones follow through
+    // drillDownRowsAppended().
+    void drillDownSelected(std::shared_ptr<const MicrotickStore> store, int radix);
+    void drillDownRowsAppended(int first, int count);
+    void drillDownFinished(bool ok);
 
 public slots:
     void setPhaseMapInfo(const QString &info);
     void populateMap(const QVector<QStringList> &rows);
+    // Rows of a progressive sweep (phase_mapper --order progressive) with the
+    // refinement level of each row.  Levels below completeLevels cover the
+    // grid uniformly; the level selector shows the map up to any level,
+    // including one the sweep had only partly refined.
+    void populateLevels(const QVector<QStringList> &rows, const QVector<int> &levels,
+                        int completeLevels);
     void clear();
 
 private:
+    void applyLevelFilter();
+    QString cellKey(int row) const;
+    // Run the cell at row in the foreground and select it.
+    void drillDown(int row);
+    // Queue the hovered row and its nearest visible neighbours.
+    void prefetchAround(int row);
+
     QTableWidget *m_table;
     QLabel *m_infoLabel;
+    QSpinBox *m_levelSelector;
     QPushButton *m_loadButton;
+    QVector<int> m_levels;
+    int m_completeLevels = 0;
+    DrillDownPool *m_drillDown;
+    QVector<TRTSConfig> m_cellConfigs;
+    QString m_selectedKey;
 };
-
@@ -4,6 +4,9 @@
 #include <QWidget>
 #include <QColor>
 #include <deque>
+#include <memory>
+
+class MicrotickStore;
 
 // Define a simple event struct here to avoid extra dependencies
 struct RhythmEvent {
@@ -21,9 +24,16 @@ public:
     ~RhythmVisualizerWidget() override = default;
 
     void appendEvent(const RhythmEvent &event);
+    // Also drops a drill-down, returning to the live stream.
     void clearEvents();
     void setVisibleTicks(int ticks) { m_visibleTicks = ticks; }
 
+public slots:
+    // Plot the ψ events of a phase-map drill-down instead of the live
+    // stream; its rows follow through onDrillDownRowsAppended().
+    void showDrillDown(std::shared_ptr<const MicrotickStore> store, int radix);
+    void onDrillDownRowsAppended(int first, int count);
+
 protected:
     void paintEvent(QPaintEvent *event) override;
 
@@ -42,5 +52,7 @@ private:
 
     std::deque<RhythmEvent> m_events;
     int                     m_visibleTicks = 100;
+    std::shared_ptr<const MicrotickStore> m_drillDown;
+    int                     m_drillDownRows = 0;
 };
 
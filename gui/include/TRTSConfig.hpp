@@ -96,6 +96,9 @@ struct TRTSConfig {
     quint32 tickCount = 5;
     quint32 microTickIntervalMs = 150;
     quint32 koppaWrapThreshold = 0;
+    // Radix of the rational components in values.csv and the output table:
+    // 10 or a power of two up to 32.
+    quint32 valuesRadix = 10;
 
     QString configPath;
 
@@ -0,0 +1,332 @@
+// gui/src/CoreRunAdapter.cpp
+// Bridges the trts_core observer API to the GUI.  The observer runs on the
+// simulation thread and only appends encoded rows; views decode and render
+// the rows they display.
+
+#include "../include/CoreRunAdapter.hpp"
+
+#include <cstdlib>
+#include <memory>
+
+#include <QByteArray>
+#include <QMutexLocker>
+#include <QThread>
+
+namespace {
+
+// Rows are published at most this often while a run is in progress.
+constexpr qint64 PublishIntervalMs = 50;
+
+QString rationalText(const TraceRow &row, int component, int radix)
+{
+    char *num = mpz_get_str(nullptr, radix, row.components[component]);
+    char *den = mpz_get_str(nullptr, radix, row.components[component + 1]);
+    const QString text = QStringLiteral("%1/%2").arg(QString::fromLatin1(num),
+                                                      QString::fromLatin1(den));
+    std::free(num);
+    std::free(den);
+    return text;
+}
+
+// Accepts "numerator/denominator" (arbitrary size) or anything mpq_set_str
+// understands.  The value is stored as written; it is never canonicalised.
+bool parseRational(const QString &text, mpq_t out)
+{
+    mpq_set_si(out, 0, 1);
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        return false;
+    }
+    const QStringList parts = trimmed.split('/');
+    if (parts.size() == 2) {
+        const QByteArray num = parts.at(0).trimmed().toLatin1();
+        const QByteArray den = parts.at(1).trimmed().toLatin1();
+        if (mpz_set_str(mpq_numref(out), num.constData(), 10) == 0 &&
+            mpz_set_str(mpq_denref(out), den.constData(), 10) == 0 &&
+            mpz_sgn(mpq_denref(out)) != 0) {
+            return true;
+        }
+        mpq_set_si(out, 0, 1);
+        return false;
+    }
+    const QByteArray cstr = trimmed.toLatin1();
+    if (mpz_set_str(mpq_numref(out), cstr.constData(), 10) == 0) {
+        mpz_set_ui(mpq_denref(out), 1UL);
+        return true;
+    }
+    mpq_set_si(out, 0, 1);
+    return false;
+}
+
+QString eventsString(const TraceRow &row)
+{
+    QStringList tokens;
+    tokens << QString(QChar(row.phase));
+    if (row.flags & TRACE_FLAG_MU_ZERO) tokens << QStringLiteral("mu=0");
+    if (row.flags & TRACE_FLAG_FORCED_EMISSION) tokens << QStringLiteral("forced");
+    if (row.flags & TRACE_FLAG_RATIO_TRIGGERED) tokens << QStringLiteral("ratio");
+    if (row.flags & TRACE_FLAG_RATIO_THRESHOLD) tokens << QStringLiteral("threshold");
+    if (row.flags & TRACE_FLAG_DUAL_ENGINE) tokens << QStringLiteral("dual");
+    if (row.flags & TRACE_FLAG_PSI_STRENGTH) tokens << QStringLiteral("psi_strength");
+    if (row.koppa_sample_index >= 0) {
+        tokens << QStringLiteral("sample=%1").arg(row.koppa_sample_index);
+    }
+    return tokens.join('|');
+}
+
+// Owns a core Config for the lifetime of a threaded run.
+struct CoreConfig {
+    CoreConfig() { config_init(&config); }
+    ~CoreConfig() { config_clear(&config); }
+    CoreConfig(const CoreConfig &) = delete;
+    CoreConfig &operator=(const CoreConfig &) = delete;
+    Config config;
+};
+
+} // namespace
+
+MicrotickStore::MicrotickStore()
+{
+    trace_encoder_init(&m_encoder, false);
+    trace_buffer_init(&m_scratch);
+    trace_buffer_init(&m_data);
+}
+
+MicrotickStore::~MicrotickStore()
+{
+    trace_encoder_clear(&m_encoder);
+    trace_buffer_clear(&m_scratch);
+    trace_buffer_clear(&m_data);
+}
+
+void MicrotickStore::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    trace_buffer_reset(&m_data);
+    m_offsets.clear();
+}
+
+int MicrotickStore::size() const
+{
+    QMutexLocker lock(&m_mutex);
+    return static_cast<int>(m_offsets.size());
+}
+
+size_t MicrotickStore::byteSize() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_data.size;
+}
+
+void MicrotickStore::append(size_t tick, int microtick, char phase, const TRTS_State *state,
+                            bool rho, bool psi, bool mu_zero, bool forced)
+{
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    trace_state_components(state, components);
+    const unsigned int flags = trace_flags_from_state(state, rho, psi, mu_zero, forced);
+    // Encode outside the lock so readers only wait for the copy.
+    trace_buffer_reset(&m_scratch);
+    if (!trace_encode_row(&m_encoder, &m_scratch, tick, microtick, phase, flags,
+                          state->koppa_sample_index, state->koppa_stack_size, components)) {
+        return;
+    }
+    QMutexLocker lock(&m_mutex);
+    const size_t offset = m_data.size;
+    if (trace_buffer_append(&m_data, m_scratch.data, m_scratch.size)) {
+        m_offsets.push_back(offset);
+    }
+}
+
+bool MicrotickStore::decode(int index, TraceRow *row) const
+{
+    QMutexLocker lock(&m_mutex);
+    if (index < 0 || static_cast<size_t>(index) >= m_offsets.size()) {
+        return false;
+    }
+    const size_t begin = m_offsets[static_cast<size_t>(index)];
+    const size_t end = static_cast<size_t>(index) + 1U < m_offsets.size()
+                           ? m_offsets[static_cast<size_t>(index) + 1U]
+                           : m_data.size;
+    return trace_decode_row(m_data.data + begin, end - begin, nullptr, row);
+}
+
+CoreRunAdapter::CoreRunAdapter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CoreRunAdapter::~CoreRunAdapter()
+{
+    wait();
+    delete m_thread;
+}
+
+void CoreRunAdapter::toCoreConfig(const TRTSConfig &cfg, Config *c, QStringList *errors)
+{
+    // Map enums
+    c->psi_mode = static_cast<PsiMode>(cfg.psiMode);
+    c->koppa_mode = static_cast<KoppaMode>(cfg.koppaMode);
+    c->engine_mode = static_cast<EngineMode>(cfg.engineMode);
+    c->engine_upsilon = static_cast<EngineTrackMode>(cfg.upsilonTrack);
+    c->engine_beta = static_cast<EngineTrackMode>(cfg.betaTrack);
+    c->koppa_trigger = static_cast<KoppaTrigger>(cfg.koppaTrigger);
+    c->prime_target = static_cast<PrimeTarget>(cfg.primeTarget);
+    c->mt10_behavior = static_cast<Mt10Behavior>(cfg.mt10Behavior);
+    c->ratio_trigger_mode = static_cast<RatioTriggerMode>(cfg.ratioTriggerMode);
+    c->sign_flip_mode = static_cast<SignFlipMode>(cfg.signFlipMode);
+    c->ticks = cfg.tickCount;
+    // Seeds
+    if (!parseRational(cfg.upsilonSeed, c->initial_upsilon) && errors) {
+        *errors << tr("Invalid υ seed: %1").arg(cfg.upsilonSeed);
+    }
+    if (!parseRational(cfg.betaSeed, c->initial_beta) && errors) {
+        *errors << tr("Invalid β seed: %1").arg(cfg.betaSeed);
+    }
+    if (!parseRational(cfg.koppaSeed, c->initial_koppa) && errors) {
+        *errors << tr("Invalid κ seed: %1").arg(cfg.koppaSeed);
+    }
+    // Boolean flags
+    c->dual_track_mode                = cfg.dualTrackSymmetry;
+    c->triple_psi_mode                = cfg.triplePsi;
+    c->multi_level_koppa              = cfg.multiLevelKoppa;
+    c->enable_asymmetric_cascade      = cfg.asymmetricCascade;
+    c->enable_conditional_triple_psi  = cfg.conditionalTriplePsi;
+    c->enable_koppa_gated_engine      = cfg.koppaGatedEngine;
+    c->enable_delta_cross_propagation = cfg.deltaCrossPropagation;
+    c->enable_delta_koppa_offset      = cfg.deltaKoppaOffset;
+    c->enable_ratio_threshold_psi     = cfg.ratioThresholdPsi;
+    c->enable_stack_depth_modes       = cfg.stackDepthModes;
+    c->enable_epsilon_phi_triangle    = cfg.epsilonPhiTriangle;
+    c->enable_modular_wrap            = cfg.modularWrap;
+    c->enable_psi_strength_parameter  = cfg.psiStrengthParameter;
+    c->enable_ratio_snapshot_logging  = cfg.ratioSnapshotLogging;
+    c->enable_feedback_oscillator     = cfg.feedbackOscillator;
+    c->enable_fibonacci_gate          = cfg.fibonacciGate;
+    c->enable_sign_flip               = (cfg.signFlipMode != TRTSConfig::SignFlipMode::None);
+    c->koppa_wrap_threshold           = cfg.koppaWrapThreshold;
+    if (config_values_radix_supported(static_cast<int>(cfg.valuesRadix))) {
+        c->values_radix = static_cast<int>(cfg.valuesRadix);
+    } else if (errors) {
+        *errors << tr("Unsupported values radix: %1").arg(cfg.valuesRadix);
+    }
+    // microTickIntervalMs is a presentation setting and has no Config field.
+}
+
+void CoreRunAdapter::prepare(const TRTSConfig &cfg, Config *c)
+{
+    QStringList errors;
+    toCoreConfig(cfg, c, &errors);
+    for (const QString &error : errors) {
+        emit statusMessage(error);
+    }
+    m_store.clear();
+    m_published = 0;
+    m_radix = c->values_radix;
+    emit rowsReset();
+}
+
+bool CoreRunAdapter::execute(const Config *c, const QByteArray &tracePath)
+{
+    SimulateFiles files = {nullptr, nullptr,
+                           tracePath.isEmpty() ? nullptr : tracePath.constData(), nullptr};
+    m_publishTimer.start();
+    const SimulateStatus status = simulate_resumable(c, &files, &CoreRunAdapter::observer,
+                                                     this, nullptr, false);
+    publishRows();
+    if (status != SIMULATE_COMPLETED) {
+        emit statusMessage(tr("Simulation failed"));
+        return false;
+    }
+    return true;
+}
+
+bool CoreRunAdapter::start(const TRTSConfig &cfg, const QString &tracePath)
+{
+    if (isRunning()) {
+        return false;
+    }
+    delete m_thread;
+    auto core = std::make_shared<CoreConfig>();
+    prepare(cfg, &core->config);
+    const QByteArray traceBytes = tracePath.toLocal8Bit();
+    m_thread = QThread::create([this, core, traceBytes] {
+        emit finished(execute(&core->config, traceBytes));
+    });
+    m_thread->start();
+    return true;
+}
+
+bool CoreRunAdapter::isRunning() const
+{
+    return m_thread && m_thread->isRunning();
+}
+
+void CoreRunAdapter::wait()
+{
+    if (m_thread) {
+        m_thread->wait();
+    }
+}
+
+bool CoreRunAdapter::run(const TRTSConfig &cfg, const QString &tracePath)
+{
+    CoreConfig core;
+    prepare(cfg, &core.config);
+    return execute(&core.config, tracePath.toLocal8Bit());
+}
+
+QString CoreRunAdapter::columnText(const TraceRow &row, int column, int radix)
+{
+    const bool psi = row.flags & TRACE_FLAG_PSI_FIRED;
+    switch (column) {
+    case TickColumn:
+        return QString::number(row.tick);
+    case MicrotickColumn:
+        return QString::number(row.microtick);
+    case UpsilonColumn:
+        return rationalText(row, 0, radix);
+    case BetaColumn:
+        return rationalText(row, 2, radix);
+    case KoppaColumn:
+        return rationalText(row, 4, radix);
+    case PsiColumn:
+        return psi ? ((row.flags & TRACE_FLAG_TRIPLE_PSI) ? QStringLiteral("3")
+                                                          : QStringLiteral("1"))
+                   : QStringLiteral("0");
+    case RhoColumn:
+        return (row.flags & TRACE_FLAG_RHO_EVENT) ? QStringLiteral("1") : QStringLiteral("0");
+    case MuColumn:
+        return (row.flags & TRACE_FLAG_MU_ZERO) ? QStringLiteral("1") : QStringLiteral("0");
+    case EventsColumn:
+        return eventsString(row);
+    default:
+        return QString();
+    }
+}
+
+void CoreRunAdapter::publishRows()
+{
+    const int size = m_store.size();
+    if (size > m_published) {
+        emit rowsAppended(m_published, size - m_published);
+        m_published = size;
+    }
+    m_publishTimer.restart();
+}
+
+void CoreRunAdapter::observer(void *userData,
+                              size_t tick,
+                              int microtick,
+                              char phase,
+                              const TRTS_State *state,
+                              bool rho,
+                              bool psi,
+                              bool mu_zero,
+                              bool forced)
+{
+    auto *self = static_cast<CoreRunAdapter*>(userData);
+    self->m_store.append(tick, microtick, phase, state, rho, psi, mu_zero, forced);
+    if (self->m_publishTimer.elapsed() >= PublishIntervalMs) {
+        self->publishRows();
+    }
+}
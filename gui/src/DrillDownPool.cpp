@@ -0,0 +1,264 @@
+// gui/src/DrillDownPool.cpp
+// Worker side of the phase-map drill-down.  Tasks only append encoded rows
+// and post to the GUI thread; publishing, caching and cancellation
+// bookkeeping all happen on the GUI thread.
+
+#include "../include/DrillDownPool.hpp"
+
+#include <QElapsedTimer>
+#include <QMetaObject>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+
+#include <atomic>
+
+namespace {
+
+// Rows of a running cell are published at most this often.
+constexpr qint64 PublishIntervalMs = 50;
+
+} // namespace
+
+struct DrillDownPool::Job {
+    QString key;
+    TRTSConfig cfg;
+    int radix = 10;
+    bool foreground = false;                 // GUI thread
+    int published = 0;                       // GUI thread
+    std::shared_ptr<MicrotickStore> store = std::make_shared<MicrotickStore>();
+    std::atomic<bool> started{false};
+    std::atomic<bool> cancelled{false};
+};
+
+class DrillDownPool::Task : public QRunnable {
+public:
+    Task(DrillDownPool *pool, std::shared_ptr<Job> job)
+        : m_pool(pool), m_job(std::move(job))
+    {
+    }
+
+    void run() override
+    {
+        m_job->started = true;
+        bool ok = false;
+        if (!m_job->cancelled) {
+            Config config;
+            config_init(&config);
+            CoreRunAdapter::toCoreConfig(m_job->cfg, &config, nullptr);
+            m_timer.start();
+            ok = simulate_until(&config, nullptr, &Task::observer, this, &Task::tickHook,
+                                this) == SIMULATE_COMPLETED;
+            config_clear(&config);
+        }
+        DrillDownPool *pool = m_pool;
+        std::shared_ptr<Job> job = m_job;
+        QMetaObject::invokeMethod(pool, [pool, job, ok] { pool->finishJob(job, ok); },
+                                  Qt::QueuedConnection);
+    }
+
+private:
+    static void observer(void *userData, size_t tick, int microtick, char phase,
+                         const TRTS_State *state, bool rho, bool psi, bool mu_zero,
+                         bool forced)
+    {
+        auto *self = static_cast<Task*>(userData);
+        self->m_job->store->append(tick, microtick, phase, state, rho, psi, mu_zero, forced);
+        if (self->m_timer.elapsed() >= PublishIntervalMs) {
+            DrillDownPool *pool = self->m_pool;
+            std::shared_ptr<Job> job = self->m_job;
+            QMetaObject::invokeMethod(pool, [pool, job] { pool->publish(job); },
+                                      Qt::QueuedConnection);
+            self->m_timer.restart();
+        }
+    }
+
+    // Cancellation is honoured at tick boundaries.
+    static bool tickHook(void *userData, size_t tick, const TRTS_State *state)
+    {
+        Q_UNUSED(tick);
+        Q_UNUSED(state);
+        return !static_cast<Task*>(userData)->m_job->cancelled;
+    }
+
+    DrillDownPool       *m_pool;
+    std::shared_ptr<Job> m_job;
+    QElapsedTimer        m_timer;
+};
+
+DrillDownPool::DrillDownPool(QObject *parent)
+    : QObject(parent)
+{
+    // Leave a core for the GUI and for the main run.
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+DrillDownPool::~DrillDownPool()
+{
+    cancelAll();
+    m_pool.waitForDone();
+}
+
+void DrillDownPool::setCacheBudget(size_t bytes)
+{
+    m_cacheBudget = bytes;
+    evict();
+}
+
+void DrillDownPool::request(const QString &key, const TRTSConfig &cfg)
+{
+    if (!m_foreground.isEmpty() && m_foreground != key) {
+        const std::shared_ptr<Job> previous = m_jobs.value(m_foreground);
+        if (previous && previous->foreground) {
+            cancelJob(previous);
+        }
+    }
+    m_foreground = key;
+
+    const auto cached = m_cache.constFind(key);
+    if (cached != m_cache.constEnd()) {
+        touch(key);
+        emit cellRowsAppended(key, 0, cached->store->size());
+        emit cellFinished(key, true);
+        return;
+    }
+    const std::shared_ptr<Job> job = m_jobs.value(key);
+    if (job && job->started) {
+        // A prefetch already under way becomes the requested run.
+        job->foreground = true;
+        publish(job);
+        return;
+    }
+    if (job) {
+        cancelJob(job);
+    }
+    startJob(key, cfg, true);
+}
+
+void DrillDownPool::prefetch(const QVector<QPair<QString, TRTSConfig>> &cells)
+{
+    QSet<QString> wanted;
+    for (const auto &cell : cells) {
+        wanted.insert(cell.first);
+    }
+    QList<std::shared_ptr<Job>> stale;
+    for (const std::shared_ptr<Job> &job : m_jobs) {
+        if (!job->foreground && !wanted.contains(job->key)) {
+            stale.append(job);
+        }
+    }
+    for (const std::shared_ptr<Job> &job : stale) {
+        cancelJob(job);
+    }
+    for (const auto &cell : cells) {
+        if (!m_cache.contains(cell.first) && !m_jobs.contains(cell.first)) {
+            startJob(cell.first, cell.second, false);
+        }
+    }
+}
+
+void DrillDownPool::cancelAll()
+{
+    const QList<std::shared_ptr<Job>> jobs = m_jobs.values();
+    for (const std::shared_ptr<Job> &job : jobs) {
+        cancelJob(job);
+    }
+    m_foreground.clear();
+}
+
+std::shared_ptr<const MicrotickStore> DrillDownPool::store(const QString &key) const
+{
+    const auto cached = m_cache.constFind(key);
+    if (cached != m_cache.constEnd()) {
+        return cached->store;
+    }
+    const std::shared_ptr<Job> job = m_jobs.value(key);
+    return job ? job->store : nullptr;
+}
+
+int DrillDownPool::radix(const QString &key) const
+{
+    const auto cached = m_cache.constFind(key);
+    if (cached != m_cache.constEnd()) {
+        return cached->radix;
+    }
+    const std::shared_ptr<Job> job = m_jobs.value(key);
+    return job ? job->radix : 10;
+}
+
+bool DrillDownPool::isCached(const QString &key) const
+{
+    return m_cache.contains(key);
+}
+
+void DrillDownPool::startJob(const QString &key, const TRTSConfig &cfg, bool foreground)
+{
+    auto job = std::make_shared<Job>();
+    job->key = key;
+    job->cfg = cfg;
+    job->foreground = foreground;
+    const int radix = static_cast<int>(cfg.valuesRadix);
+    job->radix = config_values_radix_supported(radix) ? radix : 10;
+    m_jobs.insert(key, job);
+    m_pool.start(new Task(this, job), foreground ? 1 : 0);
+}
+
+void DrillDownPool::cancelJob(const std::shared_ptr<Job> &job)
+{
+    job->cancelled = true;
+    if (m_jobs.value(job->key) == job) {
+        m_jobs.remove(job->key);
+    }
+}
+
+void DrillDownPool::publish(const std::shared_ptr<Job> &job)
+{
+    if (job->cancelled) {
+        return;
+    }
+    const int size = job->store->size();
+    if (size > job->published) {
+        emit cellRowsAppended(job->key, job->published, size - job->published);
+        job->published = size;
+    }
+}
+
+void DrillDownPool::finishJob(const std::shared_ptr<Job> &job, bool ok)
+{
+    if (m_jobs.value(job->key) == job) {
+        m_jobs.remove(job->key);
+    }
+    if (job->cancelled) {
+        return;
+    }
+    publish(job);
+    if (ok) {
+        const auto previous = m_cache.constFind(job->key);
+        if (previous != m_cache.constEnd()) {
+            m_cacheBytes -= previous->bytes;
+        }
+        CacheEntry entry;
+        entry.store = job->store;
+        entry.radix = job->radix;
+        entry.bytes = job->store->byteSize();
+        m_cache.insert(job->key, entry);
+        m_cacheBytes += entry.bytes;
+        touch(job->key);
+        evict();
+    }
+    emit cellFinished(job->key, ok);
+}
+
+void DrillDownPool::touch(const QString &key)
+{
+    m_recent.removeOne(key);
+    m_recent.prepend(key);
+}
+
+// The most recent cell is kept even when it alone exceeds the budget.
+void DrillDownPool::evict()
+{
+    while (m_cacheBytes > m_cacheBudget && m_recent.size() > 1) {
+        m_cacheBytes -= m_cache.take(m_recent.takeLast()).bytes;
+    }
+}
@@ -65,6 +65,7 @@ TRTSConfig EngineConfigPanel::configuration() const {
     config.tickCount = static_cast<quint32>(m_tickCount->value());
     config.microTickIntervalMs = static_cast<quint32>(m_microTickMs->value());
     config.koppaWrapThreshold = static_cast<quint32>(m_koppaWrap->value());
+    config.valuesRadix = m_valuesRadix->currentData().toUInt();
     return config;
 }
 
@@ -159,7 +160,12 @@ void EngineConfigPanel::buildUi() {
     m_koppaWrap->setRange(0, 1000000);
     timingForm->addRow(tr("Ticks"), m_tickCount);
     timingForm->addRow(tr("μtick ms"), m_microTickMs);
+    m_valuesRadix = new QComboBox(timingBox);
+    for (int radix : {10, 2, 4, 8, 16, 32}) {
+        m_valuesRadix->addItem(QString::number(radix), radix);
+    }
     timingForm->addRow(tr("κ wrap"), m_koppaWrap);
+    timingForm->addRow(tr("Values radix"), m_valuesRadix);
     timingBox->setLayout(timingForm);
 
     // Advanced modes toggles
@@ -218,7 +224,7 @@ void EngineConfigPanel::buildUi() {
     // Connect combo boxes
     const QList<QComboBox *> combos = {m_psiMode,    m_engineMode,   m_koppaMode,     m_koppaTrigger,
                                        m_mt10Behavior, m_ratioTrigger, m_primeTarget,   m_signFlip,
-                                       m_upsilonTrack, m_betaTrack};
+                                       m_upsilonTrack, m_betaTrack,  m_valuesRadix};
     for (QComboBox *combo : combos) {
         connect(combo, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged),
                 this, &EngineConfigPanel::emitConfigurationChanged);
@@ -268,6 +274,7 @@ void EngineConfigPanel::populateFromConfig(const TRTSConfig &config) {
     m_tickCount->setValue(config.tickCount);
     m_microTickMs->setValue(config.microTickIntervalMs);
     m_koppaWrap->setValue(config.koppaWrapThreshold);
+    applyComboBoxSelection(m_valuesRadix, m_valuesRadix->findData(static_cast<int>(config.valuesRadix)));
 }
 
 void EngineConfigPanel::applyComboBoxSelection(QComboBox *combo, int index) {
@@ -1,22 +1,10 @@
 // gui/src/MainWindow.cpp
-// Implements the MainWindow class.  This version fixes a crash caused by
-// reinterpreting a TRTSConfig as a Config by instead constructing a Config
-// explicitly and copying each field.  It also adds a Pause control.
+// Implements the MainWindow class.  Runs go through CoreRunAdapter, which
+// builds the core Config from the GUI configuration and drives trts_core
+// directly.  It also adds a Pause control.
 
 #include "../include/MainWindow.hpp"
 #include "stdio.h"
-// Step 1: Include all C headers to get the type definitions (Config, etc.).
-#include "../../simulate.h"
-#include "../../state.h"
-#include "../../config.h"
-
-// Step 2: Use a surgical extern "C" block for *only* the failing prototypes.
-// This is the CRITICAL fix that guarantees C linkage for config_init/config_clear.
-extern "C" {
-    void config_init(Config *config);
-    void config_clear(Config *config);
-}
-
 #include "../include/EngineConfigPanel.hpp"
 #include "../include/ExecutionPanel.hpp"
 
@@ -34,13 +22,11 @@ extern "C" {
 #include <QToolBar>
 #include <QStringList>
 
-// Forward declare helper for parsing rationals
-static bool parseRational(const QString &text, mpq_t out);
-
 // Constructor / destructor
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_process(new TRTSCoreProcess(this))
+    , m_adapter(new CoreRunAdapter(this))
 {
     buildUi();
     connectSignals();
@@ -106,6 +92,18 @@ void MainWindow::connectSignals()
     connect(m_actionClear,      &QAction::triggered, this, &MainWindow::handleClearOutput);
     connect(m_actionLoadConfig, &QAction::triggered, this, &MainWindow::handleLoadConfigRequested);
 
+    // In-process runs: the adapter runs on its own thread and publishes
+    // rows in batches
+    connect(m_adapter, &CoreRunAdapter::rowsReset,     this, &MainWindow::rowsReset);
+    connect(m_adapter, &CoreRunAdapter::rowsAppended,  this, &MainWindow::rowsAppended);
+    connect(m_adapter, &CoreRunAdapter::rowsAppended,  this, &MainWindow::handleRowsAppended);
+    connect(m_adapter, &CoreRunAdapter::statusMessage, this, &MainWindow::logStatus);
+    connect(m_adapter, &CoreRunAdapter::finished, this, [this](bool ok) {
+        if (ok) {
+            logStatus(tr("Finished"));
+        }
+    });
+
     connect(m_engineConfig, &EngineConfigPanel::configurationChanged,
             this, [this](const TRTSConfig &cfg) {
                 Q_UNUSED(cfg);
@@ -119,67 +117,47 @@ void MainWindow::connectSignals()
     connect(m_execution, &ExecutionPanel::pauseRequested, this, &MainWindow::handlePause);
     connect(m_execution, &ExecutionPanel::resetRequested, this, &MainWindow::handleReset);
     connect(m_execution, &ExecutionPanel::stepRequested,  this, &MainWindow::handleStartRun);
+
+    // Phase-map drill-downs replace the live run in the table and rhythm
+    // views until the next reset.
+    if (m_phaseMap && m_outputTable) {
+        connect(m_phaseMap, &PhaseMapExplorer::drillDownSelected,
+                m_outputTable, &OutputTableWidget::showDrillDown);
+        connect(m_phaseMap, &PhaseMapExplorer::drillDownRowsAppended,
+                m_outputTable, &OutputTableWidget::onDrillDownRowsAppended);
+    }
+    if (m_phaseMap && m_rhythm) {
+        connect(m_phaseMap, &PhaseMapExplorer::drillDownSelected,
+                m_rhythm, &RhythmVisualizerWidget::showDrillDown);
+        connect(m_phaseMap, &PhaseMapExplorer::drillDownRowsAppended,
+                m_rhythm, &RhythmVisualizerWidget::onDrillDownRowsAppended);
+    }
 }
 
-// Start run: convert TRTSConfig into Config and invoke streaming simulation
+// Start run: hand the configuration to the trts_core adapter
 void MainWindow::handleStartRun()
 {
     const TRTSConfig cfg = m_engineConfig->configuration();
-    // Construct and initialize a fresh Config
-    Config c;
-    config_init(&c);
-    // Map enums
-    c.psi_mode = static_cast<PsiMode>(cfg.psiMode);
-    c.koppa_mode = static_cast<KoppaMode>(cfg.koppaMode);
-    c.engine_mode = static_cast<EngineMode>(cfg.engineMode);
-    c.engine_upsilon = static_cast<EngineTrackMode>(cfg.upsilonTrack);
-    c.engine_beta = static_cast<EngineTrackMode>(cfg.betaTrack);
-    c.koppa_trigger = static_cast<KoppaTrigger>(cfg.koppaTrigger);
-    c.prime_target = static_cast<PrimeTarget>(cfg.primeTarget);
-    c.mt10_behavior = static_cast<Mt10Behavior>(cfg.mt10Behavior);
-    c.ratio_trigger_mode = static_cast<RatioTriggerMode>(cfg.ratioTriggerMode);
-    c.sign_flip_mode = static_cast<SignFlipMode>(cfg.signFlipMode);
-    // Tick count
-    c.ticks = cfg.tickCount;
-    // Parse seeds into mpq values.  parseRational returns true on success.
-    if (!parseRational(cfg.upsilonSeed, c.initial_upsilon)) {
-        logStatus(tr("Invalid υ seed: %1").arg(cfg.upsilonSeed));
-    }
-    if (!parseRational(cfg.betaSeed, c.initial_beta)) {
-        logStatus(tr("Invalid β seed: %1").arg(cfg.betaSeed));
-    }
-    if (!parseRational(cfg.koppaSeed, c.initial_koppa)) {
-        logStatus(tr("Invalid κ seed: %1").arg(cfg.koppaSeed));
+    if (!m_adapter->start(cfg)) {
+        logStatus(tr("A run is already in progress"));
+        return;
     }
-    // Copy boolean flags
-    c.dual_track_mode             = cfg.dualTrackSymmetry;
-    c.triple_psi_mode             = cfg.triplePsi;
-    c.multi_level_koppa           = cfg.multiLevelKoppa;
-    c.enable_asymmetric_cascade   = cfg.asymmetricCascade;
-    c.enable_conditional_triple_psi = cfg.conditionalTriplePsi;
-    c.enable_koppa_gated_engine   = cfg.koppaGatedEngine;
-    c.enable_delta_cross_propagation = cfg.deltaCrossPropagation;
-    c.enable_delta_koppa_offset   = cfg.deltaKoppaOffset;
-    c.enable_ratio_threshold_psi  = cfg.ratioThresholdPsi;
-    c.enable_stack_depth_modes    = cfg.stackDepthModes;
-    c.enable_epsilon_phi_triangle = cfg.epsilonPhiTriangle;
-    c.enable_modular_wrap         = cfg.modularWrap;
-    c.enable_psi_strength_parameter = cfg.psiStrengthParameter;
-    c.enable_ratio_snapshot_logging = cfg.ratioSnapshotLogging;
-    c.enable_feedback_oscillator  = cfg.feedbackOscillator;
-    c.enable_fibonacci_gate       = cfg.fibonacciGate;
-    // enable_sign_flip is true if a non‑None sign flip mode was chosen
-    c.enable_sign_flip            = (cfg.signFlipMode != TRTSConfig::SignFlipMode::None);
-    // Additional parameters
-    c.koppa_wrap_threshold = cfg.koppaWrapThreshold;
-    // microTickIntervalMs is not part of Config; the engine uses a fixed microtick
-    // interval for streaming.  We store it in ticks or pass as user data if needed.
-    // Start streaming simulation
     logStatus(tr("Running…"));
-    simulate_stream(&c, MainWindow::guiObserver, this);
-    // Clean up rationals
-    config_clear(&c);
-    logStatus(tr("Finished"));
+}
+
+// Drive the status panels from the newest row of each published batch
+void MainWindow::handleRowsAppended(int first, int count)
+{
+    TraceRow row;
+    trace_row_init(&row);
+    if (m_adapter->store().decode(first + count - 1, &row)) {
+        emit engineUpdate(row.tick, row.microtick, row.phase,
+                          row.flags & TRACE_FLAG_RHO_EVENT,
+                          row.flags & TRACE_FLAG_PSI_FIRED,
+                          row.flags & TRACE_FLAG_MU_ZERO,
+                          row.flags & TRACE_FLAG_FORCED_EMISSION);
+    }
+    trace_row_clear(&row);
 }
 
 // Stop run (not yet implemented)
@@ -270,10 +248,10 @@ void MainWindow::handleRunFinished(int exitCode, QProcess::ExitStatus)
     logStatus(tr("Engine finished with exit code %1").arg(exitCode));
 }
 
-// Utility: append to output table
+// Utility: append to the execution log
 void MainWindow::appendLogEntry(const QStringList &columns)
 {
-    if (m_outputTable) m_outputTable->appendRow(columns);
+    m_execution->appendLogRow(columns);
 }
 
 // Utility: show status text
@@ -281,49 +259,3 @@ void MainWindow::logStatus(const QString &msg)
 {
     if (m_statusLabel) m_statusLabel->setText(msg);
 }
-
-// Observer callback for streaming API
-void MainWindow::guiObserver(void *userData,
-                             size_t tick,
-                             int microtick,
-                             char phase,
-                             const TRTS_State * /*state*/,
-                             bool rho,
-                             bool psi,
-                             bool mu_zero,
-                             bool forced)
-{
-    auto *self = static_cast<MainWindow*>(userData);
-    emit self->engineUpdate(tick, microtick, phase, rho, psi, mu_zero, forced);
-}
-
-// Helper to parse a rational string into an mpq_t.  Accepts strings of the form
-// "numerator/denominator" or decimal representations.  Returns true on
-// success, false otherwise.  On failure, out is set to 0/1.
-static bool parseRational(const QString &text, mpq_t out)
-{
-    // Initialize output to 0/1
-    mpq_set_si(out, 0, 1);
-    QString trimmed = text.trimmed();
-    if (trimmed.isEmpty()) {
-        return false;
-    }
-    // Attempt to parse as fraction "a/b"
-    const QStringList parts = trimmed.split('/');
-    if (parts.size() == 2) {
-        bool ok1 = false, ok2 = false;
-        const long long num = parts.at(0).toLongLong(&ok1);
-        const long long den = parts.at(1).toLongLong(&ok2);
-        if (ok1 && ok2 && den != 0) {
-            mpq_set_si(out, num, den);
-            return true;
-        }
-    }
-    // Attempt to parse as decimal using mpq_set_str with base 10
-    QByteArray cstr = trimmed.toLatin1();
-    if (mpq_set_str(out, cstr.constData(), 10) == 0) {
-        return true;
-    }
-    // Fallback: cannot parse
-    return false;
-}
@@ -2,70 +2,175 @@
 #include "OutputTableWidget.hpp"
 #include "MainWindow.hpp"
 
+#include <QAbstractTableModel>
+#include <QCheckBox>
+#include <QHBoxLayout>
 #include <QHeaderView>
-#include <QList>
 #include <QPushButton>
-#include <QStandardItem>
-#include <QStandardItemModel>
 #include <QTableView>
 #include <QVBoxLayout>
 
+// Table over the adapter's MicrotickStore, or over a phase-map drill-down
+// store while one is shown.  Rows stay in the binary trace encoding; data()
+// decodes a row and renders the requested cell, so the cost of a run in the
+// table is proportional to what is on screen.
+class MicrotickTableModel : public QAbstractTableModel {
+public:
+    MicrotickTableModel(const CoreRunAdapter *adapter, const QCheckBox *decimal, QObject *parent)
+        : QAbstractTableModel(parent), m_adapter(adapter), m_decimal(decimal)
+    {
+        trace_row_init(&m_row);
+    }
+
+    ~MicrotickTableModel() override
+    {
+        trace_row_clear(&m_row);
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_rows;
+    }
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : CoreRunAdapter::ColumnCount;
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        const MicrotickStore *store = source();
+        if (role != Qt::DisplayRole || !index.isValid() || !store) {
+            return QVariant();
+        }
+        // A view asks for every column of a row in turn; decode it once.
+        if (index.row() != m_rowIndex) {
+            if (!store->decode(index.row(), &m_row)) {
+                m_rowIndex = -1;
+                return QVariant();
+            }
+            m_rowIndex = index.row();
+        }
+        const int sourceRadix = m_drillDown ? m_drillDownRadix : m_adapter->radix();
+        const int radix = m_decimal->isChecked() ? 10 : sourceRadix;
+        return CoreRunAdapter::columnText(m_row, index.column(), radix);
+    }
+
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override
+    {
+        if (orientation != Qt::Horizontal || role != Qt::DisplayRole) {
+            return QAbstractTableModel::headerData(section, orientation, role);
+        }
+        const QStringList labels = {
+            OutputTableWidget::tr("Tick"), OutputTableWidget::tr("MT"),
+            OutputTableWidget::tr("υ"), OutputTableWidget::tr("β"), OutputTableWidget::tr("κ"),
+            OutputTableWidget::tr("ψ"), OutputTableWidget::tr("ρ"), OutputTableWidget::tr("μ"),
+            OutputTableWidget::tr("Events")
+        };
+        return labels.value(section);
+    }
+
+    void reset()
+    {
+        beginResetModel();
+        m_rows = 0;
+        m_rowIndex = -1;
+        m_drillDown.reset();
+        endResetModel();
+    }
+
+    // Show store instead of the live run until the next reset().
+    void showDrillDown(std::shared_ptr<const MicrotickStore> store, int radix)
+    {
+        beginResetModel();
+        m_rows = 0;
+        m_rowIndex = -1;
+        m_drillDown = std::move(store);
+        m_drillDownRadix = radix;
+        endResetModel();
+    }
+
+    bool showingDrillDown() const { return m_drillDown != nullptr; }
+
+    void appendRows(int first, int count)
+    {
+        if (count <= 0 || first + count <= m_rows) {
+            return;
+        }
+        beginInsertRows(QModelIndex(), m_rows, first + count - 1);
+        m_rows = first + count;
+        endInsertRows();
+    }
+
+private:
+    const MicrotickStore *source() const
+    {
+        if (m_drillDown) {
+            return m_drillDown.get();
+        }
+        return m_adapter ? &m_adapter->store() : nullptr;
+    }
+
+    const CoreRunAdapter *m_adapter;
+    const QCheckBox      *m_decimal;
+    std::shared_ptr<const MicrotickStore> m_drillDown;
+    int                   m_drillDownRadix = 10;
+    int                   m_rows = 0;
+    mutable TraceRow      m_row;
+    mutable int           m_rowIndex = -1;
+};
+
 OutputTableWidget::OutputTableWidget(QWidget *parent)
     : QWidget(parent)
 {
+    auto *mw = qobject_cast<MainWindow*>(parent);
     auto *layout = new QVBoxLayout(this);
     m_table = new QTableView(this);
-    m_model = new QStandardItemModel(this);
-    m_model->setHorizontalHeaderLabels({
-        tr("Tick"), tr("MT"), tr("υ"), tr("β"), tr("κ"), tr("ψ"), tr("ρ"), tr("μ"), tr("Events")
-    });
+    m_exportButton = new QPushButton(tr("Export CSV"), this);
+    m_decimalToggle = new QCheckBox(tr("Show decimal"), this);
+    m_model = new MicrotickTableModel(mw ? mw->coreRunAdapter() : nullptr, m_decimalToggle, this);
     m_table->setModel(m_model);
     m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     m_table->setSelectionBehavior(QAbstractItemView::SelectRows);
-
-    m_exportButton = new QPushButton(tr("Export CSV"), this);
+    connect(m_decimalToggle, &QCheckBox::toggled, m_table->viewport(),
+            QOverload<>::of(&QWidget::update));
+    auto *buttons = new QHBoxLayout();
+    buttons->addWidget(m_decimalToggle);
+    buttons->addStretch();
+    buttons->addWidget(m_exportButton);
     layout->addWidget(m_table);
-    layout->addWidget(m_exportButton);
+    layout->addLayout(buttons);
     connect(m_exportButton, &QPushButton::clicked, this, &OutputTableWidget::exportCsvRequested);
 
     // Hook streaming updates:
-    if (auto *mw = qobject_cast<MainWindow*>(parent)) {
-        connect(mw, &MainWindow::engineUpdate,
-                this, &OutputTableWidget::onEngineUpdate);
+    if (mw) {
+        connect(mw, &MainWindow::rowsReset, this, &OutputTableWidget::clear);
+        connect(mw, &MainWindow::rowsAppended, this, &OutputTableWidget::onRowsAppended);
     }
 }
 
-void OutputTableWidget::appendRow(const QStringList &row)
+void OutputTableWidget::clear()
 {
-    QList<QStandardItem*> items;
-    items.reserve(row.size());
-    for (auto &val : row) {
-        items.append(new QStandardItem(val));
-    }
-    m_model->appendRow(items);
+    m_model->reset();
 }
 
-void OutputTableWidget::clear()
+// Slot for streaming updates; live rows wait while a drill-down is shown and
+// appear with the next reset.
+void OutputTableWidget::onRowsAppended(int first, int count)
 {
-    m_model->removeRows(0, m_model->rowCount());
+    if (!m_model->showingDrillDown()) {
+        m_model->appendRows(first, count);
+    }
 }
 
-// Slot for streaming updates:
-void OutputTableWidget::onEngineUpdate(size_t tick,
-                                       int microtick,
-                                       char /*phase*/,
-                                       bool rho,
-                                       bool psi,
-                                       bool /*mu_zero*/,
-                                       bool /*forced*/)
+void OutputTableWidget::showDrillDown(std::shared_ptr<const MicrotickStore> store, int radix)
 {
-    appendRow({
-        QString::number(tick),
-        QString::number(microtick),
-        "", "", "",
-        psi ? "1" : "0",
-        rho ? "1" : "0",
-        "0", ""
-    });
+    m_model->showDrillDown(std::move(store), radix);
 }
 
+void OutputTableWidget::onDrillDownRowsAppended(int first, int count)
+{
+    if (m_model->showingDrillDown()) {
+        m_model->appendRows(first, count);
+    }
+}
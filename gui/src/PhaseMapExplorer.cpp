@@ -1,8 +1,10 @@
 #include "PhaseMapExplorer.hpp"
+#include "DrillDownPool.hpp"
 
 #include <QHeaderView>
 #include <QLabel>
 #include <QPushButton>
+#include <QSpinBox>
 #include <QTableWidget>
 #include <QVBoxLayout>
 
@@ -15,10 +17,18 @@ PhaseMapExplorer::PhaseMapExplorer(QWidget *parent)
     m_table->setHorizontalHeaderLabels({tr("Region"), tr("Classification"), tr("Support %"), tr("Hash")});
     m_table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
     m_table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    // cellEntered() is only emitted while the mouse is tracked.
+    m_table->setMouseTracking(true);
+
+    m_levelSelector = new QSpinBox(this);
+    m_levelSelector->setPrefix(tr("Refinement level "));
+    m_levelSelector->setVisible(false);
 
     m_loadButton = new QPushButton(tr("Load phase map"), this);
+    m_drillDown = new DrillDownPool(this);
 
     layout->addWidget(m_infoLabel);
+    layout->addWidget(m_levelSelector);
     layout->addWidget(m_table);
     layout->addWidget(m_loadButton);
 
@@ -30,6 +40,80 @@ PhaseMapExplorer::PhaseMapExplorer(QWidget *parent)
             emit rerunRequested(hash);
         }
     });
+    connect(m_levelSelector, QOverload<int>::of(&QSpinBox::valueChanged), this,
+            [this](int) { applyLevelFilter(); });
+
+    connect(m_table, &QTableWidget::cellEntered, this, [this](int row, int column) {
+        Q_UNUSED(column);
+        prefetchAround(row);
+    });
+    connect(m_table, &QTableWidget::cellClicked, this, [this](int row, int column) {
+        Q_UNUSED(column);
+        drillDown(row);
+    });
+    connect(m_drillDown, &DrillDownPool::cellRowsAppended, this,
+            [this](const QString &key, int first, int count) {
+                if (key == m_selectedKey) {
+                    emit drillDownRowsAppended(first, count);
+                }
+            });
+    connect(m_drillDown, &DrillDownPool::cellFinished, this, [this](const QString &key, bool ok) {
+        if (key == m_selectedKey) {
+            emit drillDownFinished(ok);
+        }
+    });
+}
+
+void PhaseMapExplorer::setCellConfigurations(const QVector<TRTSConfig> &configs) {
+    m_cellConfigs = configs;
+}
+
+// The configuration hash identifies a cell across reloads of the map; rows
+// without one fall back to their position.
+QString PhaseMapExplorer::cellKey(int row) const {
+    const QTableWidgetItem *hash = m_table->item(row, 3);
+    return hash && !hash->text().isEmpty() ? hash->text() : QStringLiteral("row:%1").arg(row);
+}
+
+void PhaseMapExplorer::drillDown(int row) {
+    if (row < 0 || row >= m_cellConfigs.size()) {
+        return;
+    }
+    const QString key = cellKey(row);
+    // What request() reports synchronously is announced below, once the
+    // views have been handed the store.
+    m_selectedKey.clear();
+    m_drillDown->request(key, m_cellConfigs.at(row));
+    m_selectedKey = key;
+    const std::shared_ptr<const MicrotickStore> store = m_drillDown->store(key);
+    emit drillDownSelected(store, m_drillDown->radix(key));
+    if (store) {
+        emit drillDownRowsAppended(0, store->size());
+    }
+    if (m_drillDown->isCached(key)) {
+        emit drillDownFinished(true);
+    }
+}
+
+void PhaseMapExplorer::prefetchAround(int row) {
+    QVector<QPair<QString, TRTSConfig>> cells;
+    auto add = [&](int index) {
+        if (index >= 0 && index < m_cellConfigs.size() && index < m_table->rowCount()) {
+            cells.append(qMakePair(cellKey(index), m_cellConfigs.at(index)));
+        }
+    };
+    add(row);
+    int above = row - 1;
+    while (above >= 0 && m_table->isRowHidden(above)) {
+        --above;
+    }
+    add(above);
+    int below = row + 1;
+    while (below < m_table->rowCount() && m_table->isRowHidden(below)) {
+        ++below;
+    }
+    add(below);
+    m_drillDown->prefetch(cells);
 }
 
 void PhaseMapExplorer::setPhaseMapInfo(const QString &info) {
@@ -37,6 +121,9 @@ void PhaseMapExplorer::setPhaseMapInfo(const QString &info) {
 }
 
 void PhaseMapExplorer::populateMap(const QVector<QStringList> &rows) {
+    m_levels.clear();
+    m_completeLevels = 0;
+    m_levelSelector->setVisible(false);
     m_table->setRowCount(0);
     for (int i = 0; i < rows.size(); ++i) {
         m_table->insertRow(i);
@@ -47,7 +134,48 @@ void PhaseMapExplorer::populateMap(const QVector<QStringList> &rows) {
     }
 }
 
+void PhaseMapExplorer::populateLevels(const QVector<QStringList> &rows, const QVector<int> &levels,
+                                      int completeLevels) {
+    populateMap(rows);
+    m_levels = levels;
+    m_completeLevels = completeLevels;
+    int deepest = 0;
+    for (int level : levels) {
+        deepest = qMax(deepest, level);
+    }
+    // Start at the finest uniformly covered level; a partial level is one
+    // step further on the selector.
+    const QSignalBlocker blocker(m_levelSelector);
+    m_levelSelector->setRange(0, deepest);
+    m_levelSelector->setValue(qBound(0, completeLevels - 1, deepest));
+    m_levelSelector->setVisible(true);
+    applyLevelFilter();
+}
+
+void PhaseMapExplorer::applyLevelFilter() {
+    const int shownLevel = m_levelSelector->value();
+    int shown = 0;
+    for (int i = 0; i < m_table->rowCount(); ++i) {
+        const bool visible = i >= m_levels.size() || m_levels.at(i) <= shownLevel;
+        m_table->setRowHidden(i, !visible);
+        shown += visible ? 1 : 0;
+    }
+    const QString coverage = shownLevel < m_completeLevels ? tr("uniform") : tr("partial");
+    m_infoLabel->setText(tr("Levels 0-%1 (%2): %3 of %4 runs, %5 levels complete")
+                             .arg(shownLevel)
+                             .arg(coverage)
+                             .arg(shown)
+                             .arg(m_table->rowCount())
+                             .arg(m_completeLevels));
+}
+
 void PhaseMapExplorer::clear() {
+    m_drillDown->cancelAll();
+    m_cellConfigs.clear();
+    m_selectedKey.clear();
+    m_levels.clear();
+    m_completeLevels = 0;
+    m_levelSelector->setVisible(false);
     m_table->setRowCount(0);
     m_infoLabel->setText(tr("No phase map loaded"));
 }
@@ -1,6 +1,7 @@
 // RhythmVisualizerWidget.cpp
 #include "RhythmVisualizerWidget.hpp"
 #include "MainWindow.hpp"
+#include "CoreRunAdapter.hpp"
 
 #include <QPainter>
 #include <QPaintEvent>
@@ -15,6 +16,8 @@ RhythmVisualizerWidget::RhythmVisualizerWidget(QWidget *parent)
     if (auto *mw = qobject_cast<MainWindow*>(parent)) {
         connect(mw, &MainWindow::engineUpdate,
                 this, &RhythmVisualizerWidget::onEngineUpdate);
+        connect(mw, &MainWindow::rowsReset,
+                this, &RhythmVisualizerWidget::clearEvents);
     }
 }
 
@@ -27,10 +30,41 @@ void RhythmVisualizerWidget::appendEvent(const RhythmEvent &event)
 
 void RhythmVisualizerWidget::clearEvents()
 {
+    m_drillDown.reset();
+    m_drillDownRows = 0;
     m_events.clear();
     update();
 }
 
+void RhythmVisualizerWidget::showDrillDown(std::shared_ptr<const MicrotickStore> store,
+                                           int /*radix*/)
+{
+    clearEvents();
+    m_drillDown = std::move(store);
+}
+
+void RhythmVisualizerWidget::onDrillDownRowsAppended(int first, int count)
+{
+    if (!m_drillDown) return;
+    TraceRow row;
+    trace_row_init(&row);
+    // Batches may overlap rows already plotted.
+    for (int i = std::max(first, m_drillDownRows); i < first + count; ++i) {
+        if (!m_drillDown->decode(i, &row)) break;
+        m_drillDownRows = i + 1;
+        if (!(row.flags & TRACE_FLAG_PSI_FIRED)) continue;
+        RhythmEvent e;
+        e.tick      = static_cast<int>(row.tick);
+        e.microTick = row.microtick;
+        e.psiType   = "drill-down";
+        e.color     = QColor("#0088ff");
+        m_events.push_back(e);
+        ensureVisibleTick(e.tick);
+    }
+    trace_row_clear(&row);
+    update();
+}
+
 // Slot for streaming updates:
 void RhythmVisualizerWidget::onEngineUpdate(size_t tick,
                                             int microtick,
@@ -40,6 +74,7 @@ void RhythmVisualizerWidget::onEngineUpdate(size_t tick,
                                             bool /*mu_zero*/,
                                             bool /*forced*/)
 {
+    if (m_drillDown) return;
     RhythmEvent e;
     e.tick      = static_cast<int>(tick);
     e.microTick = microtick;
@@ -184,6 +184,7 @@ QJsonObject TRTSConfig::toJson() const {
     obj.insert("tick_count", static_cast<int>(tickCount));
     obj.insert("microtick_interval_ms", static_cast<int>(microTickIntervalMs));
     obj.insert("koppa_wrap_threshold", static_cast<int>(koppaWrapThreshold));
+    obj.insert("values_radix", static_cast<int>(valuesRadix));
     if (!configPath.isEmpty()) {
         obj.insert("config_path", configPath);
     }
@@ -249,6 +250,7 @@ TRTSConfig TRTSConfig::fromJson(const QJsonObject &object) {
     config.tickCount = object.value("tick_count").toInt(static_cast<int>(config.tickCount));
     config.microTickIntervalMs = object.value("microtick_interval_ms").toInt(static_cast<int>(config.microTickIntervalMs));
     config.koppaWrapThreshold = object.value("koppa_wrap_threshold").toInt(static_cast<int>(config.koppaWrapThreshold));
+    config.valuesRadix = object.value("values_radix").toInt(static_cast<int>(config.valuesRadix));
     config.configPath = object.value("config_path").toString();
 
     return config;
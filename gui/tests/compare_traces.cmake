@@ -0,0 +1,31 @@
+# gui/tests/compare_traces.cmake
+# Runs CONFIG through trts_engine and through CoreRunAdapter and fails unless
+# both write byte-identical traces.
+
+file(REMOVE_RECURSE "${WORK_DIR}")
+file(MAKE_DIRECTORY "${WORK_DIR}")
+
+execute_process(
+    COMMAND "${ENGINE}" --config "${CONFIG}" --trace "${WORK_DIR}/engine.trace" --quiet
+    RESULT_VARIABLE engine_result
+)
+if (NOT engine_result EQUAL 0)
+    message(FATAL_ERROR "trts_engine failed: ${engine_result}")
+endif ()
+
+execute_process(
+    COMMAND "${ADAPTER}" "${CONFIG}" "${WORK_DIR}/adapter.trace"
+    RESULT_VARIABLE adapter_result
+)
+if (NOT adapter_result EQUAL 0)
+    message(FATAL_ERROR "CoreRunAdapter run failed: ${adapter_result}")
+endif ()
+
+execute_process(
+    COMMAND "${CMAKE_COMMAND}" -E compare_files
+        "${WORK_DIR}/engine.trace" "${WORK_DIR}/adapter.trace"
+    RESULT_VARIABLE compare_result
+)
+if (NOT compare_result EQUAL 0)
+    message(FATAL_ERROR "CoreRunAdapter trace differs from trts_engine trace")
+endif ()
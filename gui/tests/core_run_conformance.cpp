@@ -0,0 +1,108 @@
+// gui/tests/core_run_conformance.cpp
+// Runs a configuration file through CoreRunAdapter on its worker thread, as
+// the GUI does, and writes the run's binary trace.  compare_traces.cmake
+// checks that trace against `trts_engine --trace`.  Here the rows held in
+// the adapter's MicrotickStore are checked against the trace itself.
+
+#include "CoreRunAdapter.hpp"
+
+#include <cstdio>
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+
+namespace {
+
+bool sameRow(const TraceRow &a, const TraceRow &b)
+{
+    if (a.tick != b.tick || a.microtick != b.microtick || a.phase != b.phase ||
+        a.flags != b.flags || a.koppa_sample_index != b.koppa_sample_index ||
+        a.koppa_stack_size != b.koppa_stack_size) {
+        return false;
+    }
+    for (int i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        if (mpz_cmp(a.components[i], b.components[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Every stored row must equal the corresponding trace row.
+bool storeMatchesTrace(const MicrotickStore &store, const char *tracePath)
+{
+    TraceReader reader;
+    if (!trace_reader_open(&reader, tracePath)) {
+        std::fprintf(stderr, "Unable to open trace %s\n", tracePath);
+        return false;
+    }
+    TraceRow stored;
+    trace_row_init(&stored);
+    bool ok = true;
+    int index = 0;
+    const TraceRow *row = nullptr;
+    while (ok && trace_reader_next(&reader, &row)) {
+        if (!store.decode(index, &stored) || !sameRow(stored, *row)) {
+            std::fprintf(stderr, "Stored row %d differs from the trace\n", index);
+            ok = false;
+        }
+        ++index;
+    }
+    if (ok && (trace_reader_error(&reader) || index != store.size())) {
+        std::fprintf(stderr, "Trace has %d rows, store has %d\n", index, store.size());
+        ok = false;
+    }
+    trace_row_clear(&stored);
+    trace_reader_close(&reader);
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    QCoreApplication app(argc, argv);
+    if (argc != 3) {
+        std::fprintf(stderr, "Usage: %s <config.json> <trace>\n", argv[0]);
+        return 2;
+    }
+
+    QFile file(QString::fromLocal8Bit(argv[1]));
+    if (!file.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "Unable to open %s\n", argv[1]);
+        return 1;
+    }
+    const TRTSConfig cfg = TRTSConfig::fromJson(QJsonDocument::fromJson(file.readAll()).object());
+
+    CoreRunAdapter adapter;
+    int published = 0;
+    bool contiguous = true;
+    bool ok = false;
+    QObject::connect(&adapter, &CoreRunAdapter::statusMessage, [](const QString &message) {
+        std::fprintf(stderr, "%s\n", qPrintable(message));
+    });
+    QObject::connect(&adapter, &CoreRunAdapter::rowsAppended, [&](int first, int count) {
+        contiguous = contiguous && first == published;
+        published = first + count;
+    });
+    QObject::connect(&adapter, &CoreRunAdapter::finished, [&](bool result) {
+        ok = result;
+        app.quit();
+    });
+    if (!adapter.start(cfg, QString::fromLocal8Bit(argv[2]))) {
+        return 1;
+    }
+    app.exec();
+    adapter.wait();
+
+    if (!ok) {
+        return 1;
+    }
+    if (!contiguous || published != adapter.store().size()) {
+        std::fprintf(stderr, "Published %d rows, store has %d\n", published,
+                     adapter.store().size());
+        return 1;
+    }
+    return storeMatchesTrace(adapter.store(), argv[2]) ? 0 : 1;
+}
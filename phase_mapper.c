@@ -1,12 +1,18 @@
+#include <errno.h>
 #include <gmp.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "analysis_utils.h"
 #include "config.h"
+#include "prime_batch.h"
+#include "sweep_merge.h"
 
 #define MAX_RESULTS 8192
 #define ARRAY_COUNT(arr) (sizeof(arr) / sizeof((arr)[0]))
@@ -40,6 +46,9 @@ typedef struct {
     double ratio_range;
     double ratio_stddev;
     double average_stack_depth;
+    char merged_from[72];
+    size_t merge_tick;
+    size_t level;
 } PhaseRecord;
 
 typedef struct {
@@ -51,8 +60,39 @@ typedef struct {
     char output_prefix[256];
     FractionSeed seeds[32];
     size_t seed_count;
+    bool merge_trajectories;
+    char merge_cache[256];
+    size_t merge_budget;
+    bool batch_output;
+    bool batch_plain;
+    size_t fsync_every;
+    char batch_dir[256];
+    bool progressive;
+    double deadline;
+    size_t prime_batch_runs;
+    unsigned long prime_bound;
 } PhaseOptions;
 
+// One cell of the upsilon x beta seed grid.  level is the refinement level
+// that first reaches the cell and order_key its rank inside that level.
+typedef struct {
+    size_t upsilon_index;
+    size_t beta_index;
+    size_t level;
+    size_t order_key;
+} SweepCell;
+
+static const EngineMode engine_modes[] = {ENGINE_MODE_ADD, ENGINE_MODE_MULTI, ENGINE_MODE_SLIDE,
+                                         ENGINE_MODE_DELTA_ADD};
+static const PsiMode psi_modes[] = {PSI_MODE_INHIBIT_RHO, PSI_MODE_MSTEP, PSI_MODE_RHO_ONLY,
+                                   PSI_MODE_MSTEP_RHO};
+static const KoppaMode koppa_modes[] = {KOPPA_MODE_DUMP, KOPPA_MODE_POP, KOPPA_MODE_ACCUMULATE};
+static const bool triple_modes[] = {false, true};
+
+#define MODE_COUNT                                                                        \
+    (ARRAY_COUNT(engine_modes) * ARRAY_COUNT(psi_modes) * ARRAY_COUNT(koppa_modes) *    \
+     ARRAY_COUNT(triple_modes))
+
 static const char *engine_mode_name(EngineMode mode) {
     switch (mode) {
     case ENGINE_MODE_ADD:
@@ -121,6 +161,90 @@ static void apply_seed(mpq_t dest, FractionSeed seed) {
     mpz_set_ui(mpq_denref(dest), seed.denominator);
 }
 
+// Select mode combination mode_index, counting through engine, psi, koppa
+// and triple psi modes with the triple psi mode varying fastest.
+static void apply_modes(Config *config, size_t mode_index) {
+    config->triple_psi_mode = triple_modes[mode_index % ARRAY_COUNT(triple_modes)];
+    mode_index /= ARRAY_COUNT(triple_modes);
+    config->koppa_mode = koppa_modes[mode_index % ARRAY_COUNT(koppa_modes)];
+    mode_index /= ARRAY_COUNT(koppa_modes);
+    config->psi_mode = psi_modes[mode_index % ARRAY_COUNT(psi_modes)];
+    mode_index /= ARRAY_COUNT(psi_modes);
+    config->engine_mode = engine_modes[mode_index];
+    config->engine_upsilon = track_mode_for_engine(config->engine_mode);
+    config->engine_beta = track_mode_for_engine(config->engine_mode);
+}
+
+// Level of cell (u, b) in a grid of 2^depth cells per side.  Level 0 is the
+// corner cell; level l adds the cells on the lattice of stride 2^(depth - l)
+// that no coarser level covers, so levels 0..l together sample the grid
+// uniformly at that stride.
+static size_t cell_level(size_t u, size_t b, size_t depth) {
+    size_t level = depth;
+    while (level > 0U) {
+        size_t coarser_stride = (size_t)1U << (depth - level + 1U);
+        if (u % coarser_stride != 0U || b % coarser_stride != 0U) {
+            break;
+        }
+        --level;
+    }
+    return level;
+}
+
+// Morton code of (x, y) with the bit order reversed, so consecutive keys
+// jump between the quadrants of the level lattice instead of walking it.
+static size_t reversed_morton(size_t x, size_t y, size_t bits) {
+    size_t key = 0U;
+    for (size_t bit = 0; bit < bits; ++bit) {
+        key = (key << 2U) | (((x >> bit) & 1U) << 1U) | ((y >> bit) & 1U);
+    }
+    return key;
+}
+
+static int compare_cells(const void *a, const void *b) {
+    const SweepCell *left = a;
+    const SweepCell *right = b;
+    if (left->level != right->level) {
+        return left->level < right->level ? -1 : 1;
+    }
+    if (left->order_key != right->order_key) {
+        return left->order_key < right->order_key ? -1 : 1;
+    }
+    return 0;
+}
+
+// Fill cells with the side x side seed grid in sweep order and return the
+// number of refinement levels.  Row-major order is the historical one.
+// Progressive order runs the levels coarse to fine and each level in
+// reversed Morton order, so a sweep stopped at any point has covered the
+// grid evenly, only at a coarser resolution.
+static size_t plan_cells(size_t side, bool progressive, SweepCell *cells) {
+    size_t depth = 0U;
+    while (((size_t)1U << depth) < side) {
+        ++depth;
+    }
+    for (size_t u = 0; u < side; ++u) {
+        for (size_t b = 0; b < side; ++b) {
+            SweepCell *cell = &cells[u * side + b];
+            cell->upsilon_index = u;
+            cell->beta_index = b;
+            cell->level = cell_level(u, b, depth);
+            size_t shift = depth - cell->level;
+            cell->order_key = reversed_morton(u >> shift, b >> shift, cell->level);
+        }
+    }
+    if (progressive) {
+        qsort(cells, side * side, sizeof(*cells), compare_cells);
+    }
+    return depth + 1U;
+}
+
+static double elapsed_seconds(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start->tv_sec) + (double)(now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
 static void options_init(PhaseOptions *options) {
     options->scan_all = false;
     options->ticks = 30U;
@@ -129,6 +253,17 @@ static void options_init(PhaseOptions *options) {
     options->write_output = false;
     options->output_prefix[0] = '\0';
     options->seed_count = 0U;
+    options->merge_trajectories = false;
+    options->merge_cache[0] = '\0';
+    options->merge_budget = 0U;
+    options->batch_output = false;
+    options->batch_plain = false;
+    options->fsync_every = 0U;
+    snprintf(options->batch_dir, sizeof(options->batch_dir), "%s", "phase_runs");
+    options->progressive = false;
+    options->deadline = 0.0;
+    options->prime_batch_runs = 0U;
+    options->prime_bound = PRIME_BATCH_DEFAULT_BOUND;
 }
 
 static bool parse_fraction(const char *text, FractionSeed *seed) {
@@ -185,6 +320,38 @@ static void parse_arguments(int argc, char **argv, PhaseOptions *options) {
         } else if (strcmp(argv[i], "--output-phase-map") == 0 && i + 1 < argc) {
             options->write_output = true;
             snprintf(options->output_prefix, sizeof(options->output_prefix), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--merge-trajectories") == 0 && i + 1 < argc) {
+            options->merge_trajectories = true;
+            snprintf(options->merge_cache, sizeof(options->merge_cache), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--merge-budget") == 0 && i + 1 < argc) {
+            options->merge_budget = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch-output") == 0) {
+            options->batch_output = true;
+        } else if (strcmp(argv[i], "--batch-plain") == 0) {
+            options->batch_output = true;
+            options->batch_plain = true;
+        } else if (strcmp(argv[i], "--fsync-every") == 0 && i + 1 < argc) {
+            options->batch_output = true;
+            options->fsync_every = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch-dir") == 0 && i + 1 < argc) {
+            options->batch_output = true;
+            snprintf(options->batch_dir, sizeof(options->batch_dir), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--order") == 0 && i + 1 < argc) {
+            const char *order = argv[++i];
+            if (strcmp(order, "progressive") == 0) {
+                options->progressive = true;
+            } else if (strcmp(order, "rowmajor") == 0) {
+                options->progressive = false;
+            } else {
+                fprintf(stderr, "Unknown --order %s (expected rowmajor or progressive).\n", order);
+                exit(1);
+            }
+        } else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) {
+            options->deadline = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--prime-batch") == 0 && i + 1 < argc) {
+            options->prime_batch_runs = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--prime-bound") == 0 && i + 1 < argc) {
+            options->prime_bound = strtoul(argv[++i], NULL, 10);
         } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
             const char *grid_text = argv[++i];
             const char *delimiter = strchr(grid_text, ':');
@@ -254,34 +421,38 @@ static void record_from_summary(const Config *config, const FractionSeed *ups_se
     record->ratio_range = summary->ratio_range;
     record->ratio_stddev = summary->ratio_stddev;
     record->average_stack_depth = summary->average_stack_depth;
+    record->merged_from[0] = '\0';
+    record->merge_tick = 0U;
+    record->level = 0U;
 }
 
-static void write_csv(const PhaseRecord *records, size_t count, const char *path) {
+static bool write_csv(const PhaseRecord *records, size_t count, const char *path) {
     FILE *file = fopen(path, "w");
     if (!file) {
-        return;
+        return false;
     }
     fprintf(file,
-            "engine,psi,koppa,psi_type,u_seed,b_seed,final_ratio,closest_constant,delta,convergence_tick,pattern,classification,stack_summary,final_ratio_snapshot,psi_events,rho_events,mu_zero,psi_spacing_mean,psi_spacing_stddev,ratio_variance,ratio_range,ratio_stddev,average_stack_depth\n");
+            "engine,psi,koppa,psi_type,u_seed,b_seed,final_ratio,closest_constant,delta,convergence_tick,pattern,classification,stack_summary,final_ratio_snapshot,psi_events,rho_events,mu_zero,psi_spacing_mean,psi_spacing_stddev,ratio_variance,ratio_range,ratio_stddev,average_stack_depth,merged_from,merge_tick,level\n");
     for (size_t i = 0; i < count; ++i) {
         const PhaseRecord *record = &records[i];
         fprintf(file,
-                "%s,%s,%s,%s,%s,%s,%s,%s,%.12g,%zu,%s,%s,%s,%.12g,%zu,%zu,%zu,%.12g,%.12g,%.12g,%.12g,%.12g,%.12g\n",
+                "%s,%s,%s,%s,%s,%s,%s,%s,%.12g,%zu,%s,%s,%s,%.12g,%zu,%zu,%zu,%.12g,%.12g,%.12g,%.12g,%.12g,%.12g,%s,%zu,%zu\n",
                 record->engine, record->psi, record->koppa, record->psi_type, record->upsilon_seed,
                 record->beta_seed, record->final_ratio, record->closest_constant, record->delta,
                 record->convergence_tick, record->pattern, record->classification,
                 record->stack_summary, record->final_ratio_snapshot, record->psi_events,
                 record->rho_events, record->mu_zero_events, record->psi_spacing_mean,
                 record->psi_spacing_stddev, record->ratio_variance, record->ratio_range,
-                record->ratio_stddev, record->average_stack_depth);
+                record->ratio_stddev, record->average_stack_depth, record->merged_from,
+                record->merge_tick, record->level);
     }
-    fclose(file);
+    return fclose(file) == 0;
 }
 
-static void write_json(const PhaseRecord *records, size_t count, const char *path) {
+static bool write_json(const PhaseRecord *records, size_t count, const char *path) {
     FILE *file = fopen(path, "w");
     if (!file) {
-        return;
+        return false;
     }
     fprintf(file, "[\n");
     for (size_t i = 0; i < count; ++i) {
@@ -310,7 +481,10 @@ static void write_json(const PhaseRecord *records, size_t count, const char *pat
                 "    \"ratio_variance\": %.12g,\n"
                 "    \"ratio_range\": %.12g,\n"
                 "    \"ratio_stddev\": %.12g,\n"
-                "    \"average_stack_depth\": %.12g\n"
+                "    \"average_stack_depth\": %.12g,\n"
+                "    \"merged_from\": \"%s\",\n"
+                "    \"merge_tick\": %zu,\n"
+                "    \"level\": %zu\n"
                 "  }%s\n",
                 record->engine, record->psi, record->koppa, record->psi_type, record->upsilon_seed,
                 record->beta_seed, record->final_ratio, record->closest_constant, record->delta,
@@ -318,11 +492,32 @@ static void write_json(const PhaseRecord *records, size_t count, const char *pat
                 record->stack_summary, record->final_ratio_snapshot, record->psi_events,
                 record->rho_events, record->mu_zero_events, record->psi_spacing_mean,
                 record->psi_spacing_stddev, record->ratio_variance, record->ratio_range,
-                record->ratio_stddev, record->average_stack_depth,
-                (i + 1 < count) ? "," : "");
+                record->ratio_stddev, record->average_stack_depth, record->merged_from,
+                record->merge_tick, record->level, (i + 1 < count) ? "," : "");
     }
     fprintf(file, "]\n");
-    fclose(file);
+    return fclose(file) == 0;
+}
+
+// Write <prefix>.csv and <prefix>.json through temporary files renamed into
+// place, so a reader never sees a half written map.
+static bool write_phase_map(const PhaseRecord *records, size_t count, const char *prefix) {
+    static const char *const extensions[] = {"csv", "json"};
+    bool ok = true;
+    for (size_t i = 0; i < ARRAY_COUNT(extensions); ++i) {
+        char path[512];
+        char temporary_path[520];
+        snprintf(path, sizeof(path), "%s.%s", prefix, extensions[i]);
+        snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+        bool written = i == 0U ? write_csv(records, count, temporary_path)
+                               : write_json(records, count, temporary_path);
+        if (!written || rename(temporary_path, path) != 0) {
+            perror(path);
+            remove(temporary_path);
+            ok = false;
+        }
+    }
+    return ok;
 }
 
 static void print_record(const PhaseRecord *record) {
@@ -332,6 +527,123 @@ static void print_record(const PhaseRecord *record) {
            record->classification, record->psi_type, record->stack_summary);
 }
 
+// Settings shared by every run of the sweep.
+static void sweep_config_init(Config *config, const PhaseOptions *options) {
+    config_init(config);
+    config->ticks = options->ticks;
+    config->koppa_trigger = KOPPA_ON_ALL_MU;
+    config->prime_target = PRIME_ON_MEMORY;
+    config->mt10_behavior = MT10_FORCED_PSI;
+    rational_set_si(config->initial_koppa, 1, 1);
+}
+
+// Point config at run step of the sweep and return its cell.
+static const SweepCell *configure_step(Config *config, const PhaseOptions *options,
+                                       const SweepCell *cells, size_t cell_count, size_t step,
+                                       FractionSeed *ups_seed, FractionSeed *beta_seed) {
+    size_t cell_index = options->progressive ? step / MODE_COUNT : step % cell_count;
+    const SweepCell *cell = &cells[cell_index];
+    apply_modes(config, options->progressive ? step % MODE_COUNT : step / cell_count);
+    *ups_seed = options->seeds[cell->upsilon_index];
+    *beta_seed = options->seeds[cell->beta_index];
+    apply_seed(config->initial_upsilon, *ups_seed);
+    apply_seed(config->initial_beta, *beta_seed);
+    return cell;
+}
+
+// With --prime-batch N the sweep runs N steps at a time, each on its own
+// thread, all sharing one PrimeBatch so their E-phase prime checks are
+// classified together.  Results are consumed in step order afterwards, so
+// the phase map is the one the sequential sweep produces.
+typedef struct {
+    Config config;
+    RunSummary summary;
+    bool ok;
+    bool threaded;
+    pthread_t thread;
+} WaveRun;
+
+typedef struct {
+    WaveRun *runs;
+    size_t capacity;
+    size_t first_step;
+    size_t count;
+    PrimeBatch batch;
+} RunWave;
+
+static bool run_wave_init(RunWave *wave, size_t capacity, unsigned long prime_bound,
+                          const PhaseOptions *options) {
+    wave->runs = calloc(capacity, sizeof(WaveRun));
+    if (!wave->runs || !prime_batch_init(&wave->batch, prime_bound)) {
+        free(wave->runs);
+        return false;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        sweep_config_init(&wave->runs[i].config, options);
+        wave->runs[i].config.prime_batch = &wave->batch;
+        run_summary_init(&wave->runs[i].summary);
+    }
+    wave->capacity = capacity;
+    wave->first_step = 0U;
+    wave->count = 0U;
+    return true;
+}
+
+static void run_wave_clear(RunWave *wave) {
+    for (size_t i = 0; i < wave->capacity; ++i) {
+        config_clear(&wave->runs[i].config);
+        run_summary_clear(&wave->runs[i].summary);
+    }
+    free(wave->runs);
+    prime_batch_clear(&wave->batch);
+}
+
+static void *wave_run_main(void *user_data) {
+    WaveRun *run = user_data;
+    run->ok = simulate_and_analyze_batched(&run->config, NULL, NULL, &run->summary, NULL);
+    prime_batch_leave(run->config.prime_batch);
+    return NULL;
+}
+
+// Simulate steps [first_step, first_step + count).  Every run joins the
+// batch before any starts, so no round completes without one of them; a
+// run whose thread cannot be started leaves again and runs unbatched
+// once the others are done.
+static void run_wave(RunWave *wave, const PhaseOptions *options, const SweepCell *cells,
+                     size_t cell_count, size_t first_step, size_t count) {
+    wave->first_step = first_step;
+    wave->count = count;
+    for (size_t i = 0; i < count; ++i) {
+        FractionSeed ups_seed, beta_seed;
+        configure_step(&wave->runs[i].config, options, cells, cell_count, first_step + i,
+                       &ups_seed, &beta_seed);
+        run_summary_clear(&wave->runs[i].summary);
+        run_summary_init(&wave->runs[i].summary);
+        prime_batch_join(&wave->batch);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        WaveRun *run = &wave->runs[i];
+        run->threaded = pthread_create(&run->thread, NULL, wave_run_main, run) == 0;
+        if (!run->threaded) {
+            prime_batch_leave(&wave->batch);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (wave->runs[i].threaded) {
+            pthread_join(wave->runs[i].thread, NULL);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        WaveRun *run = &wave->runs[i];
+        if (!run->threaded) {
+            run->config.prime_batch = NULL;
+            run->ok = simulate_and_analyze_batched(&run->config, NULL, NULL, &run->summary,
+                                                   NULL);
+            run->config.prime_batch = &wave->batch;
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     PhaseOptions options;
     parse_arguments(argc, argv, &options);
@@ -342,88 +654,236 @@ int main(int argc, char **argv) {
     }
 
     PhaseRecord *records = malloc(sizeof(PhaseRecord) * MAX_RESULTS);
-    if (!records) {
+    SweepCell *cells = malloc(sizeof(SweepCell) * options.seed_count * options.seed_count);
+    if (!records || !cells) {
         fprintf(stderr, "Failed to allocate records.\n");
+        free(records);
+        free(cells);
         return 1;
     }
     size_t record_count = 0U;
 
+    if (options.prime_batch_runs > 0U && (options.merge_trajectories || options.batch_output)) {
+        fprintf(stderr, "--prime-batch cannot be combined with --merge-trajectories or batched output.\n");
+        free(records);
+        free(cells);
+        return 1;
+    }
+
     Config config;
-    config_init(&config);
-    config.ticks = options.ticks;
-    config.koppa_trigger = KOPPA_ON_ALL_MU;
-    config.prime_target = PRIME_ON_MEMORY;
-    config.mt10_behavior = MT10_FORCED_PSI;
-    rational_set_si(config.initial_koppa, 1, 1);
-
-    EngineMode engine_modes[] = {ENGINE_MODE_ADD, ENGINE_MODE_MULTI, ENGINE_MODE_SLIDE,
-                                 ENGINE_MODE_DELTA_ADD};
-    PsiMode psi_modes[] = {PSI_MODE_INHIBIT_RHO, PSI_MODE_MSTEP, PSI_MODE_RHO_ONLY,
-                           PSI_MODE_MSTEP_RHO};
-    KoppaMode koppa_modes[] = {KOPPA_MODE_DUMP, KOPPA_MODE_POP, KOPPA_MODE_ACCUMULATE};
-
-    bool triple_modes[] = {false, true};
-
-    for (size_t engine_index = 0; engine_index < ARRAY_COUNT(engine_modes); ++engine_index) {
-        config.engine_mode = engine_modes[engine_index];
-        config.engine_upsilon = track_mode_for_engine(config.engine_mode);
-        config.engine_beta = track_mode_for_engine(config.engine_mode);
-
-        for (size_t psi_index = 0; psi_index < ARRAY_COUNT(psi_modes); ++psi_index) {
-            config.psi_mode = psi_modes[psi_index];
-
-            for (size_t koppa_index = 0; koppa_index < ARRAY_COUNT(koppa_modes); ++koppa_index) {
-                config.koppa_mode = koppa_modes[koppa_index];
-
-                for (size_t triple_index = 0; triple_index < ARRAY_COUNT(triple_modes); ++triple_index) {
-                    config.triple_psi_mode = triple_modes[triple_index];
-
-                    for (size_t u_index = 0; u_index < options.seed_count; ++u_index) {
-                        FractionSeed ups_seed = options.seeds[u_index];
-                        apply_seed(config.initial_upsilon, ups_seed);
-
-                        for (size_t b_index = 0; b_index < options.seed_count; ++b_index) {
-                            FractionSeed beta_seed = options.seeds[b_index];
-                            apply_seed(config.initial_beta, beta_seed);
-
-                            RunSummary summary;
-                            run_summary_init(&summary);
-                            bool ok = simulate_and_analyze(&config, &summary);
-                            if (!ok) {
-                                run_summary_clear(&summary);
-                                continue;
-                            }
+    sweep_config_init(&config, &options);
+
+    // With --merge-trajectories, cells that reach a state another cell has
+    // already passed through copy the rest of that trajectory instead of
+    // simulating it.  run_seeds maps merge run ids back to their seeds.
+    SweepMergeTable merge_table;
+    FractionSeed (*run_seeds)[2] = NULL;
+    size_t run_seed_capacity = 0U;
+    if (options.merge_trajectories &&
+        !sweep_merge_init(&merge_table, options.merge_cache, options.merge_budget)) {
+        fprintf(stderr, "Failed to prepare merge cache %s.\n", options.merge_cache);
+        free(records);
+        free(cells);
+        config_clear(&config);
+        return 1;
+    }
 
-                            if (record_count < MAX_RESULTS) {
-                                record_from_summary(&config, &ups_seed, &beta_seed, &summary,
-                                                    &records[record_count]);
-                                if (options.verbose) {
-                                    print_record(&records[record_count]);
-                                }
-                                ++record_count;
-                            }
+    // With --batch-output every run keeps its own CSVs under --batch-dir,
+    // written through a batched writer (io_uring when available) that is only
+    // drained at shard boundaries; --fsync-every N makes every N runs a shard
+    // whose files are fsynced before they are closed.  Without it each run
+    // overwrites events.csv and values.csv as before.
+    BatchOutput batch;
+    BatchOutput *batch_output = NULL;
+    size_t runs_in_shard = 0U;
+    size_t run_index = 0U;
+    int exit_status = 0;
+    if (options.batch_output) {
+        if (mkdir(options.batch_dir, 0777) != 0 && errno != EEXIST) {
+            perror(options.batch_dir);
+            if (options.merge_trajectories) {
+                sweep_merge_clear(&merge_table);
+            }
+            free(records);
+            free(cells);
+            config_clear(&config);
+            return 1;
+        }
+        BatchOutputOptions batch_options;
+        batch_output_options_init(&batch_options);
+        batch_options.sync_shards = options.fsync_every > 0U;
+        batch_options.force_plain = options.batch_plain;
+        if (!batch_output_init(&batch, &batch_options)) {
+            fprintf(stderr, "Failed to prepare batched output.\n");
+            free(records);
+            free(cells);
+            config_clear(&config);
+            return 1;
+        }
+        batch_output = &batch;
+        if (options.merge_trajectories) {
+            merge_table.batch = batch_output;
+        }
+    }
 
-                            if (options.limit > 0U && record_count >= options.limit) {
-                                run_summary_clear(&summary);
-                                goto phase_done;
-                            }
+    // Row-major order runs every mode combination over the whole grid before
+    // the next; progressive order runs all combinations of one cell before
+    // moving to the next cell of the plan and checkpoints the phase map at
+    // the end of every refinement level.
+    size_t cell_count = options.seed_count * options.seed_count;
+    size_t total_runs = cell_count * MODE_COUNT;
+    size_t level_count = plan_cells(options.seed_count, options.progressive, cells);
+    struct timespec sweep_start;
+    clock_gettime(CLOCK_MONOTONIC, &sweep_start);
+
+    // Concurrent runs keep no per-run CSVs: they would all be events.csv.
+    RunWave wave;
+    RunWave *run_wave_state = NULL;
+    if (options.prime_batch_runs > 0U) {
+        if (!run_wave_init(&wave, options.prime_batch_runs, options.prime_bound, &options)) {
+            fprintf(stderr, "Failed to prepare the prime batch.\n");
+            free(records);
+            free(cells);
+            config_clear(&config);
+            return 1;
+        }
+        run_wave_state = &wave;
+    }
 
-                            run_summary_clear(&summary);
-                        }
-                    }
+    for (size_t step = 0; step < total_runs; ++step) {
+        if (options.deadline > 0.0 && elapsed_seconds(&sweep_start) >= options.deadline) {
+            printf("Deadline reached after %zu of %zu runs.\n", step, total_runs);
+            break;
+        }
+        FractionSeed ups_seed, beta_seed;
+        const SweepCell *cell =
+            configure_step(&config, &options, cells, cell_count, step, &ups_seed, &beta_seed);
+
+        char events_path[320] = "events.csv";
+        char values_path[320] = "values.csv";
+        if (batch_output) {
+            snprintf(events_path, sizeof(events_path), "%s/run_%06zu_events.csv",
+                     options.batch_dir, run_index);
+            snprintf(values_path, sizeof(values_path), "%s/run_%06zu_values.csv",
+                     options.batch_dir, run_index);
+        }
+        ++run_index;
+
+        RunSummary summary;
+        run_summary_init(&summary);
+        SweepProvenance provenance;
+        memset(&provenance, 0, sizeof(provenance));
+        bool ok;
+        if (options.merge_trajectories) {
+            ok = sweep_merge_simulate(&merge_table, &config, events_path, values_path, &summary,
+                                      &provenance);
+            if (ok && provenance.run_id >= run_seed_capacity) {
+                size_t capacity = run_seed_capacity ? run_seed_capacity * 2U : 256U;
+                FractionSeed(*grown)[2] = realloc(run_seeds, capacity * sizeof(*run_seeds));
+                if (grown) {
+                    run_seeds = grown;
+                    run_seed_capacity = capacity;
                 }
             }
+            if (ok && provenance.run_id < run_seed_capacity) {
+                run_seeds[provenance.run_id][0] = ups_seed;
+                run_seeds[provenance.run_id][1] = beta_seed;
+            }
+        } else if (run_wave_state) {
+            if (step >= run_wave_state->first_step + run_wave_state->count) {
+                size_t count = total_runs - step;
+                if (count > run_wave_state->capacity) {
+                    count = run_wave_state->capacity;
+                }
+                // Runs past --limit would be simulated only to be dropped.
+                if (options.limit > 0U && count > options.limit - record_count) {
+                    count = options.limit - record_count;
+                }
+                run_wave(run_wave_state, &options, cells, cell_count, step, count);
+            }
+            const WaveRun *run = &run_wave_state->runs[step - run_wave_state->first_step];
+            ok = run->ok;
+            run_summary_copy(&summary, &run->summary);
+        } else {
+            ok = simulate_and_analyze_batched(&config, events_path, values_path, &summary,
+                                              batch_output);
+        }
+        if (batch_output && options.fsync_every > 0U && ++runs_in_shard == options.fsync_every) {
+            runs_in_shard = 0U;
+            if (!batch_output_shard_boundary(batch_output)) {
+                perror("batched output");
+                exit_status = 1;
+                ok = false;
+            }
+        }
+
+        if (ok && record_count < MAX_RESULTS) {
+            PhaseRecord *record = &records[record_count];
+            record_from_summary(&config, &ups_seed, &beta_seed, &summary, record);
+            record->level = cell->level;
+            if (options.merge_trajectories && provenance.merged &&
+                provenance.source_run < run_seed_capacity) {
+                const FractionSeed *source = run_seeds[provenance.source_run];
+                snprintf(record->merged_from, sizeof(record->merged_from), "%ld/%lu;%ld/%lu@%zu",
+                         source[0].numerator, source[0].denominator, source[1].numerator,
+                         source[1].denominator, provenance.source_tick);
+                record->merge_tick = provenance.merge_tick;
+            }
+            if (options.verbose) {
+                print_record(record);
+            }
+            ++record_count;
+        }
+        run_summary_clear(&summary);
+
+        bool level_done = step + 1U == total_runs ||
+                          cells[(step + 1U) / MODE_COUNT].level != cell->level;
+        if (options.progressive && level_done) {
+            printf("Refinement level %zu of %zu complete: %zu records.\n", cell->level + 1U,
+                   level_count, record_count);
+            if (options.write_output && record_count > 0U &&
+                !write_phase_map(records, record_count, options.output_prefix)) {
+                exit_status = 1;
+            }
+        }
+
+        if (ok && options.limit > 0U && record_count >= options.limit) {
+            break;
         }
     }
 
-phase_done:
-    if (options.write_output && record_count > 0U) {
-        char csv_path[512];
-        char json_path[512];
-        snprintf(csv_path, sizeof(csv_path), "%s.csv", options.output_prefix);
-        snprintf(json_path, sizeof(json_path), "%s.json", options.output_prefix);
-        write_csv(records, record_count, csv_path);
-        write_json(records, record_count, json_path);
+    if (batch_output) {
+        // Files not yet confirmed are only known to be complete here.
+        if (!batch_output_shard_boundary(batch_output)) {
+            perror("batched output");
+            exit_status = 1;
+        }
+        printf("Batched output (%s): %llu files, %llu bytes, %llu operations in %llu system calls.\n",
+               batch_output_backend_name(batch_output),
+               (unsigned long long)batch_output->files_written,
+               (unsigned long long)batch_output->bytes_written,
+               (unsigned long long)batch_output->operations,
+               (unsigned long long)batch_output->system_calls);
+        batch_output_clear(batch_output);
+    }
+    if (run_wave_state) {
+        const PrimeBatch *batch = &run_wave_state->batch;
+        printf("Prime batch (bound %lu): %llu values in %llu rounds, %llu through the trees; "
+               "%llu certified prime, %llu composite, %llu left to probable-prime tests.\n",
+               batch->bound, (unsigned long long)batch->values, (unsigned long long)batch->rounds,
+               (unsigned long long)batch->tree_values, (unsigned long long)batch->primes,
+               (unsigned long long)batch->composites, (unsigned long long)batch->rough);
+        run_wave_clear(run_wave_state);
+    }
+    if (options.merge_trajectories) {
+        printf("Merged %zu of %zu runs, %zu ticks not simulated.\n", merge_table.merged_runs,
+               merge_table.run_count, merge_table.ticks_skipped);
+        sweep_merge_clear(&merge_table);
+        free(run_seeds);
+    }
+    if (options.write_output && record_count > 0U &&
+        !write_phase_map(records, record_count, options.output_prefix)) {
+        exit_status = 1;
     }
 
     if (!options.verbose) {
@@ -433,6 +893,7 @@ phase_done:
     }
 
     free(records);
+    free(cells);
     config_clear(&config);
-    return 0;
+    return exit_status;
 }
@@ -0,0 +1,266 @@
+// prime_batch.c
+// Cross-run batch trial division (see prime_batch.h).  A round is classified
+// by the thread that completes it, under the lock: every other participant
+// is waiting on it anyway.
+
+#include "prime_batch.h"
+
+#include <stdlib.h>
+
+#define PRIME_BATCH_MAX_BOUND (1UL << 24)
+
+bool prime_batch_init(PrimeBatch *batch, unsigned long bound) {
+    if (bound == 0UL) {
+        bound = PRIME_BATCH_DEFAULT_BOUND;
+    }
+    if (bound < 2UL) {
+        bound = 2UL;
+    }
+    if (bound > PRIME_BATCH_MAX_BOUND) {
+        bound = PRIME_BATCH_MAX_BOUND;
+    }
+    batch->composite_sieve = (unsigned char *)calloc(bound + 1UL, 1U);
+    if (!batch->composite_sieve) {
+        return false;
+    }
+    if (pthread_mutex_init(&batch->lock, NULL) != 0) {
+        free(batch->composite_sieve);
+        return false;
+    }
+    if (pthread_cond_init(&batch->round_done, NULL) != 0) {
+        pthread_mutex_destroy(&batch->lock);
+        free(batch->composite_sieve);
+        return false;
+    }
+    batch->bound = bound;
+    batch->composite_sieve[0] = 1U;
+    batch->composite_sieve[1] = 1U;
+    mpz_init_set_ui(batch->prime_product, 1UL);
+    for (unsigned long n = 2UL; n <= bound; ++n) {
+        if (batch->composite_sieve[n]) {
+            continue;
+        }
+        mpz_mul_ui(batch->prime_product, batch->prime_product, n);
+        if (n > bound / n) {
+            continue;
+        }
+        for (unsigned long multiple = n * n; multiple <= bound; multiple += n) {
+            batch->composite_sieve[multiple] = 1U;
+        }
+    }
+    mpz_init(batch->bound_squared);
+    mpz_ui_pow_ui(batch->bound_squared, bound, 2UL);
+
+    batch->participants = 0U;
+    batch->arrived = 0U;
+    batch->round = 0U;
+    batch->pending = NULL;
+    batch->pending_count = 0U;
+    batch->pending_capacity = 0U;
+    batch->rounds = 0U;
+    batch->values = 0U;
+    batch->tree_values = 0U;
+    batch->primes = 0U;
+    batch->composites = 0U;
+    batch->rough = 0U;
+    return true;
+}
+
+void prime_batch_clear(PrimeBatch *batch) {
+    free(batch->pending);
+    batch->pending = NULL;
+    free(batch->composite_sieve);
+    batch->composite_sieve = NULL;
+    mpz_clear(batch->prime_product);
+    mpz_clear(batch->bound_squared);
+    pthread_cond_destroy(&batch->round_done);
+    pthread_mutex_destroy(&batch->lock);
+}
+
+// Node k of the product tree over leaves[lo, hi) has children 2k and 2k+1.
+static void build_product_tree(mpz_t *tree, size_t node, mpz_t *leaves, size_t lo, size_t hi) {
+    if (hi - lo == 1U) {
+        mpz_set(tree[node], leaves[lo]);
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2U;
+    build_product_tree(tree, 2U * node, leaves, lo, mid);
+    build_product_tree(tree, 2U * node + 1U, leaves, mid, hi);
+    mpz_mul(tree[node], tree[2U * node], tree[2U * node + 1U]);
+}
+
+// Leaves end up holding the product of primes modulo themselves; tree
+// nodes are reused for the remainders on the way down.
+static void descend_remainder_tree(mpz_t *tree, size_t node, mpz_srcptr parent, mpz_t *leaves,
+                                   size_t lo, size_t hi) {
+    mpz_tdiv_r(tree[node], parent, tree[node]);
+    if (hi - lo == 1U) {
+        mpz_swap(leaves[lo], tree[node]);
+        return;
+    }
+    size_t mid = lo + (hi - lo) / 2U;
+    descend_remainder_tree(tree, 2U * node, tree[node], leaves, lo, mid);
+    descend_remainder_tree(tree, 2U * node + 1U, tree[node], leaves, mid, hi);
+}
+
+static void certify(PrimeBatch *batch, size_t entry, PrimeCertificate certificate) {
+    *batch->pending[entry].certificate = certificate;
+    switch (certificate) {
+    case PRIME_CERT_PRIME:
+        ++batch->primes;
+        break;
+    case PRIME_CERT_COMPOSITE:
+        ++batch->composites;
+        break;
+    case PRIME_CERT_ROUGH:
+        ++batch->rough;
+        break;
+    case PRIME_CERT_UNIT:
+        break;
+    }
+}
+
+// Values up to bound are looked up in the sieve; the rest go through the
+// trees.  Allocation failure leaves them ROUGH, which is always safe.
+static void classify_pending(PrimeBatch *batch) {
+    size_t count = batch->pending_count;
+    ++batch->rounds;
+    batch->values += count;
+
+    size_t *large = (size_t *)malloc((count ? count : 1U) * sizeof(size_t));
+    size_t large_count = 0U;
+    for (size_t i = 0; i < count; ++i) {
+        mpz_srcptr value = batch->pending[i].value;
+        if (mpz_cmpabs_ui(value, 1UL) <= 0) {
+            certify(batch, i, PRIME_CERT_UNIT);
+        } else if (mpz_cmpabs_ui(value, batch->bound) <= 0) {
+            unsigned long magnitude = mpz_getlimbn(value, 0);
+            certify(batch, i,
+                    batch->composite_sieve[magnitude] ? PRIME_CERT_COMPOSITE : PRIME_CERT_PRIME);
+        } else if (large) {
+            large[large_count++] = i;
+        } else {
+            certify(batch, i, PRIME_CERT_ROUGH);
+        }
+    }
+    if (large_count == 0U) {
+        free(large);
+        return;
+    }
+
+    mpz_t *leaves = (mpz_t *)malloc(large_count * sizeof(mpz_t));
+    mpz_t *tree = (mpz_t *)malloc(4U * large_count * sizeof(mpz_t));
+    if (!leaves || !tree) {
+        for (size_t i = 0; i < large_count; ++i) {
+            certify(batch, large[i], PRIME_CERT_ROUGH);
+        }
+        free(leaves);
+        free(tree);
+        free(large);
+        return;
+    }
+    for (size_t i = 0; i < large_count; ++i) {
+        mpz_init(leaves[i]);
+        mpz_abs(leaves[i], batch->pending[large[i]].value);
+    }
+    for (size_t i = 0; i < 4U * large_count; ++i) {
+        mpz_init(tree[i]);
+    }
+    build_product_tree(tree, 1U, leaves, 0U, large_count);
+    descend_remainder_tree(tree, 1U, batch->prime_product, leaves, 0U, large_count);
+
+    mpz_t magnitude;
+    mpz_init(magnitude);
+    for (size_t i = 0; i < large_count; ++i) {
+        mpz_srcptr value = batch->pending[large[i]].value;
+        mpz_abs(magnitude, value);
+        mpz_gcd(leaves[i], leaves[i], magnitude);
+        if (mpz_cmp_ui(leaves[i], 1UL) > 0) {
+            certify(batch, large[i], PRIME_CERT_COMPOSITE);
+        } else if (mpz_cmp(magnitude, batch->bound_squared) < 0) {
+            certify(batch, large[i], PRIME_CERT_PRIME);
+        } else {
+            certify(batch, large[i], PRIME_CERT_ROUGH);
+        }
+    }
+    batch->tree_values += large_count;
+    mpz_clear(magnitude);
+
+    for (size_t i = 0; i < 4U * large_count; ++i) {
+        mpz_clear(tree[i]);
+    }
+    for (size_t i = 0; i < large_count; ++i) {
+        mpz_clear(leaves[i]);
+    }
+    free(tree);
+    free(leaves);
+    free(large);
+}
+
+// Called with the lock held by whoever completes the round.
+static void finish_round(PrimeBatch *batch) {
+    classify_pending(batch);
+    batch->pending_count = 0U;
+    batch->arrived = 0U;
+    ++batch->round;
+    pthread_cond_broadcast(&batch->round_done);
+}
+
+void prime_batch_join(PrimeBatch *batch) {
+    pthread_mutex_lock(&batch->lock);
+    ++batch->participants;
+    pthread_mutex_unlock(&batch->lock);
+}
+
+void prime_batch_leave(PrimeBatch *batch) {
+    pthread_mutex_lock(&batch->lock);
+    if (batch->participants > 0U) {
+        --batch->participants;
+    }
+    if (batch->arrived > 0U && batch->arrived >= batch->participants) {
+        finish_round(batch);
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
+
+void prime_batch_classify(PrimeBatch *batch, mpz_srcptr const *values, size_t count,
+                          PrimeCertificate *certificates) {
+    pthread_mutex_lock(&batch->lock);
+    size_t needed = batch->pending_count + count;
+    bool queued = true;
+    if (needed > batch->pending_capacity) {
+        size_t capacity = batch->pending_capacity ? batch->pending_capacity * 2U : 64U;
+        while (capacity < needed) {
+            capacity *= 2U;
+        }
+        PrimeBatchEntry *grown =
+            (PrimeBatchEntry *)realloc(batch->pending, capacity * sizeof(PrimeBatchEntry));
+        if (grown) {
+            batch->pending = grown;
+            batch->pending_capacity = capacity;
+        } else {
+            queued = false;
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (queued) {
+            PrimeBatchEntry *entry = &batch->pending[batch->pending_count++];
+            entry->value = values[i];
+            entry->certificate = &certificates[i];
+        } else {
+            certificates[i] = PRIME_CERT_ROUGH;
+        }
+    }
+
+    // A caller that never joined is a round of its own.
+    ++batch->arrived;
+    if (batch->arrived >= batch->participants) {
+        finish_round(batch);
+    } else {
+        uint64_t round = batch->round;
+        while (batch->round == round) {
+            pthread_cond_wait(&batch->round_done, &batch->lock);
+        }
+    }
+    pthread_mutex_unlock(&batch->lock);
+}
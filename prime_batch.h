@@ -0,0 +1,91 @@
+// prime_batch.h
+// Shared primality pre-screening for runs simulated side by side.  Each
+// participating run submits the numerators and denominators its E-phase
+// pattern test needs and waits until every other participant has either
+// submitted too or left; the last one to arrive classifies the whole round
+// at once with a product tree over the submitted values and a remainder
+// tree of the product of all primes up to bound (Bernstein's batch trial
+// division).  A value comes back with a certificate:
+//
+//   PRIME_CERT_UNIT       |v| <= 1, never prime;
+//   PRIME_CERT_PRIME      no prime factor up to bound and |v| < bound^2,
+//                         or |v| <= bound and prime by the sieve;
+//   PRIME_CERT_COMPOSITE  a prime factor up to bound below |v|;
+//   PRIME_CERT_ROUGH      no prime factor up to bound, too large to settle:
+//                         the caller runs its own probable-prime test.
+//
+// PRIME and COMPOSITE are proofs, so callers that only fall back to
+// mpz_probab_prime_p() on ROUGH values answer exactly as before for every
+// value mpz_probab_prime_p() itself classifies correctly.
+//
+// A round only completes when every participant has submitted or left, so a
+// participant must leave before it stops submitting (when its run ends, or
+// fails).  Classification without any participant joined runs immediately.
+
+#ifndef PRIME_BATCH_H
+#define PRIME_BATCH_H
+
+#include <gmp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PRIME_BATCH_DEFAULT_BOUND 65536UL
+
+typedef enum {
+    PRIME_CERT_UNIT = 0,
+    PRIME_CERT_PRIME,
+    PRIME_CERT_COMPOSITE,
+    PRIME_CERT_ROUGH
+} PrimeCertificate;
+
+typedef struct {
+    mpz_srcptr value;
+    PrimeCertificate *certificate;
+} PrimeBatchEntry;
+
+typedef struct PrimeBatch {
+    pthread_mutex_t lock;
+    pthread_cond_t round_done;
+    size_t participants;
+    size_t arrived;
+    uint64_t round;
+    PrimeBatchEntry *pending;
+    size_t pending_count;
+    size_t pending_capacity;
+
+    unsigned long bound;
+    unsigned char *composite_sieve;   // composite_sieve[n] for n <= bound
+    mpz_t prime_product;              // product of the primes up to bound
+    mpz_t bound_squared;
+
+    uint64_t rounds;
+    uint64_t values;
+    uint64_t tree_values;             // values classified through the trees
+    uint64_t primes;
+    uint64_t composites;
+    uint64_t rough;
+} PrimeBatch;
+
+// bound is clamped to [2, 2^24]; PRIME_BATCH_DEFAULT_BOUND when 0.
+bool prime_batch_init(PrimeBatch *batch, unsigned long bound);
+void prime_batch_clear(PrimeBatch *batch);
+
+void prime_batch_join(PrimeBatch *batch);
+void prime_batch_leave(PrimeBatch *batch);
+
+// Classify count values, blocking until the round they join completes.  The
+// values must stay untouched until the call returns.
+void prime_batch_classify(PrimeBatch *batch, mpz_srcptr const *values, size_t count,
+                          PrimeCertificate *certificates);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PRIME_BATCH_H
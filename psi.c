@@ -21,6 +21,7 @@ Violation of these principles invalidates all results. There are no exceptions.
 #include <stddef.h>
 #include <gmp.h>
 
+#include "fixed_limbs.h"
 #include "psi.h"
 #include "rational.h"
 
@@ -52,11 +53,42 @@ static bool numerator_is_prime(mpq_srcptr value) {
     return is_prime;
 }
 
+// Load a rational's raw numerator and denominator onto the fixed-limb tier.
+static bool fixed_components(mpq_srcptr value, FixedInt *num, FixedInt *den) {
+    return fixed_set_mpz(num, mpq_numref(value)) && fixed_set_mpz(den, mpq_denref(value));
+}
+
+// standard_psi() on the fixed-limb tier: the same four cross products, without
+// an mpz temporary per component.  False, with state untouched, when any
+// product would not fit.
+static bool standard_psi_fixed(TRTS_State *state) {
+    FixedInt ups_num, ups_den, beta_num, beta_den;
+    if (!fixed_components(state->upsilon, &ups_num, &ups_den) ||
+        !fixed_components(state->beta, &beta_num, &beta_den)) {
+        return false;
+    }
+    FixedInt new_u_num, new_u_den, new_b_num, new_b_den;
+    if (!fixed_mul(&new_u_num, &beta_num, &ups_den) ||
+        !fixed_mul(&new_u_den, &beta_den, &ups_num) ||
+        !fixed_mul(&new_b_num, &ups_num, &beta_den) ||
+        !fixed_mul(&new_b_den, &ups_den, &beta_num)) {
+        return false;
+    }
+    fixed_get_mpz(mpq_numref(state->upsilon), &new_u_num);
+    fixed_get_mpz(mpq_denref(state->upsilon), &new_u_den);
+    fixed_get_mpz(mpq_numref(state->beta), &new_b_num);
+    fixed_get_mpz(mpq_denref(state->beta), &new_b_den);
+    return true;
+}
+
 // Standard psi transform: (u, b) -> (b/u, u/b)
 static bool standard_psi(TRTS_State *state) {
     if (rational_is_zero(state->upsilon) || rational_is_zero(state->beta)) {
         return false;
     }
+    if (standard_psi_fixed(state)) {
+        return true;
+    }
 
     mpz_t beta_den;
     mpz_t ups_num;
@@ -92,11 +124,40 @@ static bool standard_psi(TRTS_State *state) {
     return true;
 }
 
+// triple_psi() on the fixed-limb tier, as standard_psi_fixed().
+static bool triple_psi_fixed(TRTS_State *state) {
+    FixedInt ups_num, ups_den, beta_num, beta_den, koppa_num, koppa_den;
+    if (!fixed_components(state->upsilon, &ups_num, &ups_den) ||
+        !fixed_components(state->beta, &beta_num, &beta_den) ||
+        !fixed_components(state->koppa, &koppa_num, &koppa_den)) {
+        return false;
+    }
+    FixedInt new_u_num, new_u_den, new_b_num, new_b_den, new_k_num, new_k_den;
+    if (!fixed_mul(&new_u_num, &beta_num, &koppa_den) ||
+        !fixed_mul(&new_u_den, &beta_den, &koppa_num) ||
+        !fixed_mul(&new_b_num, &koppa_num, &ups_den) ||
+        !fixed_mul(&new_b_den, &koppa_den, &ups_num) ||
+        !fixed_mul(&new_k_num, &koppa_num, &beta_den) ||
+        !fixed_mul(&new_k_den, &koppa_den, &beta_num)) {
+        return false;
+    }
+    fixed_get_mpz(mpq_numref(state->upsilon), &new_u_num);
+    fixed_get_mpz(mpq_denref(state->upsilon), &new_u_den);
+    fixed_get_mpz(mpq_numref(state->beta), &new_b_num);
+    fixed_get_mpz(mpq_denref(state->beta), &new_b_den);
+    fixed_get_mpz(mpq_numref(state->koppa), &new_k_num);
+    fixed_get_mpz(mpq_denref(state->koppa), &new_k_den);
+    return true;
+}
+
 // Triple psi transform: (u, b, k) -> (b/k, k/u, k/b)
 static bool triple_psi(TRTS_State *state) {
     if (rational_is_zero(state->koppa) || rational_is_zero(state->upsilon) || rational_is_zero(state->beta)) {
         return false;
     }
+    if (triple_psi_fixed(state)) {
+        return true;
+    }
 
     mpz_t ups_num, ups_den;
     mpz_t beta_num, beta_den;
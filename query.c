@@ -0,0 +1,829 @@
+// query.c
+// Predicate queries over binary traces.  Every block of a trace is first
+// tested against its zone map (see trace.h); only blocks that may hold a
+// matching row are read, and those are decoded in parallel.  Predicates are
+// evaluated exactly on the decoded rows, so the zone maps only ever save
+// work, never change the answer.
+
+#include <fcntl.h>
+#include <gmp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "simulate.h"
+#include "trace.h"
+
+#define QUERY_MAX_TERMS 32U
+#define QUERY_LOG2_LIMIT (1LL << 30)
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s <trace> --where <predicate> [--where ...] [--events <path>]\n"
+            "          [--values <path>] [--radix <n>] [--jobs <n>]\n"
+            "Writes the rows matching every predicate as events.csv / values.csv\n"
+            "(the values table to stdout by default).  Predicates:\n"
+            "  <value>.log2<op><n>   |value| compared with 2^n, e.g. upsilon.log2>10000\n"
+            "  <value>.sign<op><s>   sign -, 0 or + with = or !=, e.g. beta.sign=-\n"
+            "  <value>.flip          sign differs from the previous row's\n"
+            "  ratio<op><q>          the ratio snapshot upsilon/beta against a rational\n"
+            "  tick<op><n>           tick number\n"
+            "  flag:<name>, !flag:<name>\n"
+            "                        rho, psi, mu_zero, forced, ratio_triggered,\n"
+            "                        triple_psi, dual_engine, ratio_threshold,\n"
+            "                        psi_strength or sign_flip\n"
+            "<op> is one of < <= > >= = !=.  A <value> is a component of values.csv\n"
+            "(upsilon_num, koppa_stack2_den, ...) or a rational named without the\n"
+            "_num suffix (upsilon, delta_beta, ...); rows where a rational has a zero\n"
+            "denominator never match.  Blocks whose zone maps rule out a match are\n"
+            "skipped unread; the rest are decoded by --jobs threads (default: one\n"
+            "per processor).\n",
+            program);
+}
+
+/* ===========================================================
+   PREDICATES
+   =========================================================== */
+
+typedef enum {
+    QUERY_OP_LT,
+    QUERY_OP_LE,
+    QUERY_OP_GT,
+    QUERY_OP_GE,
+    QUERY_OP_EQ,
+    QUERY_OP_NE
+} QueryOp;
+
+typedef enum {
+    QUERY_LOG2,
+    QUERY_SIGN,
+    QUERY_FLIP,
+    QUERY_RATIO,
+    QUERY_TICK,
+    QUERY_FLAG
+} QueryKind;
+
+typedef struct {
+    QueryKind kind;
+    QueryOp op;
+    int num;                 // component index of the value
+    int den;                 // its denominator, -1 for a bare component
+    long long value;         // exponent or tick
+    unsigned char sign;      // TRACE_ZONE_* for QUERY_SIGN
+    unsigned int flag;
+    bool negate;             // !flag:
+    mpq_t ratio;             // QUERY_RATIO bound, as written
+    double ratio_lower;      // conservative bounds of it
+    double ratio_upper;
+} QueryTerm;
+
+typedef struct {
+    QueryTerm terms[QUERY_MAX_TERMS];
+    size_t count;
+} QueryPlan;
+
+static const struct {
+    const char *name;
+    unsigned int flag;
+} QUERY_FLAGS[] = {
+    {"rho", TRACE_FLAG_RHO_EVENT},
+    {"psi", TRACE_FLAG_PSI_FIRED},
+    {"mu_zero", TRACE_FLAG_MU_ZERO},
+    {"forced", TRACE_FLAG_FORCED_EMISSION},
+    {"ratio_triggered", TRACE_FLAG_RATIO_TRIGGERED},
+    {"triple_psi", TRACE_FLAG_TRIPLE_PSI},
+    {"dual_engine", TRACE_FLAG_DUAL_ENGINE},
+    {"ratio_threshold", TRACE_FLAG_RATIO_THRESHOLD},
+    {"psi_strength", TRACE_FLAG_PSI_STRENGTH},
+    {"sign_flip", TRACE_FLAG_SIGN_FLIP},
+};
+
+static bool parse_op(const char **text, QueryOp *op) {
+    static const struct {
+        const char *token;
+        QueryOp op;
+    } ops[] = {{"<=", QUERY_OP_LE}, {">=", QUERY_OP_GE}, {"!=", QUERY_OP_NE},
+               {"<", QUERY_OP_LT},  {">", QUERY_OP_GT},  {"=", QUERY_OP_EQ}};
+    for (size_t i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i) {
+        size_t length = strlen(ops[i].token);
+        if (strncmp(*text, ops[i].token, length) == 0) {
+            *text += length;
+            *op = ops[i].op;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_integer(const char *text, long long *value) {
+    char *end = NULL;
+    *value = strtoll(text, &end, 10);
+    return end != text && *end == '\0';
+}
+
+// A component name, or a rational named by its numerator without "_num".
+static bool parse_operand(const char *name, size_t length, int *num, int *den) {
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        const char *component = trace_component_name(i);
+        size_t component_length = strlen(component);
+        if (length == component_length && strncmp(name, component, length) == 0) {
+            *num = (int)i;
+            *den = -1;
+            return true;
+        }
+        if (i % 2U == 0U && length + 4U == component_length &&
+            strncmp(name, component, length) == 0) {
+            *num = (int)i;
+            *den = (int)i + 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parse_term(const char *text, QueryTerm *term) {
+    memset(term, 0, sizeof(*term));
+    term->den = -1;
+    if (strncmp(text, "flag:", 5) == 0 || strncmp(text, "!flag:", 6) == 0) {
+        term->kind = QUERY_FLAG;
+        term->negate = text[0] == '!';
+        const char *name = strchr(text, ':') + 1;
+        for (size_t i = 0; i < sizeof(QUERY_FLAGS) / sizeof(QUERY_FLAGS[0]); ++i) {
+            if (strcmp(name, QUERY_FLAGS[i].name) == 0) {
+                term->flag = QUERY_FLAGS[i].flag;
+                return true;
+            }
+        }
+        return false;
+    }
+    if (strncmp(text, "tick", 4) == 0) {
+        const char *cursor = text + 4;
+        term->kind = QUERY_TICK;
+        return parse_op(&cursor, &term->op) && parse_integer(cursor, &term->value) &&
+               term->value >= 0;
+    }
+    if (strncmp(text, "ratio", 5) == 0 && strchr(text, '.') == NULL) {
+        const char *cursor = text + 5;
+        term->kind = QUERY_RATIO;
+        if (!parse_op(&cursor, &term->op)) {
+            return false;
+        }
+        mpq_init(term->ratio);
+        if (mpq_set_str(term->ratio, cursor, 10) != 0 ||
+            mpz_sgn(mpq_denref(term->ratio)) == 0) {
+            mpq_clear(term->ratio);
+            return false;
+        }
+        mpz_t one;
+        mpz_init_set_ui(one, 1UL);
+        trace_quotient_bounds(mpq_numref(term->ratio), one, mpq_denref(term->ratio), one,
+                              &term->ratio_lower, &term->ratio_upper);
+        mpz_clear(one);
+        return true;
+    }
+
+    const char *dot = strchr(text, '.');
+    if (!dot || !parse_operand(text, (size_t)(dot - text), &term->num, &term->den)) {
+        return false;
+    }
+    const char *cursor = dot + 1;
+    if (strcmp(cursor, "flip") == 0) {
+        term->kind = QUERY_FLIP;
+        return true;
+    }
+    if (strncmp(cursor, "log2", 4) == 0) {
+        cursor += 4;
+        term->kind = QUERY_LOG2;
+        return parse_op(&cursor, &term->op) && term->op != QUERY_OP_NE &&
+               parse_integer(cursor, &term->value) && term->value < QUERY_LOG2_LIMIT &&
+               term->value > -QUERY_LOG2_LIMIT;
+    }
+    if (strncmp(cursor, "sign", 4) == 0) {
+        cursor += 4;
+        term->kind = QUERY_SIGN;
+        if (!parse_op(&cursor, &term->op) ||
+            (term->op != QUERY_OP_EQ && term->op != QUERY_OP_NE) || strlen(cursor) != 1U) {
+            return false;
+        }
+        switch (cursor[0]) {
+        case '-':
+            term->sign = TRACE_ZONE_NEGATIVE;
+            return true;
+        case '0':
+            term->sign = TRACE_ZONE_ZERO;
+            return true;
+        case '+':
+            term->sign = TRACE_ZONE_POSITIVE;
+            return true;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+static void query_plan_clear(QueryPlan *plan) {
+    for (size_t i = 0; i < plan->count; ++i) {
+        if (plan->terms[i].kind == QUERY_RATIO) {
+            mpq_clear(plan->terms[i].ratio);
+        }
+    }
+    plan->count = 0U;
+}
+
+static bool op_holds(QueryOp op, int comparison) {
+    switch (op) {
+    case QUERY_OP_LT:
+        return comparison < 0;
+    case QUERY_OP_LE:
+        return comparison <= 0;
+    case QUERY_OP_GT:
+        return comparison > 0;
+    case QUERY_OP_GE:
+        return comparison >= 0;
+    case QUERY_OP_EQ:
+        return comparison == 0;
+    case QUERY_OP_NE:
+        return comparison != 0;
+    }
+    return false;
+}
+
+/* ===========================================================
+   ZONE MAPS
+   =========================================================== */
+
+// Sign of a product of signs, each a single TRACE_ZONE_* bit.
+static unsigned char sign_product(unsigned char a, unsigned char b) {
+    if (a == TRACE_ZONE_ZERO || b == TRACE_ZONE_ZERO) {
+        return TRACE_ZONE_ZERO;
+    }
+    return a == b ? TRACE_ZONE_POSITIVE : TRACE_ZONE_NEGATIVE;
+}
+
+// Signs the value of term may take over the block, leaving out rows where
+// it is undefined.
+static unsigned char zone_value_signs(const TraceZoneMap *zone, const QueryTerm *term) {
+    unsigned char num = zone->signs[term->num];
+    if (term->den < 0) {
+        return num;
+    }
+    unsigned char den = zone->signs[term->den] & (unsigned char)~TRACE_ZONE_ZERO;
+    unsigned char signs = 0U;
+    for (unsigned char a = 1U; a <= TRACE_ZONE_POSITIVE; a <<= 1) {
+        for (unsigned char b = 1U; b <= TRACE_ZONE_POSITIVE; b <<= 1) {
+            if ((num & a) && (den & b)) {
+                signs |= sign_product(a, b);
+            }
+        }
+    }
+    return signs;
+}
+
+// Sign of the value in the last row of the block, 0 where undefined.
+static unsigned char zone_last_sign(const TraceZoneMap *zone, const QueryTerm *term) {
+    if (term->den < 0) {
+        return zone->last_sign[term->num];
+    }
+    if (zone->last_sign[term->den] == TRACE_ZONE_ZERO) {
+        return 0U;
+    }
+    return sign_product(zone->last_sign[term->num], zone->last_sign[term->den]);
+}
+
+static bool zone_may_match(const QueryTerm *term, const TraceBlock *block,
+                           const TraceBlock *previous) {
+    if (!block->indexed) {
+        return true;
+    }
+    const TraceZoneMap *zone = &block->zone;
+    switch (term->kind) {
+    case QUERY_TICK: {
+        long long first = (long long)zone->first_tick;
+        long long last = (long long)zone->last_tick;
+        switch (term->op) {
+        case QUERY_OP_LT:
+            return first < term->value;
+        case QUERY_OP_LE:
+            return first <= term->value;
+        case QUERY_OP_GT:
+            return last > term->value;
+        case QUERY_OP_GE:
+            return last >= term->value;
+        case QUERY_OP_EQ:
+            return first <= term->value && term->value <= last;
+        case QUERY_OP_NE:
+            return first != term->value || last != term->value;
+        }
+        return true;
+    }
+    case QUERY_FLAG:
+        return term->negate ? (zone->flags_all & term->flag) == 0U
+                            : (zone->flags_any & term->flag) != 0U;
+    case QUERY_LOG2: {
+        // A non-zero n of b bits and d of c bits give
+        // 2^(b-1-c) < |n/d| < 2^(b-c+1).
+        long long min_num = zone->min_bits[term->num];
+        long long max_num = zone->max_bits[term->num];
+        long long min_den = term->den < 0 ? 1 : zone->min_bits[term->den];
+        long long max_den = term->den < 0 ? 1 : zone->max_bits[term->den];
+        bool can_exceed = max_num > 0 && max_num - min_den + 1 > term->value;
+        bool can_fall = min_num == 0 || min_num - 1 - max_den < term->value;
+        switch (term->op) {
+        case QUERY_OP_GT:
+        case QUERY_OP_GE:
+            return can_exceed;
+        case QUERY_OP_LT:
+        case QUERY_OP_LE:
+            return can_fall;
+        default:
+            return can_exceed && can_fall;
+        }
+    }
+    case QUERY_SIGN: {
+        unsigned char signs = zone_value_signs(zone, term);
+        return term->op == QUERY_OP_EQ ? (signs & term->sign) != 0U
+                                       : (signs & (unsigned char)~term->sign) != 0U;
+    }
+    case QUERY_FLIP: {
+        unsigned char signs = zone_value_signs(zone, term);
+        if (signs == 0U) {
+            return false;
+        }
+        if ((signs & (signs - 1U)) != 0U) {
+            return true;
+        }
+        // A single sign throughout: only the first row can flip.
+        if (!previous) {
+            return false;
+        }
+        if (!previous->indexed) {
+            return true;
+        }
+        unsigned char before = zone_last_sign(&previous->zone, term);
+        return before != 0U && before != signs;
+    }
+    case QUERY_RATIO:
+        if (!zone->ratio_defined) {
+            return false;
+        }
+        switch (term->op) {
+        case QUERY_OP_GT:
+            return zone->ratio_upper > term->ratio_lower;
+        case QUERY_OP_GE:
+            return zone->ratio_upper >= term->ratio_lower;
+        case QUERY_OP_LT:
+            return zone->ratio_lower < term->ratio_upper;
+        case QUERY_OP_LE:
+            return zone->ratio_lower <= term->ratio_upper;
+        case QUERY_OP_EQ:
+            return zone->ratio_upper >= term->ratio_lower &&
+                   zone->ratio_lower <= term->ratio_upper;
+        case QUERY_OP_NE:
+            return true;
+        }
+        return true;
+    }
+    return true;
+}
+
+static bool block_may_match(const QueryPlan *plan, const TraceBlock *block,
+                            const TraceBlock *previous) {
+    for (size_t i = 0; i < plan->count; ++i) {
+        if (!zone_may_match(&plan->terms[i], block, previous)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* ===========================================================
+   ROWS
+   =========================================================== */
+
+typedef struct {
+    mpz_t left;
+    mpz_t right;
+    unsigned char flip_previous[QUERY_MAX_TERMS];   // sign before the row, 0 if unknown
+} QueryScratch;
+
+static unsigned char row_value_sign(const TraceRow *row, const QueryTerm *term) {
+    unsigned char num = (unsigned char)(mpz_sgn(row->components[term->num]) < 0
+                                            ? TRACE_ZONE_NEGATIVE
+                                            : (mpz_sgn(row->components[term->num]) > 0
+                                                   ? TRACE_ZONE_POSITIVE
+                                                   : TRACE_ZONE_ZERO));
+    if (term->den < 0) {
+        return num;
+    }
+    int den = mpz_sgn(row->components[term->den]);
+    if (den == 0) {
+        return 0U;
+    }
+    return sign_product(num, den < 0 ? TRACE_ZONE_NEGATIVE : TRACE_ZONE_POSITIVE);
+}
+
+static bool row_log2_matches(const TraceRow *row, const QueryTerm *term, QueryScratch *scratch) {
+    mpz_srcptr num = row->components[term->num];
+    mpz_srcptr den = term->den < 0 ? NULL : row->components[term->den];
+    if (den && mpz_sgn(den) == 0) {
+        return false;
+    }
+    int comparison;
+    if (mpz_sgn(num) == 0) {
+        comparison = -1;
+    } else if (term->value >= 0) {
+        // |n| against |d|·2^k
+        if (den) {
+            mpz_abs(scratch->right, den);
+        } else {
+            mpz_set_ui(scratch->right, 1UL);
+        }
+        mpz_mul_2exp(scratch->right, scratch->right, (mp_bitcnt_t)term->value);
+        comparison = mpz_cmpabs(num, scratch->right);
+    } else {
+        // |n|·2^-k against |d|
+        mpz_abs(scratch->left, num);
+        mpz_mul_2exp(scratch->left, scratch->left, (mp_bitcnt_t)(-term->value));
+        comparison = den ? mpz_cmpabs(scratch->left, den) : mpz_cmp_ui(scratch->left, 1UL);
+    }
+    return op_holds(term->op, comparison);
+}
+
+// υ/β − p/q = (υn·βd·q − p·υd·βn) / (υd·βn·q)
+static bool row_ratio_matches(const TraceRow *row, const QueryTerm *term, QueryScratch *scratch) {
+    mpz_srcptr upsilon_num = row->components[0];
+    mpz_srcptr upsilon_den = row->components[1];
+    mpz_srcptr beta_num = row->components[2];
+    mpz_srcptr beta_den = row->components[3];
+    if (mpz_sgn(upsilon_den) == 0 || mpz_sgn(beta_num) == 0 || mpz_sgn(beta_den) == 0) {
+        return false;
+    }
+    mpz_mul(scratch->left, upsilon_num, beta_den);
+    mpz_mul(scratch->left, scratch->left, mpq_denref(term->ratio));
+    mpz_mul(scratch->right, upsilon_den, beta_num);
+    mpz_mul(scratch->right, scratch->right, mpq_numref(term->ratio));
+    int comparison = mpz_cmp(scratch->left, scratch->right);
+    comparison = comparison < 0 ? -1 : (comparison > 0 ? 1 : 0);
+    comparison *= mpz_sgn(upsilon_den) * mpz_sgn(beta_num) * mpz_sgn(mpq_denref(term->ratio));
+    return op_holds(term->op, comparison);
+}
+
+static bool row_matches(const QueryPlan *plan, const TraceRow *row, QueryScratch *scratch) {
+    bool matches = true;
+    // Flip terms track every row, so they go first.
+    for (size_t i = 0; i < plan->count; ++i) {
+        const QueryTerm *term = &plan->terms[i];
+        if (term->kind == QUERY_FLIP) {
+            unsigned char sign = row_value_sign(row, term);
+            unsigned char before = scratch->flip_previous[i];
+            matches = matches && sign != 0U && before != 0U && sign != before;
+            scratch->flip_previous[i] = sign;
+        }
+    }
+    for (size_t i = 0; i < plan->count && matches; ++i) {
+        const QueryTerm *term = &plan->terms[i];
+        switch (term->kind) {
+        case QUERY_TICK: {
+            long long tick = (long long)row->tick;
+            matches = op_holds(term->op, tick < term->value ? -1 : (tick > term->value ? 1 : 0));
+            break;
+        }
+        case QUERY_FLAG:
+            matches = ((row->flags & term->flag) != 0U) != term->negate;
+            break;
+        case QUERY_LOG2:
+            matches = row_log2_matches(row, term, scratch);
+            break;
+        case QUERY_SIGN: {
+            unsigned char sign = row_value_sign(row, term);
+            matches = sign != 0U && ((sign == term->sign) == (term->op == QUERY_OP_EQ));
+            break;
+        }
+        case QUERY_RATIO:
+            matches = row_ratio_matches(row, term, scratch);
+            break;
+        case QUERY_FLIP:
+            break;
+        }
+    }
+    return matches;
+}
+
+/* ===========================================================
+   PARALLEL DECODE
+   =========================================================== */
+
+typedef struct {
+    const QueryPlan *plan;
+    const TraceIndex *index;
+    int fd;
+    int radix;
+    bool events;
+    bool values;
+} QueryJob;
+
+typedef struct {
+    size_t block;
+    bool ok;
+    size_t rows_matched;
+    char *events;
+    size_t events_size;
+    char *values;
+    size_t values_size;
+} QueryChunk;
+
+typedef struct {
+    const QueryJob *job;
+    QueryChunk *chunks;
+    size_t chunk_count;
+    size_t next;
+} QueryQueue;
+
+static bool read_block(int fd, const TraceBlock *block, TraceBuffer *data) {
+    trace_buffer_reset(data);
+    size_t size = (size_t)block->zone.bytes;
+    if (!trace_buffer_reserve(data, size)) {
+        return false;
+    }
+    size_t done = 0U;
+    while (done < size) {
+        ssize_t count = pread(fd, data->data + done, size - done, (off_t)(block->offset + done));
+        if (count <= 0) {
+            return false;
+        }
+        done += (size_t)count;
+    }
+    data->size = size;
+    return true;
+}
+
+static void query_chunk(const QueryJob *job, QueryChunk *chunk) {
+    const TraceBlock *block = &job->index->blocks[chunk->block];
+    const TraceBlock *previous = chunk->block > 0U ? &job->index->blocks[chunk->block - 1U] : NULL;
+    QueryScratch scratch;
+    mpz_init(scratch.left);
+    mpz_init(scratch.right);
+    for (size_t i = 0; i < job->plan->count; ++i) {
+        const QueryTerm *term = &job->plan->terms[i];
+        scratch.flip_previous[i] = (term->kind == QUERY_FLIP && previous && previous->indexed)
+                                       ? zone_last_sign(&previous->zone, term)
+                                       : 0U;
+    }
+    TraceBuffer data;
+    trace_buffer_init(&data);
+    TraceRow rows[2];
+    trace_row_init(&rows[0]);
+    trace_row_init(&rows[1]);
+    FILE *events = job->events ? open_memstream(&chunk->events, &chunk->events_size) : NULL;
+    FILE *values = job->values ? open_memstream(&chunk->values, &chunk->values_size) : NULL;
+
+    chunk->ok = (!job->events || events) && (!job->values || values) &&
+                read_block(job->fd, block, &data);
+    const unsigned char *cursor = data.data;
+    const unsigned char *end = data.data + data.size;
+    int current = 0;
+    bool first = true;
+    while (chunk->ok && cursor < end) {
+        // Blocks start with a self-contained row; a version 1 trace is one
+        // block whose rows chain throughout.
+        const TraceRow *before = (!first && job->index->cross_row) ? &rows[current ^ 1] : NULL;
+        if (!trace_block_next(&cursor, end, before, &rows[current])) {
+            chunk->ok = false;
+            break;
+        }
+        if (row_matches(job->plan, &rows[current], &scratch)) {
+            if (events) {
+                trace_row_write_events_csv(events, &rows[current]);
+            }
+            if (values) {
+                trace_row_write_values_csv(values, &rows[current], job->radix);
+            }
+            chunk->rows_matched += 1U;
+        }
+        first = false;
+        current ^= 1;
+    }
+    if (events && fclose(events) != 0) {
+        chunk->ok = false;
+    }
+    if (values && fclose(values) != 0) {
+        chunk->ok = false;
+    }
+    trace_row_clear(&rows[1]);
+    trace_row_clear(&rows[0]);
+    trace_buffer_clear(&data);
+    mpz_clear(scratch.right);
+    mpz_clear(scratch.left);
+}
+
+static void *chunk_worker(void *argument) {
+    QueryQueue *queue = (QueryQueue *)argument;
+    for (;;) {
+        size_t index = __atomic_fetch_add(&queue->next, 1U, __ATOMIC_RELAXED);
+        if (index >= queue->chunk_count) {
+            return NULL;
+        }
+        query_chunk(queue->job, &queue->chunks[index]);
+    }
+}
+
+typedef struct {
+    size_t rows_matched;
+    size_t blocks_read;
+    uint64_t bytes_read;
+} QueryResult;
+
+// Decode the surviving blocks in waves of a few blocks per job so memory
+// stays bounded; each wave is written out in trace order.
+static bool run_query(const QueryJob *job, const size_t *blocks, size_t block_count, size_t jobs,
+                      FILE *events, FILE *values, QueryResult *result) {
+    const size_t wave_size = jobs * 4U;
+    QueryChunk *chunks = (QueryChunk *)calloc(wave_size, sizeof(QueryChunk));
+    pthread_t *threads = (pthread_t *)calloc(jobs, sizeof(pthread_t));
+    bool ok = chunks && threads;
+    size_t next = 0U;
+    while (ok && next < block_count) {
+        QueryQueue queue = {job, chunks, 0U, 0U};
+        while (queue.chunk_count < wave_size && next < block_count) {
+            QueryChunk *chunk = &chunks[queue.chunk_count++];
+            memset(chunk, 0, sizeof(*chunk));
+            chunk->block = blocks[next++];
+        }
+        size_t started = 0U;
+        for (size_t i = 1; i < jobs && i < queue.chunk_count; ++i) {
+            if (pthread_create(&threads[i], NULL, chunk_worker, &queue) != 0) {
+                break;
+            }
+            started = i;
+        }
+        chunk_worker(&queue);
+        for (size_t i = 1; i <= started; ++i) {
+            pthread_join(threads[i], NULL);
+        }
+
+        for (size_t i = 0; i < queue.chunk_count; ++i) {
+            QueryChunk *chunk = &chunks[i];
+            if (ok && !chunk->ok) {
+                fprintf(stderr, "block at byte %llu is truncated or corrupt\n",
+                        (unsigned long long)job->index->blocks[chunk->block].offset);
+                ok = false;
+            }
+            if (ok && events && fwrite(chunk->events, 1, chunk->events_size, events) !=
+                                    chunk->events_size) {
+                perror("events");
+                ok = false;
+            }
+            if (ok && values && fwrite(chunk->values, 1, chunk->values_size, values) !=
+                                    chunk->values_size) {
+                perror("values");
+                ok = false;
+            }
+            if (ok) {
+                result->rows_matched += chunk->rows_matched;
+                result->blocks_read += 1U;
+                result->bytes_read += job->index->blocks[chunk->block].zone.bytes;
+            }
+            free(chunk->events);
+            free(chunk->values);
+        }
+    }
+    free(threads);
+    free(chunks);
+    return ok;
+}
+
+static FILE *open_output(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+    if (strcmp(path, "-") == 0) {
+        return stdout;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+    }
+    return file;
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *events_path = NULL;
+    const char *values_path = NULL;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    size_t jobs = processors > 0 ? (size_t)processors : 1U;
+    int radix = 10;
+    QueryPlan plan;
+    plan.count = 0U;
+
+    int status = EXIT_SUCCESS;
+    for (int i = 1; i < argc && status == EXIT_SUCCESS; ++i) {
+        if (strcmp(argv[i], "--where") == 0 && i + 1 < argc) {
+            const char *text = argv[++i];
+            if (plan.count == QUERY_MAX_TERMS) {
+                fprintf(stderr, "At most %u predicates are supported\n", QUERY_MAX_TERMS);
+                status = EXIT_FAILURE;
+            } else if (!parse_term(text, &plan.terms[plan.count])) {
+                fprintf(stderr, "Invalid predicate %s\n", text);
+                status = EXIT_FAILURE;
+            } else {
+                plan.count += 1U;
+            }
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (strcmp(argv[i], "--values") == 0 && i + 1 < argc) {
+            values_path = argv[++i];
+        } else if (strcmp(argv[i], "--radix") == 0 && i + 1 < argc) {
+            radix = atoi(argv[++i]);
+            if (!config_values_radix_supported(radix)) {
+                fprintf(stderr, "--radix must be 10 or a power of two up to 32\n");
+                status = EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+            long value = atol(argv[++i]);
+            jobs = value > 0 ? (size_t)value : 1U;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            query_plan_clear(&plan);
+            return EXIT_SUCCESS;
+        } else if (!trace_path && argv[i][0] != '-') {
+            trace_path = argv[i];
+        } else {
+            usage(argv[0]);
+            status = EXIT_FAILURE;
+        }
+    }
+    if (status == EXIT_SUCCESS && (!trace_path || plan.count == 0U)) {
+        usage(argv[0]);
+        status = EXIT_FAILURE;
+    }
+    if (status != EXIT_SUCCESS) {
+        query_plan_clear(&plan);
+        return status;
+    }
+    if (!events_path && !values_path) {
+        values_path = "-";
+    }
+
+    TraceIndex index;
+    if (!trace_index_load(trace_path, &index)) {
+        fprintf(stderr, "Unable to open trace %s\n", trace_path);
+        query_plan_clear(&plan);
+        return EXIT_FAILURE;
+    }
+    size_t *blocks = (size_t *)malloc((index.count > 0U ? index.count : 1U) * sizeof(size_t));
+    size_t block_count = 0U;
+    uint64_t total_bytes = 0U;
+    for (size_t i = 0; blocks && i < index.count; ++i) {
+        total_bytes += index.blocks[i].zone.bytes;
+        if (block_may_match(&plan, &index.blocks[i], i > 0U ? &index.blocks[i - 1U] : NULL)) {
+            blocks[block_count++] = i;
+        }
+    }
+
+    FILE *events_file = open_output(events_path);
+    FILE *values_file = open_output(values_path);
+    int fd = open(trace_path, O_RDONLY);
+    bool ok = blocks && fd >= 0 && (!events_path || events_file) && (!values_path || values_file);
+    if (ok && events_file) {
+        simulate_write_events_header(events_file);
+    }
+    if (ok && values_file) {
+        simulate_write_values_header_radix(values_file, radix);
+    }
+
+    QueryResult result = {0U, 0U, 0U};
+    if (ok) {
+        QueryJob job = {&plan, &index, fd, radix, events_file != NULL, values_file != NULL};
+        ok = run_query(&job, blocks, block_count, jobs, events_file, values_file, &result);
+        fprintf(stderr, "%zu rows matched; %zu of %zu blocks read, %llu of %llu bytes\n",
+                result.rows_matched, result.blocks_read, index.count,
+                (unsigned long long)result.bytes_read, (unsigned long long)total_bytes);
+        if (index.trailing_bytes > 0U) {
+            fprintf(stderr, "%s: ignored %llu bytes of an incomplete last record\n",
+                    trace_path, (unsigned long long)index.trailing_bytes);
+        }
+    }
+
+    if (fd >= 0) {
+        close(fd);
+    }
+    if (events_file && events_file != stdout && fclose(events_file) != 0) {
+        perror(events_path);
+        ok = false;
+    }
+    if (values_file && values_file != stdout && fclose(values_file) != 0) {
+        perror(values_path);
+        ok = false;
+    }
+    free(blocks);
+    trace_index_clear(&index);
+    query_plan_clear(&plan);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
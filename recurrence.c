@@ -0,0 +1,376 @@
+/*
+ * recurrence.c
+ *
+ * Each component stream is solved independently modulo every prime with
+ * the incremental Berlekamp–Massey algorithm: after n terms the solver holds
+ * the shortest connection polynomial C(x) = 1 + c1 x + ... + cL x^L with
+ * s[k] + c1 s[k-1] + ... + cL s[k-L] = 0 (mod p) for all L <= k < n.  Once
+ * n >= 2L the polynomial is unique, so agreement across primes on L and on
+ * the reconstructed rational coefficients is strong evidence of a genuine
+ * recurrence over Q, and the exact bigint check settles it.  A solver whose
+ * length would exceed max_order stops, which bounds both time and memory.
+ */
+
+#include "recurrence.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// The largest primes below 2^31, so products of residues fit in 64 bits.
+static const uint32_t RECURRENCE_PRIMES[RECURRENCE_PRIME_COUNT] = {
+    2147483647U, 2147483629U, 2147483587U};
+
+static const char *const STATUS_NAMES[] = {"verified", "refuted", "inconsistent", "none",
+                                           "short"};
+
+const char *recurrence_status_name(RecurrenceStatus status) {
+    if ((int)status < 0 || status > RECURRENCE_SHORT) {
+        return "unknown";
+    }
+    return STATUS_NAMES[status];
+}
+
+void recurrence_default_params(RecurrenceParams *params) {
+    params->max_order = 16U;
+    params->margin = 8U;
+    params->microtick = 11;
+}
+
+static uint32_t mod_inverse(uint32_t value, uint32_t prime) {
+    uint64_t result = 1U;
+    uint64_t base = value % prime;
+    uint32_t exponent = prime - 2U;
+    while (exponent > 0U) {
+        if (exponent & 1U) {
+            result = result * base % prime;
+        }
+        base = base * base % prime;
+        exponent >>= 1U;
+    }
+    return (uint32_t)result;
+}
+
+static void solver_reset(RecurrenceSolver *solver) {
+    memset(solver, 0, sizeof(*solver));
+    solver->c[0] = 1U;
+    solver->b[0] = 1U;
+    solver->shift = 1U;
+    solver->last_discrepancy = 1U;
+}
+
+// Feed term n of the segment, already reduced modulo prime.
+static void solver_push(RecurrenceSolver *solver, uint32_t prime, size_t max_order, size_t n,
+                        uint32_t residue) {
+    if (solver->overflow) {
+        return;
+    }
+    uint64_t discrepancy = residue;
+    for (size_t i = 1; i <= solver->length; ++i) {
+        discrepancy = (discrepancy + (uint64_t)solver->c[i] *
+                                         solver->history[(n - i) % RECURRENCE_MAX_ORDER_LIMIT]) %
+                      prime;
+    }
+    solver->history[n % RECURRENCE_MAX_ORDER_LIMIT] = residue;
+    if (discrepancy == 0U) {
+        solver->shift += 1U;
+        return;
+    }
+
+    bool lengthen = 2U * solver->length <= n;
+    size_t length = lengthen ? n + 1U - solver->length : solver->length;
+    if (length > max_order) {
+        solver->overflow = true;
+        return;
+    }
+    uint32_t previous[RECURRENCE_MAX_ORDER_LIMIT + 1];
+    if (lengthen) {
+        memcpy(previous, solver->c, sizeof(previous));
+    }
+    // C(x) -= (d / b) x^shift B(x); deg B + shift never exceeds the new length.
+    uint64_t scale = discrepancy * mod_inverse(solver->last_discrepancy, prime) % prime;
+    for (size_t j = 0; j + solver->shift <= length; ++j) {
+        uint64_t term = scale * solver->b[j] % prime;
+        uint32_t *target = &solver->c[j + solver->shift];
+        *target = (uint32_t)(((uint64_t)*target + prime - term) % prime);
+    }
+    if (lengthen) {
+        memcpy(solver->b, previous, sizeof(previous));
+        solver->length = length;
+        solver->last_discrepancy = (uint32_t)discrepancy;
+        solver->shift = 1U;
+    } else {
+        solver->shift += 1U;
+    }
+}
+
+bool recurrence_detector_init(RecurrenceDetector *detector, const RecurrenceParams *params,
+                              RecurrenceSink sink, void *user_data) {
+    memset(detector, 0, sizeof(*detector));
+    if (params) {
+        detector->params = *params;
+    } else {
+        recurrence_default_params(&detector->params);
+    }
+    if (detector->params.max_order > RECURRENCE_MAX_ORDER_LIMIT) {
+        detector->params.max_order = RECURRENCE_MAX_ORDER_LIMIT;
+    }
+    if (detector->params.max_order == 0U) {
+        detector->params.max_order = 1U;
+    }
+    detector->window = 2U * detector->params.max_order;
+    detector->sink = sink;
+    detector->user_data = user_data;
+    detector->streams = (RecurrenceStream *)calloc(TRACE_COMPONENT_COUNT, sizeof(RecurrenceStream));
+    if (!detector->streams) {
+        return false;
+    }
+    for (size_t c = 0; c < TRACE_COMPONENT_COUNT; ++c) {
+        RecurrenceStream *stream = &detector->streams[c];
+        for (size_t p = 0; p < RECURRENCE_PRIME_COUNT; ++p) {
+            solver_reset(&stream->solvers[p]);
+        }
+        for (size_t i = 0; i < detector->window; ++i) {
+            mpz_init(stream->head[i]);
+            mpz_init(stream->tail[i]);
+        }
+    }
+    for (size_t i = 0; i < RECURRENCE_MAX_ORDER_LIMIT; ++i) {
+        mpq_init(detector->result.coefficients[i]);
+    }
+    return true;
+}
+
+void recurrence_detector_clear(RecurrenceDetector *detector) {
+    if (!detector->streams) {
+        return;
+    }
+    for (size_t c = 0; c < TRACE_COMPONENT_COUNT; ++c) {
+        for (size_t i = 0; i < detector->window; ++i) {
+            mpz_clear(detector->streams[c].head[i]);
+            mpz_clear(detector->streams[c].tail[i]);
+        }
+    }
+    free(detector->streams);
+    detector->streams = NULL;
+    for (size_t i = 0; i < RECURRENCE_MAX_ORDER_LIMIT; ++i) {
+        mpq_clear(detector->result.coefficients[i]);
+    }
+}
+
+// Smallest-denominator rational congruent to value modulo modulus with
+// numerator and denominator below sqrt(modulus / 2).
+static bool rational_reconstruct(mpq_t out, const mpz_t value, const mpz_t modulus) {
+    mpz_t bound, r0, r1, t0, t1, q, tmp;
+    mpz_inits(bound, r0, r1, t0, t1, q, tmp, NULL);
+    mpz_fdiv_q_2exp(bound, modulus, 1U);
+    mpz_sqrt(bound, bound);
+    mpz_set(r0, modulus);
+    mpz_mod(r1, value, modulus);
+    mpz_set_ui(t0, 0U);
+    mpz_set_ui(t1, 1U);
+    while (mpz_cmp(r1, bound) > 0) {
+        mpz_fdiv_qr(q, tmp, r0, r1);
+        mpz_swap(r0, r1);
+        mpz_swap(r1, tmp);
+        mpz_submul(t0, q, t1);
+        mpz_swap(t0, t1);
+    }
+    mpz_abs(tmp, t1);
+    bool ok = mpz_sgn(t1) != 0 && mpz_cmp(tmp, bound) <= 0;
+    if (ok) {
+        mpz_gcd(tmp, r1, t1);
+        ok = mpz_cmp_ui(tmp, 1U) == 0;
+    }
+    // r1 and t1 are coprime, so only the sign needs moving to the numerator;
+    // the stream values themselves are never reduced.
+    if (ok) {
+        mpz_set(mpq_numref(out), r1);
+        mpz_set(mpq_denref(out), t1);
+        if (mpz_sgn(t1) < 0) {
+            mpz_neg(mpq_numref(out), mpq_numref(out));
+            mpz_neg(mpq_denref(out), mpq_denref(out));
+        }
+    }
+    mpz_clears(bound, r0, r1, t0, t1, q, tmp, NULL);
+    return ok;
+}
+
+// Rebuild a[i] = -c[i+1] over Q from every prime but the last and require
+// the last prime's solution to agree.
+static bool reconstruct_coefficients(const RecurrenceStream *stream, size_t order,
+                                     mpq_t *coefficients) {
+    mpz_t value, modulus, step;
+    mpz_inits(value, modulus, step, NULL);
+    bool ok = true;
+    const size_t last = RECURRENCE_PRIME_COUNT - 1U;
+    for (size_t i = 0; ok && i < order; ++i) {
+        mpz_set_ui(value, 0U);
+        mpz_set_ui(modulus, 1U);
+        for (size_t p = 0; p < last; ++p) {
+            uint32_t prime = RECURRENCE_PRIMES[p];
+            uint32_t target = (prime - stream->solvers[p].c[i + 1U]) % prime;
+            // value += modulus * ((target - value) / modulus mod prime)
+            uint64_t current = mpz_fdiv_ui(value, prime);
+            uint64_t inverse = mod_inverse((uint32_t)mpz_fdiv_ui(modulus, prime), prime);
+            uint64_t lift = ((uint64_t)target + prime - current) % prime * inverse % prime;
+            mpz_mul_ui(step, modulus, (unsigned long)lift);
+            mpz_add(value, value, step);
+            mpz_mul_ui(modulus, modulus, prime);
+        }
+        ok = rational_reconstruct(coefficients[i], value, modulus);
+        if (ok) {
+            uint32_t prime = RECURRENCE_PRIMES[last];
+            uint64_t den = mpz_fdiv_ui(mpq_denref(coefficients[i]), prime);
+            uint64_t num = mpz_fdiv_ui(mpq_numref(coefficients[i]), prime);
+            uint32_t expected = (prime - stream->solvers[last].c[i + 1U]) % prime;
+            ok = den != 0U && num * mod_inverse((uint32_t)den, prime) % prime == expected;
+        }
+    }
+    mpz_clears(value, modulus, step, NULL);
+    return ok;
+}
+
+// Check D s[k] = sum (D a[i]) s[k-1-i] with bigints for every k in
+// [first + order, end) whose terms are held by window (indexed by
+// term % size, or directly when size is 0).
+static bool verify_range(mpz_t *window, size_t size, size_t first, size_t end, size_t order,
+                         mpz_t *scaled, const mpz_t denominator, size_t *checked) {
+    mpz_t lhs, rhs;
+    mpz_inits(lhs, rhs, NULL);
+    bool ok = true;
+    for (size_t k = first + order; ok && k < end; ++k) {
+        mpz_mul(lhs, denominator, window[size ? k % size : k]);
+        mpz_set_ui(rhs, 0U);
+        for (size_t i = 0; i < order; ++i) {
+            size_t index = k - 1U - i;
+            mpz_addmul(rhs, scaled[i], window[size ? index % size : index]);
+        }
+        ok = mpz_cmp(lhs, rhs) == 0;
+        *checked += 1U;
+    }
+    mpz_clears(lhs, rhs, NULL);
+    return ok;
+}
+
+static bool verify_exact(RecurrenceDetector *detector, RecurrenceStream *stream, size_t order,
+                         size_t *checked) {
+    mpq_t *coefficients = detector->result.coefficients;
+    mpz_t denominator;
+    mpz_init_set_ui(denominator, 1U);
+    for (size_t i = 0; i < order; ++i) {
+        mpz_lcm(denominator, denominator, mpq_denref(coefficients[i]));
+    }
+    mpz_t scaled[RECURRENCE_MAX_ORDER_LIMIT];
+    for (size_t i = 0; i < order; ++i) {
+        mpz_init(scaled[i]);
+        mpz_divexact(scaled[i], denominator, mpq_denref(coefficients[i]));
+        mpz_mul(scaled[i], scaled[i], mpq_numref(coefficients[i]));
+    }
+
+    size_t terms = detector->terms;
+    size_t window = detector->window;
+    size_t head_end = terms < window ? terms : window;
+    bool ok = verify_range(stream->head, 0U, 0U, head_end, order, scaled, denominator, checked);
+    if (ok && terms > window) {
+        ok = verify_range(stream->tail, window, terms - window, terms, order, scaled, denominator,
+                          checked);
+    }
+
+    for (size_t i = 0; i < order; ++i) {
+        mpz_clear(scaled[i]);
+    }
+    mpz_clear(denominator);
+    return ok;
+}
+
+static void evaluate_stream(RecurrenceDetector *detector, size_t component) {
+    RecurrenceStream *stream = &detector->streams[component];
+    RecurrenceResult *result = &detector->result;
+    result->start_tick = detector->segment_start_tick;
+    result->end_tick = detector->last_tick;
+    result->terms = detector->terms;
+    result->component = component;
+    result->order = 0U;
+    result->relations_checked = 0U;
+
+    size_t overflowed = 0U;
+    size_t order = stream->solvers[0].length;
+    bool agree = true;
+    for (size_t p = 0; p < RECURRENCE_PRIME_COUNT; ++p) {
+        const RecurrenceSolver *solver = &stream->solvers[p];
+        overflowed += solver->overflow ? 1U : 0U;
+        agree = agree && solver->length == order;
+        if (solver->length > order) {
+            order = solver->length;
+        }
+    }
+    result->order = order;
+    if (overflowed == RECURRENCE_PRIME_COUNT) {
+        result->status = RECURRENCE_NONE;
+        result->order = 0U;
+    } else if (overflowed > 0U || !agree) {
+        result->status = RECURRENCE_INCONSISTENT;
+    } else if (detector->terms < 2U * order + detector->params.margin) {
+        result->status = RECURRENCE_SHORT;
+    } else if (!reconstruct_coefficients(stream, order, result->coefficients)) {
+        result->status = RECURRENCE_INCONSISTENT;
+    } else if (verify_exact(detector, stream, order, &result->relations_checked)) {
+        result->status = RECURRENCE_VERIFIED;
+        detector->verified_count += 1U;
+    } else {
+        result->status = RECURRENCE_REFUTED;
+    }
+    if (detector->sink) {
+        detector->sink(detector->user_data, result);
+    }
+}
+
+static void close_segment(RecurrenceDetector *detector) {
+    if (detector->terms > 0U) {
+        for (size_t c = 0; c < TRACE_COMPONENT_COUNT; ++c) {
+            evaluate_stream(detector, c);
+            for (size_t p = 0; p < RECURRENCE_PRIME_COUNT; ++p) {
+                solver_reset(&detector->streams[c].solvers[p]);
+            }
+        }
+        detector->segment_count += 1U;
+    }
+    detector->terms = 0U;
+}
+
+void recurrence_detector_push(RecurrenceDetector *detector, size_t tick, int microtick,
+                              unsigned int flags,
+                              mpz_srcptr const components[TRACE_COMPONENT_COUNT]) {
+    if (flags & TRACE_FLAG_PSI_FIRED) {
+        detector->psi_pending = true;
+    }
+    if (detector->params.microtick != 0 && microtick != detector->params.microtick) {
+        return;
+    }
+    if (detector->psi_pending) {
+        close_segment(detector);
+        detector->psi_pending = false;
+    }
+    if (detector->terms == 0U) {
+        detector->segment_start_tick = tick;
+    }
+    size_t n = detector->terms;
+    for (size_t c = 0; c < TRACE_COMPONENT_COUNT; ++c) {
+        RecurrenceStream *stream = &detector->streams[c];
+        for (size_t p = 0; p < RECURRENCE_PRIME_COUNT; ++p) {
+            uint32_t residue = (uint32_t)mpz_fdiv_ui(components[c], RECURRENCE_PRIMES[p]);
+            solver_push(&stream->solvers[p], RECURRENCE_PRIMES[p], detector->params.max_order, n,
+                        residue);
+        }
+        if (n < detector->window) {
+            mpz_set(stream->head[n], components[c]);
+        }
+        mpz_set(stream->tail[n % detector->window], components[c]);
+    }
+    detector->terms = n + 1U;
+    detector->last_tick = tick;
+}
+
+void recurrence_detector_finish(RecurrenceDetector *detector) {
+    close_segment(detector);
+}
@@ -0,0 +1,114 @@
+// recurrence.h
+// Streaming discovery of linear recurrences in the integer component
+// streams of a run.  Every sampled component value is reduced modulo a few
+// word-size primes and fed to an incremental Berlekamp–Massey solver per
+// prime, so the search itself never touches bigints.  Segments are closed at
+// psi events; for each component the primes must agree on the recurrence
+// order, the coefficients reconstructed from all but one prime must reduce
+// to the remaining prime's solution, and the surviving recurrence is then
+// checked exactly against the bigint values kept from the start and the end
+// of the segment.  Memory use is bounded by the maximum order searched for.
+
+#ifndef RECURRENCE_H
+#define RECURRENCE_H
+
+#include <gmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RECURRENCE_PRIME_COUNT 3
+#define RECURRENCE_MAX_ORDER_LIMIT 64
+// Bigint values kept at each end of a segment for exact verification.
+#define RECURRENCE_WINDOW_LIMIT (2 * RECURRENCE_MAX_ORDER_LIMIT)
+
+typedef enum {
+    RECURRENCE_VERIFIED = 0,  // holds exactly on every retained window
+    RECURRENCE_REFUTED,       // the primes agree but the bigint check fails
+    RECURRENCE_INCONSISTENT,  // the primes disagree on order or coefficients
+    RECURRENCE_NONE,          // no recurrence up to max_order
+    RECURRENCE_SHORT          // too few terms to trust the order found
+} RecurrenceStatus;
+
+typedef struct {
+    size_t max_order;   // longest recurrence searched for, <= RECURRENCE_MAX_ORDER_LIMIT
+    size_t margin;      // terms required beyond 2 * order before a recurrence counts
+    int microtick;      // microtick sampled in every tick, 0 samples every microtick
+} RecurrenceParams;
+
+typedef struct {
+    size_t start_tick;
+    size_t end_tick;
+    size_t terms;
+    size_t component;            // TRACE_COMPONENT_COUNT index
+    RecurrenceStatus status;
+    size_t order;
+    // s[n] = coefficients[0] s[n-1] + ... + coefficients[order-1] s[n-order];
+    // only set for VERIFIED and REFUTED results.
+    mpq_t coefficients[RECURRENCE_MAX_ORDER_LIMIT];
+    size_t relations_checked;    // exact relations evaluated with bigints
+} RecurrenceResult;
+
+typedef void (*RecurrenceSink)(void *user_data, const RecurrenceResult *result);
+
+// Berlekamp–Massey state for one component modulo one prime.  c is the
+// connection polynomial, b the one saved at the last length change and
+// history the last max_order residues.
+typedef struct {
+    uint32_t c[RECURRENCE_MAX_ORDER_LIMIT + 1];
+    uint32_t b[RECURRENCE_MAX_ORDER_LIMIT + 1];
+    uint32_t history[RECURRENCE_MAX_ORDER_LIMIT];
+    size_t length;
+    size_t shift;
+    uint32_t last_discrepancy;
+    bool overflow;
+} RecurrenceSolver;
+
+typedef struct {
+    RecurrenceSolver solvers[RECURRENCE_PRIME_COUNT];
+    mpz_t head[RECURRENCE_WINDOW_LIMIT];
+    mpz_t tail[RECURRENCE_WINDOW_LIMIT];
+} RecurrenceStream;
+
+typedef struct {
+    RecurrenceParams params;
+    RecurrenceSink sink;
+    void *user_data;
+    RecurrenceStream *streams;   // TRACE_COMPONENT_COUNT entries
+    size_t window;               // bigint values kept at each end
+    size_t terms;                // terms in the current segment
+    size_t segment_start_tick;
+    size_t last_tick;
+    bool psi_pending;            // a psi event since the last sampled term
+    size_t segment_count;
+    size_t verified_count;
+    RecurrenceResult result;
+} RecurrenceDetector;
+
+void recurrence_default_params(RecurrenceParams *params);
+bool recurrence_detector_init(RecurrenceDetector *detector, const RecurrenceParams *params,
+                              RecurrenceSink sink, void *user_data);
+void recurrence_detector_clear(RecurrenceDetector *detector);
+
+// Feed one microtick.  flags is a TraceFlag mask (see trace.h); a row with
+// TRACE_FLAG_PSI_FIRED closes the current segment before it is sampled.
+void recurrence_detector_push(RecurrenceDetector *detector, size_t tick, int microtick,
+                              unsigned int flags,
+                              mpz_srcptr const components[TRACE_COMPONENT_COUNT]);
+
+// Close the final segment.
+void recurrence_detector_finish(RecurrenceDetector *detector);
+
+const char *recurrence_status_name(RecurrenceStatus status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECURRENCE_H
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_loader.h"
+#include "recurrence.h"
+#include "simulate.h"
+#include "trace.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s (--trace <path> | --config <path>) [--output <path>]\n"
+            "          [--max-order <n>] [--margin <n>] [--microtick <mt>] [--verified-only]\n"
+            "Searches every component stream for linear recurrences between psi\n"
+            "events.  Streams are solved with Berlekamp-Massey modulo several word-size\n"
+            "primes, cross-checked across the primes and verified exactly against the\n"
+            "bigint values at both ends of each segment.  One CSV row is written per\n"
+            "segment and component.  --microtick samples that microtick of every tick\n"
+            "(default 11, 0 samples every microtick); --max-order bounds the order\n"
+            "searched for (default 16, at most %d).\n",
+            program, RECURRENCE_MAX_ORDER_LIMIT);
+}
+
+typedef struct {
+    FILE *file;
+    bool verified_only;
+} RecurrenceOutput;
+
+static void write_header(FILE *file) {
+    fprintf(file, "start_tick,end_tick,terms,component,status,order,relations_checked,"
+                  "coefficients\n");
+}
+
+static void write_result(void *user_data, const RecurrenceResult *result) {
+    RecurrenceOutput *output = (RecurrenceOutput *)user_data;
+    if (output->verified_only && result->status != RECURRENCE_VERIFIED) {
+        return;
+    }
+    fprintf(output->file, "%zu,%zu,%zu,%s,%s,%zu,%zu,", result->start_tick, result->end_tick,
+            result->terms, trace_component_name(result->component),
+            recurrence_status_name(result->status), result->order, result->relations_checked);
+    if (result->status == RECURRENCE_VERIFIED || result->status == RECURRENCE_REFUTED) {
+        for (size_t i = 0; i < result->order; ++i) {
+            if (i > 0U) {
+                fputc(';', output->file);
+            }
+            mpq_out_str(output->file, 10, result->coefficients[i]);
+        }
+    }
+    fputc('\n', output->file);
+}
+
+static void detector_observer(void *user_data, size_t tick, int microtick, char phase,
+                              const TRTS_State *state, bool rho_event, bool psi_fired,
+                              bool mu_zero, bool forced_emission) {
+    (void)phase;
+    RecurrenceDetector *detector = (RecurrenceDetector *)user_data;
+    unsigned int flags = trace_flags_from_state(state, rho_event, psi_fired, mu_zero,
+                                                forced_emission);
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    trace_state_components(state, components);
+    recurrence_detector_push(detector, tick, microtick, flags, components);
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *config_path = NULL;
+    const char *output_path = NULL;
+    RecurrenceOutput output = {stdout, false};
+    RecurrenceParams params;
+    recurrence_default_params(&params);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--max-order") == 0 && i + 1 < argc) {
+            params.max_order = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--margin") == 0 && i + 1 < argc) {
+            params.margin = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--microtick") == 0 && i + 1 < argc) {
+            params.microtick = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--verified-only") == 0) {
+            output.verified_only = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((trace_path == NULL) == (config_path == NULL) || params.microtick < 0 ||
+        params.microtick > 11) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (output_path) {
+        output.file = fopen(output_path, "w");
+        if (!output.file) {
+            perror(output_path);
+            return EXIT_FAILURE;
+        }
+    }
+    write_header(output.file);
+
+    RecurrenceDetector detector;
+    if (!recurrence_detector_init(&detector, &params, write_result, &output)) {
+        fprintf(stderr, "Out of memory\n");
+        if (output.file != stdout) {
+            fclose(output.file);
+        }
+        return EXIT_FAILURE;
+    }
+
+    int status = EXIT_SUCCESS;
+    if (trace_path) {
+        TraceReader reader;
+        if (!trace_reader_open(&reader, trace_path)) {
+            fprintf(stderr, "Unable to open trace %s\n", trace_path);
+            status = EXIT_FAILURE;
+        } else {
+            const TraceRow *row = NULL;
+            while (trace_reader_next(&reader, &row)) {
+                mpz_srcptr components[TRACE_COMPONENT_COUNT];
+                for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+                    components[i] = row->components[i];
+                }
+                recurrence_detector_push(&detector, row->tick, row->microtick, row->flags,
+                                         components);
+            }
+            if (trace_reader_error(&reader)) {
+                fprintf(stderr, "%s: truncated or corrupt trace\n", trace_path);
+                status = EXIT_FAILURE;
+            }
+            trace_reader_close(&reader);
+        }
+    } else {
+        Config config;
+        config_init(&config);
+        char error_buffer[256];
+        if (!config_load_from_file(&config, config_path, error_buffer, sizeof(error_buffer))) {
+            fprintf(stderr, "Failed to load configuration: %s\n",
+                    (error_buffer[0] != '\0') ? error_buffer : "unknown error");
+            status = EXIT_FAILURE;
+        } else {
+            simulate_stream(&config, detector_observer, &detector);
+        }
+        config_clear(&config);
+    }
+
+    if (status == EXIT_SUCCESS) {
+        recurrence_detector_finish(&detector);
+        fprintf(stderr, "%zu segments, %zu verified recurrences\n", detector.segment_count,
+                detector.verified_count);
+    }
+    recurrence_detector_clear(&detector);
+    if (output.file != stdout) {
+        fclose(output.file);
+    }
+    return status;
+}
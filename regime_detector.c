@@ -0,0 +1,301 @@
+/*
+ * regime_detector.c
+ *
+ * One observation is formed per tick from the values at its last microtick
+ * and the event counts over all of its microticks.  For every channel the
+ * first warmup_ticks observations of a segment fix a reference mean and
+ * scale; afterwards a two-sided CUSUM accumulates standardised deviations
+ * beyond the drift allowance and reports a change once either side exceeds
+ * the threshold.  The tick that triggered the change opens the next
+ * segment.
+ */
+
+#include "regime_detector.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+
+// Ratio snapshots are saturated at ±2^500: finite, and small enough that
+// the running variance cannot overflow.
+#define REGIME_RATIO_LOG2_LIMIT 500L
+
+static const char *const CHANNEL_NAMES[REGIME_CHANNEL_COUNT] = {
+    "ratio", "upsilon_growth", "beta_growth", "psi_rate", "rho_rate"};
+
+const char *regime_channel_name(RegimeChannel channel) {
+    if ((int)channel < 0 || channel >= REGIME_CHANNEL_COUNT) {
+        return "end";
+    }
+    return CHANNEL_NAMES[channel];
+}
+
+void regime_detector_default_params(RegimeDetectorParams *params) {
+    params->warmup_ticks = 32U;
+    params->threshold = 8.0;
+    params->drift = 1.0;
+}
+
+static void stats_reset(RegimeStats *stats) {
+    stats->count = 0U;
+    stats->mean = 0.0;
+    stats->m2 = 0.0;
+    stats->min = 0.0;
+    stats->max = 0.0;
+}
+
+static void stats_add(RegimeStats *stats, double value) {
+    stats->count += 1U;
+    if (stats->count == 1U) {
+        stats->min = value;
+        stats->max = value;
+    } else {
+        if (value < stats->min) {
+            stats->min = value;
+        }
+        if (value > stats->max) {
+            stats->max = value;
+        }
+    }
+    double delta = value - stats->mean;
+    stats->mean += delta / (double)stats->count;
+    stats->m2 += delta * (value - stats->mean);
+}
+
+double regime_stats_stddev(const RegimeStats *stats) {
+    if (stats->count < 2U) {
+        return 0.0;
+    }
+    return sqrt(stats->m2 / (double)(stats->count - 1U));
+}
+
+static void segment_reset(RegimeDetector *detector, size_t start_tick) {
+    RegimeSegment *segment = &detector->segment;
+    memset(segment, 0, sizeof(*segment));
+    segment->start_tick = start_tick;
+    segment->end_tick = start_tick;
+    segment->trigger_channel = -1;
+    for (int i = 0; i < REGIME_CHANNEL_COUNT; ++i) {
+        stats_reset(&segment->stats[i]);
+        detector->cusum[i].reference_mean = 0.0;
+        detector->cusum[i].reference_scale = 0.0;
+        detector->cusum[i].cusum_high = 0.0;
+        detector->cusum[i].cusum_low = 0.0;
+    }
+}
+
+void regime_detector_init(RegimeDetector *detector, const RegimeDetectorParams *params,
+                          RegimeSink sink, void *user_data) {
+    memset(detector, 0, sizeof(*detector));
+    if (params) {
+        detector->params = *params;
+    } else {
+        regime_detector_default_params(&detector->params);
+    }
+    if (detector->params.warmup_ticks < 2U) {
+        detector->params.warmup_ticks = 2U;
+    }
+    detector->sink = sink;
+    detector->user_data = user_data;
+    segment_reset(detector, 0U);
+}
+
+// log2 of the larger of |num| and |den|; zero maps to 0.
+static double rational_log2_magnitude(mpz_srcptr num, mpz_srcptr den) {
+    double result = 0.0;
+    mpz_srcptr parts[2] = {num, den};
+    for (int i = 0; i < 2; ++i) {
+        if (mpz_sgn(parts[i]) == 0) {
+            continue;
+        }
+        long exponent = 0;
+        double mantissa = mpz_get_d_2exp(&exponent, parts[i]);
+        double value = log2(fabs(mantissa)) + (double)exponent;
+        if (value > result) {
+            result = value;
+        }
+    }
+    return result;
+}
+
+// The signed ratio υ/β = (υn·βd) / (υd·βn), evaluated through scaled
+// mantissas so values far outside the double range do not overflow before
+// the quotient is taken.  Magnitudes beyond REGIME_RATIO_LOG2_LIMIT saturate
+// there; tiny ones flush to a signed zero.
+static bool ratio_snapshot(mpz_srcptr upsilon_num, mpz_srcptr upsilon_den, mpz_srcptr beta_num,
+                           mpz_srcptr beta_den, double *ratio) {
+    if (mpz_sgn(beta_num) == 0 || mpz_sgn(upsilon_den) == 0 || mpz_sgn(beta_den) == 0) {
+        return false;
+    }
+    if (mpz_sgn(upsilon_num) == 0) {
+        *ratio = 0.0;
+        return true;
+    }
+    long e_un = 0, e_ud = 0, e_bn = 0, e_bd = 0;
+    double d_un = mpz_get_d_2exp(&e_un, upsilon_num);
+    double d_ud = mpz_get_d_2exp(&e_ud, upsilon_den);
+    double d_bn = mpz_get_d_2exp(&e_bn, beta_num);
+    double d_bd = mpz_get_d_2exp(&e_bd, beta_den);
+    long exponent = e_un + e_bd - e_ud - e_bn;
+    // The mantissas lie in [0.5, 1), so |quotient| is in (0.25, 4).
+    double quotient = (d_un * d_bd) / (d_ud * d_bn);
+    if (exponent >= REGIME_RATIO_LOG2_LIMIT - 1L) {
+        *ratio = copysign(ldexp(1.0, (int)REGIME_RATIO_LOG2_LIMIT), quotient);
+    } else if (exponent < -REGIME_RATIO_LOG2_LIMIT) {
+        *ratio = copysign(0.0, quotient);
+    } else {
+        *ratio = ldexp(quotient, (int)exponent);
+    }
+    return true;
+}
+
+static void emit_segment(RegimeDetector *detector) {
+    RegimeSegment *segment = &detector->segment;
+    const RegimeStats *ratio = &segment->stats[REGIME_CHANNEL_RATIO];
+    const RegimeStats *growth = &segment->stats[REGIME_CHANNEL_UPSILON_GROWTH];
+    double scale = fabs(ratio->mean) > 1.0 ? fabs(ratio->mean) : 1.0;
+    double spread = regime_stats_stddev(ratio);
+    const char *shape;
+    if (ratio->count == 0U) {
+        shape = "Undefined";
+    } else if (spread <= 1.0e-12 * scale) {
+        shape = "Fixed";
+    } else if (segment->ratio_sign_changes * 3U > ratio->count) {
+        shape = "Oscillating";
+    } else if (spread < 0.05 * scale) {
+        shape = "Banded";
+    } else {
+        shape = "Chaotic";
+    }
+    bool growing = growth->count > 0U && growth->mean > 0.5;
+    snprintf(segment->label, sizeof(segment->label), "%s%s", shape, growing ? "/Growing" : "");
+    if (detector->sink) {
+        detector->sink(detector->user_data, segment);
+    }
+    detector->segment_count += 1U;
+}
+
+static void close_tick(RegimeDetector *detector) {
+    double values[REGIME_CHANNEL_COUNT];
+    bool valid[REGIME_CHANNEL_COUNT];
+    values[REGIME_CHANNEL_RATIO] = detector->ratio;
+    valid[REGIME_CHANNEL_RATIO] = detector->ratio_defined && isfinite(detector->ratio);
+    values[REGIME_CHANNEL_UPSILON_GROWTH] = detector->upsilon_log2 - detector->previous_upsilon_log2;
+    values[REGIME_CHANNEL_BETA_GROWTH] = detector->beta_log2 - detector->previous_beta_log2;
+    valid[REGIME_CHANNEL_UPSILON_GROWTH] = detector->have_previous;
+    valid[REGIME_CHANNEL_BETA_GROWTH] = detector->have_previous;
+    values[REGIME_CHANNEL_PSI_RATE] = (double)detector->tick_psi;
+    values[REGIME_CHANNEL_RHO_RATE] = (double)detector->tick_rho;
+    valid[REGIME_CHANNEL_PSI_RATE] = true;
+    valid[REGIME_CHANNEL_RHO_RATE] = true;
+
+    RegimeSegment *segment = &detector->segment;
+    int changed = -1;
+    for (int i = 0; i < REGIME_CHANNEL_COUNT && changed < 0; ++i) {
+        RegimeCusum *cusum = &detector->cusum[i];
+        if (!valid[i] || cusum->reference_scale <= 0.0) {
+            continue;
+        }
+        double z = (values[i] - cusum->reference_mean) / cusum->reference_scale;
+        double high = cusum->cusum_high + z - detector->params.drift;
+        double low = cusum->cusum_low - z - detector->params.drift;
+        cusum->cusum_high = high > 0.0 ? high : 0.0;
+        cusum->cusum_low = low > 0.0 ? low : 0.0;
+        if (cusum->cusum_high > detector->params.threshold ||
+            cusum->cusum_low > detector->params.threshold) {
+            changed = i;
+        }
+    }
+
+    bool empty = segment->stats[REGIME_CHANNEL_PSI_RATE].count == 0U;
+    if (changed >= 0) {
+        segment->trigger_channel = changed;
+        emit_segment(detector);
+        segment_reset(detector, detector->tick);
+    } else if (empty) {
+        segment->start_tick = detector->tick;
+    }
+
+    for (int i = 0; i < REGIME_CHANNEL_COUNT; ++i) {
+        if (!valid[i]) {
+            continue;
+        }
+        RegimeStats *stats = &segment->stats[i];
+        stats_add(stats, values[i]);
+        if (stats->count == detector->params.warmup_ticks) {
+            double scale = regime_stats_stddev(stats);
+            // Event counts are integers, so a quiet warm-up (a constant
+            // count) must not make a single extra event look like a
+            // millions-of-sigma shift: use the Poisson spread, at least 1.
+            double floor;
+            if (i == REGIME_CHANNEL_PSI_RATE || i == REGIME_CHANNEL_RHO_RATE) {
+                floor = sqrt(fabs(stats->mean));
+                if (floor < 1.0) {
+                    floor = 1.0;
+                }
+            } else {
+                floor = 1.0e-6 * (fabs(stats->mean) > 1.0 ? fabs(stats->mean) : 1.0);
+            }
+            detector->cusum[i].reference_mean = stats->mean;
+            detector->cusum[i].reference_scale = scale > floor ? scale : floor;
+        }
+    }
+    if (valid[REGIME_CHANNEL_RATIO] && detector->have_previous &&
+        ((detector->ratio > 0.0 && detector->previous_ratio < 0.0) ||
+         (detector->ratio < 0.0 && detector->previous_ratio > 0.0))) {
+        segment->ratio_sign_changes += 1U;
+    }
+    segment->psi_events += detector->tick_psi;
+    segment->rho_events += detector->tick_rho;
+    segment->mu_zero_events += detector->tick_mu_zero;
+    segment->end_tick = detector->tick;
+
+    detector->have_previous = true;
+    detector->previous_ratio = valid[REGIME_CHANNEL_RATIO] ? detector->ratio : 0.0;
+    detector->previous_upsilon_log2 = detector->upsilon_log2;
+    detector->previous_beta_log2 = detector->beta_log2;
+    detector->tick_open = false;
+    detector->tick_psi = 0U;
+    detector->tick_rho = 0U;
+    detector->tick_mu_zero = 0U;
+}
+
+void regime_detector_push(RegimeDetector *detector, size_t tick, int microtick,
+                          mpz_srcptr upsilon_num, mpz_srcptr upsilon_den, mpz_srcptr beta_num,
+                          mpz_srcptr beta_den, unsigned int flags) {
+    if (detector->tick_open && tick != detector->tick) {
+        close_tick(detector);
+    }
+    detector->tick_open = true;
+    detector->tick = tick;
+    if (flags & TRACE_FLAG_PSI_FIRED) {
+        detector->tick_psi += 1U;
+    }
+    if (flags & TRACE_FLAG_RHO_EVENT) {
+        detector->tick_rho += 1U;
+    }
+    if (flags & TRACE_FLAG_MU_ZERO) {
+        detector->tick_mu_zero += 1U;
+    }
+    // Only the closing microtick's values enter the observation.
+    if (microtick == 11) {
+        detector->ratio_defined =
+            ratio_snapshot(upsilon_num, upsilon_den, beta_num, beta_den, &detector->ratio);
+        detector->upsilon_log2 = rational_log2_magnitude(upsilon_num, upsilon_den);
+        detector->beta_log2 = rational_log2_magnitude(beta_num, beta_den);
+        close_tick(detector);
+    }
+}
+
+void regime_detector_finish(RegimeDetector *detector) {
+    if (detector->tick_open) {
+        close_tick(detector);
+    }
+    if (detector->segment.stats[REGIME_CHANNEL_PSI_RATE].count > 0U) {
+        detector->segment.trigger_channel = -1;
+        emit_segment(detector);
+        segment_reset(detector, detector->tick + 1U);
+    }
+}
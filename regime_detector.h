@@ -0,0 +1,109 @@
+// regime_detector.h
+// Streaming change-point detection over per-tick snapshot observables.  Each
+// completed tick yields one observation per channel (the signed ratio
+// snapshot υ/β, the per-tick growth of log2 magnitudes and the ψ/ρ event counts).
+// A two-sided CUSUM per channel, standardised against a reference taken at
+// the start of the current segment, closes the segment when any channel
+// drifts.  Memory use is constant regardless of run length.  Floating-point
+// is used for the snapshots only and never feeds back into the simulation.
+
+#ifndef REGIME_DETECTOR_H
+#define REGIME_DETECTOR_H
+
+#include <gmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    REGIME_CHANNEL_RATIO = 0,
+    REGIME_CHANNEL_UPSILON_GROWTH,
+    REGIME_CHANNEL_BETA_GROWTH,
+    REGIME_CHANNEL_PSI_RATE,
+    REGIME_CHANNEL_RHO_RATE,
+    REGIME_CHANNEL_COUNT
+} RegimeChannel;
+
+typedef struct {
+    size_t count;
+    double mean;
+    double m2;
+    double min;
+    double max;
+} RegimeStats;
+
+typedef struct {
+    size_t start_tick;
+    size_t end_tick;
+    int trigger_channel; // channel that closed the segment, -1 at end of run
+    RegimeStats stats[REGIME_CHANNEL_COUNT];
+    size_t ratio_sign_changes;
+    size_t psi_events;
+    size_t rho_events;
+    size_t mu_zero_events;
+    char label[32];
+} RegimeSegment;
+
+typedef struct {
+    size_t warmup_ticks;   // observations used to fix the segment reference
+    double threshold;      // CUSUM decision interval h, in standard deviations
+    double drift;          // CUSUM allowance k, in standard deviations
+} RegimeDetectorParams;
+
+typedef void (*RegimeSink)(void *user_data, const RegimeSegment *segment);
+
+typedef struct {
+    double reference_mean;
+    double reference_scale;
+    double cusum_high;
+    double cusum_low;
+} RegimeCusum;
+
+typedef struct {
+    RegimeDetectorParams params;
+    RegimeSink sink;
+    void *user_data;
+    RegimeSegment segment;
+    RegimeCusum cusum[REGIME_CHANNEL_COUNT];
+    size_t segment_count;
+    // Per-tick accumulators.
+    bool tick_open;
+    size_t tick;
+    double ratio;
+    bool ratio_defined;
+    double upsilon_log2;
+    double beta_log2;
+    size_t tick_psi;
+    size_t tick_rho;
+    size_t tick_mu_zero;
+    // Previous tick, for growth rates and sign changes.
+    bool have_previous;
+    double previous_ratio;
+    double previous_upsilon_log2;
+    double previous_beta_log2;
+} RegimeDetector;
+
+void regime_detector_default_params(RegimeDetectorParams *params);
+void regime_detector_init(RegimeDetector *detector, const RegimeDetectorParams *params,
+                          RegimeSink sink, void *user_data);
+
+// Feed one microtick.  flags is a TraceFlag mask (see trace.h); υ and β are
+// passed as raw numerator/denominator pairs.
+void regime_detector_push(RegimeDetector *detector, size_t tick, int microtick,
+                          mpz_srcptr upsilon_num, mpz_srcptr upsilon_den, mpz_srcptr beta_num,
+                          mpz_srcptr beta_den, unsigned int flags);
+
+// Close the final tick and segment.
+void regime_detector_finish(RegimeDetector *detector);
+
+double regime_stats_stddev(const RegimeStats *stats);
+const char *regime_channel_name(RegimeChannel channel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // REGIME_DETECTOR_H
@@ -0,0 +1,142 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config_loader.h"
+#include "regime_detector.h"
+#include "simulate.h"
+#include "trace.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s (--trace <path> | --config <path>) [--output <path>]\n"
+            "          [--warmup <ticks>] [--threshold <h>] [--drift <k>]\n"
+            "Splits a run into regimes with a streaming CUSUM change-point detector\n"
+            "over the ratio snapshot, log2 growth and psi/rho rates, and writes one\n"
+            "CSV row per regime.  --trace reads a binary trace; --config runs the\n"
+            "simulation directly without writing any trace.\n",
+            program);
+}
+
+static void write_header(FILE *file) {
+    fprintf(file,
+            "start_tick,end_tick,ticks,trigger,label,ratio_mean,ratio_stddev,ratio_min,"
+            "ratio_max,ratio_sign_changes,upsilon_growth_mean,beta_growth_mean,psi_rate,"
+            "rho_rate,psi_events,rho_events,mu_zero_events\n");
+}
+
+static void write_segment(void *user_data, const RegimeSegment *segment) {
+    FILE *file = (FILE *)user_data;
+    const RegimeStats *ratio = &segment->stats[REGIME_CHANNEL_RATIO];
+    fprintf(file, "%zu,%zu,%zu,%s,%s,%.17g,%.17g,%.17g,%.17g,%zu,%.6f,%.6f,%.6f,%.6f,%zu,%zu,%zu\n",
+            segment->start_tick, segment->end_tick, segment->end_tick - segment->start_tick + 1U,
+            regime_channel_name((RegimeChannel)segment->trigger_channel), segment->label,
+            ratio->mean, regime_stats_stddev(ratio), ratio->min, ratio->max,
+            segment->ratio_sign_changes, segment->stats[REGIME_CHANNEL_UPSILON_GROWTH].mean,
+            segment->stats[REGIME_CHANNEL_BETA_GROWTH].mean,
+            segment->stats[REGIME_CHANNEL_PSI_RATE].mean,
+            segment->stats[REGIME_CHANNEL_RHO_RATE].mean, segment->psi_events,
+            segment->rho_events, segment->mu_zero_events);
+    fflush(file);
+}
+
+static void detector_observer(void *user_data, size_t tick, int microtick, char phase,
+                              const TRTS_State *state, bool rho_event, bool psi_fired,
+                              bool mu_zero, bool forced_emission) {
+    (void)phase;
+    RegimeDetector *detector = (RegimeDetector *)user_data;
+    unsigned int flags = trace_flags_from_state(state, rho_event, psi_fired, mu_zero,
+                                                forced_emission);
+    regime_detector_push(detector, tick, microtick, mpq_numref(state->upsilon),
+                         mpq_denref(state->upsilon), mpq_numref(state->beta),
+                         mpq_denref(state->beta), flags);
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *config_path = NULL;
+    const char *output_path = NULL;
+    RegimeDetectorParams params;
+    regime_detector_default_params(&params);
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--config") == 0 && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            output_path = argv[++i];
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            params.warmup_ticks = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            params.threshold = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--drift") == 0 && i + 1 < argc) {
+            params.drift = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((trace_path == NULL) == (config_path == NULL)) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    FILE *output = stdout;
+    if (output_path) {
+        output = fopen(output_path, "w");
+        if (!output) {
+            perror(output_path);
+            return EXIT_FAILURE;
+        }
+    }
+    write_header(output);
+
+    RegimeDetector detector;
+    regime_detector_init(&detector, &params, write_segment, output);
+
+    int status = EXIT_SUCCESS;
+    if (trace_path) {
+        TraceReader reader;
+        if (!trace_reader_open(&reader, trace_path)) {
+            fprintf(stderr, "Unable to open trace %s\n", trace_path);
+            status = EXIT_FAILURE;
+        } else {
+            const TraceRow *row = NULL;
+            while (trace_reader_next(&reader, &row)) {
+                regime_detector_push(&detector, row->tick, row->microtick, row->components[0],
+                                     row->components[1], row->components[2],
+                                     row->components[3], row->flags);
+            }
+            if (trace_reader_error(&reader)) {
+                fprintf(stderr, "%s: truncated or corrupt trace\n", trace_path);
+                status = EXIT_FAILURE;
+            }
+            trace_reader_close(&reader);
+        }
+    } else {
+        Config config;
+        config_init(&config);
+        char error_buffer[256];
+        if (!config_load_from_file(&config, config_path, error_buffer, sizeof(error_buffer))) {
+            fprintf(stderr, "Failed to load configuration: %s\n",
+                    (error_buffer[0] != '\0') ? error_buffer : "unknown error");
+            status = EXIT_FAILURE;
+        } else {
+            simulate_stream(&config, detector_observer, &detector);
+        }
+        config_clear(&config);
+    }
+
+    if (status == EXIT_SUCCESS) {
+        regime_detector_finish(&detector);
+        fprintf(stderr, "%zu regimes\n", detector.segment_count);
+    }
+    if (output != stdout) {
+        fclose(output);
+    }
+    return status;
+}
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <gmp.h>
 #include <math.h>
 #include <stdbool.h>
@@ -5,10 +6,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <time.h>
 
 #include "analysis_utils.h"
 #include "config.h"
+#include "surrogate.h"
+#include "sweep_merge.h"
 
 #define ARRAY_COUNT(arr) (sizeof(arr) / sizeof((arr)[0]))
 
@@ -28,8 +32,29 @@ typedef struct {
     char target_constant[32];
     bool save_output;
     char output_path[256];
+    bool merge_trajectories;
+    char merge_cache[256];
+    // Bytes of state fingerprints the merge table may hold (see sweep_merge.h).
+    size_t merge_budget;
+    bool batch_output;
+    char batch_dir[256];
+    // Pre-screening of mutants by a nearest-neighbour surrogate of the score
+    // (see surrogate.h), optionally seeded from and extended into an
+    // archive of earlier runs.
+    bool surrogate;
+    char surrogate_archive[256];
+    size_t surrogate_k;
+    double surrogate_kappa;
 } EvolutionOptions;
 
+typedef struct {
+    Surrogate model;
+    FILE *archive;          // open for appending, or NULL
+    size_t simulated;
+    size_t screened;
+    size_t archived;        // points loaded from the archive
+} SurrogateScreen;
+
 static EngineMode ENGINE_MODES[] = {ENGINE_MODE_ADD, ENGINE_MODE_MULTI, ENGINE_MODE_SLIDE,
                                     ENGINE_MODE_DELTA_ADD};
 static PsiMode PSI_MODES[] = {PSI_MODE_MSTEP, PSI_MODE_RHO_ONLY, PSI_MODE_MSTEP_RHO,
@@ -99,6 +124,14 @@ static void config_clone(Config *dest, const Config *src) {
     dest->enable_feedback_oscillator = src->enable_feedback_oscillator;
     dest->sign_flip_mode = src->sign_flip_mode;
     dest->koppa_wrap_threshold = src->koppa_wrap_threshold;
+    dest->koppa_gate_slide_below = src->koppa_gate_slide_below;
+    dest->koppa_gate_multi_below = src->koppa_gate_multi_below;
+    dest->enable_ratio_custom_range = src->enable_ratio_custom_range;
+    rational_set(dest->ratio_custom_lower, src->ratio_custom_lower);
+    rational_set(dest->ratio_custom_upper, src->ratio_custom_upper);
+    mpz_set(dest->modulus_bound, src->modulus_bound);
+    dest->values_radix = src->values_radix;
+    dest->compaction_interval = src->compaction_interval;
 }
 
 static void candidate_copy(Candidate *dest, const Candidate *src) {
@@ -183,26 +216,11 @@ static void mutate_config(Config *config) {
     }
 }
 
-static double evaluate_candidate(Candidate *candidate, const EvolutionOptions *options) {
-    if (!candidate->evaluated) {
-        RunSummary summary;
-        run_summary_init(&summary);
-        bool ok = simulate_and_analyze(&candidate->config, &summary);
-        if (!ok) {
-            run_summary_clear(&summary);
-            candidate->score = -INFINITY;
-            candidate->evaluated = true;
-            return candidate->score;
-        }
-        run_summary_copy(&candidate->summary, &summary);
-        run_summary_clear(&summary);
-        candidate->evaluated = true;
-    }
-
+// Score of a completed run under options->strategy.
+static double score_summary(const RunSummary *summary, const EvolutionOptions *options) {
     double target_value = 0.0;
     bool has_target = analysis_constant_value(options->target_constant, &target_value);
 
-    const RunSummary *summary = &candidate->summary;
     double score = 0.0;
 
     if (strcmp(options->strategy, "target-convergence") == 0 && has_target) {
@@ -241,10 +259,211 @@ static double evaluate_candidate(Candidate *candidate, const EvolutionOptions *o
         }
     }
 
-    candidate->score = score;
     return score;
 }
 
+// merge_table is NULL unless --merge-trajectories was given, batch unless
+// --batch-output was.  Batched evaluations each write their own CSVs under
+// options->batch_dir, numbered by run_index.
+static double evaluate_candidate(Candidate *candidate, const EvolutionOptions *options,
+                                 SweepMergeTable *merge_table, BatchOutput *batch,
+                                 size_t *run_index) {
+    if (!candidate->evaluated) {
+        char events_path[320] = "events.csv";
+        char values_path[320] = "values.csv";
+        if (batch) {
+            snprintf(events_path, sizeof(events_path), "%s/run_%06zu_events.csv",
+                     options->batch_dir, *run_index);
+            snprintf(values_path, sizeof(values_path), "%s/run_%06zu_values.csv",
+                     options->batch_dir, *run_index);
+            *run_index += 1U;
+        }
+        RunSummary summary;
+        run_summary_init(&summary);
+        bool ok = merge_table ? sweep_merge_simulate(merge_table, &candidate->config, events_path,
+                                                     values_path, &summary, NULL)
+                              : simulate_and_analyze_batched(&candidate->config, events_path,
+                                                             values_path, &summary, batch);
+        if (!ok) {
+            run_summary_clear(&summary);
+            candidate->score = -INFINITY;
+            candidate->evaluated = true;
+            return candidate->score;
+        }
+        run_summary_copy(&candidate->summary, &summary);
+        run_summary_clear(&summary);
+        candidate->evaluated = true;
+    }
+
+    candidate->score = score_summary(&candidate->summary, options);
+    return candidate->score;
+}
+
+#define SURROGATE_ARCHIVE_FIELDS 17
+
+static const char SURROGATE_ARCHIVE_HEADER[] =
+    "engine_mode,psi_mode,koppa_mode,triple_psi,multi_level_koppa,ticks,upsilon_seed,"
+    "beta_seed,completed,ratio_defined,final_ratio_snapshot,closest_delta,convergence_tick,"
+    "psi_events,psi_spacing_stddev,ratio_variance,pattern\n";
+
+// One archive row: the configuration fields the surrogate sees and the
+// summary fields every strategy scores, so an archive written under one
+// strategy trains the surrogate under any other.
+static bool load_archive_row(char *line, const EvolutionOptions *options, Surrogate *model) {
+    char *fields[SURROGATE_ARCHIVE_FIELDS];
+    size_t count = 0U;
+    char *cursor = line;
+    while (count < SURROGATE_ARCHIVE_FIELDS) {
+        fields[count++] = cursor;
+        char *comma = strchr(cursor, ',');
+        if (!comma) {
+            break;
+        }
+        *comma = '\0';
+        cursor = comma + 1;
+    }
+    if (count != SURROGATE_ARCHIVE_FIELDS) {
+        return false;
+    }
+    fields[SURROGATE_ARCHIVE_FIELDS - 1][strcspn(fields[SURROGATE_ARCHIVE_FIELDS - 1], "\r\n")] =
+        '\0';
+
+    Config config;
+    config_init(&config);
+    config.engine_mode = (EngineMode)strtol(fields[0], NULL, 10);
+    config.psi_mode = (PsiMode)strtol(fields[1], NULL, 10);
+    config.koppa_mode = (KoppaMode)strtol(fields[2], NULL, 10);
+    config.triple_psi_mode = strtol(fields[3], NULL, 10) != 0;
+    config.multi_level_koppa = strtol(fields[4], NULL, 10) != 0;
+    config.ticks = (size_t)strtoul(fields[5], NULL, 10);
+    bool ok = mpq_set_str(config.initial_upsilon, fields[6], 10) == 0 &&
+              mpq_set_str(config.initial_beta, fields[7], 10) == 0 &&
+              mpz_sgn(mpq_denref(config.initial_upsilon)) != 0 &&
+              mpz_sgn(mpq_denref(config.initial_beta)) != 0;
+    SurrogateFeatures features;
+    if (ok) {
+        surrogate_features(&config, &features);
+    }
+    config_clear(&config);
+    if (!ok) {
+        return false;
+    }
+
+    double score = -INFINITY;
+    if (strtol(fields[8], NULL, 10) != 0) {
+        RunSummary summary;
+        run_summary_init(&summary);
+        summary.ratio_defined = strtol(fields[9], NULL, 10) != 0;
+        summary.final_ratio_snapshot = strtod(fields[10], NULL);
+        summary.closest_delta = strtod(fields[11], NULL);
+        summary.convergence_tick = (size_t)strtoul(fields[12], NULL, 10);
+        summary.psi_events = (size_t)strtoul(fields[13], NULL, 10);
+        summary.psi_spacing_stddev = strtod(fields[14], NULL);
+        summary.ratio_variance = strtod(fields[15], NULL);
+        snprintf(summary.pattern, sizeof(summary.pattern), "%s", fields[16]);
+        score = score_summary(&summary, options);
+        run_summary_clear(&summary);
+    }
+    return surrogate_add(model, &features, score);
+}
+
+// Loads options->surrogate_archive, if any, and reopens it for appending.
+static bool surrogate_screen_init(SurrogateScreen *screen, const EvolutionOptions *options) {
+    surrogate_init(&screen->model, options->surrogate_k);
+    screen->archive = NULL;
+    screen->simulated = 0U;
+    screen->screened = 0U;
+    screen->archived = 0U;
+    if (options->surrogate_archive[0] == '\0') {
+        return true;
+    }
+
+    FILE *file = fopen(options->surrogate_archive, "r");
+    if (file) {
+        char line[1024];
+        while (fgets(line, sizeof(line), file)) {
+            if (strncmp(line, "engine_mode,", 12U) == 0) {
+                continue;
+            }
+            if (load_archive_row(line, options, &screen->model)) {
+                screen->archived += 1U;
+            }
+        }
+        fclose(file);
+    }
+
+    screen->archive = fopen(options->surrogate_archive, "a");
+    if (!screen->archive) {
+        surrogate_clear(&screen->model);
+        return false;
+    }
+    if (ftell(screen->archive) == 0L) {
+        fputs(SURROGATE_ARCHIVE_HEADER, screen->archive);
+    }
+    return true;
+}
+
+static void surrogate_screen_clear(SurrogateScreen *screen) {
+    if (screen->archive) {
+        fclose(screen->archive);
+        screen->archive = NULL;
+    }
+    surrogate_clear(&screen->model);
+}
+
+// Teach the surrogate a candidate that has just been simulated.
+static void surrogate_screen_record(SurrogateScreen *screen, const Candidate *candidate) {
+    SurrogateFeatures features;
+    surrogate_features(&candidate->config, &features);
+    surrogate_add(&screen->model, &features, candidate->score);
+    screen->simulated += 1U;
+    if (!screen->archive) {
+        return;
+    }
+
+    const Config *config = &candidate->config;
+    const RunSummary *summary = &candidate->summary;
+    bool completed = candidate->score != -INFINITY;
+    fprintf(screen->archive, "%d,%d,%d,%d,%d,%zu,", (int)config->engine_mode,
+            (int)config->psi_mode, (int)config->koppa_mode, config->triple_psi_mode ? 1 : 0,
+            config->multi_level_koppa ? 1 : 0, config->ticks);
+    mpq_out_str(screen->archive, 10, config->initial_upsilon);
+    fputc(',', screen->archive);
+    mpq_out_str(screen->archive, 10, config->initial_beta);
+    if (!completed) {
+        fputs(",0,0,0,0,0,0,0,0,\n", screen->archive);
+        return;
+    }
+    fprintf(screen->archive, ",1,%d,%.17g,%.17g,%zu,%zu,%.17g,%.17g,%s\n",
+            summary->ratio_defined ? 1 : 0, summary->final_ratio_snapshot,
+            summary->closest_delta, summary->convergence_tick, summary->psi_events,
+            summary->psi_spacing_stddev, summary->ratio_variance, summary->pattern);
+}
+
+// The score a mutant has to be able to reach to matter: the elite-th best
+// exact score seen so far this generation.
+static double elite_cutoff(const Candidate *population, size_t count, size_t elite,
+                           double *scores) {
+    size_t found = 0U;
+    for (size_t i = 0; i < count; ++i) {
+        if (!population[i].evaluated) {
+            continue;
+        }
+        // Keep the best `elite` scores, in descending order.
+        double score = population[i].score;
+        if (found == elite && score <= scores[elite - 1U]) {
+            continue;
+        }
+        size_t slot = found < elite ? found++ : elite - 1U;
+        while (slot > 0U && scores[slot - 1U] < score) {
+            scores[slot] = scores[slot - 1U];
+            --slot;
+        }
+        scores[slot] = score;
+    }
+    return found == elite ? scores[elite - 1U] : -INFINITY;
+}
+
 static int compare_candidates(const void *lhs, const void *rhs) {
     const Candidate *a = (const Candidate *)lhs;
     const Candidate *b = (const Candidate *)rhs;
@@ -303,6 +522,15 @@ static void parse_arguments(int argc, char **argv, EvolutionOptions *options) {
     snprintf(options->target_constant, sizeof(options->target_constant), "%s", "rho");
     options->save_output = false;
     options->output_path[0] = '\0';
+    options->merge_trajectories = false;
+    options->merge_cache[0] = '\0';
+    options->merge_budget = (size_t)64U << 20;
+    options->batch_output = false;
+    snprintf(options->batch_dir, sizeof(options->batch_dir), "%s", "refine_runs");
+    options->surrogate = false;
+    options->surrogate_archive[0] = '\0';
+    options->surrogate_k = 5U;
+    options->surrogate_kappa = 1.0;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--generations") == 0 && i + 1 < argc) {
@@ -320,6 +548,26 @@ static void parse_arguments(int argc, char **argv, EvolutionOptions *options) {
         } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
             options->save_output = true;
             snprintf(options->output_path, sizeof(options->output_path), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--merge-trajectories") == 0 && i + 1 < argc) {
+            options->merge_trajectories = true;
+            snprintf(options->merge_cache, sizeof(options->merge_cache), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--merge-budget") == 0 && i + 1 < argc) {
+            options->merge_budget = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--batch-output") == 0) {
+            options->batch_output = true;
+        } else if (strcmp(argv[i], "--batch-dir") == 0 && i + 1 < argc) {
+            options->batch_output = true;
+            snprintf(options->batch_dir, sizeof(options->batch_dir), "%s", argv[++i]);
+        } else if (strcmp(argv[i], "--surrogate") == 0) {
+            options->surrogate = true;
+        } else if (strcmp(argv[i], "--surrogate-archive") == 0 && i + 1 < argc) {
+            options->surrogate = true;
+            snprintf(options->surrogate_archive, sizeof(options->surrogate_archive), "%s",
+                     argv[++i]);
+        } else if (strcmp(argv[i], "--surrogate-k") == 0 && i + 1 < argc) {
+            options->surrogate_k = (size_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--surrogate-kappa") == 0 && i + 1 < argc) {
+            options->surrogate_kappa = strtod(argv[++i], NULL);
         }
     }
 
@@ -342,6 +590,60 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+    SweepMergeTable merge_table;
+    if (options.merge_trajectories && !sweep_merge_init(&merge_table, options.merge_cache,
+                                                         options.merge_budget)) {
+        fprintf(stderr, "Failed to prepare merge cache %s.\n", options.merge_cache);
+        free(population);
+        free(next_population);
+        return 1;
+    }
+
+    BatchOutput batch;
+    BatchOutput *batch_output = NULL;
+    size_t run_index = 0U;
+    int exit_status = 0;
+    if (options.batch_output) {
+        BatchOutputOptions batch_options;
+        batch_output_options_init(&batch_options);
+        if ((mkdir(options.batch_dir, 0777) != 0 && errno != EEXIST) ||
+            !batch_output_init(&batch, &batch_options)) {
+            fprintf(stderr, "Failed to prepare batched output.\n");
+            if (options.merge_trajectories) {
+                sweep_merge_clear(&merge_table);
+            }
+            free(population);
+            free(next_population);
+            return 1;
+        }
+        batch_output = &batch;
+        if (options.merge_trajectories) {
+            merge_table.batch = batch_output;
+        }
+    }
+
+    SurrogateScreen screen;
+    SurrogateScreen *surrogate = NULL;
+    double *elite_scores = NULL;
+    if (options.surrogate) {
+        elite_scores = malloc(sizeof(double) * options.elite);
+        if (!elite_scores || !surrogate_screen_init(&screen, &options)) {
+            fprintf(stderr, "Failed to prepare surrogate archive %s.\n",
+                    options.surrogate_archive);
+            free(elite_scores);
+            if (options.merge_trajectories) {
+                sweep_merge_clear(&merge_table);
+            }
+            if (batch_output) {
+                batch_output_clear(batch_output);
+            }
+            free(population);
+            free(next_population);
+            return 1;
+        }
+        surrogate = &screen;
+    }
+
     for (size_t i = 0; i < options.population; ++i) {
         candidate_init(&population[i]);
         randomize_config(&population[i].config);
@@ -349,8 +651,44 @@ int main(int argc, char **argv) {
     }
 
     for (size_t generation = 0; generation < options.generations; ++generation) {
+        size_t elite_count = options.elite;
+        if (elite_count > options.population) {
+            elite_count = options.population;
+        }
+
+        // Carried-over elites are rescored first so that, with a surrogate,
+        // every mutant is screened against the best exact scores known.
+        for (size_t i = 0; i < options.population; ++i) {
+            if (population[i].evaluated) {
+                evaluate_candidate(&population[i], &options, NULL, NULL, NULL);
+            }
+        }
         for (size_t i = 0; i < options.population; ++i) {
-            evaluate_candidate(&population[i], &options);
+            Candidate *candidate = &population[i];
+            if (candidate->evaluated) {
+                continue;
+            }
+            if (surrogate) {
+                double cutoff =
+                    elite_cutoff(population, options.population, elite_count, elite_scores);
+                SurrogateFeatures features;
+                SurrogatePrediction prediction;
+                surrogate_features(&candidate->config, &features);
+                if (!surrogate_should_run(&surrogate->model, &features, cutoff,
+                                          options.surrogate_kappa, &prediction)) {
+                    // Left unevaluated: should it survive as an elite, it
+                    // is screened again next generation.
+                    candidate->score = -INFINITY;
+                    surrogate->screened += 1U;
+                    continue;
+                }
+            }
+            evaluate_candidate(candidate, &options,
+                               options.merge_trajectories ? &merge_table : NULL, batch_output,
+                               &run_index);
+            if (surrogate) {
+                surrogate_screen_record(surrogate, candidate);
+            }
         }
 
         qsort(population, options.population, sizeof(Candidate), compare_candidates);
@@ -363,11 +701,6 @@ int main(int argc, char **argv) {
             candidate_init(&next_population[i]);
         }
 
-        size_t elite_count = options.elite;
-        if (elite_count > options.population) {
-            elite_count = options.population;
-        }
-
         for (size_t i = 0; i < elite_count; ++i) {
             candidate_copy(&next_population[i], &population[i]);
         }
@@ -395,10 +728,28 @@ int main(int argc, char **argv) {
         print_candidate_summary(&population[0], options.generations, 0U);
     }
 
+    if (surrogate) {
+        printf("Surrogate: %zu simulated, %zu screened out, %zu archived points loaded\n",
+               surrogate->simulated, surrogate->screened, surrogate->archived);
+        surrogate_screen_clear(surrogate);
+        free(elite_scores);
+    }
+
     for (size_t i = 0; i < options.population; ++i) {
         candidate_clear(&population[i]);
     }
+    if (options.merge_trajectories) {
+        sweep_merge_clear(&merge_table);
+    }
+    if (batch_output) {
+        // The batched CSVs are only known to be complete once drained.
+        if (!batch_output_drain(batch_output)) {
+            perror("batched output");
+            exit_status = 1;
+        }
+        batch_output_clear(batch_output);
+    }
     free(population);
     free(next_population);
-    return 0;
+    return exit_status;
 }
@@ -12,14 +12,23 @@
 
 #include "simulate.h"
 
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
 
+#include "checkpoint.h"
 #include "engine.h"
+#include "fixed_limbs.h"
 #include "koppa.h"
+#include "prime_batch.h"
 #include "psi.h"
 #include "rational.h"
+#include "threshold.h"
+#include "trace.h"
 
 /* ===========================================================
    PRIME AND PATTERN CHECK LOGIC
@@ -41,6 +50,21 @@ static bool mpz_is_prime_signed(mpz_srcptr value) {
     return prime;
 }
 
+// mpz_is_prime_signed() for a value prime_batch_classify() has certified;
+// only values with no small factor still need the probable-prime test.
+static bool certified_prime(PrimeCertificate certificate, mpz_srcptr value) {
+    switch (certificate) {
+    case PRIME_CERT_PRIME:
+        return true;
+    case PRIME_CERT_COMPOSITE:
+    case PRIME_CERT_UNIT:
+        return false;
+    case PRIME_CERT_ROUGH:
+        break;
+    }
+    return mpz_is_prime_signed(value);
+}
+
 // Determine if an integer is a perfect square.  Returns true if n = m*m.
 static bool mpz_is_square(const mpz_t n) {
     if (mpz_sgn(n) < 0) {
@@ -114,8 +138,18 @@ static bool mpq_has_pattern_component(const Config *config, mpq_srcptr value) {
     mpz_srcptr num = mpq_numref(value);
     mpz_srcptr den = mpq_denref(value);
     // Standard prime check
-    bool num_prime = mpz_is_prime_signed(num);
-    bool den_prime = mpz_is_prime_signed(den);
+    bool num_prime;
+    bool den_prime;
+    if (config->prime_batch) {
+        mpz_srcptr components[2] = {num, den};
+        PrimeCertificate certificates[2];
+        prime_batch_classify(config->prime_batch, components, 2U, certificates);
+        num_prime = certified_prime(certificates[0], num);
+        den_prime = certified_prime(certificates[1], den);
+    } else {
+        num_prime = mpz_is_prime_signed(num);
+        den_prime = mpz_is_prime_signed(den);
+    }
     if (num_prime || den_prime) {
         return true;
     }
@@ -176,6 +210,76 @@ static void ratio_bounds(RatioTriggerMode mode, mpq_t lower, mpq_t upper) {
     }
 }
 
+// υ/β as the raw cross quotient X/Y = (υn·βd)/(υd·βn) on the fixed-limb
+// tier: no mpq_div, and no GCD, just to compare a ratio.  False when a
+// component is too wide for it or a denominator is zero.
+static bool ratio_cross_fixed(const TRTS_State *state, FixedInt *x, FixedInt *y) {
+    FixedInt ups_num, ups_den, beta_num, beta_den;
+    if (!fixed_set_mpz(&ups_num, mpq_numref(state->upsilon)) ||
+        !fixed_set_mpz(&ups_den, mpq_denref(state->upsilon)) ||
+        !fixed_set_mpz(&beta_num, mpq_numref(state->beta)) ||
+        !fixed_set_mpz(&beta_den, mpq_denref(state->beta))) {
+        return false;
+    }
+    if (fixed_sgn(&ups_den) == 0 || fixed_sgn(&beta_den) == 0) {
+        return false;
+    }
+    return fixed_mul(x, &ups_num, &beta_den) && fixed_mul(y, &ups_den, &beta_num);
+}
+
+// Sign of X/Y - bound, as mpq_cmp() gives it against the canonical υ/β.
+// Only bounds with a positive denominator are compared here.
+static bool ratio_order_fixed(const FixedInt *x, const FixedInt *y, mpq_srcptr bound,
+                              int *order) {
+    FixedInt bound_num, bound_den;
+    if (mpz_sgn(mpq_denref(bound)) <= 0 || !fixed_set_mpz(&bound_num, mpq_numref(bound)) ||
+        !fixed_set_mpz(&bound_den, mpq_denref(bound))) {
+        return false;
+    }
+    // X/Y > p/q  <=>  X·q·sgn(Y) > p·|Y|
+    FixedInt magnitude = *y;
+    magnitude.size = fixed_abs_size(magnitude.size);
+    FixedInt lhs, rhs;
+    if (!fixed_mul(&lhs, x, &bound_den) || !fixed_mul(&rhs, &bound_num, &magnitude)) {
+        return false;
+    }
+    if (fixed_sgn(y) < 0) {
+        fixed_neg(&lhs);
+    }
+    *order = fixed_cmp(&lhs, &rhs);
+    return true;
+}
+
+static bool ratio_in_range_fixed(const Config *config, const TRTS_State *state,
+                                 bool *in_range) {
+    FixedInt x, y;
+    if (!ratio_cross_fixed(state, &x, &y)) {
+        return false;
+    }
+    int lower_order = 0;
+    int upper_order = 0;
+    if (config->ratio_trigger_mode == RATIO_TRIGGER_CUSTOM && config->enable_ratio_custom_range) {
+        if (!ratio_order_fixed(&x, &y, config->ratio_custom_lower, &lower_order) ||
+            !ratio_order_fixed(&x, &y, config->ratio_custom_upper, &upper_order)) {
+            return false;
+        }
+    } else {
+        mpq_t lower, upper;
+        rational_init(lower);
+        rational_init(upper);
+        ratio_bounds(config->ratio_trigger_mode, lower, upper);
+        bool ok = ratio_order_fixed(&x, &y, lower, &lower_order) &&
+                  ratio_order_fixed(&x, &y, upper, &upper_order);
+        rational_clear(lower);
+        rational_clear(upper);
+        if (!ok) {
+            return false;
+        }
+    }
+    *in_range = lower_order > 0 && upper_order < 0;
+    return true;
+}
+
 // Return true if |υ/β| lies inside the ratio trigger window defined by the
 // config.  Supports built‑in modes (golden, sqrt2, plastic) and a custom
 // mode when enable_ratio_custom_range is true.  Returns false if the
@@ -187,6 +291,11 @@ static bool ratio_in_range(const Config *config, const TRTS_State *state) {
     if (rational_is_zero(state->beta)) {
         return false;
     }
+    // The threshold tracker records the ratio itself, so it takes the mpq path.
+    bool fixed_in_range = false;
+    if (!config->threshold_tracker && ratio_in_range_fixed(config, state, &fixed_in_range)) {
+        return fixed_in_range;
+    }
     mpq_t ratio;
     rational_init(ratio);
     // ratio = upsilon / beta
@@ -194,8 +303,17 @@ static bool ratio_in_range(const Config *config, const TRTS_State *state) {
     bool in_range = false;
     if (config->ratio_trigger_mode == RATIO_TRIGGER_CUSTOM && config->enable_ratio_custom_range) {
         // Custom window: check config->ratio_custom_lower < ratio < config->ratio_custom_upper
-        if (mpq_cmp(ratio, config->ratio_custom_lower) > 0 && mpq_cmp(ratio, config->ratio_custom_upper) < 0) {
-            in_range = true;
+        bool above_lower = mpq_cmp(ratio, config->ratio_custom_lower) > 0;
+        if (config->threshold_tracker) {
+            threshold_record(config->threshold_tracker, THRESHOLD_RATIO_CUSTOM_LOWER,
+                             THRESHOLD_BELOW, ratio, above_lower);
+        }
+        if (above_lower) {
+            in_range = mpq_cmp(ratio, config->ratio_custom_upper) < 0;
+            if (config->threshold_tracker) {
+                threshold_record(config->threshold_tracker, THRESHOLD_RATIO_CUSTOM_UPPER,
+                                 THRESHOLD_ABOVE, ratio, in_range);
+            }
         }
     } else {
         mpq_t lower, upper;
@@ -222,6 +340,21 @@ static bool ratio_threshold_outside(const Config *config, const TRTS_State *stat
     if (rational_is_zero(state->beta)) {
         return false;
     }
+    // mpq_get_d() truncates towards zero, so the snapshot is below ½ exactly
+    // when |X/Y| is, and above 2 exactly when |X/Y| >= 2 + 2^-51: the
+    // integer tests 2|X| < |Y| and 2^51|X| >= (2^52 + 1)|Y|.
+    FixedInt x, y;
+    if (ratio_cross_fixed(state, &x, &y)) {
+        x.size = fixed_abs_size(x.size);
+        y.size = fixed_abs_size(y.size);
+        FixedInt two_x, scale_x, scale_y, scaled_x, scaled_y;
+        fixed_set_limb(&scale_x, (mp_limb_t)1 << 51);
+        fixed_set_limb(&scale_y, ((mp_limb_t)1 << 52) + 1U);
+        if (fixed_add(&two_x, &x, &x) && fixed_mul(&scaled_x, &x, &scale_x) &&
+            fixed_mul(&scaled_y, &y, &scale_y)) {
+            return fixed_cmp(&two_x, &y) < 0 || fixed_cmp(&scaled_x, &scaled_y) >= 0;
+        }
+    }
     mpq_t ratio;
     rational_init(ratio);
     rational_div(ratio, state->upsilon, state->beta);
@@ -268,6 +401,10 @@ static bool stack_allows_psi(const Config *config, const TRTS_State *state) {
 typedef struct {
     FILE *events_file;
     FILE *values_file;
+    TraceWriter *trace_writer;
+    int values_radix;
+    // Optional; receives the run's limb compaction totals.
+    StateCompaction *compaction;
 } SimulationOutputs;
 
 static void log_event(FILE *events_file, size_t tick, int microtick, char phase,
@@ -285,7 +422,14 @@ static void log_event(FILE *events_file, size_t tick, int microtick, char phase,
 }
 
 static void log_values(FILE *values_file, size_t tick, int microtick,
-                        const TRTS_State *state) {
+                        const TRTS_State *state, int radix) {
+    if (radix != 10) {
+        mpz_srcptr components[TRACE_COMPONENT_COUNT];
+        trace_state_components(state, components);
+        trace_write_values_columns(values_file, tick, microtick, state->koppa_stack_size,
+                                   components, radix);
+        return;
+    }
     gmp_fprintf(values_file,
         "%zu,%d,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%zu,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd,%Zd\n",
         tick, microtick,
@@ -307,36 +451,123 @@ static void log_values(FILE *values_file, size_t tick, int microtick,
         mpq_numref(state->triangle_epsilon_over_prev), mpq_denref(state->triangle_epsilon_over_prev));
 }
 
-static void emit_outputs(const SimulationOutputs *outputs, size_t tick, int microtick,
+void simulate_write_events_row(FILE *events_file, size_t tick, int microtick, char phase,
+                               const TRTS_State *state, bool rho_event, bool psi_fired,
+                               bool mu_zero, bool forced_emission) {
+    log_event(events_file, tick, microtick, phase, rho_event, psi_fired, mu_zero,
+              forced_emission, state);
+}
+
+void simulate_write_values_row(FILE *values_file, size_t tick, int microtick,
+                               const TRTS_State *state, int radix) {
+    log_values(values_file, tick, microtick, state, radix);
+}
+
+// Returns false when the binary trace could not be written.  CSV streams
+// are checked once, when they are closed.
+static bool emit_outputs(const SimulationOutputs *outputs, size_t tick, int microtick,
                           char phase, bool rho_event, bool psi_fired, bool mu_zero,
                           bool forced_emission, const TRTS_State *state,
                           SimulateObserver observer, void *user_data) {
+    bool ok = true;
     if (outputs) {
         if (outputs->events_file) {
             log_event(outputs->events_file, tick, microtick, phase,
                       rho_event, psi_fired, mu_zero, forced_emission, state);
         }
         if (outputs->values_file) {
-            log_values(outputs->values_file, tick, microtick, state);
+            log_values(outputs->values_file, tick, microtick, state, outputs->values_radix);
+        }
+        if (outputs->trace_writer) {
+            ok = trace_writer_append(outputs->trace_writer, tick, microtick, phase, state,
+                                     rho_event, psi_fired, mu_zero, forced_emission);
         }
     }
     if (observer) {
         observer(user_data, tick, microtick, phase, state,
                  rho_event, psi_fired, mu_zero, forced_emission);
     }
+    return ok;
+}
+
+/* ===========================================================
+   PREEMPTION AND CHECKPOINTS
+   =========================================================== */
+
+static volatile sig_atomic_t preemption_requested = 0;
+
+// Resume point, preemption target and tick hook for run_simulation().  A
+// NULL control runs from the config seeds with preemption disabled.
+typedef struct {
+    const char *checkpoint_path;
+    SimulateTickHook tick_hook;
+    void *hook_data;
+    const TRTS_State *resume_state;
+    size_t resume_tick;
+    int resume_microtick;
+    SimulateStatus status;
+} SimulationControl;
+
+static int64_t output_offset(FILE *file) {
+    if (!file || fflush(file) != 0) {
+        return -1;
+    }
+    return (int64_t)ftello(file);
+}
+
+static bool write_checkpoint(const Config *config, const SimulationOutputs *outputs,
+                             const char *path, size_t tick, int microtick,
+                             const TRTS_State *state) {
+    CheckpointPosition position;
+    position.tick = tick;
+    position.microtick = microtick;
+    position.ticks_total = config->ticks;
+    position.events_offset = output_offset(outputs ? outputs->events_file : NULL);
+    position.values_offset = output_offset(outputs ? outputs->values_file : NULL);
+    position.trace_offset = -1;
+    position.trace_rows = 0U;
+    if (outputs && outputs->trace_writer) {
+        position.trace_offset = output_offset(outputs->trace_writer->file);
+        position.trace_rows = outputs->trace_writer->rows_written;
+    }
+    return checkpoint_write(path, config, &position, state);
 }
 
 /* ===========================================================
    CORE SIMULATION LOOP
    =========================================================== */
 
-static void run_simulation(const Config *config, const SimulationOutputs *outputs,
-                            SimulateObserver observer, void *user_data) {
+// Returns false, with control->status set to SIMULATE_FAILED, when an
+// output could not be written.
+static bool run_simulation(const Config *config, const SimulationOutputs *outputs,
+                            SimulateObserver observer, void *user_data,
+                            SimulationControl *control) {
     TRTS_State state;
     state_init(&state);
     state_reset(&state, config);
-    for (size_t tick = 1; tick <= config->ticks; ++tick) {
-        for (int microtick = 1; microtick <= 11; ++microtick) {
+    EngineReducer reducer;
+    engine_reducer_init(&reducer, config);
+    StateCompaction local_compaction;
+    state_compaction_init(&local_compaction);
+    StateCompaction *compaction =
+        outputs && outputs->compaction ? outputs->compaction : &local_compaction;
+    size_t start_tick = 1;
+    int start_microtick = 1;
+    if (control && control->resume_state) {
+        state_copy(&state, control->resume_state);
+        start_tick = control->resume_tick;
+        start_microtick = control->resume_microtick + 1;
+        if (start_microtick > 11) {
+            start_tick += 1;
+            start_microtick = 1;
+        }
+    }
+    if (control) {
+        control->status = SIMULATE_COMPLETED;
+    }
+    for (size_t tick = start_tick; tick <= config->ticks; ++tick) {
+        for (int microtick = (tick == start_tick) ? start_microtick : 1; microtick <= 11;
+             ++microtick) {
             char phase;
             switch (microtick) {
             case 1:
@@ -371,7 +602,7 @@ static void run_simulation(const Config *config, const SimulationOutputs *output
             case 'E': {
                 // Epsilon phase: compute epsilon and run engine step
                 rational_set(state.epsilon, state.upsilon);
-                bool engine_ok = engine_step(config, &state, microtick);
+                bool engine_ok = engine_step_reduced(config, &state, microtick, &reducer);
                 (void)engine_ok;
                 mpq_srcptr prime_target = (config->prime_target == PRIME_ON_MEMORY)
                                               ? state.epsilon
@@ -433,35 +664,65 @@ static void run_simulation(const Config *config, const SimulationOutputs *output
             }
             }
             // Emit outputs (log or observer callback)
-            emit_outputs(outputs, tick, microtick, phase, rho_event,
-                         psi_fired, mu_zero, forced_emission, &state,
-                         observer, user_data);
+            if (!emit_outputs(outputs, tick, microtick, phase, rho_event,
+                              psi_fired, mu_zero, forced_emission, &state,
+                              observer, user_data)) {
+                if (control) {
+                    control->status = SIMULATE_FAILED;
+                }
+                state_clear(&state);
+                engine_reducer_clear(&reducer);
+                return false;
+            }
+            // Preemption is honoured only between microticks, once every
+            // output of the current one has been written.
+            if (control && control->checkpoint_path && preemption_requested &&
+                !(tick == config->ticks && microtick == 11)) {
+                preemption_requested = 0;
+                control->status = write_checkpoint(config, outputs, control->checkpoint_path,
+                                                   tick, microtick, &state)
+                                      ? SIMULATE_PREEMPTED
+                                      : SIMULATE_FAILED;
+                state_clear(&state);
+                engine_reducer_clear(&reducer);
+                return true;
+            }
+        }
+        if (config->compaction_interval > 0U && tick % config->compaction_interval == 0U) {
+            state_compact(&state, compaction);
+        }
+        if (control && control->tick_hook && tick < config->ticks &&
+            !control->tick_hook(control->hook_data, tick, &state)) {
+            control->status = SIMULATE_STOPPED;
+            state_clear(&state);
+            engine_reducer_clear(&reducer);
+            return true;
         }
     }
     state_clear(&state);
+    engine_reducer_clear(&reducer);
+    return true;
 }
 
 /* ===========================================================
    ENTRY POINTS
    =========================================================== */
 
-void simulate(const Config *config) {
-    FILE *events_file = fopen("events.csv", "w");
-    if (!events_file) {
-        perror("events.csv");
-        return;
-    }
-    FILE *values_file = fopen("values.csv", "w");
-    if (!values_file) {
-        perror("values.csv");
-        fclose(events_file);
-        return;
-    }
-    // Write CSV headers
+void simulate_write_events_header(FILE *events_file) {
     fprintf(events_file,
             "tick,mt,phase,rho_event,psi_fired,mu_zero,forced_emission,"
             "ratio_triggered,triple_psi,dual_engine,koppa_sample_index,"
             "ratio_threshold,psi_strength,sign_flip\n");
+}
+
+void simulate_write_values_header(FILE *values_file) {
+    simulate_write_values_header_radix(values_file, 10);
+}
+
+void simulate_write_values_header_radix(FILE *values_file, int radix) {
+    if (radix != 10) {
+        fprintf(values_file, SIMULATE_RADIX_MARKER "%d\n", radix);
+    }
     fprintf(values_file,
             "tick,mt,upsilon_num,upsilon_den,beta_num,beta_den,koppa_num,koppa_den,"
             "koppa_sample_num,koppa_sample_den,prev_upsilon_num,prev_upsilon_den,"
@@ -472,12 +733,208 @@ void simulate(const Config *config) {
             "triangle_phi_over_epsilon_den,triangle_prev_over_phi_num,"
             "triangle_prev_over_phi_den,triangle_epsilon_over_prev_num,"
             "triangle_epsilon_over_prev_den\n");
-    SimulationOutputs outputs = {events_file, values_file};
-    run_simulation(config, &outputs, NULL, NULL);
+}
+
+int simulate_values_radix_from_line(const char *line) {
+    const size_t marker_length = strlen(SIMULATE_RADIX_MARKER);
+    if (!line || strncmp(line, SIMULATE_RADIX_MARKER, marker_length) != 0) {
+        return 0;
+    }
+    char *end = NULL;
+    long radix = strtol(line + marker_length, &end, 10);
+    if (end == line + marker_length || (*end != '\0' && *end != '\n' && *end != '\r') ||
+        !config_values_radix_supported((int)radix)) {
+        return 0;
+    }
+    return (int)radix;
+}
+
+void simulate(const Config *config) {
+    FILE *events_file = fopen("events.csv", "w");
+    if (!events_file) {
+        perror("events.csv");
+        return;
+    }
+    FILE *values_file = fopen("values.csv", "w");
+    if (!values_file) {
+        perror("values.csv");
+        fclose(events_file);
+        return;
+    }
+    simulate_write_events_header(events_file);
+    simulate_write_values_header_radix(values_file, config->values_radix);
+    SimulationOutputs outputs = {events_file, values_file, NULL, config->values_radix};
+    run_simulation(config, &outputs, NULL, NULL, NULL);
     fclose(events_file);
     fclose(values_file);
 }
 
+bool simulate_binary(const Config *config, const char *trace_path) {
+    TraceWriter writer;
+    if (!trace_writer_open(&writer, trace_path)) {
+        perror(trace_path);
+        return false;
+    }
+    SimulationOutputs outputs = {NULL, NULL, &writer, 10};
+    bool ok = run_simulation(config, &outputs, NULL, NULL, NULL);
+    if (!trace_writer_close(&writer)) {
+        ok = false;
+    }
+    if (!ok) {
+        fprintf(stderr, "%s: write failed\n", trace_path);
+    }
+    return ok;
+}
+
 void simulate_stream(const Config *config, SimulateObserver observer, void *user_data) {
-    run_simulation(config, NULL, observer, user_data);
+    run_simulation(config, NULL, observer, user_data, NULL);
+}
+
+static void preemption_signal_handler(int signal_number) {
+    (void)signal_number;
+    simulate_request_preemption();
+}
+
+void simulate_request_preemption(void) {
+    preemption_requested = 1;
+}
+
+void simulate_install_preemption_handler(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = preemption_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+// Open a CSV output for a fresh run (truncating it; the caller writes the
+// header) or for a resumed run (cutting it back to the checkpointed offset).
+static FILE *open_csv_output(const char *path, bool resume, int64_t offset, BatchOutput *batch) {
+    if (!resume) {
+        return batch ? batch_output_open(batch, path) : fopen(path, "w");
+    }
+    if (offset < 0) {
+        fprintf(stderr, "%s was not part of the checkpointed run\n", path);
+        return NULL;
+    }
+    FILE *file = fopen(path, "r+");
+    if (!file) {
+        return NULL;
+    }
+    if (ftruncate(fileno(file), (off_t)offset) != 0 || fseek(file, 0L, SEEK_END) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    return file;
+}
+
+static SimulateStatus run_with_files(const Config *config, const SimulateFiles *files,
+                                     SimulateObserver observer, void *user_data,
+                                     SimulationControl *control, bool resume) {
+    SimulationOutputs outputs = {NULL, NULL, NULL, config->values_radix,
+                                 files ? files->compaction : NULL};
+    TraceWriter writer;
+    TRTS_State resume_state;
+    state_init(&resume_state);
+    CheckpointPosition position;
+    memset(&position, 0, sizeof(position));
+    const char *checkpoint_path = control->checkpoint_path;
+
+    if (resume) {
+        char error[128];
+        if (!checkpoint_path ||
+            !checkpoint_read(checkpoint_path, config, &position, &resume_state, error,
+                             sizeof(error))) {
+            fprintf(stderr, "Cannot resume from %s: %s\n",
+                    checkpoint_path ? checkpoint_path : "(none)",
+                    checkpoint_path ? error : "no checkpoint path");
+            state_clear(&resume_state);
+            return SIMULATE_FAILED;
+        }
+        control->resume_state = &resume_state;
+        control->resume_tick = position.tick;
+        control->resume_microtick = position.microtick;
+    }
+
+    bool ok = !(files && files->batch && (checkpoint_path || resume));
+    BatchOutput *batch = files ? files->batch : NULL;
+    if (ok && files && files->events_path) {
+        outputs.events_file =
+            open_csv_output(files->events_path, resume, position.events_offset, batch);
+        ok = outputs.events_file != NULL;
+        if (ok && !resume) {
+            simulate_write_events_header(outputs.events_file);
+        }
+    }
+    if (ok && files && files->values_path) {
+        outputs.values_file =
+            open_csv_output(files->values_path, resume, position.values_offset, batch);
+        ok = outputs.values_file != NULL;
+        if (ok && !resume) {
+            simulate_write_values_header_radix(outputs.values_file, config->values_radix);
+        }
+    }
+    if (ok && files && files->trace_path) {
+        if (resume) {
+            ok = position.trace_offset >= 0 &&
+                 trace_writer_resume(&writer, files->trace_path, (uint64_t)position.trace_offset,
+                                     position.trace_rows, &resume_state);
+        } else {
+            ok = trace_writer_open(&writer, files->trace_path);
+        }
+        if (ok) {
+            outputs.trace_writer = &writer;
+        }
+    }
+
+    if (ok) {
+        run_simulation(config, &outputs, observer, user_data, control);
+    } else {
+        perror("simulate");
+    }
+
+    // A full disk or a failed flush only shows up here; a run whose outputs
+    // are incomplete must not report success.
+    if (outputs.events_file && fclose(outputs.events_file) != 0) {
+        perror(files->events_path);
+        ok = false;
+    }
+    if (outputs.values_file && fclose(outputs.values_file) != 0) {
+        perror(files->values_path);
+        ok = false;
+    }
+    if (outputs.trace_writer && !trace_writer_close(outputs.trace_writer)) {
+        perror(files->trace_path);
+        ok = false;
+    }
+    state_clear(&resume_state);
+    if (ok && control->status == SIMULATE_COMPLETED && resume) {
+        remove(checkpoint_path);
+    }
+    return ok ? control->status : SIMULATE_FAILED;
+}
+
+SimulateStatus simulate_resumable(const Config *config, const SimulateFiles *files,
+                                  SimulateObserver observer, void *user_data,
+                                  const char *checkpoint_path, bool resume) {
+    SimulationControl control = {checkpoint_path, NULL, NULL, NULL, 0U, 0, SIMULATE_FAILED};
+    return run_with_files(config, files, observer, user_data, &control, resume);
+}
+
+SimulateStatus simulate_until(const Config *config, const SimulateFiles *files,
+                              SimulateObserver observer, void *user_data,
+                              SimulateTickHook hook, void *hook_data) {
+    SimulationControl control = {NULL, hook, hook_data, NULL, 0U, 0, SIMULATE_FAILED};
+    return run_with_files(config, files, observer, user_data, &control, false);
+}
+
+SimulateStatus simulate_continue(const Config *config, const TRTS_State *state, size_t tick,
+                                 int microtick, SimulateObserver observer, void *user_data,
+                                 SimulateTickHook hook, void *hook_data) {
+    SimulationControl control = {NULL, hook, hook_data, state, tick, microtick,
+                                 SIMULATE_FAILED};
+    run_simulation(config, NULL, observer, user_data, &control);
+    return control.status;
 }
@@ -6,13 +6,15 @@
 #ifndef SIMULATE_H
 #define SIMULATE_H
 
-#ifdef __cplusplus
-extern "C" {
-#endif
 #include "stdio.h"
+#include "batch_output.h"
 #include "config.h"
 #include "state.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // A callback invoked on each microtick when using simulate_stream().  The
 // callback receives the current tick, microtick number, phase ('E','M','R'),
 // a pointer to the immutable state, and flags indicating whether rho or psi
@@ -32,6 +34,33 @@ typedef void (*SimulateObserver)(void *user_data,
 // the observer callback.
 void simulate(const Config *config);
 
+// Run a simulation and write a single binary trace (see trace.h) holding the
+// columns of both events.csv and values.csv.  Returns false if the trace
+// file cannot be created.
+bool simulate_binary(const Config *config, const char *trace_path);
+
+// Write the CSV header lines used by simulate() for events.csv and
+// values.csv, so that other writers can produce identical files.
+void simulate_write_events_header(FILE *events_file);
+void simulate_write_values_header(FILE *values_file);
+
+// Write one events.csv or values.csv row exactly as simulate() does, for
+// writers that own their streams (see sweep_merge.h).
+void simulate_write_events_row(FILE *events_file, size_t tick, int microtick, char phase,
+                               const TRTS_State *state, bool rho_event, bool psi_fired,
+                               bool mu_zero, bool forced_emission);
+void simulate_write_values_row(FILE *values_file, size_t tick, int microtick,
+                               const TRTS_State *state, int radix);
+
+// values.csv written with a non-decimal values_radix (see config.h) starts
+// with a "#radix=N" line ahead of the column header.  Readers pass the first
+// line to simulate_values_radix_from_line(), which returns N for a marker
+// line and 0 for anything else, in which case the file is decimal and that
+// line is the header.
+#define SIMULATE_RADIX_MARKER "#radix="
+void simulate_write_values_header_radix(FILE *values_file, int radix);
+int simulate_values_radix_from_line(const char *line);
+
 // Run a simulation and invoke the provided observer on every microtick.
 // No files are written in this mode.  Both config and user_data may be
 // modified after the call returns, but must remain valid for the duration
@@ -40,6 +69,63 @@ void simulate_stream(const Config *config,
                       SimulateObserver observer,
                       void *user_data);
 
+typedef enum {
+    SIMULATE_COMPLETED = 0,
+    SIMULATE_PREEMPTED,
+    SIMULATE_FAILED,
+    SIMULATE_STOPPED
+} SimulateStatus;
+
+// Output files for simulate_resumable(); any path may be NULL.  When batch
+// is set the CSVs are written through it (see batch_output.h) and are only
+// complete once the batch drains; batched runs cannot be checkpointed.
+// compaction, when set, supplies the thresholds for the run's limb
+// compaction passes (config->compaction_interval) and accumulates their
+// totals; otherwise the defaults of state_compaction_init() apply.
+typedef struct {
+    const char *events_path;
+    const char *values_path;
+    const char *trace_path;
+    BatchOutput *batch;
+    StateCompaction *compaction;
+} SimulateFiles;
+
+// Run a simulation that can be preempted at a microtick boundary.  When
+// checkpoint_path is set and a preemption has been requested, the run
+// writes an exact checkpoint after the current microtick and returns
+// SIMULATE_PREEMPTED.  With resume set, the run continues from that
+// checkpoint, truncating the output files back to the checkpointed offsets,
+// so the finished files are byte-identical to those of an uninterrupted run.
+// The observer is only invoked for microticks executed by this call.
+SimulateStatus simulate_resumable(const Config *config, const SimulateFiles *files,
+                                  SimulateObserver observer, void *user_data,
+                                  const char *checkpoint_path, bool resume);
+
+// Called with the full state after the last microtick of every tick except
+// the final one.  Returning false ends the run after that tick.
+typedef bool (*SimulateTickHook)(void *user_data, size_t tick, const TRTS_State *state);
+
+// Run a simulation into the given files, consulting hook at every tick
+// boundary and invoking observer (which may be NULL) on every microtick.
+// Returns SIMULATE_STOPPED when the hook ended the run early.
+SimulateStatus simulate_until(const Config *config, const SimulateFiles *files,
+                              SimulateObserver observer, void *user_data,
+                              SimulateTickHook hook, void *hook_data);
+
+// Continue a run from state, the state after microtick `microtick` of
+// `tick`, with the same observer and hook as simulate_until() and no output
+// files.  A NULL state starts from the config seeds.
+SimulateStatus simulate_continue(const Config *config, const TRTS_State *state, size_t tick,
+                                 int microtick, SimulateObserver observer, void *user_data,
+                                 SimulateTickHook hook, void *hook_data);
+
+// Ask a running simulate_resumable() to checkpoint and stop.  Safe to call
+// from a signal handler.
+void simulate_request_preemption(void);
+
+// Route SIGUSR2 and SIGTERM to simulate_request_preemption().
+void simulate_install_preemption_handler(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -119,3 +119,119 @@ void state_reset(TRTS_State *state, const Config *config) {
     state->psi_strength_applied = false;
     state->sign_flip_polarity = false;
 }
+
+void state_copy(TRTS_State *dest, const TRTS_State *src) {
+    rational_set(dest->upsilon, src->upsilon);
+    rational_set(dest->beta, src->beta);
+    rational_set(dest->koppa, src->koppa);
+    rational_set(dest->epsilon, src->epsilon);
+    rational_set(dest->phi, src->phi);
+    rational_set(dest->previous_upsilon, src->previous_upsilon);
+    rational_set(dest->previous_beta, src->previous_beta);
+    rational_set(dest->delta_upsilon, src->delta_upsilon);
+    rational_set(dest->delta_beta, src->delta_beta);
+    rational_set(dest->triangle_phi_over_epsilon, src->triangle_phi_over_epsilon);
+    rational_set(dest->triangle_prev_over_phi, src->triangle_prev_over_phi);
+    rational_set(dest->triangle_epsilon_over_prev, src->triangle_epsilon_over_prev);
+    for (size_t i = 0; i < 4; ++i) {
+        rational_set(dest->koppa_stack[i], src->koppa_stack[i]);
+    }
+    rational_set(dest->koppa_sample, src->koppa_sample);
+    dest->koppa_stack_size = src->koppa_stack_size;
+    dest->koppa_sample_index = src->koppa_sample_index;
+    dest->rho_pending = src->rho_pending;
+    dest->rho_latched = src->rho_latched;
+    dest->psi_recent = src->psi_recent;
+    dest->ratio_triggered_recent = src->ratio_triggered_recent;
+    dest->psi_triple_recent = src->psi_triple_recent;
+    dest->dual_engine_last_step = src->dual_engine_last_step;
+    dest->ratio_threshold_recent = src->ratio_threshold_recent;
+    dest->psi_strength_applied = src->psi_strength_applied;
+    dest->sign_flip_polarity = src->sign_flip_polarity;
+    dest->tick = src->tick;
+}
+
+void state_rationals(TRTS_State *state, mpq_ptr rationals[STATE_RATIONAL_COUNT]) {
+    size_t n = 0U;
+    rationals[n++] = state->upsilon;
+    rationals[n++] = state->beta;
+    rationals[n++] = state->koppa;
+    rationals[n++] = state->epsilon;
+    rationals[n++] = state->phi;
+    rationals[n++] = state->previous_upsilon;
+    rationals[n++] = state->previous_beta;
+    rationals[n++] = state->delta_upsilon;
+    rationals[n++] = state->delta_beta;
+    rationals[n++] = state->triangle_phi_over_epsilon;
+    rationals[n++] = state->triangle_prev_over_phi;
+    rationals[n++] = state->triangle_epsilon_over_prev;
+    for (size_t i = 0; i < 4; ++i) {
+        rationals[n++] = state->koppa_stack[i];
+    }
+    rationals[n++] = state->koppa_sample;
+}
+
+unsigned int state_flag_bits(const TRTS_State *state) {
+    const bool flags[] = {state->rho_pending,          state->rho_latched,
+                          state->psi_recent,           state->ratio_triggered_recent,
+                          state->psi_triple_recent,    state->dual_engine_last_step,
+                          state->ratio_threshold_recent, state->psi_strength_applied,
+                          state->sign_flip_polarity};
+    unsigned int bits = 0U;
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        if (flags[i]) {
+            bits |= 1U << i;
+        }
+    }
+    return bits;
+}
+
+void state_compaction_init(StateCompaction *compaction) {
+    compaction->shrink_ratio = 4U;
+    compaction->headroom_percent = 25U;
+    compaction->min_limbs = 8U;
+    compaction->passes = 0U;
+    compaction->resized = 0U;
+    compaction->reclaimed_bytes = 0U;
+}
+
+// GMP has no accessor for the allocation; _mp_alloc is the documented field.
+static size_t compact_integer(mpz_ptr value, StateCompaction *compaction) {
+    const size_t allocated = (size_t)value->_mp_alloc;
+    const size_t used = mpz_size(value) > 0U ? mpz_size(value) : 1U;
+    if (allocated <= compaction->min_limbs || allocated <= used * compaction->shrink_ratio) {
+        return 0U;
+    }
+    const size_t target = used + (used * compaction->headroom_percent + 99U) / 100U;
+    mpz_realloc2(value, (mp_bitcnt_t)target * GMP_NUMB_BITS);
+    const size_t kept = (size_t)value->_mp_alloc;
+    if (kept >= allocated) {
+        return 0U;
+    }
+    compaction->resized += 1U;
+    return (allocated - kept) * sizeof(mp_limb_t);
+}
+
+size_t state_compact(TRTS_State *state, StateCompaction *compaction) {
+    mpq_ptr rationals[STATE_RATIONAL_COUNT];
+    state_rationals(state, rationals);
+    size_t reclaimed = 0U;
+    for (size_t i = 0; i < STATE_RATIONAL_COUNT; ++i) {
+        reclaimed += compact_integer(mpq_numref(rationals[i]), compaction);
+        reclaimed += compact_integer(mpq_denref(rationals[i]), compaction);
+    }
+    compaction->passes += 1U;
+    compaction->reclaimed_bytes += reclaimed;
+    return reclaimed;
+}
+
+void state_apply_flag_bits(TRTS_State *state, unsigned int bits) {
+    bool *flags[] = {&state->rho_pending,          &state->rho_latched,
+                     &state->psi_recent,           &state->ratio_triggered_recent,
+                     &state->psi_triple_recent,    &state->dual_engine_last_step,
+                     &state->ratio_threshold_recent, &state->psi_strength_applied,
+                     &state->sign_flip_polarity};
+    for (size_t i = 0; i < sizeof(flags) / sizeof(flags[0]); ++i) {
+        *flags[i] = (bits & (1U << i)) != 0U;
+    }
+}
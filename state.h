@@ -59,5 +59,38 @@ typedef struct {
 void state_init(TRTS_State *state);
 void state_clear(TRTS_State *state);
 void state_reset(TRTS_State *state, const Config *config);
+// Copy every field verbatim; both states must be initialised.
+void state_copy(TRTS_State *dest, const TRTS_State *src);
+
+// Every persistent rational of TRTS_State, in a fixed order shared by the
+// checkpoint format and state fingerprints.
+#define STATE_RATIONAL_COUNT 17
+void state_rationals(TRTS_State *state, mpq_ptr rationals[STATE_RATIONAL_COUNT]);
+// The boolean flags packed into bits, in declaration order.
+unsigned int state_flag_bits(const TRTS_State *state);
+void state_apply_flag_bits(TRTS_State *state, unsigned int bits);
+
+// Limb-capacity compaction.  GMP never returns limbs, so after koppa is
+// dumped or popped, or a psi fire or subtraction shrinks a component, the
+// integer keeps its peak allocation.  state_compact() reallocates every
+// component whose allocation exceeds shrink_ratio times its current size
+// down to that size plus headroom_percent.  The gap between the two is the
+// hysteresis: a compacted component has to regrow well past its headroom
+// and shrink again before it is touched a second time.  Values are never
+// changed, only the capacity behind them.
+typedef struct {
+    size_t shrink_ratio;
+    size_t headroom_percent;
+    // Allocations of at most this many limbs are left alone.
+    size_t min_limbs;
+    // Totals over every pass.
+    size_t passes;
+    size_t resized;
+    size_t reclaimed_bytes;
+} StateCompaction;
+
+void state_compaction_init(StateCompaction *compaction);
+// Returns the bytes reclaimed by this pass.
+size_t state_compact(TRTS_State *state, StateCompaction *compaction);
 
 #endif // STATE_H
@@ -0,0 +1,191 @@
+// surrogate.c
+// k-nearest-neighbour score surrogate (see surrogate.h).  Predictions are
+// inverse-distance weighted means of the neighbours' squashed scores; the
+// uncertainty is their weighted spread plus their mean distance, so a
+// configuration far from everything simulated so far always looks
+// uncertain enough to be run.
+
+#include "surrogate.h"
+
+#include <gmp.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Distance weights: a differing mode counts 1, a differing switch 0.5, ten
+// ticks 1 and a factor of four in a seed numerator or denominator 1.
+static const double FEATURE_SCALE[SURROGATE_FEATURE_COUNT] = {
+    1.0, 1.0, 1.0, 0.5, 0.5, 0.1, 0.5, 0.5, 0.5, 0.5, 1.0, 1.0};
+
+// Features 0-2 are categorical: any difference costs the full weight.
+#define SURROGATE_CATEGORICAL 3
+
+// Keeps a point at distance zero from taking all of the weight while
+// others are close by.
+#define SURROGATE_DISTANCE_FLOOR 0.05
+
+// Squashed scores below this are failures; the floor keeps them finite.
+#define SURROGATE_TARGET_FLOOR -50.0
+
+static double squash(double score) {
+    if (isnan(score)) {
+        return SURROGATE_TARGET_FLOOR;
+    }
+    double value = copysign(log1p(fabs(score)), score);
+    return value < SURROGATE_TARGET_FLOOR ? SURROGATE_TARGET_FLOOR : value;
+}
+
+static double unsquash(double value) {
+    return copysign(expm1(fabs(value)), value);
+}
+
+static double log2_magnitude(mpz_srcptr value) {
+    if (mpz_sgn(value) == 0) {
+        return 0.0;
+    }
+    long exponent = 0;
+    double mantissa = mpz_get_d_2exp(&exponent, value);
+    return log2(fabs(mantissa)) + (double)exponent;
+}
+
+void surrogate_features(const Config *config, SurrogateFeatures *features) {
+    double *values = features->values;
+    values[0] = (double)config->engine_mode;
+    values[1] = (double)config->psi_mode;
+    values[2] = (double)config->koppa_mode;
+    values[3] = config->triple_psi_mode ? 1.0 : 0.0;
+    values[4] = config->multi_level_koppa ? 1.0 : 0.0;
+    values[5] = (double)config->ticks;
+    // Seeds are taken as written: 6/4 is not the run 3/2 is.
+    values[6] = log2_magnitude(mpq_numref(config->initial_upsilon));
+    values[7] = log2_magnitude(mpq_denref(config->initial_upsilon));
+    values[8] = log2_magnitude(mpq_numref(config->initial_beta));
+    values[9] = log2_magnitude(mpq_denref(config->initial_beta));
+    values[10] = (double)mpq_sgn(config->initial_upsilon);
+    values[11] = (double)mpq_sgn(config->initial_beta);
+}
+
+void surrogate_init(Surrogate *surrogate, size_t k) {
+    surrogate->points = NULL;
+    surrogate->count = 0U;
+    surrogate->capacity = 0U;
+    surrogate->k = k > 0U ? k : 1U;
+}
+
+void surrogate_clear(Surrogate *surrogate) {
+    free(surrogate->points);
+    surrogate->points = NULL;
+    surrogate->count = 0U;
+    surrogate->capacity = 0U;
+}
+
+bool surrogate_add(Surrogate *surrogate, const SurrogateFeatures *features, double score) {
+    if (surrogate->count == surrogate->capacity) {
+        size_t capacity = surrogate->capacity ? surrogate->capacity * 2U : 64U;
+        SurrogatePoint *points =
+            (SurrogatePoint *)realloc(surrogate->points, capacity * sizeof(SurrogatePoint));
+        if (!points) {
+            return false;
+        }
+        surrogate->points = points;
+        surrogate->capacity = capacity;
+    }
+    SurrogatePoint *point = &surrogate->points[surrogate->count++];
+    point->features = *features;
+    point->target = squash(score);
+    return true;
+}
+
+static double feature_distance(const SurrogateFeatures *a, const SurrogateFeatures *b) {
+    double sum = 0.0;
+    for (int i = 0; i < SURROGATE_FEATURE_COUNT; ++i) {
+        double difference = fabs(a->values[i] - b->values[i]);
+        if (i < SURROGATE_CATEGORICAL && difference > 0.0) {
+            difference = 1.0;
+        }
+        difference *= FEATURE_SCALE[i];
+        sum += difference * difference;
+    }
+    return sqrt(sum);
+}
+
+typedef struct {
+    double distance;
+    double target;
+} Neighbour;
+
+// Mean and uncertainty in squashed units.
+static bool predict_squashed(const Surrogate *surrogate, const SurrogateFeatures *features,
+                             double *mean_out, double *uncertainty_out, double *distance_out) {
+    size_t k = surrogate->k;
+    if (surrogate->count < k) {
+        return false;
+    }
+    Neighbour *nearest = (Neighbour *)malloc(k * sizeof(Neighbour));
+    if (!nearest) {
+        return false;
+    }
+    // Insertion into a sorted list of k: the archive is small next to the
+    // cost of a single simulation.
+    size_t found = 0U;
+    for (size_t i = 0; i < surrogate->count; ++i) {
+        double distance = feature_distance(features, &surrogate->points[i].features);
+        if (found == k && distance >= nearest[k - 1U].distance) {
+            continue;
+        }
+        size_t slot = found < k ? found++ : k - 1U;
+        while (slot > 0U && nearest[slot - 1U].distance > distance) {
+            nearest[slot] = nearest[slot - 1U];
+            --slot;
+        }
+        nearest[slot].distance = distance;
+        nearest[slot].target = surrogate->points[i].target;
+    }
+
+    double weight_sum = 0.0, mean = 0.0, distance_sum = 0.0;
+    for (size_t i = 0; i < k; ++i) {
+        double weight = 1.0 / (nearest[i].distance + SURROGATE_DISTANCE_FLOOR);
+        weight_sum += weight;
+        mean += weight * nearest[i].target;
+        distance_sum += nearest[i].distance;
+    }
+    mean /= weight_sum;
+    double spread = 0.0;
+    for (size_t i = 0; i < k; ++i) {
+        double weight = 1.0 / (nearest[i].distance + SURROGATE_DISTANCE_FLOOR);
+        double deviation = nearest[i].target - mean;
+        spread += weight * deviation * deviation;
+    }
+    free(nearest);
+    *distance_out = distance_sum / (double)k;
+    *mean_out = mean;
+    *uncertainty_out = sqrt(spread / weight_sum) + *distance_out;
+    return true;
+}
+
+static void fill_prediction(double mean, double uncertainty, double distance,
+                            SurrogatePrediction *prediction) {
+    prediction->score = unsquash(mean);
+    prediction->lower = unsquash(mean - uncertainty);
+    prediction->upper = unsquash(mean + uncertainty);
+    prediction->distance = distance;
+}
+
+bool surrogate_predict(const Surrogate *surrogate, const SurrogateFeatures *features,
+                       SurrogatePrediction *prediction) {
+    double mean = 0.0, uncertainty = 0.0, distance = 0.0;
+    if (!predict_squashed(surrogate, features, &mean, &uncertainty, &distance)) {
+        return false;
+    }
+    fill_prediction(mean, uncertainty, distance, prediction);
+    return true;
+}
+
+bool surrogate_should_run(const Surrogate *surrogate, const SurrogateFeatures *features,
+                          double cutoff, double kappa, SurrogatePrediction *prediction) {
+    double mean = 0.0, uncertainty = 0.0, distance = 0.0;
+    if (!predict_squashed(surrogate, features, &mean, &uncertainty, &distance)) {
+        return true;
+    }
+    fill_prediction(mean, uncertainty, distance, prediction);
+    return mean + kappa * uncertainty >= squash(cutoff);
+}
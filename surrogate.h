@@ -0,0 +1,73 @@
+// surrogate.h
+// Nearest-neighbour score surrogate for configuration searches.  Every exact
+// run that has been scored is kept as a point in a small feature space of
+// its configuration (modes, switches, tick count and the magnitudes of the
+// seed numerators and denominators); a new configuration's score is
+// predicted from its k nearest points, together with an uncertainty that
+// grows with their disagreement and with their distance.  The surrogate
+// only decides which configurations are worth simulating: it never stands
+// in for a run's results.
+//
+// Scores are learned through a signed log, so one exceptional score cannot
+// swamp the neighbourhood and -INFINITY (a failed run) stays finite.
+
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "config.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SURROGATE_FEATURE_COUNT 12
+
+typedef struct {
+    double values[SURROGATE_FEATURE_COUNT];
+} SurrogateFeatures;
+
+typedef struct {
+    SurrogateFeatures features;
+    double target;      // squashed score
+} SurrogatePoint;
+
+typedef struct {
+    SurrogatePoint *points;
+    size_t count;
+    size_t capacity;
+    size_t k;
+} Surrogate;
+
+typedef struct {
+    double score;         // predicted score
+    double lower;         // score one uncertainty below and above it
+    double upper;
+    double distance;      // mean distance of the neighbours used
+} SurrogatePrediction;
+
+void surrogate_features(const Config *config, SurrogateFeatures *features);
+
+void surrogate_init(Surrogate *surrogate, size_t k);
+void surrogate_clear(Surrogate *surrogate);
+
+// Learn the exact score of a configuration.
+bool surrogate_add(Surrogate *surrogate, const SurrogateFeatures *features, double score);
+
+// False until the surrogate holds k points.
+bool surrogate_predict(const Surrogate *surrogate, const SurrogateFeatures *features,
+                       SurrogatePrediction *prediction);
+
+// Whether a configuration should be simulated: always while the surrogate
+// cannot predict, otherwise when its predicted score plus kappa
+// uncertainties reaches cutoff.
+bool surrogate_should_run(const Surrogate *surrogate, const SurrogateFeatures *features,
+                          double cutoff, double kappa, SurrogatePrediction *prediction);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SURROGATE_H
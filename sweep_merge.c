@@ -0,0 +1,497 @@
+/*
+ * sweep_merge.c
+ *
+ * A run writes its own binary trace next to the usual CSVs.  At every tick
+ * boundary the simulate_until() hook fingerprints the state; a hit in the
+ * table from a finished run stops the simulation, after which the remaining
+ * rows are read from the source trace and appended to the CSVs and to this
+ * run's trace.  Appending to the trace as well keeps every cached trace
+ * complete, so later runs can merge into merged runs.
+ *
+ * The CSV streams stay open across both halves of the run, and every row,
+ * simulated or inherited, is also handed to a RunAnalyzer in its decoded
+ * form.  A merged run's summary therefore costs no text parsing, and batched
+ * output never has to be drained before the inherited rows are appended.
+ * Summaries cannot simply be carried over from the source run: the inherited
+ * window starts at an arbitrary tick of it, and statistics such as the ratio
+ * extremes and psi spacing depend on the rows on both sides of the join.
+ */
+
+#include "sweep_merge.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "simulate.h"
+
+#define SWEEP_MERGE_INITIAL_BUCKETS 1024U
+
+struct SweepMergeEntry {
+    SweepMergeEntry *next;
+    uint64_t hash;
+    size_t run_id;
+    size_t tick;
+    size_t size;
+    unsigned char data[];
+};
+
+typedef struct {
+    SweepMergeTable *table;
+    size_t run_id;
+    size_t config_id;
+    size_t ticks;
+    int values_radix;
+    TraceBuffer fingerprint;
+    bool merged;
+    size_t source_run;
+    size_t merge_tick;
+    size_t source_tick;
+    TRTS_State stop_state;
+    FILE *events_file;
+    FILE *values_file;
+    RunAnalyzer *analyzer;
+} SweepRunContext;
+
+static uint64_t hash_bytes(uint64_t hash, const unsigned char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= data[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+// Little-endian, so config fingerprints are the same on every host.
+static bool append_u64(TraceBuffer *out, uint64_t value) {
+    unsigned char bytes[8];
+    for (size_t i = 0; i < 8; ++i) {
+        bytes[i] = (unsigned char)(value >> (8U * i));
+    }
+    return trace_buffer_append(out, bytes, sizeof(bytes));
+}
+
+static bool append_mpz(TraceBuffer *out, mpz_srcptr value) {
+    const unsigned char sign = (unsigned char)(mpz_sgn(value) + 1);
+    const size_t length = mpz_sgn(value) == 0 ? 0U : (mpz_sizeinbase(value, 2) + 7U) / 8U;
+    if (!trace_buffer_append(out, &sign, 1U) || !append_u64(out, (uint64_t)length)) {
+        return false;
+    }
+    const size_t offset = out->size;
+    for (size_t i = 0; i < length; ++i) {
+        const unsigned char zero = 0U;
+        if (!trace_buffer_append(out, &zero, 1U)) {
+            return false;
+        }
+    }
+    if (length > 0U) {
+        mpz_export(out->data + offset, NULL, 1, 1, 0, 0, value);
+    }
+    return true;
+}
+
+bool sweep_merge_state_fingerprint(const TRTS_State *state, TraceBuffer *out) {
+    mpq_ptr rationals[STATE_RATIONAL_COUNT];
+    state_rationals((TRTS_State *)state, rationals);
+    for (size_t i = 0; i < STATE_RATIONAL_COUNT; ++i) {
+        if (!append_mpz(out, mpq_numref(rationals[i])) ||
+            !append_mpz(out, mpq_denref(rationals[i]))) {
+            return false;
+        }
+    }
+    const unsigned int flag_bits = state_flag_bits(state);
+    return trace_buffer_append(out, &state->koppa_stack_size, sizeof(state->koppa_stack_size)) &&
+           trace_buffer_append(out, &state->koppa_sample_index,
+                               sizeof(state->koppa_sample_index)) &&
+           trace_buffer_append(out, &flag_bits, sizeof(flag_bits)) &&
+           trace_buffer_append(out, &state->tick, sizeof(state->tick));
+}
+
+bool sweep_merge_config_fingerprint(const Config *config, TraceBuffer *out) {
+    const unsigned char modes[] = {
+        (unsigned char)config->psi_mode,           (unsigned char)config->koppa_mode,
+        (unsigned char)config->engine_mode,        (unsigned char)config->engine_upsilon,
+        (unsigned char)config->engine_beta,        (unsigned char)config->koppa_trigger,
+        (unsigned char)config->prime_target,       (unsigned char)config->mt10_behavior,
+        (unsigned char)config->ratio_trigger_mode, (unsigned char)config->sign_flip_mode};
+    const unsigned char toggles[] = {config->dual_track_mode,
+                                     config->triple_psi_mode,
+                                     config->multi_level_koppa,
+                                     config->enable_asymmetric_cascade,
+                                     config->enable_conditional_triple_psi,
+                                     config->enable_koppa_gated_engine,
+                                     config->enable_delta_cross_propagation,
+                                     config->enable_delta_koppa_offset,
+                                     config->enable_ratio_threshold_psi,
+                                     config->enable_stack_depth_modes,
+                                     config->enable_epsilon_phi_triangle,
+                                     config->enable_sign_flip,
+                                     config->enable_modular_wrap,
+                                     config->enable_psi_strength_parameter,
+                                     config->enable_ratio_snapshot_logging,
+                                     config->enable_feedback_oscillator,
+                                     config->enable_fibonacci_gate,
+                                     config->enable_ratio_custom_range,
+                                     config->enable_twin_prime_trigger,
+                                     config->enable_fibonacci_trigger,
+                                     config->enable_perfect_power_trigger};
+    return trace_buffer_append(out, modes, sizeof(modes)) &&
+           trace_buffer_append(out, toggles, sizeof(toggles)) &&
+           append_u64(out, (uint64_t)config->koppa_wrap_threshold) &&
+           append_u64(out, (uint64_t)config->koppa_gate_slide_below) &&
+           append_u64(out, (uint64_t)config->koppa_gate_multi_below) &&
+           append_mpz(out, mpq_numref(config->ratio_custom_lower)) &&
+           append_mpz(out, mpq_denref(config->ratio_custom_lower)) &&
+           append_mpz(out, mpq_numref(config->ratio_custom_upper)) &&
+           append_mpz(out, mpq_denref(config->ratio_custom_upper)) &&
+           append_mpz(out, config->modulus_bound);
+}
+
+bool sweep_merge_init(SweepMergeTable *table, const char *cache_dir, size_t byte_budget) {
+    memset(table, 0, sizeof(*table));
+    snprintf(table->cache_dir, sizeof(table->cache_dir), "%s", cache_dir ? cache_dir : ".");
+    if (mkdir(table->cache_dir, 0777) != 0 && errno != EEXIST) {
+        perror(table->cache_dir);
+        return false;
+    }
+    table->buckets = (SweepMergeEntry **)calloc(SWEEP_MERGE_INITIAL_BUCKETS,
+                                                sizeof(SweepMergeEntry *));
+    if (!table->buckets) {
+        return false;
+    }
+    table->bucket_count = SWEEP_MERGE_INITIAL_BUCKETS;
+    table->byte_budget = byte_budget;
+    return true;
+}
+
+static void run_trace_path(const SweepMergeTable *table, size_t run_id, char *path,
+                           size_t capacity) {
+    snprintf(path, capacity, "%s/run_%zu.trace", table->cache_dir, run_id);
+}
+
+void sweep_merge_clear(SweepMergeTable *table) {
+    for (size_t i = 0; i < table->bucket_count; ++i) {
+        SweepMergeEntry *entry = table->buckets[i];
+        while (entry) {
+            SweepMergeEntry *next = entry->next;
+            free(entry);
+            entry = next;
+        }
+    }
+    free(table->buckets);
+    for (size_t i = 0; i < table->run_count; ++i) {
+        char path[640];
+        run_trace_path(table, i, path, sizeof(path));
+        remove(path);
+    }
+    free(table->runs);
+    for (size_t i = 0; i < table->config_count; ++i) {
+        trace_buffer_clear(&table->configs[i]);
+    }
+    free(table->configs);
+    memset(table, 0, sizeof(*table));
+}
+
+static bool intern_config(SweepMergeTable *table, const Config *config, size_t *config_id) {
+    TraceBuffer fingerprint;
+    trace_buffer_init(&fingerprint);
+    if (!sweep_merge_config_fingerprint(config, &fingerprint)) {
+        trace_buffer_clear(&fingerprint);
+        return false;
+    }
+    for (size_t i = 0; i < table->config_count; ++i) {
+        if (table->configs[i].size == fingerprint.size &&
+            memcmp(table->configs[i].data, fingerprint.data, fingerprint.size) == 0) {
+            trace_buffer_clear(&fingerprint);
+            *config_id = i;
+            return true;
+        }
+    }
+    if (table->config_count == table->config_capacity) {
+        size_t capacity = table->config_capacity ? table->config_capacity * 2U : 16U;
+        TraceBuffer *configs =
+            (TraceBuffer *)realloc(table->configs, capacity * sizeof(TraceBuffer));
+        if (!configs) {
+            trace_buffer_clear(&fingerprint);
+            return false;
+        }
+        table->configs = configs;
+        table->config_capacity = capacity;
+    }
+    table->configs[table->config_count] = fingerprint;
+    *config_id = table->config_count++;
+    return true;
+}
+
+static bool add_run(SweepMergeTable *table, size_t ticks, size_t config_id, size_t *run_id) {
+    if (table->run_count == table->run_capacity) {
+        size_t capacity = table->run_capacity ? table->run_capacity * 2U : 64U;
+        SweepMergeRun *runs =
+            (SweepMergeRun *)realloc(table->runs, capacity * sizeof(SweepMergeRun));
+        if (!runs) {
+            return false;
+        }
+        table->runs = runs;
+        table->run_capacity = capacity;
+    }
+    SweepMergeRun *run = &table->runs[table->run_count];
+    run->ticks = ticks;
+    run->config_id = config_id;
+    run->complete = false;
+    *run_id = table->run_count++;
+    return true;
+}
+
+static void grow_buckets(SweepMergeTable *table) {
+    size_t bucket_count = table->bucket_count * 2U;
+    SweepMergeEntry **buckets = (SweepMergeEntry **)calloc(bucket_count, sizeof(SweepMergeEntry *));
+    if (!buckets) {
+        return;
+    }
+    for (size_t i = 0; i < table->bucket_count; ++i) {
+        SweepMergeEntry *entry = table->buckets[i];
+        while (entry) {
+            SweepMergeEntry *next = entry->next;
+            size_t index = (size_t)(entry->hash & (bucket_count - 1U));
+            entry->next = buckets[index];
+            buckets[index] = entry;
+            entry = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = buckets;
+    table->bucket_count = bucket_count;
+}
+
+static void publish(SweepMergeTable *table, uint64_t hash, size_t run_id, size_t tick,
+                    const TraceBuffer *fingerprint) {
+    const size_t bytes = sizeof(SweepMergeEntry) + fingerprint->size;
+    if (table->byte_budget > 0U && table->bytes_in_use + bytes > table->byte_budget) {
+        return;
+    }
+    SweepMergeEntry *entry = (SweepMergeEntry *)malloc(bytes);
+    if (!entry) {
+        return;
+    }
+    entry->hash = hash;
+    entry->run_id = run_id;
+    entry->tick = tick;
+    entry->size = fingerprint->size;
+    memcpy(entry->data, fingerprint->data, fingerprint->size);
+    size_t index = (size_t)(hash & (table->bucket_count - 1U));
+    entry->next = table->buckets[index];
+    table->buckets[index] = entry;
+    table->bytes_in_use += bytes;
+    if (++table->entry_count > table->bucket_count) {
+        grow_buckets(table);
+    }
+}
+
+// A source must be a finished run of the same effective configuration whose
+// trace still holds every tick this run has left.
+static const SweepMergeEntry *find_source(const SweepMergeTable *table,
+                                          const SweepRunContext *context, uint64_t hash,
+                                          size_t tick) {
+    const SweepMergeEntry *entry = table->buckets[hash & (table->bucket_count - 1U)];
+    for (; entry; entry = entry->next) {
+        const SweepMergeRun *run = &table->runs[entry->run_id];
+        if (entry->hash == hash && run->complete && run->config_id == context->config_id &&
+            entry->tick + (context->ticks - tick) <= run->ticks &&
+            entry->size == context->fingerprint.size &&
+            memcmp(entry->data, context->fingerprint.data, entry->size) == 0) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static bool merge_tick_hook(void *user_data, size_t tick, const TRTS_State *state) {
+    SweepRunContext *context = (SweepRunContext *)user_data;
+    trace_buffer_reset(&context->fingerprint);
+    if (!sweep_merge_state_fingerprint(state, &context->fingerprint)) {
+        return true;
+    }
+    uint64_t hash = hash_bytes(0xCBF29CE484222325ULL, context->fingerprint.data,
+                               context->fingerprint.size);
+    hash = hash_bytes(hash, (const unsigned char *)&context->config_id,
+                      sizeof(context->config_id));
+
+    const SweepMergeEntry *source = find_source(context->table, context, hash, tick);
+    if (source) {
+        context->merged = true;
+        context->source_run = source->run_id;
+        context->merge_tick = tick;
+        context->source_tick = source->tick;
+        state_copy(&context->stop_state, state);
+        return false;
+    }
+    publish(context->table, hash, context->run_id, tick, &context->fingerprint);
+    return true;
+}
+
+static void merge_observer(void *user_data, size_t tick, int microtick, char phase,
+                           const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
+                           bool forced_emission) {
+    SweepRunContext *context = (SweepRunContext *)user_data;
+    if (context->events_file) {
+        simulate_write_events_row(context->events_file, tick, microtick, phase, state, rho_event,
+                                  psi_fired, mu_zero, forced_emission);
+    }
+    if (context->values_file) {
+        simulate_write_values_row(context->values_file, tick, microtick, state,
+                                  context->values_radix);
+    }
+    if (context->analyzer) {
+        run_analyzer_observer(context->analyzer, tick, microtick, phase, state, rho_event,
+                              psi_fired, mu_zero, forced_emission);
+    }
+}
+
+static int64_t file_size(const char *path) {
+    struct stat info;
+    return stat(path, &info) == 0 ? (int64_t)info.st_size : -1;
+}
+
+// Copy ticks source_tick+1 .. source_tick+(ticks-merge_tick) of the source
+// trace into the CSVs, the analyzer and this run's trace, shifted onto this
+// run's ticks.
+static bool inherit_rows(const SweepMergeTable *table, const SweepRunContext *context,
+                         const char *trace_path) {
+    char source_path[640];
+    run_trace_path(table, context->source_run, source_path, sizeof(source_path));
+    const size_t last_tick = context->source_tick + (context->ticks - context->merge_tick);
+    const int64_t trace_bytes = file_size(trace_path);
+    if (trace_bytes < 0) {
+        return false;
+    }
+
+    TraceReader reader;
+    if (!trace_reader_open(&reader, source_path)) {
+        return false;
+    }
+    TraceWriter writer;
+    if (!trace_writer_resume(&writer, trace_path, (uint64_t)trace_bytes,
+                             (uint64_t)context->merge_tick * 11U, &context->stop_state)) {
+        trace_reader_close(&reader);
+        return false;
+    }
+    bool ok = true;
+    TraceRow shifted;
+    const TraceRow *row = NULL;
+    while (ok && trace_reader_next(&reader, &row)) {
+        if (row->tick <= context->source_tick) {
+            continue;
+        }
+        if (row->tick > last_tick) {
+            break;
+        }
+        // A shallow copy: only the tick differs, the limbs are shared.
+        shifted = *row;
+        shifted.tick = row->tick - context->source_tick + context->merge_tick;
+        if (context->events_file) {
+            trace_row_write_events_csv(context->events_file, &shifted);
+        }
+        if (context->values_file) {
+            trace_row_write_values_csv(context->values_file, &shifted, context->values_radix);
+        }
+        if (context->analyzer) {
+            run_analyzer_add_row(context->analyzer, &shifted);
+        }
+        ok = trace_writer_append_row(&writer, &shifted);
+    }
+    ok = ok && !trace_reader_error(&reader) && writer.rows_written == context->ticks * 11U;
+    ok = trace_writer_close(&writer) && ok;
+    trace_reader_close(&reader);
+    return ok;
+}
+
+// A fresh CSV with its header, through the batch when there is one.
+static FILE *open_csv(const SweepMergeTable *table, const char *path) {
+    FILE *file = table->batch ? batch_output_open(table->batch, path) : fopen(path, "w");
+    if (!file) {
+        perror(path);
+    }
+    return file;
+}
+
+static bool close_csv(FILE *file, const char *path) {
+    if (file && fclose(file) != 0) {
+        perror(path);
+        return false;
+    }
+    return true;
+}
+
+bool sweep_merge_simulate(SweepMergeTable *table, const Config *config, const char *events_path,
+                          const char *values_path, RunSummary *summary,
+                          SweepProvenance *provenance) {
+    SweepRunContext context;
+    memset(&context, 0, sizeof(context));
+    context.table = table;
+    context.ticks = config->ticks;
+    context.values_radix = config->values_radix;
+    if (!intern_config(table, config, &context.config_id) ||
+        !add_run(table, config->ticks, context.config_id, &context.run_id)) {
+        return false;
+    }
+    trace_buffer_init(&context.fingerprint);
+    state_init(&context.stop_state);
+    RunAnalyzer analyzer;
+    if (summary) {
+        run_analyzer_init(&analyzer, summary);
+        context.analyzer = &analyzer;
+    }
+
+    bool ok = true;
+    if (events_path) {
+        context.events_file = open_csv(table, events_path);
+        ok = context.events_file != NULL;
+        if (ok) {
+            simulate_write_events_header(context.events_file);
+        }
+    }
+    if (ok && values_path) {
+        context.values_file = open_csv(table, values_path);
+        ok = context.values_file != NULL;
+        if (ok) {
+            simulate_write_values_header_radix(context.values_file, config->values_radix);
+        }
+    }
+
+    char trace_path[640];
+    run_trace_path(table, context.run_id, trace_path, sizeof(trace_path));
+    if (ok) {
+        SimulateFiles files = {NULL, NULL, trace_path, NULL};
+        SimulateStatus status =
+            simulate_until(config, &files, merge_observer, &context, merge_tick_hook, &context);
+        ok = status == SIMULATE_COMPLETED || status == SIMULATE_STOPPED;
+        if (ok && status == SIMULATE_STOPPED) {
+            ok = inherit_rows(table, &context, trace_path);
+            if (ok) {
+                table->merged_runs += 1U;
+                table->ticks_skipped += context.ticks - context.merge_tick;
+            }
+        }
+    }
+    ok = close_csv(context.events_file, events_path) && ok;
+    ok = close_csv(context.values_file, values_path) && ok;
+    table->runs[context.run_id].complete = ok;
+
+    if (summary) {
+        if (ok) {
+            run_analyzer_finish(&analyzer);
+        }
+        run_analyzer_clear(&analyzer);
+    }
+    if (provenance) {
+        provenance->run_id = context.run_id;
+        provenance->merged = ok && context.merged;
+        provenance->source_run = context.source_run;
+        provenance->merge_tick = context.merge_tick;
+        provenance->source_tick = context.source_tick;
+    }
+    state_clear(&context.stop_state);
+    trace_buffer_clear(&context.fingerprint);
+    return ok;
+}
@@ -0,0 +1,93 @@
+// sweep_merge.h
+// Exact trajectory merging for parameter sweeps.  Every run publishes a
+// fingerprint of its full state at each tick boundary, keyed by the parts of
+// the configuration that drive the simulation (everything except the seeds
+// and the tick count).  When a run reaches a state that an earlier run of
+// the same effective configuration already passed through, their futures are
+// identical: the run stops simulating and copies the remaining rows from the
+// earlier run's trace, relabelled to its own ticks.  Candidates found by hash
+// are always confirmed byte-for-byte, so merged output is identical to what
+// a full simulation would have written.
+//
+// Sweeps run sequentially, so the table is not synchronised.
+
+#ifndef SWEEP_MERGE_H
+#define SWEEP_MERGE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "analysis_utils.h"
+#include "batch_output.h"
+#include "config.h"
+#include "trace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct SweepMergeEntry SweepMergeEntry;
+
+typedef struct {
+    size_t ticks;
+    size_t config_id;
+    bool complete;
+} SweepMergeRun;
+
+typedef struct {
+    size_t run_id;
+    bool merged;
+    size_t source_run;
+    // Last tick this run simulated, and the tick of the source run that held
+    // the same state.
+    size_t merge_tick;
+    size_t source_tick;
+} SweepProvenance;
+
+typedef struct {
+    char cache_dir[512];
+    size_t byte_budget;
+    size_t bytes_in_use;
+    SweepMergeEntry **buckets;
+    size_t bucket_count;
+    size_t entry_count;
+    SweepMergeRun *runs;
+    size_t run_count;
+    size_t run_capacity;
+    TraceBuffer *configs;
+    size_t config_count;
+    size_t config_capacity;
+    size_t merged_runs;
+    size_t ticks_skipped;
+    // Optional; when set after init the CSVs are written through it and are
+    // complete once the batch drains.
+    BatchOutput *batch;
+} SweepMergeTable;
+
+// Traces of every run are kept in cache_dir until sweep_merge_clear().  Once
+// byte_budget bytes of fingerprints are held, runs still merge against the
+// table but no longer add to it; 0 means unlimited.
+bool sweep_merge_init(SweepMergeTable *table, const char *cache_dir, size_t byte_budget);
+void sweep_merge_clear(SweepMergeTable *table);
+
+// Replacement for simulate_and_analyze(): writes the run's CSVs to the given
+// paths (either may be NULL), merging with an earlier run when possible, and
+// fills summary (when not NULL) as analyze_latest_run() would from them.
+bool sweep_merge_simulate(SweepMergeTable *table, const Config *config, const char *events_path,
+                          const char *values_path, RunSummary *summary,
+                          SweepProvenance *provenance);
+
+// Append a deterministic byte image of every field of state to out.
+bool sweep_merge_state_fingerprint(const TRTS_State *state, TraceBuffer *out);
+
+// Append everything in config that can influence a step; the seeds only
+// matter through the state and the tick count only bounds the run.  The
+// bytes do not depend on the host, so checkpoints can store them too.
+bool sweep_merge_config_fingerprint(const Config *config, TraceBuffer *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SWEEP_MERGE_H
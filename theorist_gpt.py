@@ -4,12 +4,14 @@
 from __future__ import annotations
 
 import argparse
+import bisect
 import csv
 import json
 import math
 import os
 import sys
-from dataclasses import dataclass, field
+from concurrent.futures import ProcessPoolExecutor
+from dataclasses import asdict, dataclass, field
 from typing import Dict, Iterable, List, Optional, Sequence, Tuple
 
 
@@ -59,6 +61,26 @@ def parse_arguments(argv: Optional[Sequence[str]] = None) -> argparse.Namespace:
         default=None,
         help="Maximum number of hypotheses to report (default: all).",
     )
+    parser.add_argument(
+        "--jobs",
+        type=int,
+        default=os.cpu_count() or 1,
+        help="Worker processes used to ingest run directories (default: all CPUs).",
+    )
+    parser.add_argument(
+        "--digest-cache",
+        metavar="PATH",
+        default=None,
+        help=(
+            "Per-run digest cache keyed by file mtime and size "
+            "(default: <output-dir>/run_digests.json)."
+        ),
+    )
+    parser.add_argument(
+        "--no-cache",
+        action="store_true",
+        help="Re-parse every run and leave the digest cache untouched.",
+    )
     parser.add_argument(
         "paths",
         nargs="*",
@@ -193,52 +215,181 @@ def determine_run_id(base: str, root: str) -> str:
     return os.path.join(os.path.basename(base), rel_path)
 
 
-def gather_run_containers(paths: Sequence[str], include_root: bool) -> Dict[str, RunContainer]:
+def _run_file_handler(filename: str, allow_fingerprint: bool = True):
+    if filename.endswith(".csv"):
+        return _handle_csv
+    if filename.endswith(".json"):
+        return _handle_json
+    if filename.endswith(".log"):
+        return _handle_log
+    if allow_fingerprint and filename.endswith(".fingerprint"):
+        return _handle_fingerprint
+    return None
+
+
+def plan_run_ingestion(paths: Sequence[str], include_root: bool) -> Dict[str, List[str]]:
+    """Map each run id to the files ingest_run should read, in directory walk order.
+
+    Run directories are visited in the order os.walk yields them, followed by
+    the working directory when include_root is set; fingerprint files are
+    only picked up inside run directories."""
     base_directories = [
         os.path.abspath(path)
         for path in paths
         if os.path.exists(path)
     ]
-    containers: Dict[str, RunContainer] = {}
+    plan: Dict[str, List[str]] = {}
 
     for base in base_directories:
         for root, _dirs, files in os.walk(base):
-            run_id = determine_run_id(base, root)
-            container = containers.setdefault(run_id, RunContainer(run_id))
+            run_files = plan.setdefault(determine_run_id(base, root), [])
             for filename in files:
-                path = os.path.join(root, filename)
-                if filename.endswith(".csv"):
-                    _handle_csv(path, container)
-                elif filename.endswith(".json"):
-                    _handle_json(path, container)
-                elif filename.endswith(".log"):
-                    _handle_log(path, container)
-                elif filename.endswith(".fingerprint"):
-                    _handle_fingerprint(path, container)
+                if _run_file_handler(filename):
+                    run_files.append(os.path.join(root, filename))
 
     if include_root:
         root_path = os.getcwd()
-        root_container = containers.setdefault("root", RunContainer("root"))
+        run_files = plan.setdefault("root", [])
         for filename in os.listdir(root_path):
             path = os.path.join(root_path, filename)
             if os.path.isdir(path):
                 continue
-            if filename.endswith(".csv"):
-                _handle_csv(path, root_container)
-            elif filename.endswith(".json"):
-                _handle_json(path, root_container)
-            elif filename.endswith(".log"):
-                _handle_log(path, root_container)
-    return containers
+            if _run_file_handler(filename, allow_fingerprint=False):
+                run_files.append(path)
+    return plan
+
+
+def _file_stamps(files: Sequence[str]) -> List[List[object]]:
+    stamps: List[List[object]] = []
+    for path in files:
+        try:
+            info = os.stat(path)
+        except FileNotFoundError:
+            stamps.append([path, None, None])
+            continue
+        stamps.append([path, info.st_mtime_ns, info.st_size])
+    return stamps
+
+
+def _analysis_to_digest(analysis: RunAnalysis) -> Dict[str, object]:
+    digest = asdict(analysis)
+    # Nothing downstream of analyze_run reads the ratio series; keep only the
+    # tail the convergence value was taken from.
+    digest["ratios"] = analysis.ratios[-5:]
+    return digest
+
+
+def _analysis_from_digest(digest: Dict[str, object]) -> RunAnalysis:
+    fields = dict(digest)
+    for key in ("initial_upsilon", "initial_beta"):
+        value = fields.get(key)
+        fields[key] = RationalValue(**value) if value else None
+    return RunAnalysis(**fields)
+
+
+def ingest_run(run_id: str, files: Sequence[str]) -> Optional[Dict[str, object]]:
+    """Parse one run's files and return its digest, or None when it has no values."""
+    container = RunContainer(run_id)
+    for path in files:
+        handler = _run_file_handler(os.path.basename(path))
+        if handler:
+            handler(path, container)
+    if not container.value_rows:
+        return None
+    return _analysis_to_digest(analyze_run(container))
+
+
+def _ingest_task(task: Tuple[str, List[str]]) -> Optional[Dict[str, object]]:
+    return ingest_run(task[0], task[1])
+
+
+def load_digest_cache(path: Optional[str]) -> Dict[str, Dict[str, object]]:
+    if not path:
+        return {}
+    try:
+        with open(path, "r", encoding="utf-8") as handle:
+            data = json.load(handle)
+    except (FileNotFoundError, json.JSONDecodeError):
+        return {}
+    return data if isinstance(data, dict) else {}
+
+
+def save_digest_cache(path: str, cache: Dict[str, Dict[str, object]]) -> None:
+    directory = os.path.dirname(path)
+    if directory:
+        os.makedirs(directory, exist_ok=True)
+    temp_path = path + ".tmp"
+    with open(temp_path, "w", encoding="utf-8") as handle:
+        json.dump(cache, handle)
+    os.replace(temp_path, path)
+
+
+def ingest_runs(
+    paths: Sequence[str],
+    include_root: bool,
+    jobs: int = 1,
+    cache_path: Optional[str] = None,
+) -> List[RunAnalysis]:
+    """Analyze every run that has value rows, reusing cached digests for runs
+    whose files are unchanged and parsing the rest across worker processes.
+    Results follow the run order of plan_run_ingestion."""
+    plan = plan_run_ingestion(paths, include_root)
+    cache = load_digest_cache(cache_path)
+    digests: Dict[str, Optional[Dict[str, object]]] = {}
+    stamps: Dict[str, List[List[object]]] = {}
+    pending: List[Tuple[str, List[str]]] = []
+
+    for run_id, files in plan.items():
+        stamps[run_id] = _file_stamps(files)
+        cached = cache.get(run_id)
+        if cached is not None and cached.get("files") == stamps[run_id]:
+            digests[run_id] = cached.get("digest")
+        else:
+            pending.append((run_id, files))
+
+    if pending:
+        if jobs > 1 and len(pending) > 1:
+            chunksize = max(1, len(pending) // (jobs * 8))
+            with ProcessPoolExecutor(max_workers=jobs) as executor:
+                results = list(executor.map(_ingest_task, pending, chunksize=chunksize))
+        else:
+            results = [_ingest_task(task) for task in pending]
+        for (run_id, _files), digest in zip(pending, results):
+            digests[run_id] = digest
+
+    if cache_path:
+        save_digest_cache(
+            cache_path,
+            {run_id: {"files": stamps[run_id], "digest": digests[run_id]} for run_id in plan},
+        )
+
+    return [
+        _analysis_from_digest(digests[run_id])
+        for run_id in plan
+        if digests[run_id] is not None
+    ]
 
 
 def _handle_csv(path: str, container: RunContainer) -> None:
     try:
         with open(path, "r", encoding="utf-8") as handle:
+            # values.csv may carry its components in another radix behind a
+            # leading "#radix=N" line; rows are stored in decimal.
+            radix = 10
+            first = handle.readline()
+            if first.startswith("#radix="):
+                radix = int(first[len("#radix="):])
+            else:
+                handle.seek(0)
             reader = csv.DictReader(handle)
             header = reader.fieldnames or []
             if {"upsilon_num", "upsilon_den", "beta_num", "beta_den"}.issubset(header):
+                components = [key for key in header if key.endswith(("_num", "_den"))]
                 for row in reader:
+                    if radix != 10:
+                        for key in components:
+                            if row.get(key):
+                                row[key] = str(int(row[key], radix))
                     container.value_rows.append(dict(row))
             elif {"event_type", "psi_fired", "rho_event"}.issubset(header):
                 for row in reader:
@@ -419,20 +570,38 @@ def _categorize_symmetry(ratios: Sequence[float]) -> str:
 
 
 def cluster_by_convergence(analyses: Sequence[RunAnalysis]) -> List[Tuple[float, List[RunAnalysis]]]:
+    """Greedy clustering: each run joins the earliest-created cluster whose
+    reference value lies within the tolerance, otherwise it founds a new one.
+
+    Cluster references are kept in a sorted index.  Two references are never
+    within the tolerance of each other, so at most two of them can match a
+    value and only the neighbours found by bisection need checking."""
     clusters: List[Tuple[float, List[RunAnalysis]]] = []
     tolerance = 1e-5
+    sorted_refs: List[float] = []
+    sorted_clusters: List[int] = []
     for analysis in analyses:
         value = analysis.convergence_value
         if value is None or value in (math.inf, -math.inf):
             continue
-        placed = False
-        for idx, (ref, members) in enumerate(clusters):
-            if abs(ref - value) < tolerance:
-                members.append(analysis)
-                placed = True
-                break
-        if not placed:
+        if math.isnan(value):
             clusters.append((value, [analysis]))
+            continue
+        chosen: Optional[int] = None
+        position = max(0, bisect.bisect_left(sorted_refs, value - tolerance) - 1)
+        while position < len(sorted_refs) and sorted_refs[position] <= value + tolerance:
+            if abs(sorted_refs[position] - value) < tolerance:
+                index = sorted_clusters[position]
+                if chosen is None or index < chosen:
+                    chosen = index
+            position += 1
+        if chosen is not None:
+            clusters[chosen][1].append(analysis)
+            continue
+        insert_at = bisect.bisect_left(sorted_refs, value)
+        sorted_refs.insert(insert_at, value)
+        sorted_clusters.insert(insert_at, len(clusters))
+        clusters.append((value, [analysis]))
     clusters.sort(key=lambda item: item[0])
     return clusters
 
@@ -737,8 +906,15 @@ def main(argv: Optional[Sequence[str]] = None) -> int:
         os.path.join(os.getcwd(), "phase_maps"),
     ]
     include_root = bool(args.scan_all or not args.paths)
-    containers = gather_run_containers(default_paths, include_root=include_root)
-    analyses = [analyze_run(container) for container in containers.values() if container.value_rows]
+    cache_path = None
+    if not args.no_cache:
+        cache_path = args.digest_cache or os.path.join(args.output_dir, "run_digests.json")
+    analyses = ingest_runs(
+        default_paths,
+        include_root=include_root,
+        jobs=max(1, args.jobs),
+        cache_path=cache_path,
+    )
 
     if not analyses:
         sys.stderr.write("No TRTS data located. Ensure runs have been generated.\n")
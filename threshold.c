@@ -0,0 +1,520 @@
+// threshold.c
+// Interval bookkeeping and the branch queue behind parametric threshold
+// sweeps (see threshold.h).  Branches are replayed from the tick boundary
+// before their fork with simulate_continue(), so only the tick in which a
+// split happened is ever simulated twice.
+
+#include "threshold.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "rational.h"
+#include "simulate.h"
+#include "trace.h"
+
+struct ThresholdPending {
+    ThresholdInterval intervals[THRESHOLD_PARAM_COUNT];
+    size_t branch;
+    size_t parent;
+    size_t fork_tick;
+    int fork_microtick;
+    bool has_snapshot;
+    TRTS_State snapshot;
+    size_t snapshot_tick;
+    uint64_t digest;
+    size_t comparisons;
+    size_t psi_events;
+    size_t rho_events;
+};
+
+static const char *const param_names[THRESHOLD_PARAM_COUNT] = {
+    "ratio_custom_lower", "ratio_custom_upper", "koppa_wrap_threshold",
+    "koppa_gate_slide_below", "koppa_gate_multi_below"};
+
+void threshold_interval_init(ThresholdInterval *interval) {
+    interval->tracked = false;
+    interval->lower_open = false;
+    interval->upper_open = false;
+    rational_init(interval->lower);
+    rational_init(interval->upper);
+}
+
+void threshold_interval_clear(ThresholdInterval *interval) {
+    rational_clear(interval->lower);
+    rational_clear(interval->upper);
+}
+
+static void interval_copy(ThresholdInterval *dest, const ThresholdInterval *src) {
+    dest->tracked = src->tracked;
+    dest->lower_open = src->lower_open;
+    dest->upper_open = src->upper_open;
+    mpq_set(dest->lower, src->lower);
+    mpq_set(dest->upper, src->upper);
+}
+
+const char *threshold_param_name(ThresholdParam param) {
+    return param < THRESHOLD_PARAM_COUNT ? param_names[param] : "unknown";
+}
+
+bool threshold_param_from_name(const char *name, ThresholdParam *param) {
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        if (strcmp(name, param_names[i]) == 0) {
+            *param = (ThresholdParam)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool threshold_param_integral(ThresholdParam param) {
+    return param != THRESHOLD_RATIO_CUSTOM_LOWER && param != THRESHOLD_RATIO_CUSTOM_UPPER;
+}
+
+// "n" or "n/d" with d > 0, kept exactly as written.
+static bool parse_bound(const char *text, size_t length, bool integral, mpq_t value) {
+    char buffer[256];
+    if (length == 0U || length >= sizeof(buffer)) {
+        return false;
+    }
+    memcpy(buffer, text, length);
+    buffer[length] = '\0';
+    char *slash = strchr(buffer, '/');
+    if (slash) {
+        *slash = '\0';
+    }
+    if (mpz_set_str(mpq_numref(value), buffer, 10) != 0) {
+        return false;
+    }
+    if (!slash) {
+        mpz_set_ui(mpq_denref(value), 1UL);
+    } else if (integral || mpz_set_str(mpq_denref(value), slash + 1, 10) != 0 ||
+               mpz_sgn(mpq_denref(value)) <= 0) {
+        return false;
+    }
+    return !integral || (mpz_sgn(mpq_numref(value)) >= 0 && mpz_fits_ulong_p(mpq_numref(value)));
+}
+
+bool threshold_interval_parse(ThresholdParam param, const char *text,
+                              ThresholdInterval *interval) {
+    const char *colon = strchr(text, ':');
+    bool integral = threshold_param_integral(param);
+    if (!colon || !parse_bound(text, (size_t)(colon - text), integral, interval->lower) ||
+        !parse_bound(colon + 1, strlen(colon + 1), integral, interval->upper) ||
+        mpq_cmp(interval->lower, interval->upper) > 0) {
+        return false;
+    }
+    interval->tracked = true;
+    interval->lower_open = false;
+    interval->upper_open = false;
+    return true;
+}
+
+static bool interval_empty(const ThresholdInterval *interval) {
+    int order = mpq_cmp(interval->lower, interval->upper);
+    return order > 0 || (order == 0 && (interval->lower_open || interval->upper_open));
+}
+
+// Intersect interval with p > bound / p >= bound (lower) or p < bound /
+// p <= bound (upper).  Integer intervals round the bound inwards and stay
+// closed.
+static void restrict_interval(ThresholdInterval *interval, mpq_srcptr bound, bool lower,
+                              bool open, bool integral, mpq_t scratch) {
+    if (integral) {
+        if (lower) {
+            if (open) {
+                mpz_fdiv_q(mpq_numref(scratch), mpq_numref(bound), mpq_denref(bound));
+                mpz_add_ui(mpq_numref(scratch), mpq_numref(scratch), 1UL);
+            } else {
+                mpz_cdiv_q(mpq_numref(scratch), mpq_numref(bound), mpq_denref(bound));
+            }
+        } else if (open) {
+            mpz_cdiv_q(mpq_numref(scratch), mpq_numref(bound), mpq_denref(bound));
+            mpz_sub_ui(mpq_numref(scratch), mpq_numref(scratch), 1UL);
+        } else {
+            mpz_fdiv_q(mpq_numref(scratch), mpq_numref(bound), mpq_denref(bound));
+        }
+        mpz_set_ui(mpq_denref(scratch), 1UL);
+        bound = scratch;
+        open = false;
+    }
+    if (lower) {
+        int order = mpq_cmp(bound, interval->lower);
+        if (order > 0 || (order == 0 && open)) {
+            mpq_set(interval->lower, bound);
+            interval->lower_open = open;
+        }
+    } else {
+        int order = mpq_cmp(bound, interval->upper);
+        if (order < 0 || (order == 0 && open)) {
+            mpq_set(interval->upper, bound);
+            interval->upper_open = open;
+        }
+    }
+}
+
+// The value a branch runs with: the midpoint of its interval, rounded down
+// for integer parameters.  Any interior point would do; the midpoint keeps
+// it away from the bounds that later splits carve.
+static void interval_midpoint(const ThresholdInterval *interval, bool integral, mpq_t value) {
+    mpq_add(value, interval->lower, interval->upper);
+    if (integral) {
+        mpz_fdiv_q_2exp(mpq_numref(value), mpq_numref(value), 1UL);
+    } else {
+        mpq_div_2exp(value, value, 1UL);
+    }
+}
+
+static void read_param(const Config *config, ThresholdParam param, mpq_t value) {
+    switch (param) {
+    case THRESHOLD_RATIO_CUSTOM_LOWER:
+        mpq_set(value, config->ratio_custom_lower);
+        break;
+    case THRESHOLD_RATIO_CUSTOM_UPPER:
+        mpq_set(value, config->ratio_custom_upper);
+        break;
+    case THRESHOLD_KOPPA_WRAP:
+        mpq_set_ui(value, config->koppa_wrap_threshold, 1UL);
+        break;
+    case THRESHOLD_KOPPA_GATE_SLIDE:
+        mpq_set_ui(value, config->koppa_gate_slide_below, 1UL);
+        break;
+    case THRESHOLD_KOPPA_GATE_MULTI:
+        mpq_set_ui(value, config->koppa_gate_multi_below, 1UL);
+        break;
+    default:
+        break;
+    }
+}
+
+// Integer values are in range: intervals never leave the parsed bounds.
+static void write_param(Config *config, ThresholdParam param, mpq_srcptr value) {
+    switch (param) {
+    case THRESHOLD_RATIO_CUSTOM_LOWER:
+        mpq_set(config->ratio_custom_lower, value);
+        break;
+    case THRESHOLD_RATIO_CUSTOM_UPPER:
+        mpq_set(config->ratio_custom_upper, value);
+        break;
+    case THRESHOLD_KOPPA_WRAP:
+        config->koppa_wrap_threshold = mpz_get_ui(mpq_numref(value));
+        break;
+    case THRESHOLD_KOPPA_GATE_SLIDE:
+        config->koppa_gate_slide_below = mpz_get_ui(mpq_numref(value));
+        break;
+    case THRESHOLD_KOPPA_GATE_MULTI:
+        config->koppa_gate_multi_below = mpz_get_ui(mpq_numref(value));
+        break;
+    default:
+        break;
+    }
+}
+
+static ThresholdPending *pending_new(void) {
+    ThresholdPending *pending = (ThresholdPending *)malloc(sizeof(ThresholdPending));
+    if (!pending) {
+        return NULL;
+    }
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        threshold_interval_init(&pending->intervals[i]);
+    }
+    state_init(&pending->snapshot);
+    pending->has_snapshot = false;
+    pending->snapshot_tick = 0U;
+    return pending;
+}
+
+static void pending_free(ThresholdPending *pending) {
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        threshold_interval_clear(&pending->intervals[i]);
+    }
+    state_clear(&pending->snapshot);
+    free(pending);
+}
+
+static bool pending_push(ThresholdTracker *tracker, ThresholdPending *pending) {
+    if (tracker->pending_count == tracker->pending_capacity) {
+        size_t capacity = tracker->pending_capacity ? tracker->pending_capacity * 2U : 16U;
+        ThresholdPending **grown = (ThresholdPending **)realloc(
+            tracker->pending, capacity * sizeof(ThresholdPending *));
+        if (!grown) {
+            return false;
+        }
+        tracker->pending = grown;
+        tracker->pending_capacity = capacity;
+    }
+    tracker->pending[tracker->pending_count++] = pending;
+    return true;
+}
+
+// Queue the current branch with intervals[param] replaced by other, to be
+// replayed from the last tick boundary.
+static void fork_branch(ThresholdTracker *tracker, ThresholdParam param,
+                        const ThresholdInterval *other) {
+    ThresholdPending *pending = pending_new();
+    if (!pending) {
+        tracker->failed = true;
+        return;
+    }
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        interval_copy(&pending->intervals[i],
+                      i == (int)param ? other : &tracker->intervals[i]);
+    }
+    pending->branch = tracker->next_branch++;
+    pending->parent = tracker->branch;
+    // Comparisons happen inside the microtick after the last one observed.
+    pending->fork_tick = tracker->last_tick;
+    pending->fork_microtick = tracker->last_microtick + 1;
+    if (pending->fork_microtick > 11) {
+        pending->fork_tick += 1U;
+        pending->fork_microtick = 1;
+    }
+    pending->has_snapshot = tracker->has_snapshot;
+    if (tracker->has_snapshot) {
+        state_copy(&pending->snapshot, &tracker->snapshot);
+    }
+    pending->snapshot_tick = tracker->snapshot_tick;
+    pending->digest = tracker->snapshot_digest;
+    pending->comparisons = tracker->snapshot_comparisons;
+    pending->psi_events = tracker->snapshot_psi;
+    pending->rho_events = tracker->snapshot_rho;
+    if (!pending_push(tracker, pending)) {
+        pending_free(pending);
+        tracker->failed = true;
+    }
+}
+
+void threshold_record(ThresholdTracker *tracker, ThresholdParam param,
+                      ThresholdRelation relation, mpq_srcptr value, bool outcome) {
+    ThresholdInterval *interval = &tracker->intervals[param];
+    if (!interval->tracked || tracker->failed) {
+        return;
+    }
+    tracker->comparisons += 1U;
+    bool integral = threshold_param_integral(param);
+    // The values answering the other way: p < v came out true, so p >= v;
+    // false, so p < v; and likewise for p > v.
+    bool other_lower = (relation == THRESHOLD_BELOW) == outcome;
+    ThresholdInterval other;
+    threshold_interval_init(&other);
+    interval_copy(&other, interval);
+    restrict_interval(&other, value, other_lower, !outcome, integral, tracker->bound);
+    if (!interval_empty(&other)) {
+        fork_branch(tracker, param, &other);
+    }
+    threshold_interval_clear(&other);
+    restrict_interval(interval, value, !other_lower, outcome, integral, tracker->bound);
+}
+
+void threshold_record_z(ThresholdTracker *tracker, ThresholdParam param,
+                        ThresholdRelation relation, mpz_srcptr value, bool outcome) {
+    if (!tracker->intervals[param].tracked) {
+        return;
+    }
+    mpz_abs(mpq_numref(tracker->magnitude), value);
+    mpz_set_ui(mpq_denref(tracker->magnitude), 1UL);
+    threshold_record(tracker, param, relation, tracker->magnitude, outcome);
+}
+
+/* ===========================================================
+   SWEEP
+   =========================================================== */
+
+static uint64_t fold_bytes(uint64_t digest, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < size; ++i) {
+        digest ^= bytes[i];
+        digest *= 0x100000001B3ULL;
+    }
+    return digest;
+}
+
+static uint64_t fold_state(uint64_t digest, const TRTS_State *state) {
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    trace_state_components(state, components);
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        int sign = mpz_sgn(components[i]);
+        size_t limbs = mpz_size(components[i]);
+        digest = fold_bytes(digest, &sign, sizeof(sign));
+        digest = fold_bytes(digest, &limbs, sizeof(limbs));
+        for (size_t limb = 0; limb < limbs; ++limb) {
+            mp_limb_t value = mpz_getlimbn(components[i], (mp_size_t)limb);
+            digest = fold_bytes(digest, &value, sizeof(value));
+        }
+    }
+    return digest;
+}
+
+static void sweep_observer(void *user_data, size_t tick, int microtick, char phase,
+                           const TRTS_State *state, bool rho_event, bool psi_fired,
+                           bool mu_zero, bool forced_emission) {
+    (void)phase;
+    ThresholdTracker *tracker = (ThresholdTracker *)user_data;
+    unsigned int flags = trace_flags_from_state(state, rho_event, psi_fired, mu_zero,
+                                                forced_emission);
+    tracker->digest = fold_bytes(tracker->digest, &flags, sizeof(flags));
+    tracker->digest = fold_state(tracker->digest, state);
+    tracker->psi_events += psi_fired ? 1U : 0U;
+    tracker->rho_events += rho_event ? 1U : 0U;
+    tracker->last_tick = tick;
+    tracker->last_microtick = microtick;
+}
+
+static bool sweep_tick_hook(void *user_data, size_t tick, const TRTS_State *state) {
+    ThresholdTracker *tracker = (ThresholdTracker *)user_data;
+    state_copy(&tracker->snapshot, state);
+    tracker->has_snapshot = true;
+    tracker->snapshot_tick = tick;
+    tracker->snapshot_digest = tracker->digest;
+    tracker->snapshot_comparisons = tracker->comparisons;
+    tracker->snapshot_psi = tracker->psi_events;
+    tracker->snapshot_rho = tracker->rho_events;
+    return true;
+}
+
+static int compare_digests(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a;
+    uint64_t right = *(const uint64_t *)b;
+    return left < right ? -1 : (left > right ? 1 : 0);
+}
+
+static void report(ThresholdSink sink, void *user_data, const ThresholdPending *pending,
+                   const ThresholdTracker *tracker, mpq_t *values, bool explored) {
+    ThresholdBranch branch;
+    branch.branch = pending->branch;
+    branch.parent = pending->parent;
+    branch.fork_tick = pending->fork_tick;
+    branch.fork_microtick = pending->fork_microtick;
+    branch.explored = explored;
+    branch.intervals = explored ? tracker->intervals : pending->intervals;
+    branch.values = values;
+    branch.comparisons = explored ? tracker->comparisons : 0U;
+    branch.psi_events = explored ? tracker->psi_events : 0U;
+    branch.rho_events = explored ? tracker->rho_events : 0U;
+    branch.digest = explored ? tracker->digest : 0U;
+    sink(user_data, &branch);
+}
+
+bool threshold_sweep(Config *config, const ThresholdInterval ranges[THRESHOLD_PARAM_COUNT],
+                     size_t max_branches, ThresholdSink sink, void *user_data,
+                     ThresholdSummary *summary) {
+    ThresholdTracker tracker;
+    memset(&tracker, 0, sizeof(tracker));
+    mpq_t saved[THRESHOLD_PARAM_COUNT];
+    mpq_t values[THRESHOLD_PARAM_COUNT];
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        threshold_interval_init(&tracker.intervals[i]);
+        rational_init(saved[i]);
+        rational_init(values[i]);
+        read_param(config, (ThresholdParam)i, saved[i]);
+    }
+    state_init(&tracker.snapshot);
+    rational_init(tracker.bound);
+    rational_init(tracker.magnitude);
+    tracker.branch = SIZE_MAX;
+    memset(summary, 0, sizeof(*summary));
+    uint64_t *digests = NULL;
+
+    ThresholdPending *root = pending_new();
+    if (!root || !pending_push(&tracker, root)) {
+        if (root) {
+            pending_free(root);
+        }
+        tracker.failed = true;
+    } else {
+        for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+            interval_copy(&root->intervals[i], &ranges[i]);
+        }
+        root->branch = tracker.next_branch++;
+        root->parent = SIZE_MAX;
+        root->fork_tick = 0U;
+        root->fork_microtick = 0;
+        root->digest = 0xCBF29CE484222325ULL;
+        root->comparisons = 0U;
+        root->psi_events = 0U;
+        root->rho_events = 0U;
+    }
+
+    // Depth first, so the queue holds one sibling per split on the path.
+    while (tracker.pending_count > 0U && !tracker.failed) {
+        ThresholdPending *pending = tracker.pending[--tracker.pending_count];
+        for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+            if (pending->intervals[i].tracked) {
+                interval_midpoint(&pending->intervals[i], threshold_param_integral(i),
+                                  values[i]);
+            } else {
+                mpq_set(values[i], saved[i]);
+            }
+        }
+        if (max_branches > 0U && summary->explored == max_branches) {
+            report(sink, user_data, pending, &tracker, values, false);
+            summary->unexplored += 1U;
+            pending_free(pending);
+            continue;
+        }
+        uint64_t *grown = (uint64_t *)realloc(digests,
+                                              (summary->explored + 1U) * sizeof(uint64_t));
+        if (!grown) {
+            pending_free(pending);
+            tracker.failed = true;
+            break;
+        }
+        digests = grown;
+
+        for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+            interval_copy(&tracker.intervals[i], &pending->intervals[i]);
+            write_param(config, (ThresholdParam)i, values[i]);
+        }
+        tracker.branch = pending->branch;
+        tracker.comparisons = pending->comparisons;
+        tracker.has_snapshot = pending->has_snapshot;
+        if (pending->has_snapshot) {
+            state_copy(&tracker.snapshot, &pending->snapshot);
+        }
+        tracker.snapshot_tick = pending->snapshot_tick;
+        tracker.snapshot_digest = pending->digest;
+        tracker.snapshot_comparisons = pending->comparisons;
+        tracker.snapshot_psi = pending->psi_events;
+        tracker.snapshot_rho = pending->rho_events;
+        tracker.last_tick = pending->snapshot_tick;
+        tracker.last_microtick = 11;
+        tracker.digest = pending->digest;
+        tracker.psi_events = pending->psi_events;
+        tracker.rho_events = pending->rho_events;
+
+        config->threshold_tracker = &tracker;
+        simulate_continue(config, pending->has_snapshot ? &pending->snapshot : NULL,
+                          pending->snapshot_tick, 11, sweep_observer, &tracker,
+                          sweep_tick_hook, &tracker);
+        config->threshold_tracker = NULL;
+
+        if (!tracker.failed) {
+            report(sink, user_data, pending, &tracker, values, true);
+            digests[summary->explored++] = tracker.digest;
+        }
+        pending_free(pending);
+    }
+
+    if (summary->explored > 0U) {
+        qsort(digests, summary->explored, sizeof(uint64_t), compare_digests);
+        summary->distinct = 1U;
+        for (size_t i = 1; i < summary->explored; ++i) {
+            summary->distinct += digests[i] != digests[i - 1U] ? 1U : 0U;
+        }
+    }
+    free(digests);
+    for (size_t i = 0; i < tracker.pending_count; ++i) {
+        pending_free(tracker.pending[i]);
+    }
+    free(tracker.pending);
+    for (int i = 0; i < THRESHOLD_PARAM_COUNT; ++i) {
+        write_param(config, (ThresholdParam)i, saved[i]);
+        threshold_interval_clear(&tracker.intervals[i]);
+        rational_clear(saved[i]);
+        rational_clear(values[i]);
+    }
+    state_clear(&tracker.snapshot);
+    rational_clear(tracker.bound);
+    rational_clear(tracker.magnitude);
+    return !tracker.failed;
+}
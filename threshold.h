@@ -0,0 +1,145 @@
+// threshold.h
+// Parametric runs over the engine's comparison thresholds.  A trajectory
+// depends on ratio_custom_lower/upper, koppa_wrap_threshold and the koppa
+// gate bands only through the outcomes of comparisons against them, so a
+// run can carry, for each swept parameter, the exact interval of values
+// that agree with every comparison made so far.  Comparisons that every
+// value in the interval answers alike only narrow it; a comparison that
+// would split it forks the run: the current branch keeps the side its own
+// parameter value lies on and the other side is queued, to be replayed
+// from the last tick boundary.  A whole threshold range is thereby covered
+// by one exact trajectory per distinct behaviour, each with its interval.
+
+#ifndef THRESHOLD_H
+#define THRESHOLD_H
+
+#include <gmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "config.h"
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    THRESHOLD_RATIO_CUSTOM_LOWER = 0,
+    THRESHOLD_RATIO_CUSTOM_UPPER,
+    THRESHOLD_KOPPA_WRAP,
+    THRESHOLD_KOPPA_GATE_SLIDE,
+    THRESHOLD_KOPPA_GATE_MULTI,
+    THRESHOLD_PARAM_COUNT
+} ThresholdParam;
+
+// What a comparison asked of the parameter p against a state value v.
+typedef enum {
+    THRESHOLD_BELOW,   // p < v
+    THRESHOLD_ABOVE    // p > v
+} ThresholdRelation;
+
+// Closed or half-open interval of parameter values.  Intervals of the
+// integer parameters hold only integers and are always kept closed.
+typedef struct {
+    bool tracked;
+    bool lower_open;
+    bool upper_open;
+    mpq_t lower;
+    mpq_t upper;
+} ThresholdInterval;
+
+// One finished branch of a sweep.  Every parameter value in intervals
+// yields exactly the trajectory run with values.  Branches left unexplored
+// by max_branches still report their exact interval, fixed up to the fork.
+typedef struct {
+    size_t branch;
+    size_t parent;                 // SIZE_MAX for the root
+    size_t fork_tick;              // microtick whose comparison split the parent
+    int fork_microtick;
+    bool explored;
+    const ThresholdInterval *intervals;   // THRESHOLD_PARAM_COUNT entries
+    mpq_t *values;                        // parameter values the branch ran with
+    size_t comparisons;            // comparisons against swept parameters
+    size_t psi_events;
+    size_t rho_events;
+    uint64_t digest;               // flags and components of every microtick
+} ThresholdBranch;
+
+typedef void (*ThresholdSink)(void *user_data, const ThresholdBranch *branch);
+
+typedef struct ThresholdPending ThresholdPending;
+
+// Comparison log of the branch being run; reached through
+// Config.threshold_tracker.
+typedef struct ThresholdTracker {
+    ThresholdInterval intervals[THRESHOLD_PARAM_COUNT];
+    size_t comparisons;
+    size_t branch;
+    size_t next_branch;
+    // Position and history at the end of the last complete tick, the point
+    // branches forked during the current tick are replayed from.
+    bool has_snapshot;
+    TRTS_State snapshot;
+    size_t snapshot_tick;
+    uint64_t snapshot_digest;
+    size_t snapshot_comparisons;
+    size_t snapshot_psi;
+    size_t snapshot_rho;
+    size_t last_tick;
+    int last_microtick;
+    uint64_t digest;
+    size_t psi_events;
+    size_t rho_events;
+    ThresholdPending **pending;
+    size_t pending_count;
+    size_t pending_capacity;
+    bool failed;
+    mpq_t bound;
+    mpq_t magnitude;
+} ThresholdTracker;
+
+void threshold_interval_init(ThresholdInterval *interval);
+void threshold_interval_clear(ThresholdInterval *interval);
+
+const char *threshold_param_name(ThresholdParam param);
+bool threshold_param_from_name(const char *name, ThresholdParam *param);
+bool threshold_param_integral(ThresholdParam param);
+
+// Set interval to [lower, upper] from "lower:upper".  Integer parameters
+// take integers in [0, ULONG_MAX]; the others take rationals.  Returns
+// false for malformed or empty ranges.
+bool threshold_interval_parse(ThresholdParam param, const char *text,
+                              ThresholdInterval *interval);
+
+// Record that the comparison relation of param against value came out as
+// outcome, forking when the parameter interval held values answering it
+// the other way.  The _z form compares against |value|, as every integer
+// threshold does.
+void threshold_record(ThresholdTracker *tracker, ThresholdParam param,
+                      ThresholdRelation relation, mpq_srcptr value, bool outcome);
+void threshold_record_z(ThresholdTracker *tracker, ThresholdParam param,
+                        ThresholdRelation relation, mpz_srcptr value, bool outcome);
+
+typedef struct {
+    size_t explored;
+    size_t unexplored;
+    size_t distinct;    // explored branches with distinct digests, i.e. trajectories
+} ThresholdSummary;
+
+// Sweep every parameter with ranges[p].tracked over its range; the others
+// keep the value in config.  Each branch runs with the midpoint of its
+// interval written into config's threshold fields, which are restored
+// before returning.  At most max_branches branches are simulated (0 for no
+// limit); the rest are reported unexplored.  Returns false when memory ran
+// out.
+bool threshold_sweep(Config *config, const ThresholdInterval ranges[THRESHOLD_PARAM_COUNT],
+                     size_t max_branches, ThresholdSink sink, void *user_data,
+                     ThresholdSummary *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // THRESHOLD_H
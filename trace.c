@@ -0,0 +1,1109 @@
+/*
+ * trace.c
+ *
+ * Binary microtick trace encoder, writer and reader.  Values are stored
+ * exactly as they sit in the engine state: raw numerators and denominators
+ * exported limb-for-limb, never reduced or canonicalised.  Many logged
+ * components are exact copies of one another (κ_sample of κ or a stack
+ * slot, previous υ of the last row's υ, stack slots that did not move), so
+ * each component is first matched against the components already written
+ * for this row and against the previous row.  Matching uses a cheap
+ * size/limb fingerprint and is confirmed by a full comparison, so a
+ * back-reference is only ever emitted for an identical value.
+ */
+
+#include "trace.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+static const char TRACE_MAGIC[8] = {'T', 'R', 'T', 'S', 'T', 'R', 'C', '\0'};
+
+enum {
+    TRACE_TAG_LITERAL = 0,
+    TRACE_TAG_SAME_ROW = 1,
+    TRACE_TAG_PREVIOUS_ROW = 2
+};
+
+enum {
+    TRACE_SIGN_ZERO = 0,
+    TRACE_SIGN_POSITIVE = 1,
+    TRACE_SIGN_NEGATIVE = 2
+};
+
+#define TRACE_HEADER_CROSS_ROW 0x01u
+#define TRACE_HEADER_ZONE_MAPS 0x02u
+
+#define TRACE_HEADER_SIZE 12U
+
+// Zone map records: a zero-length record, then this many bytes ending in
+// TRACE_ZONE_MAGIC.  The fixed size lets trace_index_load() walk them back
+// from the end of the file.
+#define TRACE_ZONE_SIZE (40U + 9U * TRACE_COMPONENT_COUNT + 17U + 4U)
+
+static const char TRACE_ZONE_MAGIC[4] = {'T', 'Z', 'M', '1'};
+
+// Quotients are bounded with a relative slack far above the error of the
+// double evaluation, and saturate beyond 2^±1000.
+#define TRACE_RATIO_SLACK 0x1p-40
+#define TRACE_RATIO_LOG2_LIMIT 1000L
+
+/* ===========================================================
+   Byte buffers and varints
+   =========================================================== */
+
+void trace_buffer_init(TraceBuffer *buffer) {
+    buffer->data = NULL;
+    buffer->size = 0U;
+    buffer->capacity = 0U;
+}
+
+void trace_buffer_clear(TraceBuffer *buffer) {
+    free(buffer->data);
+    trace_buffer_init(buffer);
+}
+
+void trace_buffer_reset(TraceBuffer *buffer) {
+    buffer->size = 0U;
+}
+
+bool trace_buffer_reserve(TraceBuffer *buffer, size_t extra) {
+    size_t needed = buffer->size + extra;
+    if (needed <= buffer->capacity) {
+        return true;
+    }
+    size_t capacity = buffer->capacity ? buffer->capacity : 256U;
+    while (capacity < needed) {
+        capacity *= 2U;
+    }
+    unsigned char *data = (unsigned char *)realloc(buffer->data, capacity);
+    if (!data) {
+        return false;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return true;
+}
+
+bool trace_buffer_append(TraceBuffer *buffer, const void *data, size_t size) {
+    if (!trace_buffer_reserve(buffer, size)) {
+        return false;
+    }
+    memcpy(buffer->data + buffer->size, data, size);
+    buffer->size += size;
+    return true;
+}
+
+static bool put_byte(TraceBuffer *buffer, unsigned char value) {
+    return trace_buffer_append(buffer, &value, 1U);
+}
+
+static bool put_varint(TraceBuffer *buffer, uint64_t value) {
+    unsigned char bytes[10];
+    size_t count = 0U;
+    do {
+        unsigned char byte = (unsigned char)(value & 0x7Fu);
+        value >>= 7;
+        if (value != 0U) {
+            byte |= 0x80u;
+        }
+        bytes[count++] = byte;
+    } while (value != 0U);
+    return trace_buffer_append(buffer, bytes, count);
+}
+
+static size_t varint_length(uint64_t value) {
+    size_t length = 1U;
+    while (value >= 0x80u) {
+        value >>= 7;
+        ++length;
+    }
+    return length;
+}
+
+static bool get_varint(const unsigned char **cursor, const unsigned char *end, uint64_t *value) {
+    uint64_t result = 0U;
+    unsigned int shift = 0U;
+    while (*cursor < end && shift < 64U) {
+        unsigned char byte = **cursor;
+        ++(*cursor);
+        result |= (uint64_t)(byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0U) {
+            *value = result;
+            return true;
+        }
+        shift += 7U;
+    }
+    return false;
+}
+
+static bool read_varint(FILE *file, uint64_t *value) {
+    uint64_t result = 0U;
+    unsigned int shift = 0U;
+    while (shift < 64U) {
+        int byte = getc(file);
+        if (byte == EOF) {
+            return false;
+        }
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+        shift += 7U;
+    }
+    return false;
+}
+
+/* ===========================================================
+   Rows
+   =========================================================== */
+
+void trace_row_init(TraceRow *row) {
+    row->tick = 0U;
+    row->microtick = 0;
+    row->phase = 'E';
+    row->flags = 0U;
+    row->koppa_sample_index = -1;
+    row->koppa_stack_size = 0U;
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_init(row->components[i]);
+    }
+}
+
+void trace_row_clear(TraceRow *row) {
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_clear(row->components[i]);
+    }
+}
+
+void trace_row_copy(TraceRow *dest, const TraceRow *src) {
+    if (dest == src) {
+        return;
+    }
+    dest->tick = src->tick;
+    dest->microtick = src->microtick;
+    dest->phase = src->phase;
+    dest->flags = src->flags;
+    dest->koppa_sample_index = src->koppa_sample_index;
+    dest->koppa_stack_size = src->koppa_stack_size;
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_set(dest->components[i], src->components[i]);
+    }
+}
+
+unsigned int trace_flags_from_state(const TRTS_State *state, bool rho_event, bool psi_fired,
+                                    bool mu_zero, bool forced_emission) {
+    unsigned int flags = 0U;
+    flags |= rho_event ? TRACE_FLAG_RHO_EVENT : 0U;
+    flags |= psi_fired ? TRACE_FLAG_PSI_FIRED : 0U;
+    flags |= mu_zero ? TRACE_FLAG_MU_ZERO : 0U;
+    flags |= forced_emission ? TRACE_FLAG_FORCED_EMISSION : 0U;
+    flags |= state->ratio_triggered_recent ? TRACE_FLAG_RATIO_TRIGGERED : 0U;
+    flags |= state->psi_triple_recent ? TRACE_FLAG_TRIPLE_PSI : 0U;
+    flags |= state->dual_engine_last_step ? TRACE_FLAG_DUAL_ENGINE : 0U;
+    flags |= state->ratio_threshold_recent ? TRACE_FLAG_RATIO_THRESHOLD : 0U;
+    flags |= state->psi_strength_applied ? TRACE_FLAG_PSI_STRENGTH : 0U;
+    flags |= state->sign_flip_polarity ? TRACE_FLAG_SIGN_FLIP : 0U;
+    return flags;
+}
+
+void trace_state_components(const TRTS_State *state, mpz_srcptr components[TRACE_COMPONENT_COUNT]) {
+    mpq_srcptr rationals[TRACE_COMPONENT_COUNT / 2] = {
+        state->upsilon,
+        state->beta,
+        state->koppa,
+        state->koppa_sample,
+        state->previous_upsilon,
+        state->previous_beta,
+        state->koppa_stack[0],
+        state->koppa_stack[1],
+        state->koppa_stack[2],
+        state->koppa_stack[3],
+        state->delta_upsilon,
+        state->delta_beta,
+        state->triangle_phi_over_epsilon,
+        state->triangle_prev_over_phi,
+        state->triangle_epsilon_over_prev
+    };
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT / 2; ++i) {
+        components[2 * i] = mpq_numref(rationals[i]);
+        components[2 * i + 1] = mpq_denref(rationals[i]);
+    }
+}
+
+const char *trace_component_name(size_t index) {
+    static const char *const names[TRACE_COMPONENT_COUNT] = {
+        "upsilon_num", "upsilon_den", "beta_num", "beta_den",
+        "koppa_num", "koppa_den", "koppa_sample_num", "koppa_sample_den",
+        "prev_upsilon_num", "prev_upsilon_den", "prev_beta_num", "prev_beta_den",
+        "koppa_stack0_num", "koppa_stack0_den", "koppa_stack1_num", "koppa_stack1_den",
+        "koppa_stack2_num", "koppa_stack2_den", "koppa_stack3_num", "koppa_stack3_den",
+        "delta_upsilon_num", "delta_upsilon_den", "delta_beta_num", "delta_beta_den",
+        "triangle_phi_over_epsilon_num", "triangle_phi_over_epsilon_den",
+        "triangle_prev_over_phi_num", "triangle_prev_over_phi_den",
+        "triangle_epsilon_over_prev_num", "triangle_epsilon_over_prev_den"};
+    return index < TRACE_COMPONENT_COUNT ? names[index] : "unknown";
+}
+
+/* ===========================================================
+   Zone maps
+   =========================================================== */
+
+void trace_quotient_bounds(mpz_srcptr a, mpz_srcptr b, mpz_srcptr c, mpz_srcptr d,
+                           double *lower, double *upper) {
+    if (mpz_sgn(a) == 0) {
+        *lower = 0.0;
+        *upper = 0.0;
+        return;
+    }
+    long e_a = 0, e_b = 0, e_c = 0, e_d = 0;
+    double m_a = mpz_get_d_2exp(&e_a, a);
+    double m_b = mpz_get_d_2exp(&e_b, b);
+    double m_c = mpz_get_d_2exp(&e_c, c);
+    double m_d = mpz_get_d_2exp(&e_d, d);
+    long exponent = e_a + e_b - e_c - e_d;
+    // The mantissas lie in [0.5, 1), so |quotient| is in (0.25, 4).
+    double quotient = (m_a * m_b) / (m_c * m_d);
+    bool negative = quotient < 0.0;
+    if (exponent > TRACE_RATIO_LOG2_LIMIT) {
+        double bound = ldexp(1.0, (int)TRACE_RATIO_LOG2_LIMIT - 1);
+        *lower = negative ? -INFINITY : bound;
+        *upper = negative ? -bound : INFINITY;
+    } else if (exponent < -TRACE_RATIO_LOG2_LIMIT) {
+        double bound = ldexp(1.0, 1 - (int)TRACE_RATIO_LOG2_LIMIT);
+        *lower = negative ? -bound : 0.0;
+        *upper = negative ? 0.0 : bound;
+    } else {
+        double value = ldexp(quotient, (int)exponent);
+        double slack = fabs(value) * TRACE_RATIO_SLACK;
+        *lower = value - slack;
+        *upper = value + slack;
+    }
+}
+
+static unsigned char zone_sign(mpz_srcptr value) {
+    int sign = mpz_sgn(value);
+    return sign < 0 ? TRACE_ZONE_NEGATIVE : (sign > 0 ? TRACE_ZONE_POSITIVE : TRACE_ZONE_ZERO);
+}
+
+void trace_zone_reset(TraceZoneMap *zone) {
+    memset(zone, 0, sizeof(*zone));
+    zone->ratio_lower = INFINITY;
+    zone->ratio_upper = -INFINITY;
+}
+
+void trace_zone_add_row(TraceZoneMap *zone, size_t tick, unsigned int flags,
+                        mpz_srcptr const components[TRACE_COMPONENT_COUNT]) {
+    bool first = zone->rows == 0U;
+    if (first) {
+        zone->first_tick = (uint64_t)tick;
+        zone->flags_all = flags;
+    }
+    zone->last_tick = (uint64_t)tick;
+    zone->flags_any |= flags;
+    zone->flags_all &= flags;
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_srcptr value = components[i];
+        uint32_t bits = mpz_sgn(value) == 0 ? 0U : (uint32_t)mpz_sizeinbase(value, 2);
+        unsigned char sign = zone_sign(value);
+        if (first || bits < zone->min_bits[i]) {
+            zone->min_bits[i] = bits;
+        }
+        if (first || bits > zone->max_bits[i]) {
+            zone->max_bits[i] = bits;
+        }
+        zone->signs[i] |= sign;
+        if (first) {
+            zone->first_sign[i] = sign;
+        }
+        zone->last_sign[i] = sign;
+    }
+    // υ/β = (υn·βd) / (υd·βn)
+    if (mpz_sgn(components[1]) != 0 && mpz_sgn(components[2]) != 0 &&
+        mpz_sgn(components[3]) != 0) {
+        double lower = 0.0, upper = 0.0;
+        trace_quotient_bounds(components[0], components[3], components[1], components[2],
+                              &lower, &upper);
+        zone->ratio_defined = true;
+        zone->ratio_lower = fmin(zone->ratio_lower, lower);
+        zone->ratio_upper = fmax(zone->ratio_upper, upper);
+    } else {
+        zone->ratio_undefined = true;
+    }
+    zone->rows += 1U;
+}
+
+static unsigned char *put_le(unsigned char *out, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; ++i) {
+        out[i] = (unsigned char)(value >> (8U * i));
+    }
+    return out + bytes;
+}
+
+static uint64_t get_le(const unsigned char **cursor, size_t bytes) {
+    uint64_t value = 0U;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= (uint64_t)(*cursor)[i] << (8U * i);
+    }
+    *cursor += bytes;
+    return value;
+}
+
+static unsigned int sign_index(unsigned char sign) {
+    return sign == TRACE_ZONE_POSITIVE ? 2U : (sign == TRACE_ZONE_ZERO ? 1U : 0U);
+}
+
+static void zone_serialise(const TraceZoneMap *zone, unsigned char out[TRACE_ZONE_SIZE]) {
+    uint64_t lower_bits = 0U, upper_bits = 0U;
+    memcpy(&lower_bits, &zone->ratio_lower, sizeof(lower_bits));
+    memcpy(&upper_bits, &zone->ratio_upper, sizeof(upper_bits));
+    unsigned char *cursor = out;
+    cursor = put_le(cursor, zone->rows, 8U);
+    cursor = put_le(cursor, zone->bytes, 8U);
+    cursor = put_le(cursor, zone->first_tick, 8U);
+    cursor = put_le(cursor, zone->last_tick, 8U);
+    cursor = put_le(cursor, zone->flags_any, 4U);
+    cursor = put_le(cursor, zone->flags_all, 4U);
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        cursor = put_le(cursor, zone->min_bits[i], 4U);
+        cursor = put_le(cursor, zone->max_bits[i], 4U);
+        *cursor++ = (unsigned char)(zone->signs[i] | (sign_index(zone->first_sign[i]) << 3) |
+                                    (sign_index(zone->last_sign[i]) << 5));
+    }
+    *cursor++ = (unsigned char)((zone->ratio_defined ? 1u : 0u) |
+                                (zone->ratio_undefined ? 2u : 0u));
+    cursor = put_le(cursor, lower_bits, 8U);
+    cursor = put_le(cursor, upper_bits, 8U);
+    memcpy(cursor, TRACE_ZONE_MAGIC, sizeof(TRACE_ZONE_MAGIC));
+}
+
+static bool zone_parse(const unsigned char in[TRACE_ZONE_SIZE], TraceZoneMap *zone) {
+    if (memcmp(in + TRACE_ZONE_SIZE - sizeof(TRACE_ZONE_MAGIC), TRACE_ZONE_MAGIC,
+               sizeof(TRACE_ZONE_MAGIC)) != 0) {
+        return false;
+    }
+    const unsigned char *cursor = in;
+    zone->rows = get_le(&cursor, 8U);
+    zone->bytes = get_le(&cursor, 8U);
+    zone->first_tick = get_le(&cursor, 8U);
+    zone->last_tick = get_le(&cursor, 8U);
+    zone->flags_any = (unsigned int)get_le(&cursor, 4U);
+    zone->flags_all = (unsigned int)get_le(&cursor, 4U);
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        zone->min_bits[i] = (uint32_t)get_le(&cursor, 4U);
+        zone->max_bits[i] = (uint32_t)get_le(&cursor, 4U);
+        unsigned char packed = *cursor++;
+        zone->signs[i] = packed & 0x07u;
+        zone->first_sign[i] = (unsigned char)(1u << ((packed >> 3) & 0x03u));
+        zone->last_sign[i] = (unsigned char)(1u << ((packed >> 5) & 0x03u));
+    }
+    unsigned char ratio = *cursor++;
+    zone->ratio_defined = (ratio & 1u) != 0U;
+    zone->ratio_undefined = (ratio & 2u) != 0U;
+    uint64_t lower_bits = get_le(&cursor, 8U);
+    uint64_t upper_bits = get_le(&cursor, 8U);
+    memcpy(&zone->ratio_lower, &lower_bits, sizeof(lower_bits));
+    memcpy(&zone->ratio_upper, &upper_bits, sizeof(upper_bits));
+    return zone->rows > 0U && zone->bytes > 0U;
+}
+
+/* ===========================================================
+   Encoder
+   =========================================================== */
+
+// Cheap fingerprint: signed limb count plus the lowest and highest limbs.
+// Equal values always share a fingerprint; unequal values that collide are
+// rejected by the mpz_cmp() that confirms every candidate.
+static uint64_t component_hash(mpz_srcptr value) {
+    size_t limbs = mpz_size(value);
+    uint64_t hash = (uint64_t)limbs * 0x9E3779B97F4A7C15ULL;
+    hash ^= (uint64_t)(mpz_sgn(value) + 1);
+    if (limbs > 0U) {
+        hash ^= (uint64_t)mpz_getlimbn(value, 0) * 0xC2B2AE3D27D4EB4FULL;
+        hash = (hash << 31) | (hash >> 33);
+        hash ^= (uint64_t)mpz_getlimbn(value, (mp_size_t)(limbs - 1U)) * 0x165667B19E3779F9ULL;
+    }
+    return hash;
+}
+
+void trace_encoder_init(TraceEncoder *encoder, bool cross_row) {
+    encoder->cross_row = cross_row;
+    encoder->have_previous = false;
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_init(encoder->previous[i]);
+        encoder->previous_hash[i] = 0U;
+    }
+    encoder->literal_count = 0U;
+    encoder->reference_count = 0U;
+}
+
+void trace_encoder_clear(TraceEncoder *encoder) {
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_clear(encoder->previous[i]);
+    }
+}
+
+void trace_encoder_reset(TraceEncoder *encoder) {
+    encoder->have_previous = false;
+}
+
+static bool encode_literal(TraceBuffer *out, mpz_srcptr value) {
+    int sign = mpz_sgn(value);
+    if (sign == 0) {
+        return put_byte(out, (unsigned char)((TRACE_TAG_LITERAL << 6) | TRACE_SIGN_ZERO));
+    }
+    unsigned char tag = (unsigned char)((TRACE_TAG_LITERAL << 6) |
+                                        (sign > 0 ? TRACE_SIGN_POSITIVE : TRACE_SIGN_NEGATIVE));
+    size_t byte_count = (mpz_sizeinbase(value, 2) + 7U) / 8U;
+    if (!put_byte(out, tag) || !put_varint(out, (uint64_t)byte_count) ||
+        !trace_buffer_reserve(out, byte_count)) {
+        return false;
+    }
+    size_t written = 0U;
+    mpz_export(out->data + out->size, &written, -1, 1, 0, 0, value);
+    out->size += written;
+    return true;
+}
+
+bool trace_encode_row(TraceEncoder *encoder, TraceBuffer *out, size_t tick, int microtick,
+                      char phase, unsigned int flags, int koppa_sample_index,
+                      size_t koppa_stack_size,
+                      mpz_srcptr const components[TRACE_COMPONENT_COUNT]) {
+    bool ok = put_varint(out, (uint64_t)tick) && put_byte(out, (unsigned char)microtick) &&
+              put_byte(out, (unsigned char)phase) && put_varint(out, (uint64_t)flags) &&
+              put_byte(out, (unsigned char)(koppa_sample_index + 1)) &&
+              put_varint(out, (uint64_t)koppa_stack_size);
+    if (!ok) {
+        return false;
+    }
+
+    bool use_previous = encoder->cross_row && encoder->have_previous;
+    uint64_t hashes[TRACE_COMPONENT_COUNT];
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        mpz_srcptr value = components[i];
+        hashes[i] = component_hash(value);
+        int reference = -1;
+        int tag = TRACE_TAG_LITERAL;
+
+        // Zero is a single byte either way; only search for non-zero values.
+        if (mpz_sgn(value) != 0) {
+            for (size_t j = 0; j < i && reference < 0; ++j) {
+                if (hashes[j] == hashes[i] &&
+                    (components[j] == value || mpz_cmp(components[j], value) == 0)) {
+                    reference = (int)j;
+                    tag = TRACE_TAG_SAME_ROW;
+                }
+            }
+            if (reference < 0 && use_previous) {
+                // Same column first: unchanged fields are by far the most common.
+                if (encoder->previous_hash[i] == hashes[i] &&
+                    mpz_cmp(encoder->previous[i], value) == 0) {
+                    reference = (int)i;
+                    tag = TRACE_TAG_PREVIOUS_ROW;
+                }
+                for (size_t j = 0; j < TRACE_COMPONENT_COUNT && reference < 0; ++j) {
+                    if (j != i && encoder->previous_hash[j] == hashes[i] &&
+                        mpz_cmp(encoder->previous[j], value) == 0) {
+                        reference = (int)j;
+                        tag = TRACE_TAG_PREVIOUS_ROW;
+                    }
+                }
+            }
+        }
+
+        if (reference >= 0) {
+            ok = put_byte(out, (unsigned char)((tag << 6) | reference));
+            encoder->reference_count += 1U;
+        } else {
+            ok = encode_literal(out, value);
+            encoder->literal_count += 1U;
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+
+    if (encoder->cross_row) {
+        for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+            mpz_set(encoder->previous[i], components[i]);
+            encoder->previous_hash[i] = hashes[i];
+        }
+        encoder->have_previous = true;
+    }
+    return true;
+}
+
+/* ===========================================================
+   Decoder
+   =========================================================== */
+
+bool trace_decode_row(const unsigned char *data, size_t size, const TraceRow *previous,
+                      TraceRow *row) {
+    const unsigned char *cursor = data;
+    const unsigned char *end = data + size;
+    uint64_t value = 0U;
+
+    if (!get_varint(&cursor, end, &value)) {
+        return false;
+    }
+    row->tick = (size_t)value;
+    if (end - cursor < 2) {
+        return false;
+    }
+    row->microtick = (int)cursor[0];
+    row->phase = (char)cursor[1];
+    cursor += 2;
+    if (!get_varint(&cursor, end, &value)) {
+        return false;
+    }
+    row->flags = (unsigned int)value;
+    if (cursor >= end) {
+        return false;
+    }
+    row->koppa_sample_index = (int)(*cursor++) - 1;
+    if (!get_varint(&cursor, end, &value)) {
+        return false;
+    }
+    row->koppa_stack_size = (size_t)value;
+
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        if (cursor >= end) {
+            return false;
+        }
+        unsigned char tag = *cursor++;
+        unsigned int kind = tag >> 6;
+        unsigned int low = tag & 0x3Fu;
+        switch (kind) {
+        case TRACE_TAG_LITERAL: {
+            if (low == TRACE_SIGN_ZERO) {
+                mpz_set_ui(row->components[i], 0UL);
+                break;
+            }
+            if (!get_varint(&cursor, end, &value) || (uint64_t)(end - cursor) < value) {
+                return false;
+            }
+            mpz_import(row->components[i], (size_t)value, -1, 1, 0, 0, cursor);
+            cursor += value;
+            if (low == TRACE_SIGN_NEGATIVE) {
+                mpz_neg(row->components[i], row->components[i]);
+            }
+            break;
+        }
+        case TRACE_TAG_SAME_ROW:
+            if (low >= i) {
+                return false;
+            }
+            mpz_set(row->components[i], row->components[low]);
+            break;
+        case TRACE_TAG_PREVIOUS_ROW:
+            if (!previous || low >= TRACE_COMPONENT_COUNT) {
+                return false;
+            }
+            mpz_set(row->components[i], previous->components[low]);
+            break;
+        default:
+            return false;
+        }
+    }
+    return cursor == end;
+}
+
+/* ===========================================================
+   Files
+   =========================================================== */
+
+static bool write_header(FILE *file, unsigned char flags) {
+    unsigned char header[TRACE_HEADER_SIZE];
+    memcpy(header, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header[8] = (unsigned char)TRACE_FORMAT_VERSION;
+    header[9] = (unsigned char)TRACE_COMPONENT_COUNT;
+    header[10] = flags;
+    header[11] = 0u;
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+// Read and check the header at the current position; *flags gets its
+// TRACE_HEADER_* bits.
+static bool read_header(FILE *file, unsigned int *flags) {
+    unsigned char header[TRACE_HEADER_SIZE];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        (header[8] != 1u && header[8] != TRACE_FORMAT_VERSION) ||
+        header[9] != TRACE_COMPONENT_COUNT) {
+        return false;
+    }
+    *flags = header[10];
+    if (header[8] == 1u) {
+        *flags &= ~TRACE_HEADER_ZONE_MAPS;
+    }
+    return true;
+}
+
+bool trace_write_header(FILE *file, bool cross_row) {
+    return write_header(file, cross_row ? TRACE_HEADER_CROSS_ROW : 0u);
+}
+
+bool trace_write_record(FILE *file, const unsigned char *payload, size_t size) {
+    TraceBuffer prefix;
+    unsigned char storage[10];
+    prefix.data = storage;
+    prefix.size = 0U;
+    prefix.capacity = sizeof(storage);
+    if (!put_varint(&prefix, (uint64_t)size)) {
+        return false;
+    }
+    return fwrite(prefix.data, 1, prefix.size, file) == prefix.size &&
+           fwrite(payload, 1, size, file) == size;
+}
+
+static bool index_push(TraceIndex *index, uint64_t offset, bool indexed,
+                       const TraceZoneMap *zone) {
+    TraceBlock *blocks =
+        (TraceBlock *)realloc(index->blocks, (index->count + 1U) * sizeof(TraceBlock));
+    if (!blocks) {
+        return false;
+    }
+    index->blocks = blocks;
+    blocks[index->count].offset = offset;
+    blocks[index->count].indexed = indexed;
+    blocks[index->count].zone = *zone;
+    index->count += 1U;
+    return true;
+}
+
+// Walk the records from the current position, just after the header, up to
+// end, reading only length prefixes and zone maps.  Rows after the last
+// zone map form an unindexed block; a record cut short by end is left out
+// and counted in index->trailing_bytes.
+static bool scan_blocks(FILE *file, uint64_t end, bool zone_maps, TraceIndex *index) {
+    uint64_t position = TRACE_HEADER_SIZE;
+    uint64_t block_start = position;
+    unsigned char record[TRACE_ZONE_SIZE];
+    TraceZoneMap zone;
+    while (position < end) {
+        uint64_t size = 0U;
+        uint64_t marker = position;
+        if (!read_varint(file, &size)) {
+            break;
+        }
+        position += varint_length(size);
+        if (size == 0U) {
+            if (!zone_maps || end - position < TRACE_ZONE_SIZE) {
+                position = marker;
+                break;
+            }
+            if (fread(record, 1, sizeof(record), file) != sizeof(record) ||
+                !zone_parse(record, &zone) || zone.bytes != marker - block_start ||
+                !index_push(index, block_start, true, &zone)) {
+                return false;
+            }
+            position += TRACE_ZONE_SIZE;
+            block_start = position;
+        } else {
+            if (size > end - position) {
+                position = marker;
+                break;
+            }
+            if (fseeko(file, (off_t)size, SEEK_CUR) != 0) {
+                return false;
+            }
+            position += size;
+        }
+    }
+    index->trailing_bytes = end - position;
+    end = position;
+    if (block_start < end) {
+        trace_zone_reset(&zone);
+        zone.bytes = end - block_start;
+        return index_push(index, block_start, false, &zone);
+    }
+    return true;
+}
+
+// Follow the zone maps back from end.  Fails, leaving index to be
+// discarded, as soon as the bytes before end are not a zone map.
+static bool walk_blocks_back(FILE *file, uint64_t end, TraceIndex *index) {
+    unsigned char record[1U + TRACE_ZONE_SIZE];
+    TraceZoneMap zone;
+    uint64_t position = end;
+    while (position > TRACE_HEADER_SIZE) {
+        if (position - TRACE_HEADER_SIZE < sizeof(record) ||
+            fseeko(file, (off_t)(position - sizeof(record)), SEEK_SET) != 0 ||
+            fread(record, 1, sizeof(record), file) != sizeof(record) || record[0] != 0u ||
+            !zone_parse(record + 1, &zone) ||
+            zone.bytes > position - sizeof(record) - TRACE_HEADER_SIZE) {
+            return false;
+        }
+        position -= sizeof(record) + zone.bytes;
+        if (!index_push(index, position, true, &zone)) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < index->count / 2U; ++i) {
+        TraceBlock swap = index->blocks[i];
+        index->blocks[i] = index->blocks[index->count - 1U - i];
+        index->blocks[index->count - 1U - i] = swap;
+    }
+    return true;
+}
+
+bool trace_index_load(const char *path, TraceIndex *index) {
+    index->cross_row = false;
+    index->blocks = NULL;
+    index->count = 0U;
+    index->trailing_bytes = 0U;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    unsigned int flags = 0U;
+    bool ok = read_header(file, &flags) && fseeko(file, 0, SEEK_END) == 0;
+    off_t end = ok ? ftello(file) : -1;
+    ok = ok && end >= (off_t)TRACE_HEADER_SIZE;
+    if (ok) {
+        index->cross_row = (flags & TRACE_HEADER_CROSS_ROW) != 0U;
+        bool zone_maps = (flags & TRACE_HEADER_ZONE_MAPS) != 0U;
+        if (!zone_maps || !walk_blocks_back(file, (uint64_t)end, index)) {
+            index->count = 0U;
+            ok = fseeko(file, (off_t)TRACE_HEADER_SIZE, SEEK_SET) == 0 &&
+                 scan_blocks(file, (uint64_t)end, zone_maps, index);
+        }
+    }
+    fclose(file);
+    if (!ok) {
+        trace_index_clear(index);
+    }
+    return ok;
+}
+
+void trace_index_clear(TraceIndex *index) {
+    free(index->blocks);
+    index->blocks = NULL;
+    index->count = 0U;
+}
+
+bool trace_block_next(const unsigned char **cursor, const unsigned char *end,
+                      const TraceRow *previous, TraceRow *row) {
+    uint64_t size = 0U;
+    if (*cursor >= end || !get_varint(cursor, end, &size) || size == 0U ||
+        (uint64_t)(end - *cursor) < size ||
+        !trace_decode_row(*cursor, (size_t)size, previous, row)) {
+        return false;
+    }
+    *cursor += size;
+    return true;
+}
+
+static bool writer_flush_zone(TraceWriter *writer) {
+    if (!writer->zone_maps || writer->zone.rows == 0U) {
+        return true;
+    }
+    unsigned char record[1U + TRACE_ZONE_SIZE];
+    record[0] = 0u;
+    zone_serialise(&writer->zone, record + 1);
+    if (fwrite(record, 1, sizeof(record), writer->file) != sizeof(record)) {
+        return false;
+    }
+    writer->bytes_written += sizeof(record);
+    trace_zone_reset(&writer->zone);
+    return true;
+}
+
+// Rebuild the zone map of the block cut at end by a checkpoint from the
+// rows already on disk.
+static bool writer_reload_zone(TraceWriter *writer, uint64_t end) {
+    TraceIndex index = {false, NULL, 0U, 0U};
+    bool ok = fseeko(writer->file, (off_t)TRACE_HEADER_SIZE, SEEK_SET) == 0 &&
+              scan_blocks(writer->file, end, true, &index) && index.trailing_bytes == 0U;
+    if (ok && index.count > 0U && !index.blocks[index.count - 1U].indexed) {
+        const TraceBlock *block = &index.blocks[index.count - 1U];
+        TraceBuffer data;
+        trace_buffer_init(&data);
+        ok = trace_buffer_reserve(&data, (size_t)block->zone.bytes) &&
+             fseeko(writer->file, (off_t)block->offset, SEEK_SET) == 0 &&
+             fread(data.data, 1, (size_t)block->zone.bytes, writer->file) ==
+                 (size_t)block->zone.bytes;
+        TraceRow rows[2];
+        trace_row_init(&rows[0]);
+        trace_row_init(&rows[1]);
+        const unsigned char *cursor = data.data;
+        const unsigned char *data_end = data.data + block->zone.bytes;
+        int current = 0;
+        while (ok && cursor < data_end) {
+            const TraceRow *previous = writer->zone.rows > 0U ? &rows[current ^ 1] : NULL;
+            ok = trace_block_next(&cursor, data_end, previous, &rows[current]);
+            if (ok) {
+                mpz_srcptr components[TRACE_COMPONENT_COUNT];
+                for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+                    components[i] = rows[current].components[i];
+                }
+                trace_zone_add_row(&writer->zone, rows[current].tick, rows[current].flags,
+                                   components);
+                current ^= 1;
+            }
+        }
+        writer->zone.bytes = block->zone.bytes;
+        trace_row_clear(&rows[0]);
+        trace_row_clear(&rows[1]);
+        trace_buffer_clear(&data);
+    }
+    trace_index_clear(&index);
+    return ok && fseeko(writer->file, 0, SEEK_END) == 0;
+}
+
+bool trace_writer_open(TraceWriter *writer, const char *path) {
+    writer->file = fopen(path, "wb");
+    if (!writer->file) {
+        return false;
+    }
+    trace_encoder_init(&writer->encoder, true);
+    trace_buffer_init(&writer->row_buffer);
+    writer->rows_written = 0U;
+    writer->bytes_written = TRACE_HEADER_SIZE;
+    writer->zone_maps = true;
+    trace_zone_reset(&writer->zone);
+    if (!write_header(writer->file, TRACE_HEADER_CROSS_ROW | TRACE_HEADER_ZONE_MAPS)) {
+        trace_writer_close(writer);
+        return false;
+    }
+    return true;
+}
+
+bool trace_writer_resume(TraceWriter *writer, const char *path, uint64_t offset,
+                         uint64_t rows_written, const TRTS_State *last_state) {
+    writer->file = fopen(path, "r+b");
+    if (!writer->file) {
+        return false;
+    }
+    unsigned int flags = 0U;
+    if (!read_header(writer->file, &flags) || fflush(writer->file) != 0 ||
+        ftruncate(fileno(writer->file), (off_t)offset) != 0 ||
+        fseek(writer->file, 0L, SEEK_END) != 0) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return false;
+    }
+    trace_encoder_init(&writer->encoder, true);
+    trace_buffer_init(&writer->row_buffer);
+    writer->rows_written = (size_t)rows_written;
+    writer->bytes_written = (size_t)offset;
+    writer->zone_maps = (flags & TRACE_HEADER_ZONE_MAPS) != 0U;
+    trace_zone_reset(&writer->zone);
+    if (writer->zone_maps && !writer_reload_zone(writer, offset)) {
+        writer->zone_maps = false;
+        trace_writer_close(writer);
+        return false;
+    }
+
+    // The last row on disk was encoded from last_state; encoding it again
+    // into the scratch buffer restores the encoder's previous-row table.
+    if (rows_written > 0U) {
+        mpz_srcptr components[TRACE_COMPONENT_COUNT];
+        trace_state_components(last_state, components);
+        trace_encode_row(&writer->encoder, &writer->row_buffer, 0U, 0, 'E', 0U,
+                         last_state->koppa_sample_index, last_state->koppa_stack_size,
+                         components);
+        trace_buffer_reset(&writer->row_buffer);
+        writer->encoder.literal_count = 0U;
+        writer->encoder.reference_count = 0U;
+    }
+    return true;
+}
+
+bool trace_writer_close(TraceWriter *writer) {
+    if (!writer->file) {
+        return true;
+    }
+    bool ok = writer_flush_zone(writer) && !ferror(writer->file);
+    if (fclose(writer->file) != 0) {
+        ok = false;
+    }
+    writer->file = NULL;
+    trace_encoder_clear(&writer->encoder);
+    trace_buffer_clear(&writer->row_buffer);
+    return ok;
+}
+
+static bool writer_append_components(TraceWriter *writer, size_t tick, int microtick,
+                                     char phase, unsigned int flags, int koppa_sample_index,
+                                     size_t koppa_stack_size,
+                                     mpz_srcptr const components[TRACE_COMPONENT_COUNT]) {
+    // Blocks start with a self-contained row.
+    if (writer->zone_maps && writer->zone.rows == 0U) {
+        trace_encoder_reset(&writer->encoder);
+    }
+    trace_buffer_reset(&writer->row_buffer);
+    if (!trace_encode_row(&writer->encoder, &writer->row_buffer, tick, microtick, phase, flags,
+                          koppa_sample_index, koppa_stack_size, components)) {
+        return false;
+    }
+    if (!trace_write_record(writer->file, writer->row_buffer.data, writer->row_buffer.size)) {
+        return false;
+    }
+    size_t record_bytes = writer->row_buffer.size + varint_length(writer->row_buffer.size);
+    writer->rows_written += 1U;
+    writer->bytes_written += record_bytes;
+    if (writer->zone_maps) {
+        trace_zone_add_row(&writer->zone, tick, flags, components);
+        writer->zone.bytes += record_bytes;
+        if (writer->zone.rows >= TRACE_ZONE_BLOCK_ROWS) {
+            return writer_flush_zone(writer);
+        }
+    }
+    return true;
+}
+
+bool trace_writer_append(TraceWriter *writer, size_t tick, int microtick, char phase,
+                         const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
+                         bool forced_emission) {
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    trace_state_components(state, components);
+    unsigned int flags = trace_flags_from_state(state, rho_event, psi_fired, mu_zero,
+                                                forced_emission);
+    return writer_append_components(writer, tick, microtick, phase, flags,
+                                    state->koppa_sample_index, state->koppa_stack_size,
+                                    components);
+}
+
+bool trace_writer_append_row(TraceWriter *writer, const TraceRow *row) {
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        components[i] = row->components[i];
+    }
+    return writer_append_components(writer, row->tick, row->microtick, row->phase, row->flags,
+                                    row->koppa_sample_index, row->koppa_stack_size,
+                                    components);
+}
+
+bool trace_reader_open(TraceReader *reader, const char *path) {
+    reader->file = fopen(path, "rb");
+    if (!reader->file) {
+        return false;
+    }
+    unsigned int flags = 0U;
+    if (!read_header(reader->file, &flags)) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return false;
+    }
+    reader->cross_row = (flags & TRACE_HEADER_CROSS_ROW) != 0U;
+    reader->zone_maps = (flags & TRACE_HEADER_ZONE_MAPS) != 0U;
+    trace_row_init(&reader->rows[0]);
+    trace_row_init(&reader->rows[1]);
+    reader->current = 0;
+    reader->have_previous = false;
+    reader->error = false;
+    trace_buffer_init(&reader->row_buffer);
+    return true;
+}
+
+void trace_reader_close(TraceReader *reader) {
+    if (!reader->file) {
+        return;
+    }
+    fclose(reader->file);
+    reader->file = NULL;
+    trace_row_clear(&reader->rows[0]);
+    trace_row_clear(&reader->rows[1]);
+    trace_buffer_clear(&reader->row_buffer);
+}
+
+bool trace_reader_next(TraceReader *reader, const TraceRow **row) {
+    if (reader->error) {
+        return false;
+    }
+    uint64_t size = 0U;
+    do {
+        // End of file is only clean on a record boundary.
+        int first = getc(reader->file);
+        if (first == EOF) {
+            reader->error = ferror(reader->file) != 0;
+            return false;
+        }
+        ungetc(first, reader->file);
+
+        trace_buffer_reset(&reader->row_buffer);
+        if (!read_varint(reader->file, &size)) {
+            reader->error = true;
+            return false;
+        }
+        // Zone maps are only of use to trace_index_load().
+        if (size == 0U && (!reader->zone_maps ||
+                           fseeko(reader->file, (off_t)TRACE_ZONE_SIZE, SEEK_CUR) != 0)) {
+            reader->error = true;
+            return false;
+        }
+    } while (size == 0U);
+    if (!trace_buffer_reserve(&reader->row_buffer, (size_t)size) ||
+        fread(reader->row_buffer.data, 1, (size_t)size, reader->file) != (size_t)size) {
+        reader->error = true;
+        return false;
+    }
+    // A trace written without cross-row references must not contain any;
+    // decoding without a previous row rejects them.
+    int next = 1 - reader->current;
+    const TraceRow *previous =
+        (reader->cross_row && reader->have_previous) ? &reader->rows[reader->current] : NULL;
+    if (!trace_decode_row(reader->row_buffer.data, (size_t)size, previous,
+                          &reader->rows[next])) {
+        reader->error = true;
+        return false;
+    }
+    reader->current = next;
+    reader->have_previous = true;
+    *row = &reader->rows[next];
+    return true;
+}
+
+bool trace_reader_error(const TraceReader *reader) {
+    return reader->error;
+}
+
+/* ===========================================================
+   CSV rendering
+   =========================================================== */
+
+void trace_row_write_events_csv(FILE *file, const TraceRow *row) {
+    unsigned int flags = row->flags;
+    fprintf(file, "%zu,%d,%c,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", row->tick, row->microtick,
+            row->phase, (flags & TRACE_FLAG_RHO_EVENT) ? 1 : 0,
+            (flags & TRACE_FLAG_PSI_FIRED) ? 1 : 0, (flags & TRACE_FLAG_MU_ZERO) ? 1 : 0,
+            (flags & TRACE_FLAG_FORCED_EMISSION) ? 1 : 0,
+            (flags & TRACE_FLAG_RATIO_TRIGGERED) ? 1 : 0, (flags & TRACE_FLAG_TRIPLE_PSI) ? 1 : 0,
+            (flags & TRACE_FLAG_DUAL_ENGINE) ? 1 : 0, row->koppa_sample_index,
+            (flags & TRACE_FLAG_RATIO_THRESHOLD) ? 1 : 0,
+            (flags & TRACE_FLAG_PSI_STRENGTH) ? 1 : 0, (flags & TRACE_FLAG_SIGN_FLIP) ? 1 : 0);
+}
+
+void trace_write_values_columns(FILE *file, size_t tick, int microtick, size_t koppa_stack_size,
+                                mpz_srcptr const components[TRACE_COMPONENT_COUNT], int radix) {
+    // values.csv places koppa_stack_size between the stack slots and the deltas.
+    fprintf(file, "%zu,%d", tick, microtick);
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        if (i == 20U) {
+            fprintf(file, ",%zu", koppa_stack_size);
+        }
+        if (radix == 10) {
+            gmp_fprintf(file, ",%Zd", components[i]);
+        } else {
+            // Power-of-two radices convert in linear time.
+            fputc(',', file);
+            mpz_out_str(file, radix, components[i]);
+        }
+    }
+    fputc('\n', file);
+}
+
+void trace_row_write_values_csv(FILE *file, const TraceRow *row, int radix) {
+    mpz_srcptr components[TRACE_COMPONENT_COUNT];
+    for (size_t i = 0; i < TRACE_COMPONENT_COUNT; ++i) {
+        components[i] = row->components[i];
+    }
+    trace_write_values_columns(file, row->tick, row->microtick, row->koppa_stack_size,
+                               components, radix);
+}
@@ -0,0 +1,249 @@
+// trace.h
+// Compact binary microtick traces.  A trace row carries the same columns as
+// events.csv and values.csv, but components are written as raw limbs and any
+// component that exactly equals another component of the same row or of the
+// previous row is written as a one-byte back-reference instead.  Readers
+// resolve the references, so callers always see fully materialised rows.
+//
+// Traces written by TraceWriter are cut into blocks of TRACE_ZONE_BLOCK_ROWS
+// rows.  The first row of a block never refers to the previous row, so
+// blocks decode independently, and each block is followed by a zone map: a
+// zero-length record and a fixed-size summary of the block (bit lengths and
+// signs of every component, υ/β ratio bounds, flag unions, tick range).
+// Row readers skip the zone maps; trts_query uses them to skip whole blocks.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <gmp.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "state.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Components in values.csv column order: upsilon, beta, koppa, koppa_sample,
+// previous_upsilon, previous_beta, koppa_stack[0..3], delta_upsilon,
+// delta_beta and the three triangle ratios, each as numerator/denominator.
+#define TRACE_COMPONENT_COUNT 30
+
+// Version 2 traces carry zone maps; version 1 traces are still read.
+#define TRACE_FORMAT_VERSION 2
+
+#define TRACE_ZONE_BLOCK_ROWS 4096U
+
+// Event flags packed into each row.  The first four mirror the observer
+// arguments, the remainder mirror the per-microtick state flags that are
+// written to events.csv.
+typedef enum {
+    TRACE_FLAG_RHO_EVENT = 1u << 0,
+    TRACE_FLAG_PSI_FIRED = 1u << 1,
+    TRACE_FLAG_MU_ZERO = 1u << 2,
+    TRACE_FLAG_FORCED_EMISSION = 1u << 3,
+    TRACE_FLAG_RATIO_TRIGGERED = 1u << 4,
+    TRACE_FLAG_TRIPLE_PSI = 1u << 5,
+    TRACE_FLAG_DUAL_ENGINE = 1u << 6,
+    TRACE_FLAG_RATIO_THRESHOLD = 1u << 7,
+    TRACE_FLAG_PSI_STRENGTH = 1u << 8,
+    TRACE_FLAG_SIGN_FLIP = 1u << 9
+} TraceFlag;
+
+typedef struct {
+    unsigned char *data;
+    size_t size;
+    size_t capacity;
+} TraceBuffer;
+
+// Sign sets of a zone map.
+enum {
+    TRACE_ZONE_NEGATIVE = 1u << 0,
+    TRACE_ZONE_ZERO = 1u << 1,
+    TRACE_ZONE_POSITIVE = 1u << 2
+};
+
+// Summary of one block of rows.  Bounds hold for every row of the block;
+// bit lengths are mpz_sizeinbase(|c|, 2), 0 for zero.  The υ/β bounds are
+// conservative doubles over the rows where the ratio is defined.
+typedef struct {
+    uint64_t rows;
+    uint64_t bytes;                 // row records of the block, length prefixes included
+    uint64_t first_tick;
+    uint64_t last_tick;
+    unsigned int flags_any;
+    unsigned int flags_all;
+    uint32_t min_bits[TRACE_COMPONENT_COUNT];
+    uint32_t max_bits[TRACE_COMPONENT_COUNT];
+    unsigned char signs[TRACE_COMPONENT_COUNT];
+    unsigned char first_sign[TRACE_COMPONENT_COUNT];   // single TRACE_ZONE_* bit
+    unsigned char last_sign[TRACE_COMPONENT_COUNT];
+    bool ratio_defined;             // some row has υd, βn and βd non-zero
+    bool ratio_undefined;           // some row has not
+    double ratio_lower;
+    double ratio_upper;
+} TraceZoneMap;
+
+// A block of a trace file and the zone map it is covered by.  Rows written
+// after the last zone map, e.g. by a run that did not finish, and whole
+// version 1 traces form a block with indexed false, which can never be
+// skipped.
+typedef struct {
+    uint64_t offset;
+    bool indexed;
+    TraceZoneMap zone;
+} TraceBlock;
+
+typedef struct {
+    bool cross_row;
+    TraceBlock *blocks;
+    size_t count;
+    uint64_t trailing_bytes;        // incomplete last record of a cut trace
+} TraceIndex;
+
+typedef struct {
+    size_t tick;
+    int microtick;
+    char phase;
+    unsigned int flags;
+    int koppa_sample_index;
+    size_t koppa_stack_size;
+    mpz_t components[TRACE_COMPONENT_COUNT];
+} TraceRow;
+
+// Row encoder.  When cross_row is false every row is self-contained, which
+// is what ring buffers and random-access consumers need.
+typedef struct {
+    bool cross_row;
+    bool have_previous;
+    mpz_t previous[TRACE_COMPONENT_COUNT];
+    uint64_t previous_hash[TRACE_COMPONENT_COUNT];
+    size_t literal_count;
+    size_t reference_count;
+} TraceEncoder;
+
+typedef struct {
+    FILE *file;
+    TraceEncoder encoder;
+    TraceBuffer row_buffer;
+    size_t rows_written;
+    size_t bytes_written;
+    // Zone map of the block being written.  Traces resumed from a version 1
+    // file carry on without zone maps.
+    bool zone_maps;
+    TraceZoneMap zone;
+} TraceWriter;
+
+typedef struct {
+    FILE *file;
+    bool cross_row;
+    bool zone_maps;
+    TraceRow rows[2];
+    int current;
+    bool have_previous;
+    bool error;
+    TraceBuffer row_buffer;
+} TraceReader;
+
+void trace_buffer_init(TraceBuffer *buffer);
+void trace_buffer_clear(TraceBuffer *buffer);
+void trace_buffer_reset(TraceBuffer *buffer);
+bool trace_buffer_append(TraceBuffer *buffer, const void *data, size_t size);
+// Make room for extra more bytes after buffer->size.
+bool trace_buffer_reserve(TraceBuffer *buffer, size_t extra);
+
+void trace_row_init(TraceRow *row);
+void trace_row_clear(TraceRow *row);
+void trace_row_copy(TraceRow *dest, const TraceRow *src);
+
+// Collect the observer arguments and state flags into a TraceFlag mask.
+unsigned int trace_flags_from_state(const TRTS_State *state, bool rho_event, bool psi_fired,
+                                    bool mu_zero, bool forced_emission);
+
+// Point components[] at the live state fields in values.csv column order.
+void trace_state_components(const TRTS_State *state, mpz_srcptr components[TRACE_COMPONENT_COUNT]);
+
+// values.csv column name of component index ("upsilon_num", ...).
+const char *trace_component_name(size_t index);
+
+// Conservative double bounds [*lower, *upper] of (a·b)/(c·d), none of which
+// may be zero except a.  Magnitudes beyond 2^1000 widen to infinity and
+// below 2^-1000 to zero.
+void trace_quotient_bounds(mpz_srcptr a, mpz_srcptr b, mpz_srcptr c, mpz_srcptr d,
+                           double *lower, double *upper);
+
+void trace_zone_reset(TraceZoneMap *zone);
+// Fold one row into zone; rows and bytes are left to the caller.
+void trace_zone_add_row(TraceZoneMap *zone, size_t tick, unsigned int flags,
+                        mpz_srcptr const components[TRACE_COMPONENT_COUNT]);
+
+void trace_encoder_init(TraceEncoder *encoder, bool cross_row);
+void trace_encoder_clear(TraceEncoder *encoder);
+void trace_encoder_reset(TraceEncoder *encoder);
+
+// Append one encoded row (without its length prefix) to out.
+bool trace_encode_row(TraceEncoder *encoder, TraceBuffer *out, size_t tick, int microtick,
+                      char phase, unsigned int flags, int koppa_sample_index,
+                      size_t koppa_stack_size,
+                      mpz_srcptr const components[TRACE_COMPONENT_COUNT]);
+
+// Decode one row payload.  previous may be NULL when the payload is known to
+// be self-contained; a cross-row reference without a previous row fails.
+bool trace_decode_row(const unsigned char *data, size_t size, const TraceRow *previous,
+                      TraceRow *row);
+
+// Write the file header for a trace.  Used by the writer and by sinks that
+// dump self-contained rows.
+bool trace_write_header(FILE *file, bool cross_row);
+bool trace_write_record(FILE *file, const unsigned char *payload, size_t size);
+
+bool trace_writer_open(TraceWriter *writer, const char *path);
+// Reopen a cross-row trace that was cut at a checkpoint: truncate it to
+// offset and continue after the row that was encoded from last_state.
+bool trace_writer_resume(TraceWriter *writer, const char *path, uint64_t offset,
+                         uint64_t rows_written, const TRTS_State *last_state);
+// Returns false if any buffered write or the final flush failed.
+bool trace_writer_close(TraceWriter *writer);
+bool trace_writer_append(TraceWriter *writer, size_t tick, int microtick, char phase,
+                         const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
+                         bool forced_emission);
+// Append an already materialised row, e.g. one read back from another trace.
+bool trace_writer_append_row(TraceWriter *writer, const TraceRow *row);
+
+bool trace_reader_open(TraceReader *reader, const char *path);
+void trace_reader_close(TraceReader *reader);
+// Returns true and points *row at the next fully resolved row, or false at
+// end of file or on a truncated or malformed record; trace_reader_error
+// tells the two apart.  The row stays valid until the following call.
+bool trace_reader_next(TraceReader *reader, const TraceRow **row);
+bool trace_reader_error(const TraceReader *reader);
+
+// Locate the blocks of a trace.  The zone maps are found by walking back
+// from the end of the file, so no row is read; traces that do not end on a
+// zone map are scanned record by record instead.
+bool trace_index_load(const char *path, TraceIndex *index);
+void trace_index_clear(TraceIndex *index);
+
+// Decode the next record of a block held in memory into row, advancing
+// *cursor past it.  previous is the row before, NULL at the start of a
+// block.  Returns false at the end of the data or on a malformed record.
+bool trace_block_next(const unsigned char **cursor, const unsigned char *end,
+                      const TraceRow *previous, TraceRow *row);
+
+// Render a row in the column layout of events.csv / values.csv.  radix is
+// the values_radix of the run (see config.h).
+void trace_row_write_events_csv(FILE *file, const TraceRow *row);
+void trace_row_write_values_csv(FILE *file, const TraceRow *row, int radix);
+
+// Write one values.csv line from components in values.csv column order.
+void trace_write_values_columns(FILE *file, size_t tick, int microtick, size_t koppa_stack_size,
+                                mpz_srcptr const components[TRACE_COMPONENT_COUNT], int radix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulate.h"
+#include "trace.h"
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s <trace> [--events <path>] [--values <path>] [--radix <n>] [--stats]\n"
+            "Renders a binary trace as events.csv / values.csv.  With no output\n"
+            "options the values table is written to stdout.  --radix writes the\n"
+            "values components in a power of two up to 32 (default 10).\n",
+            program);
+}
+
+static FILE *open_output(const char *path) {
+    if (!path) {
+        return NULL;
+    }
+    if (strcmp(path, "-") == 0) {
+        return stdout;
+    }
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        perror(path);
+    }
+    return file;
+}
+
+int main(int argc, char **argv) {
+    const char *trace_path = NULL;
+    const char *events_path = NULL;
+    const char *values_path = NULL;
+    bool stats = false;
+    int radix = 10;
+
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (strcmp(argv[i], "--values") == 0 && i + 1 < argc) {
+            values_path = argv[++i];
+        } else if (strcmp(argv[i], "--radix") == 0 && i + 1 < argc) {
+            radix = atoi(argv[++i]);
+            if (!config_values_radix_supported(radix)) {
+                fprintf(stderr, "--radix must be 10 or a power of two up to 32\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+            usage(argv[0]);
+            return EXIT_SUCCESS;
+        } else if (!trace_path) {
+            trace_path = argv[i];
+        } else {
+            usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (!trace_path) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (!events_path && !values_path && !stats) {
+        values_path = "-";
+    }
+
+    TraceReader reader;
+    if (!trace_reader_open(&reader, trace_path)) {
+        fprintf(stderr, "Unable to open trace %s\n", trace_path);
+        return EXIT_FAILURE;
+    }
+
+    FILE *events_file = open_output(events_path);
+    FILE *values_file = open_output(values_path);
+    if ((events_path && !events_file) || (values_path && !values_file)) {
+        trace_reader_close(&reader);
+        return EXIT_FAILURE;
+    }
+    if (events_file) {
+        simulate_write_events_header(events_file);
+    }
+    if (values_file) {
+        simulate_write_values_header_radix(values_file, radix);
+    }
+
+    size_t rows = 0U;
+    const TraceRow *row = NULL;
+    while (trace_reader_next(&reader, &row)) {
+        if (events_file) {
+            trace_row_write_events_csv(events_file, row);
+        }
+        if (values_file) {
+            trace_row_write_values_csv(values_file, row, radix);
+        }
+        ++rows;
+    }
+    bool ok = !trace_reader_error(&reader);
+    if (!ok) {
+        fprintf(stderr, "%s: truncated or corrupt trace after %zu rows\n", trace_path, rows);
+    }
+
+    if (stats) {
+        long size = ftell(reader.file);
+        fprintf(stderr, "%zu rows, %ld bytes, %.1f bytes/row\n", rows, size,
+                rows ? (double)size / (double)rows : 0.0);
+    }
+
+    if (events_file && events_file != stdout && fclose(events_file) != 0) {
+        perror(events_path);
+        ok = false;
+    }
+    if (values_file && values_file != stdout && fclose(values_file) != 0) {
+        perror(values_path);
+        ok = false;
+    }
+    trace_reader_close(&reader);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
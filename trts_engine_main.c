@@ -5,10 +5,14 @@
 #include <gmp.h>
 
 #include "config_loader.h"
+#include "flight_recorder.h"
 #include "simulate.h"
 
 typedef struct {
     const Config *config;
+    FlightRecorder *flight;
+    // Suppresses the per-microtick stdout protocol (batch and scheduled runs).
+    bool quiet;
 } ObserverContext;
 
 static const char *psi_mode_label(PsiMode mode) {
@@ -74,6 +78,13 @@ static void gui_observer(void *user_data, size_t tick, int microtick, char phase
                          const TRTS_State *state, bool rho_event, bool psi_fired, bool mu_zero,
                          bool forced_emission) {
     const ObserverContext *context = (const ObserverContext *)user_data;
+    if (context && context->flight) {
+        flight_recorder_record(context->flight, tick, microtick, phase, state, rho_event,
+                               psi_fired, mu_zero, forced_emission);
+    }
+    if (context && context->quiet) {
+        return;
+    }
 
     char upsilon_buffer[256];
     char beta_buffer[256];
@@ -151,11 +162,41 @@ static void gui_observer(void *user_data, size_t tick, int microtick, char phase
 }
 
 static void usage(const char *program) {
-    fprintf(stderr, "Usage: %s --config <path>\n", program);
+    fprintf(stderr,
+            "Usage: %s --config <path> [--trace <path>] [--events <path>] [--values <path>]\n"
+            "          [--values-radix <n>] [--compaction-interval <ticks>] [--quiet]\n"
+            "          [--checkpoint <path> [--resume]]\n"
+            "          [--flight-recorder <prefix> [--flight-depth <rows>]\n"
+            "           [--flight-budget <bytes>] [--flight-post <rows>]\n"
+            "           [--flight-trigger triple_psi,mu_zero,recurrence|none]]\n"
+            "The flight recorder keeps the last <rows> microticks in memory and\n"
+            "dumps them as a binary trace on SIGUSR1, on the first occurrence of\n"
+            "each trigger and at the end of the run.\n"
+            "With --checkpoint, SIGUSR2 or SIGTERM stops the run at the next\n"
+            "microtick boundary after writing an exact checkpoint (exit status 75);\n"
+            "--resume continues it with byte-identical outputs.\n"
+            "--compaction-interval right-sizes over-allocated state integers every\n"
+            "<ticks> ticks (0 = never); the reclaimed bytes are reported on stderr.\n"
+            "--quiet drops the per-microtick status lines on stdout.\n",
+            program);
 }
 
 int main(int argc, char **argv) {
     const char *config_path = NULL;
+    const char *trace_path = NULL;
+    const char *events_path = NULL;
+    const char *values_path = NULL;
+    const char *checkpoint_path = NULL;
+    bool resume = false;
+    bool quiet = false;
+    int values_radix = 0;
+    const char *compaction_text = NULL;
+    const char *flight_prefix = NULL;
+    size_t flight_depth = 4096U;
+    size_t flight_budget = 0U;
+    size_t flight_post = 0U;
+    unsigned int flight_triggers =
+        FLIGHT_TRIGGER_TRIPLE_PSI | FLIGHT_TRIGGER_MU_ZERO | FLIGHT_TRIGGER_RECURRENCE;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--config") == 0) {
@@ -164,6 +205,43 @@ int main(int argc, char **argv) {
                 return EXIT_FAILURE;
             }
             config_path = argv[++i];
+        } else if (strcmp(argv[i], "--trace") == 0) {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                return EXIT_FAILURE;
+            }
+            trace_path = argv[++i];
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            events_path = argv[++i];
+        } else if (strcmp(argv[i], "--values") == 0 && i + 1 < argc) {
+            values_path = argv[++i];
+        } else if (strcmp(argv[i], "--values-radix") == 0 && i + 1 < argc) {
+            values_radix = atoi(argv[++i]);
+            if (!config_values_radix_supported(values_radix)) {
+                fprintf(stderr, "--values-radix must be 10 or a power of two up to 32\n");
+                return EXIT_FAILURE;
+            }
+        } else if (strcmp(argv[i], "--compaction-interval") == 0 && i + 1 < argc) {
+            compaction_text = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--resume") == 0) {
+            resume = true;
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            quiet = true;
+        } else if (strcmp(argv[i], "--flight-recorder") == 0 && i + 1 < argc) {
+            flight_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--flight-depth") == 0 && i + 1 < argc) {
+            flight_depth = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--flight-budget") == 0 && i + 1 < argc) {
+            flight_budget = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--flight-post") == 0 && i + 1 < argc) {
+            flight_post = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--flight-trigger") == 0 && i + 1 < argc) {
+            if (!flight_recorder_parse_triggers(argv[++i], &flight_triggers)) {
+                fprintf(stderr, "Unknown flight trigger list: %s\n", argv[i]);
+                return EXIT_FAILURE;
+            }
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             usage(argv[0]);
             return EXIT_SUCCESS;
@@ -174,7 +252,7 @@ int main(int argc, char **argv) {
         }
     }
 
-    if (!config_path) {
+    if (!config_path || (resume && !checkpoint_path)) {
         usage(argv[0]);
         return EXIT_FAILURE;
     }
@@ -189,10 +267,57 @@ int main(int argc, char **argv) {
         config_clear(&config);
         return EXIT_FAILURE;
     }
+    if (values_radix != 0) {
+        config.values_radix = values_radix;
+    }
+    if (compaction_text) {
+        config.compaction_interval = (size_t)strtoull(compaction_text, NULL, 10);
+    }
+
+    ObserverContext context = {&config, NULL, quiet};
 
-    ObserverContext context = {&config};
-    simulate_stream(&config, gui_observer, &context);
+    FlightRecorder flight_recorder;
+    if (flight_prefix) {
+        if (!flight_recorder_init(&flight_recorder, flight_depth, flight_budget, flight_triggers,
+                                  flight_prefix)) {
+            fprintf(stderr, "Invalid flight recorder depth\n");
+            config_clear(&config);
+            return EXIT_FAILURE;
+        }
+        flight_recorder_set_post_trigger(&flight_recorder, flight_post);
+        flight_recorder_install_signal_handler();
+        context.flight = &flight_recorder;
+    }
 
+    if (checkpoint_path) {
+        simulate_install_preemption_handler();
+    }
+
+    StateCompaction compaction;
+    state_compaction_init(&compaction);
+    SimulateFiles files = {events_path, values_path, trace_path, NULL, &compaction};
+    SimulateObserver observer = (quiet && !context.flight) ? NULL : gui_observer;
+    SimulateStatus status =
+        simulate_resumable(&config, &files, observer, &context, checkpoint_path, resume);
+
+    if (context.flight) {
+        flight_recorder_finish(context.flight);
+        flight_recorder_clear(context.flight);
+    }
+    if (!quiet && compaction.passes > 0U) {
+        fprintf(stderr, "Limb compaction: %zu passes, %zu integers resized, %zu bytes reclaimed\n",
+                compaction.passes, compaction.resized, compaction.reclaimed_bytes);
+    }
     config_clear(&config);
-    return EXIT_SUCCESS;
+    switch (status) {
+    case SIMULATE_COMPLETED:
+        return EXIT_SUCCESS;
+    case SIMULATE_PREEMPTED:
+        fprintf(stderr, "Preempted; checkpoint written to %s\n", checkpoint_path);
+        return 75;
+    case SIMULATE_FAILED:
+    case SIMULATE_STOPPED:
+        break;
+    }
+    return EXIT_FAILURE;
 }
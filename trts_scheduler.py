@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""Priority scheduler for trts_engine jobs with checkpoint-based preemption.
+
+Each job is a JSON file::
+
+    {"name": "growth-a", "config": "configs/growth.json", "priority": 0}
+
+and runs ``trts_engine --quiet --config ... --checkpoint <dir>/checkpoint.bin``
+with its events, values and trace written to ``<output>/<name>/`` and the
+engine's diagnostics appended to ``<output>/<name>/engine.log``.  When a job
+with a higher priority is waiting and every slot is busy, the lowest
+priority running job receives SIGUSR2: it finishes its current microtick,
+writes an exact checkpoint and exits with status 75.  It is then queued
+again and later continues with ``--resume``, producing the same bytes as an
+uninterrupted run.
+
+A job directory holds everything needed to continue elsewhere, so a
+preempted job migrates by copying its directory to another host and
+submitting it there with ``"resume": true``.
+
+Batch mode runs the given job files and exits.  With ``--spool DIR`` the
+scheduler runs as a daemon and picks up job files dropped into DIR.
+"""
+
+import argparse
+import heapq
+import itertools
+import json
+import os
+import signal
+import subprocess
+import sys
+import time
+from dataclasses import dataclass, field
+from pathlib import Path
+from typing import Dict, List, Optional
+
+EXIT_PREEMPTED = 75
+DEFAULT_ENGINE = Path("./build/trts_engine")
+
+
+@dataclass
+class Job:
+    name: str
+    config: Path
+    priority: int
+    directory: Path
+    resume: bool = False
+    preemptions: int = 0
+    process: Optional[subprocess.Popen] = field(default=None, repr=False)
+    preempting: bool = False
+
+    @property
+    def checkpoint(self) -> Path:
+        return self.directory / "checkpoint.bin"
+
+    @property
+    def log(self) -> Path:
+        return self.directory / "engine.log"
+
+    def command(self, engine: Path) -> List[str]:
+        cmd = [
+            str(engine),
+            "--quiet",
+            "--config",
+            str(self.config),
+            "--events",
+            str(self.directory / "events.csv"),
+            "--values",
+            str(self.directory / "values.csv"),
+            "--trace",
+            str(self.directory / "trace.bin"),
+            "--checkpoint",
+            str(self.checkpoint),
+        ]
+        if self.resume:
+            cmd.append("--resume")
+        return cmd
+
+    def write_state(self, status: str) -> None:
+        """Record the job status next to its outputs for later migration."""
+        payload = {
+            "name": self.name,
+            "config": str(self.config),
+            "priority": self.priority,
+            "status": status,
+            "resume": self.resume,
+            "preemptions": self.preemptions,
+        }
+        with open(self.directory / "job.json", "w", encoding="utf-8") as handle:
+            json.dump(payload, handle, indent=2)
+
+
+def load_job(path: Path, output_dir: Path) -> Job:
+    """Parse a job file; relative config paths are resolved against it."""
+    with open(path, "r", encoding="utf-8") as handle:
+        spec = json.load(handle)
+    config = Path(spec["config"])
+    if not config.is_absolute():
+        config = (path.parent / config).resolve()
+    name = spec.get("name", path.stem)
+    directory = Path(spec.get("directory", output_dir / name))
+    directory.mkdir(parents=True, exist_ok=True)
+    resume = bool(spec.get("resume", False)) and (directory / "checkpoint.bin").exists()
+    return Job(name, config, int(spec.get("priority", 0)), directory, resume)
+
+
+class Scheduler:
+    def __init__(self, engine: Path, slots: int) -> None:
+        self.engine = engine
+        self.slots = slots
+        self.queue: List = []
+        self.running: Dict[int, Job] = {}
+        self.counter = itertools.count()
+        self.finished: List[Job] = []
+        self.failed: List[Job] = []
+
+    def submit(self, job: Job) -> None:
+        # Highest priority first; FIFO among equal priorities.
+        heapq.heappush(self.queue, (-job.priority, next(self.counter), job))
+        job.write_state("queued")
+
+    def _start(self, job: Job) -> None:
+        # stderr goes to a file rather than a pipe: nothing drains a pipe
+        # while the engine runs, so a chatty engine would block on it.
+        mode = "ab" if job.resume else "wb"
+        with open(job.log, mode) as log:
+            job.process = subprocess.Popen(job.command(self.engine),
+                                           stdout=subprocess.DEVNULL, stderr=log)
+        job.preempting = False
+        self.running[job.process.pid] = job
+        job.write_state("running")
+        print(f"start   {job.name} (priority {job.priority}{', resume' if job.resume else ''})")
+
+    def _harvest(self) -> None:
+        for pid, job in list(self.running.items()):
+            code = job.process.poll()
+            if code is None:
+                continue
+            del self.running[pid]
+            if code == 0:
+                job.write_state("done")
+                self.finished.append(job)
+                print(f"done    {job.name}")
+            elif code == EXIT_PREEMPTED:
+                job.resume = True
+                job.preemptions += 1
+                print(f"preempt {job.name} (checkpoint {job.checkpoint})")
+                self.submit(job)
+            else:
+                job.write_state("failed")
+                self.failed.append(job)
+                print(f"failed  {job.name} (exit {code}) {self._log_tail(job)}")
+
+    @staticmethod
+    def _log_tail(job: Job, lines: int = 5) -> str:
+        try:
+            with open(job.log, "r", encoding="utf-8", errors="replace") as handle:
+                return " | ".join(line.strip() for line in handle.readlines()[-lines:])
+        except OSError:
+            return ""
+
+    def _preempt_for_waiting(self) -> None:
+        if not self.queue or len(self.running) < self.slots:
+            return
+        if any(job.preempting for job in self.running.values()):
+            return
+        waiting_priority = -self.queue[0][0]
+        victim = min(self.running.values(), key=lambda job: job.priority)
+        if victim.priority < waiting_priority:
+            victim.preempting = True
+            victim.process.send_signal(signal.SIGUSR2)
+
+    def step(self) -> None:
+        self._harvest()
+        while self.queue and len(self.running) < self.slots:
+            _, _, job = heapq.heappop(self.queue)
+            self._start(job)
+        self._preempt_for_waiting()
+
+    def idle(self) -> bool:
+        return not self.queue and not self.running
+
+    def shutdown(self) -> None:
+        """Checkpoint every running job so the fleet can be drained."""
+        for job in self.running.values():
+            job.process.send_signal(signal.SIGUSR2)
+        while self.running:
+            self._harvest()
+            time.sleep(0.1)
+
+
+def scan_spool(spool: Path, output_dir: Path, scheduler: Scheduler) -> None:
+    accepted = spool / "accepted"
+    accepted.mkdir(exist_ok=True)
+    for path in sorted(spool.glob("*.json")):
+        try:
+            job = load_job(path, output_dir)
+        except (OSError, KeyError, ValueError, json.JSONDecodeError) as exc:
+            print(f"reject  {path.name}: {exc}", file=sys.stderr)
+            path.rename(spool / f"{path.name}.rejected")
+            continue
+        path.rename(accepted / path.name)
+        scheduler.submit(job)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("jobs", nargs="*", type=Path, help="job files to run in batch mode")
+    parser.add_argument("--engine", type=Path, default=DEFAULT_ENGINE)
+    parser.add_argument("--slots", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("--output", type=Path, default=Path("scheduler_output"))
+    parser.add_argument("--spool", type=Path, help="run as a daemon watching this directory")
+    parser.add_argument("--poll", type=float, default=0.5, help="poll interval in seconds")
+    args = parser.parse_args()
+
+    if not args.engine.exists():
+        raise FileNotFoundError(f"trts_engine not found at {args.engine}")
+
+    scheduler = Scheduler(args.engine, max(1, args.slots))
+    for path in args.jobs:
+        scheduler.submit(load_job(path, args.output))
+
+    stop = False
+
+    def request_stop(signum, frame):  # pragma: no cover - signal handler
+        nonlocal stop
+        stop = True
+
+    signal.signal(signal.SIGINT, request_stop)
+    signal.signal(signal.SIGTERM, request_stop)
+
+    while not stop:
+        if args.spool:
+            scan_spool(args.spool, args.output, scheduler)
+        scheduler.step()
+        if not args.spool and scheduler.idle():
+            break
+        time.sleep(args.poll)
+
+    if stop:
+        scheduler.shutdown()
+
+    print(f"\nFinished: {len(scheduler.finished)}  Failed: {len(scheduler.failed)}  "
+          f"Queued: {len(scheduler.queue)}")
+
+
+if __name__ == "__main__":
+    main()
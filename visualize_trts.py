@@ -81,6 +81,14 @@ def load_values(values_csv: Path) -> List[DataRow]:
 
     rows: List[DataRow] = []
     with values_csv.open("r", encoding="utf-8") as handle:
+        # Components may be written in another radix, announced by a
+        # leading "#radix=N" line; tick and mt are always decimal.
+        radix = 10
+        first = handle.readline()
+        if first.startswith("#radix="):
+            radix = int(first[len("#radix="):])
+        else:
+            handle.seek(0)
         reader = csv.DictReader(handle)
         missing = required_columns - set(reader.fieldnames or [])
         if missing:
@@ -88,7 +96,7 @@ def load_values(values_csv: Path) -> List[DataRow]:
         for raw in reader:
             row = DataRow({})
             for key in required_columns:
-                row[key] = int(raw[key])
+                row[key] = int(raw[key], 10 if key in ("tick", "mt") else radix)
             row["tick_mt"] = row["tick"] + row["mt"] / 10.0
             row["upsilon_float"] = _safe_divide(row["upsilon_num"], row["upsilon_den"])
             row["beta_float"] = _safe_divide(row["beta_num"], row["beta_den"])